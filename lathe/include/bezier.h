@@ -0,0 +1,163 @@
+#ifndef BEZIER_H
+#define BEZIER_H
+
+// 三次bezier曲线光栅化到工件轮廓
+// 原来按固定的t步长1/Y_SEGMENTS用pow()取点，每个点只切它落进的那一个格子：走得快的地方跳过格子，走得慢的地方一个格子切好几次
+// 现在先按Wang的公式算出折线要几段才能保证离曲线不超过BEZIER_TOLERANCE（曲线越弯段数越多），
+// 再用幂基的Horner形式（不用pow）一次算4个点（SSE2；evaluate_scalar()是逐点的参考实现，两者逐位一致）
+// 折线是连续的，按它切（polyline_cut()）或求每个格子里的最低点（bezier_rasterize()）都不会漏掉曲线x范围里的任何一个格子
+// 同样不依赖glad/GLFW
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LATHE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+const float BEZIER_TOLERANCE = 2e-5f;//折线离曲线最远的距离（(-1,1)半截面坐标，半径方向0.25µm）
+const int BEZIER_MAX_SEGMENTS = 1 << 16;
+const float BEZIER_NONE = FLT_MAX;//bezier_rasterize()：曲线没经过的格子
+
+// a cubic in the (-1,1)x(-1,1) half-section space, kept in power basis: p(t) = ((a t + b) t + c) t + d
+class Bezier
+{
+public:
+    glm::vec2 a, b, c, d;
+    glm::vec2 end;//D，t = 1的点不用多项式算，首尾两点和控制点逐位相同
+
+    Bezier(glm::vec2 A, glm::vec2 B, glm::vec2 C, glm::vec2 D);
+
+    int segments(float tolerance = BEZIER_TOLERANCE) const;
+    glm::vec2 at(float t) const;
+    void evaluate(int n, glm::vec2* out) const;
+    void evaluate_scalar(int n, glm::vec2* out) const;
+    void flatten(std::vector<glm::vec2>& out, float tolerance = BEZIER_TOLERANCE) const;
+
+private:
+    float bend = 0.0f;//max |P(i) - 2P(i+1) + P(i+2)|，Wang的公式用
+};
+
+inline Bezier::Bezier(glm::vec2 A, glm::vec2 B, glm::vec2 C, glm::vec2 D)
+    : a(-A + 3.0f * B - 3.0f * C + D), b(3.0f * A - 6.0f * B + 3.0f * C), c(3.0f * (B - A)), d(A), end(D)
+{
+    bend = std::max(glm::length(A - 2.0f * B + C), glm::length(B - 2.0f * C + D));
+}
+
+// Wang's bound: n uniform steps in t keep every chord within tolerance of the cubic, n = sqrt(3·2/8 · bend / tolerance)
+inline int Bezier::segments(float tolerance) const
+{
+    double n = std::ceil(std::sqrt(0.75 * bend / std::max(tolerance, 1e-9f)));
+    return (int)std::max(1.0, std::min((double)BEZIER_MAX_SEGMENTS, n));
+}
+
+inline glm::vec2 Bezier::at(float t) const
+{
+    return ((a * t + b) * t + c) * t + d;
+}
+
+// the n + 1 points at t = i / n into out
+inline void Bezier::evaluate(int n, glm::vec2* out) const
+{
+#ifdef LATHE_SSE2
+    const float step = 1.0f / n;
+    const __m128 vstep = _mm_set1_ps(step);
+    const __m128 ax = _mm_set1_ps(a.x), bx = _mm_set1_ps(b.x), cx = _mm_set1_ps(c.x), dx = _mm_set1_ps(d.x);
+    const __m128 ay = _mm_set1_ps(a.y), by = _mm_set1_ps(b.y), cy = _mm_set1_ps(c.y), dy = _mm_set1_ps(d.y);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i four = _mm_set1_epi32(4);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(index), vstep);
+        __m128 x = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(ax, t), bx), t), cx), t), dx);
+        __m128 y = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(ay, t), by), t), cy), t), dy);
+        _mm_storeu_ps(&out[i].x, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(&out[i + 2].x, _mm_unpacklo_ps(_mm_movehl_ps(x, x), _mm_movehl_ps(y, y)));
+        index = _mm_add_epi32(index, four);
+    }
+    for (; i < n; i++)
+    {
+        out[i] = at((float)i * step);
+    }
+    out[0] = d;
+    out[n] = end;
+#else
+    evaluate_scalar(n, out);
+#endif
+}
+
+inline void Bezier::evaluate_scalar(int n, glm::vec2* out) const
+{
+    const float step = 1.0f / n;
+    for (int i = 0; i < n; i++)
+    {
+        out[i] = at((float)i * step);
+    }
+    out[0] = d;
+    out[n] = end;
+}
+
+// the polyline within tolerance of the curve
+inline void Bezier::flatten(std::vector<glm::vec2>& out, float tolerance) const
+{
+    int n = segments(tolerance);
+    out.resize(n + 1);
+    evaluate(n, &out[0]);
+}
+
+// a point of the half-section space in profile units: u along the bar 0~1, radius 1.0 = the original bar
+inline double bezier_axial(const glm::vec2& p)
+{
+    return ((double)p.x + 1.0) / 2.0;
+}
+
+inline float bezier_radius(const glm::vec2& p)
+{
+    return (p.y + 1.0f) / 2.0f;
+}
+
+// the lowest radius the polyline reaches inside each of bins bins along the bar, min-ed into lowest[]
+// (filled with BEZIER_NONE by the caller); every bin the polyline's x range touches gets a value,
+// [first, last] grows to cover them (start with first = bins, last = -1)
+inline void bezier_rasterize(const glm::vec2* points, size_t count, int bins, float* lowest, int& first, int& last)
+{
+    const size_t pieces = count > 1 ? count - 1 : count;//只有一个点时按一段长度为0的折线
+    for (size_t k = 0; k < pieces; k++)
+    {
+        const glm::vec2& p = points[k];
+        const glm::vec2& q = points[std::min(k + 1, count - 1)];
+        double u0 = bezier_axial(p), u1 = bezier_axial(q);
+        float r0 = bezier_radius(p), r1 = bezier_radius(q);
+        if (u1 < u0)
+        {
+            std::swap(u0, u1);
+            std::swap(r0, r1);
+        }
+        int i0 = std::max(0, (int)std::floor(u0 * bins));
+        int i1 = std::min(bins - 1, std::max((int)std::floor(u0 * bins), (int)std::ceil(u1 * bins) - 1));
+        for (int i = i0; i <= i1; i++)
+        {
+            //线段在这个格子里的两端，直线上的最低点在两端之一
+            double a = std::max(u0, (double)i / bins), b = std::min(u1, (double)(i + 1) / bins);
+            float ra = r0, rb = r1;
+            if (u1 > u0)
+            {
+                ra = r0 + (r1 - r0) * (float)((a - u0) / (u1 - u0));
+                rb = r0 + (r1 - r0) * (float)((b - u0) / (u1 - u0));
+            }
+            lowest[i] = std::min(lowest[i], std::min(ra, rb));
+        }
+        if (i0 <= i1)
+        {
+            first = std::min(first, i0);
+            last = std::max(last, i1);
+        }
+    }
+}
+
+#endif
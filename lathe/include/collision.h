@@ -0,0 +1,62 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+// 快移碰撞检查：G0不该碰到工件，以前只有刀具位置的几个硬限位，快移照样按切削执行
+// 每条G0执行之前，刀具从起点到终点扫过的区域的下边缘（点状刀尖是一条线段，有刀刃的刀是Tool::swept_envelope()的折线）
+// 逐段交给Metrology::first_above()：线段树按每个segment里轮廓的最高点剪枝，不碰的移动O(log n)，
+// 剩下的segment按折点精确比较；只有真的切进去超过RAPID_TOLERANCE才算碰撞（刀尖贴着刚车出来的表面退刀不算）
+// 同样不依赖glad/GLFW
+#include <vector>
+#include <algorithm>
+
+#include "workpiece.h"
+#include "tool.h"
+#include "metrology.h"
+
+const float RAPID_TOLERANCE = 1e-5f;//半径单位，0.25µm，只用来吸收浮点误差
+
+// what GcodeProgram does when a rapid would hit the part
+enum RapidPolicy
+{
+    RAPID_IGNORE,//不检查，快移照样切（原来的行为）
+    RAPID_WARN,//报错、计数，照样执行
+    RAPID_STOP,//报错，程序在这条G0之前停下（像机床报警），默认
+};
+
+// where a rapid first hits the part
+struct RapidCollision
+{
+    double u = 0.0;//碰到的segment的起点（0~1）
+    float depth = 0.0f;//切进去多深（半径单位）
+};
+
+// check the straight move of tool from (u0, d0) to (u1, d1) against the part as it is now:
+// metrology is brought up to date first (only the segments cut since the last call), true and where if it would cut
+inline bool rapid_collision(Metrology& metrology, Workpiece& workpiece, const Tool& tool, double u0, float d0, double u1, float d1, RapidCollision& hit)
+{
+    metrology.update(workpiece);
+    float excess = 0.0f;
+    int y = -1;
+    if (tool.is_point())
+    {
+        y = metrology.first_above(workpiece, u0, d0, u1, d1, RAPID_TOLERANCE, excess);
+    }
+    else
+    {
+        Profile::KnotList edge;
+        tool.swept_envelope(u0, d0, u1, d1, edge);
+        for (size_t i = 0; i + 1 < edge.size() && y < 0; i++)
+        {
+            y = metrology.first_above(workpiece, edge[i].first, edge[i].second.right, edge[i + 1].first, edge[i + 1].second.left, RAPID_TOLERANCE, excess);
+        }
+    }
+    if (y < 0)
+    {
+        return false;
+    }
+    hit.u = (double)y / metrology.bins();
+    hit.depth = excess;
+    return true;
+}
+
+#endif
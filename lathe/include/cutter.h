@@ -0,0 +1,299 @@
+#ifndef CUTTER_H
+#define CUTTER_H
+
+// 切削引擎：刀具位置 + 切削逻辑，直接作用在Workpiece的半径集合上
+// 同样不依赖glad/GLFW
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+
+#include "workpiece.h"
+#include "tool.h"
+#include "bezier.h"
+
+//切削刀具设置(刀用一个倒四棱锥表示)
+const glm::vec3 knife_pos_reset(-2.0f, 0.55f, 0.0f);
+
+//刀具运动按固定的时间步推进，和帧率无关：每秒MOTION_TICK_RATE步，每步切掉刀尖这一步扫过的路径
+const int MOTION_TICK_RATE = 1000;
+
+class Cutter
+{
+public:
+    glm::vec3 knife_pos = knife_pos_reset;//空间位置
+    float knife_distance = 1.0f;
+    int r_segments = R_SEGMENTS;//径向进刀的精细度，move_up/move_down每次移动1/r_segments个半径
+    int tool = 0;//tool_library()里的下标，0是理想的刀尖点
+
+    //连续运动（advance()）：速度按秒计，方向由输入设置，从下一个tick开始生效
+    float feed_speed = 0.6f;//左右走刀速度，世界坐标单位/秒（工件全长4）
+    float infeed_speed = 0.6f;//径向进退刀速度，半径单位/秒
+    float feed_scale = 1.0f;//走刀速度倍率（精车时调小）
+    int axial_dir = 0;//+1往+x走，-1往-x走，0不动
+    int radial_dir = 0;//+1退刀，-1进刀，0不动
+    double spindle_speed = 0.0;//二维模式下主轴的角速度（rad/s）
+    double spindle_phase = 0.0;//时间0时刀下方的工件角度
+    long long motion_tick = -1;//下一个要走的tick，-1表示运动时钟还没开始
+    Profile::KnotList envelope;//刀刃在当前位置的折线，每个tick重复使用
+
+    void reset();
+    int knife_segment(const Workpiece& workpiece) const;
+    double knife_axial() const;
+    void set_position(double u, float distance);
+    float feed_step(const Workpiece& workpiece) const;
+    void move_up();
+    void move_down();
+    float move_left(Workpiece& workpiece);
+    float move_right(Workpiece& workpiece);
+    float spindle_cut(Workpiece& workpiece, double from, double theta0, double theta1);
+    float advance(Workpiece& workpiece, double now);
+    float motion_step(Workpiece& workpiece, long long tick);
+    float cut_move(Workpiece& workpiece, long long tick, double from, float from_distance);
+    float cut_sweep(Workpiece& workpiece, double u0, float d0, double u1, float d1);
+};
+
+inline void Cutter::reset()
+{
+    knife_distance = 1.0f;
+    knife_pos = knife_pos_reset;
+}
+
+// index of the radius segment under the knife
+inline int Cutter::knife_segment(const Workpiece& workpiece) const
+{
+    return (int)((knife_pos.x + 2.0f) * workpiece.y_segments / 4.0f);
+}
+
+// knife position along the bar in profile coordinates (0~1)
+inline double Cutter::knife_axial() const
+{
+    return ((double)knife_pos.x + 2.0) / 4.0;
+}
+
+// put the knife tip at profile position u (0~1) and depth distance (radius 1.0 = the original bar)
+inline void Cutter::set_position(double u, float distance)
+{
+    knife_pos.x = (float)(u * 4.0 - 2.0);
+    knife_distance = std::max(0.0f, distance);
+    knife_pos.y = knife_pos_reset.y - 0.5f + 0.5f * knife_distance;
+}
+
+inline void Cutter::move_up()
+{
+    knife_pos.y = knife_pos.y + 0.5f / r_segments;
+    knife_distance += 1.0f / r_segments;
+}
+
+inline void Cutter::move_down()
+{
+    if (knife_pos.y > 0.05f)
+    {
+        knife_pos.y = knife_pos.y - 0.5f / r_segments;
+        knife_distance -= 1.0f / r_segments;
+        if (knife_distance < 0)
+        {
+            knife_distance = 0.0f;
+        }
+    }
+}
+
+// one segment (4 / y_segments) per move_left/move_right
+inline float Cutter::feed_step(const Workpiece& workpiece) const
+{
+    return 4.0f / workpiece.y_segments;
+}
+
+// the move_left/move_right return the cut mount, 0 when nothing was removed
+// 刀尖扫过的整段[旧位置, 新位置]都切到knife_distance
+inline float Cutter::move_left(Workpiece& workpiece)
+{
+    if (knife_pos.x < 2.0f)
+    {
+        double from = knife_axial();
+        knife_pos.x = std::min(2.0f, knife_pos.x + feed_step(workpiece));
+        if (workpiece.field_enabled)
+        {
+            return 0.0f;//二维模式下由spindle_cut()切
+        }
+        return workpiece.cut_span(from, knife_axial(), knife_distance);
+    }
+    return 0.0f;
+}
+
+inline float Cutter::move_right(Workpiece& workpiece)
+{
+    if (knife_pos.x > -2.0f)
+    {
+        double from = knife_axial();
+        knife_pos.x = std::max(-2.0f, knife_pos.x - feed_step(workpiece));
+        if (workpiece.field_enabled)
+        {
+            return 0.0f;
+        }
+        return workpiece.cut_span(knife_axial(), from, knife_distance);
+    }
+    return 0.0f;
+}
+
+// 2D mode: the knife moved from axial position `from` to where it is now while the spindle turned the
+// workpiece angles theta0~theta1 under it; a knife that stands still keeps cutting as the bar turns
+inline float Cutter::spindle_cut(Workpiece& workpiece, double from, double theta0, double theta1)
+{
+    double to = knife_axial();
+    return workpiece.cut_field(std::min(from, to), std::max(from, to), theta0, theta1, knife_distance);
+}
+
+// run the motion ticks that are due by time now (seconds), returns the largest cut mount
+// ticks are numbered from time 0, so the same input timeline gives the same ticks (and the same part) at any frame rate;
+// a frame only decides how many of them run now. Direction changes made after advance() apply from the next tick on
+inline float Cutter::advance(Workpiece& workpiece, double now)
+{
+    long long due = (long long)std::floor(now * MOTION_TICK_RATE);
+    if (motion_tick < 0)
+    {
+        motion_tick = due;
+    }
+    float mount = 0.0f;
+    for (; motion_tick < due; motion_tick++)
+    {
+        mount = std::max(mount, motion_step(workpiece, motion_tick));
+    }
+    return mount;
+}
+
+// one tick: move in and along at the set speeds, then cut_move()
+inline float Cutter::motion_step(Workpiece& workpiece, long long tick)
+{
+    const float dt = 1.0f / MOTION_TICK_RATE;
+    double from = knife_axial();
+    float from_distance = knife_distance;
+    if (radial_dir > 0)
+    {
+        knife_pos.y = knife_pos.y + 0.5f * infeed_speed * dt;
+        knife_distance += infeed_speed * dt;
+    }
+    else if (radial_dir < 0 && knife_pos.y > 0.05f)
+    {
+        knife_pos.y = knife_pos.y - 0.5f * infeed_speed * dt;
+        knife_distance = std::max(0.0f, knife_distance - infeed_speed * dt);
+    }
+    if (axial_dir != 0)
+    {
+        knife_pos.x = std::max(-2.0f, std::min(2.0f, knife_pos.x + axial_dir * feed_speed * feed_scale * dt));
+    }
+    return cut_move(workpiece, tick, from, from_distance);
+}
+
+// the knife moved during tick from (from, from_distance) to where it is now: cut the straight path the tip swept,
+// then the tool's edge at the new position (at the old position it was cut by the previous tick,
+// a tick is much shorter than any edge); in 2D mode only for the spindle angles of this tick
+inline float Cutter::cut_move(Workpiece& workpiece, long long tick, double from, float from_distance)
+{
+    const Tool& knife = tool_library()[tool];
+    double to = knife_axial();
+    if (workpiece.field_enabled)
+    {
+        //主轴在这个tick里转过的角度
+        double theta0 = spindle_speed * ((double)tick / MOTION_TICK_RATE) + spindle_phase;
+        double theta1 = spindle_speed * ((double)(tick + 1) / MOTION_TICK_RATE) + spindle_phase;
+        float mount = from <= to
+            ? workpiece.cut_field(from, to, theta0, theta1, from_distance, knife_distance)
+            : workpiece.cut_field(to, from, theta0, theta1, knife_distance, from_distance);
+        if (!knife.is_point())
+        {
+            //主轴一直在转，刀不动也要切
+            knife.envelope(to, knife_distance, envelope);
+            mount = std::max(mount, workpiece.cut_field_envelope(envelope, theta0, theta1));
+        }
+        return mount;
+    }
+    float mount = 0.0f;
+    if (from < to)
+    {
+        mount = workpiece.cut_span(from, to, from_distance, knife_distance);
+    }
+    else if (to < from)
+    {
+        mount = workpiece.cut_span(to, from, knife_distance, from_distance);
+    }
+    if (!knife.is_point() && (to != from || knife_distance != from_distance))
+    {
+        knife.envelope(to, knife_distance, envelope);
+        mount = std::max(mount, workpiece.cut_envelope(envelope));
+    }
+    return mount;
+}
+
+// cut everything the tool passes moving straight from (u0, d0) to (u1, d1) at once, for any length of move
+// (the G-code full-speed mode); the 2D field is cut over the whole revolution
+inline float Cutter::cut_sweep(Workpiece& workpiece, double u0, float d0, double u1, float d1)
+{
+    const Tool& knife = tool_library()[tool];
+    if (!knife.is_point())
+    {
+        knife.swept_envelope(u0, d0, u1, d1, envelope);
+        return workpiece.cut_envelope(envelope);
+    }
+    if (u0 < u1)
+    {
+        return workpiece.cut_span(u0, u1, d0, d1);
+    }
+    if (u1 < u0)
+    {
+        return workpiece.cut_span(u1, u0, d1, d0);
+    }
+    return 0.0f;
+}
+
+// cut the workpiece down to a polyline in the half-section space: each run where x keeps going one way
+// is one envelope for Workpiece::cut_envelope(), so a curve that doubles back keeps the lower of its passes
+inline float polyline_cut(Workpiece& workpiece, const std::vector<glm::vec2>& points)
+{
+    Profile::KnotList envelope;
+    float mount = 0.0f;
+    size_t start = 0;
+    while (start + 1 < points.size())
+    {
+        //这一段的走向，竖直的线段跟着前后的走向
+        size_t end = start + 1;
+        int dir = 0;
+        for (; end < points.size(); end++)
+        {
+            float dx = points[end].x - points[end - 1].x;
+            int d = dx > 0.0f ? 1 : (dx < 0.0f ? -1 : 0);
+            if (dir != 0 && d != 0 && d != dir)
+            {
+                break;
+            }
+            dir = d != 0 ? d : dir;
+        }
+        envelope.clear();
+        for (size_t k = 0; k < end - start; k++)
+        {
+            const glm::vec2& p = points[dir >= 0 ? start + k : end - 1 - k];
+            double u = bezier_axial(p);
+            float r = std::max(0.0f, bezier_radius(p));
+            if (!envelope.empty() && envelope.back().first >= u)
+            {
+                envelope.back().second.right = r;//竖直的一段
+                continue;
+            }
+            envelope.push_back(std::make_pair(u, ProfileKnot{ r, r }));
+        }
+        mount = std::max(mount, workpiece.cut_envelope(envelope));
+        start = end - 1;
+    }
+    return mount;
+}
+
+// cut the cubic bezier A,B,C,D (in the (-1,1)x(-1,1) half-section space) into the workpiece
+// along its flattened polyline, every segment the curve passes over (bezier.h)
+inline float bezier_cut(Workpiece& workpiece, glm::vec2 A, glm::vec2 B, glm::vec2 C, glm::vec2 D)
+{
+    std::vector<glm::vec2> points;
+    Bezier(A, B, C, D).flatten(points);
+    return polyline_cut(workpiece, points);
+}
+
+#endif
@@ -0,0 +1,396 @@
+#ifndef DEVIATION_H
+#define DEVIATION_H
+
+// 目标轮廓和实际工件的偏差：每个segment一个目标半径和上下公差带，切一刀之后增量更新
+// 每个segment的超差（实际 - 目标，还要切掉的）、欠差（目标 - 实际，切多了的）和是否超出公差带是线段树的叶子，
+// 父节点取两个子节点的最大值（和它在哪个segment）、超出公差的segment数相加
+// 和Metrology一样只重算dirty范围里的叶子和它们的祖先，O(k + log n)，不用每刀从头扫一遍；
+// 超出公差的区间从根往下只走out > 0的子树，r个区间O(r log n)
+// 一维模式比的是radius[y]（segment里的平均半径，和绘制的一样，斜面上正好是中点的半径，目标也取在segment中点）；
+// 二维模式按这一行里最高的列算超差、最低的列算欠差
+// 每个segment的分类（DEVIATION_*）由渲染线程写进PackedVertex::deviation，cylinder.fs按它上色
+// 偏差单位mm（半径方向），目标半径是工件坐标（1.0是原始半径），DEVIATION_NONE_TARGET（负数）表示这个segment不比较
+// 同样不依赖glad/GLFW
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <iostream>
+#include <algorithm>
+
+#include "workpiece.h"
+
+const double DEVIATION_TOLERANCE = 0.05;//默认公差带（mm，半径方向），上下各这么多
+const float DEVIATION_NONE_TARGET = -1.0f;//和DRAWING_NONE、MESH_NONE一样，图纸没画到的地方
+const int DEVIATION_RANGE_LIMIT = 16;//报告、发布给渲染线程的超差区间最多几个
+
+//每个segment的分类，写进PackedVertex::deviation
+const uint8_t DEVIATION_NONE = 0;//没有目标
+const uint8_t DEVIATION_IN = 1;//在公差带里
+const uint8_t DEVIATION_OVER = 2;//超差：比目标大，还要切
+const uint8_t DEVIATION_UNDER = 3;//欠差：比目标小，切多了
+
+// one node: worst over-size and under-size of its segments (mm, negative when every segment is on the other side)
+// and where they are, and how many segments are outside their band
+struct DeviationNode
+{
+    float over = -FLT_MAX;
+    float under = -FLT_MAX;
+    int over_bin = -1;
+    int under_bin = -1;
+    int out = 0;
+};
+
+// a run of consecutive segments outside their band, [first, last]
+struct DeviationRange
+{
+    int first = 0;
+    int last = 0;
+    float over = -FLT_MAX;//这一段里最大的超差、欠差（mm）
+    float under = -FLT_MAX;
+};
+
+inline DeviationNode deviation_merge(const DeviationNode& a, const DeviationNode& b)
+{
+    DeviationNode m;
+    m.over = std::max(a.over, b.over);
+    m.over_bin = a.over >= b.over ? a.over_bin : b.over_bin;
+    m.under = std::max(a.under, b.under);
+    m.under_bin = a.under >= b.under ? a.under_bin : b.under_bin;
+    m.out = a.out + b.out;
+    return m;
+}
+
+class Deviation
+{
+public:
+    void set_target(Workpiece& workpiece, const std::vector<float>& target, double under = DEVIATION_TOLERANCE, double over = DEVIATION_TOLERANCE);
+    void set_band(Workpiece& workpiece, int first, int last, double under, double over);
+    void clear();
+    void build(Workpiece& workpiece);
+    void update(Workpiece& workpiece);
+    bool active() const;
+    int bins() const;
+    const std::vector<float>& target() const;
+    DeviationNode query(int first, int last) const;
+    const DeviationNode& total() const;
+    uint8_t state(int y) const;
+    int ranges(std::vector<DeviationRange>& out, int limit = DEVIATION_RANGE_LIMIT) const;
+
+private:
+    int n = 0;//segment数
+    int size = 1;//叶子层的宽度，2的幂，叶子i在nodes[size + i]
+    bool field = false;//按二维半径场建的
+    std::vector<float> targets;//每个segment的目标半径，空的时候没有目标
+    std::vector<float> band_under;//每个segment允许的欠差、超差（mm）
+    std::vector<float> band_over;
+    std::vector<DeviationNode> nodes;
+
+    DeviationNode leaf(const Workpiece& workpiece, int y) const;
+    void refresh(const Workpiece& workpiece, int first, int last);
+    void resample(int bins);
+    void collect(int node, int lo, int hi, std::vector<DeviationRange>& out, int limit) const;
+};
+
+// compare against target (one radius per segment, DEVIATION_NONE_TARGET where nothing is compared)
+// with the same band everywhere; rebuilds the whole tree
+inline void Deviation::set_target(Workpiece& workpiece, const std::vector<float>& target, double under, double over)
+{
+    targets = target;
+    targets.resize(workpiece.y_segments, DEVIATION_NONE_TARGET);
+    band_under.assign(workpiece.y_segments, (float)under);
+    band_over.assign(workpiece.y_segments, (float)over);
+    build(workpiece);
+}
+
+// a band of its own for segments first..last (a tight fit at a bearing seat, say): only their leaves and ancestors
+inline void Deviation::set_band(Workpiece& workpiece, int first, int last, double under, double over)
+{
+    if (!active())
+    {
+        return;
+    }
+    update(workpiece);
+    first = std::max(0, first);
+    last = std::min(n - 1, last);
+    if (first > last)
+    {
+        return;
+    }
+    std::fill(band_under.begin() + first, band_under.begin() + last + 1, (float)under);
+    std::fill(band_over.begin() + first, band_over.begin() + last + 1, (float)over);
+    refresh(workpiece, first, last);
+}
+
+// no target any more: every segment is DEVIATION_NONE
+inline void Deviation::clear()
+{
+    targets.clear();
+    band_under.clear();
+    band_over.clear();
+    nodes.clear();
+    n = 0;
+}
+
+// segment y against its target: the mean radius in 1D, the highest and the lowest column in 2D
+inline DeviationNode Deviation::leaf(const Workpiece& workpiece, int y) const
+{
+    DeviationNode m;
+    float goal = targets[y];
+    if (goal < 0.0f)
+    {
+        return m;
+    }
+    float highest, lowest;
+    if (workpiece.field_enabled)
+    {
+        const RadiusField& f = workpiece.field;
+        highest = 0.0f;
+        lowest = FLT_MAX;
+        for (int t = 0; t < f.theta_segments; t++)
+        {
+            highest = std::max(highest, f.at(y, t));
+            lowest = std::min(lowest, f.at(y, t));
+        }
+    }
+    else
+    {
+        highest = workpiece.radius[y];
+        lowest = highest;
+    }
+    const float mm = (float)(STOCK_DIAMETER * 0.5);
+    m.over = (highest - goal) * mm;
+    m.under = (goal - lowest) * mm;
+    m.over_bin = y;
+    m.under_bin = y;
+    m.out = m.over > band_over[y] || m.under > band_under[y] ? 1 : 0;
+    return m;
+}
+
+// every segment from scratch (a new target, resolution or 2D mode), clears the workpiece's pending range
+inline void Deviation::build(Workpiece& workpiece)
+{
+    workpiece.clear_deviation();
+    if (targets.empty())
+    {
+        return;
+    }
+    resample(workpiece.y_segments);
+    field = workpiece.field_enabled;
+    size = 1;
+    while (size < n)
+    {
+        size *= 2;
+    }
+    nodes.assign(2 * size, DeviationNode());
+    for (int y = 0; y < n; y++)
+    {
+        nodes[size + y] = leaf(workpiece, y);
+    }
+    for (int i = size - 1; i >= 1; i--)
+    {
+        nodes[i] = deviation_merge(nodes[2 * i], nodes[2 * i + 1]);
+    }
+}
+
+// after a resolution change the target and the bands are taken from the nearest old segment
+inline void Deviation::resample(int bins)
+{
+    int old = (int)targets.size();
+    if (old != bins)
+    {
+        std::vector<float> t(bins), lo(bins), hi(bins);
+        for (int y = 0; y < bins; y++)
+        {
+            int from = (int)(((long long)y * 2 + 1) * old / (2LL * bins));
+            t[y] = targets[from];
+            lo[y] = band_under[from];
+            hi[y] = band_over[from];
+        }
+        targets.swap(t);
+        band_under.swap(lo);
+        band_over.swap(hi);
+    }
+    n = bins;
+}
+
+// take the segments the workpiece changed since the last update (see Workpiece::pending_deviation()),
+// their leaves and ancestors only; the pending range is cleared here (one Deviation per workpiece, like Metrology)
+inline void Deviation::update(Workpiece& workpiece)
+{
+    if (targets.empty())
+    {
+        workpiece.clear_deviation();
+        return;
+    }
+    if (n != workpiece.y_segments || field != workpiece.field_enabled)
+    {
+        build(workpiece);
+        return;
+    }
+    int first, count;
+    if (!workpiece.pending_deviation(first, count))
+    {
+        return;
+    }
+    refresh(workpiece, first, std::min(first + count - 1, n - 1));
+    workpiece.clear_deviation();
+}
+
+// leaves first..last again, then each level above only between the ancestors of the first and the last one
+inline void Deviation::refresh(const Workpiece& workpiece, int first, int last)
+{
+    for (int y = first; y <= last; y++)
+    {
+        nodes[size + y] = leaf(workpiece, y);
+    }
+    for (int lo = (size + first) / 2, hi = (size + last) / 2; lo >= 1; lo /= 2, hi /= 2)
+    {
+        for (int i = lo; i <= hi; i++)
+        {
+            nodes[i] = deviation_merge(nodes[2 * i], nodes[2 * i + 1]);
+        }
+    }
+}
+
+inline bool Deviation::active() const
+{
+    return !targets.empty();
+}
+
+inline int Deviation::bins() const
+{
+    return n;
+}
+
+inline const std::vector<float>& Deviation::target() const
+{
+    return targets;
+}
+
+// segments [first, last], bottom up: O(log n) nodes
+inline DeviationNode Deviation::query(int first, int last) const
+{
+    DeviationNode left, right;
+    first = std::max(0, first);
+    last = std::min(n - 1, last);
+    if (first > last || nodes.empty())
+    {
+        return left;
+    }
+    for (int lo = size + first, hi = size + last + 1; lo < hi; lo /= 2, hi /= 2)
+    {
+        if (lo & 1)
+        {
+            left = deviation_merge(left, nodes[lo++]);
+        }
+        if (hi & 1)
+        {
+            right = deviation_merge(nodes[--hi], right);
+        }
+    }
+    return deviation_merge(left, right);
+}
+
+// the whole bar (an empty node without a target)
+inline const DeviationNode& Deviation::total() const
+{
+    static const DeviationNode empty;
+    return nodes.empty() ? empty : nodes[1];
+}
+
+// what segment y is drawn as; in 2D mode a row both over- and under-size counts as over-size (there is still something to cut)
+inline uint8_t Deviation::state(int y) const
+{
+    if (y < 0 || y >= n || nodes.empty() || targets[y] < 0.0f)
+    {
+        return DEVIATION_NONE;
+    }
+    const DeviationNode& m = nodes[size + y];
+    if (m.over > band_over[y])
+    {
+        return DEVIATION_OVER;
+    }
+    return m.under > band_under[y] ? DEVIATION_UNDER : DEVIATION_IN;
+}
+
+// the first `limit` runs of out-of-tolerance segments from the u = 0 end, only down subtrees that have any;
+// returns how many runs there are in all (counted up to limit + 1: more than limit means the list is cut short)
+inline int Deviation::ranges(std::vector<DeviationRange>& out, int limit) const
+{
+    out.clear();
+    if (total().out == 0)
+    {
+        return 0;
+    }
+    collect(1, 0, size - 1, out, limit + 1);
+    int found = (int)out.size();
+    if (found > limit)
+    {
+        out.resize(limit);
+    }
+    return found;
+}
+
+inline void Deviation::collect(int node, int lo, int hi, std::vector<DeviationRange>& out, int limit) const
+{
+    if (nodes[node].out == 0 || lo >= n)
+    {
+        return;
+    }
+    if ((int)out.size() >= limit && out.back().last + 1 < lo)
+    {
+        return;//已经够了，这棵子树接不到最后一段上
+    }
+    if (node >= size)
+    {
+        const DeviationNode& m = nodes[node];
+        if (!out.empty() && out.back().last + 1 == lo)
+        {
+            out.back().last = lo;
+            out.back().over = std::max(out.back().over, m.over);
+            out.back().under = std::max(out.back().under, m.under);
+            return;
+        }
+        if ((int)out.size() >= limit)
+        {
+            return;
+        }
+        DeviationRange r;
+        r.first = lo;
+        r.last = lo;
+        r.over = m.over;
+        r.under = m.under;
+        out.push_back(r);
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    collect(2 * node, lo, mid, out, limit);
+    collect(2 * node + 1, mid + 1, hi, out, limit);
+}
+
+// worst over- and under-size and where (G-code z, like the metrology report), then the out-of-tolerance runs
+inline void print_deviation_report(const DeviationNode& all, const std::vector<DeviationRange>& ranges, int range_count, int bins)
+{
+    if (bins == 0)
+    {
+        std::cout << "deviation: no target" << std::endl;
+        return;
+    }
+    auto z = [bins](int y) { return ((y + 0.5) / bins - 1.0) * STOCK_LENGTH; };
+    std::cout << "deviation: max over-size " << all.over << " mm at z " << z(all.over_bin) << ", max under-size " << all.under
+        << " mm at z " << z(all.under_bin) << ", " << all.out << " of " << bins << " segments out of tolerance";
+    if (range_count == 0)
+    {
+        std::cout << std::endl;
+        return;
+    }
+    std::cout << " in " << range_count << (range_count > (int)ranges.size() ? "+" : "") << " runs:" << std::endl;
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        const DeviationRange& r = ranges[i];
+        std::cout << "  z " << (double)r.first / bins * STOCK_LENGTH - STOCK_LENGTH << " ~ " << (double)(r.last + 1) / bins * STOCK_LENGTH - STOCK_LENGTH
+            << " mm: over " << r.over << " mm, under " << r.under << " mm" << std::endl;
+    }
+}
+
+#endif
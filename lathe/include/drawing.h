@@ -0,0 +1,821 @@
+#ifndef DRAWING_H
+#define DRAWING_H
+
+// 从CAD图纸读目标轮廓：SVG的<path d="...">和DXF的LWPOLYLINE/LINE/ARC
+// 图纸坐标是毫米，和G代码一样：x是轴向的Z（Z0在工件+x一端的端面，往卡盘方向是负的），y = 0是回转轴线，离轴线的距离|y|是半径
+// （SVG的y朝下、整个剖面画了上下两半都没关系）；SVG的transform不管，DXF的$INSUNITS也不管
+// 流式读取：文件按DRAWING_BUFFER一块一块读，不建DOM、不存实体，路径数据边读边解析，每条线段（圆弧、曲线按DRAWING_TOLERANCE拆成折线）
+// 一读出来就落到轴向格子里：格子中点处所有线段的最大半径就是目标（外轮廓；内孔、剖面线都在它下面）
+// 整条在轴线上的线段（中心线、半剖面的底边）不算，否则零件两头以外的格子目标就成了0
+// 所以内存只有读缓冲和每个格子一个float，和文件多大无关；几MB的图纸几十毫秒读完
+// 同样不依赖glad/GLFW
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+
+#include "bezier.h"
+#include "gcode.h"
+
+const double DRAWING_TOLERANCE = 0.002;//圆弧、曲线拆成折线的最大弦高（mm），和G代码的圆弧一样
+const size_t DRAWING_BUFFER = 1 << 16;//每次从文件读这么多字节
+const float DRAWING_NONE = -1.0f;//没有线段经过中点的格子
+const int DRAWING_MAX_REPORTED_ERRORS = 10;
+
+enum DrawingFormat
+{
+    DRAWING_UNKNOWN = 0,
+    DRAWING_SVG,
+    DRAWING_DXF
+};
+
+// what reading a drawing found
+struct DrawingReport
+{
+    bool ok = false;
+    DrawingFormat format = DRAWING_UNKNOWN;
+    long long bytes = 0;
+    long long entities = 0;//SVG的path、DXF的实体
+    long long segments = 0;//落到格子里的直线段
+    int bins_hit = 0;
+    int errors = 0;
+    double read_ms = 0.0;
+};
+
+// the file, one DRAWING_BUFFER at a time
+class DrawingStream
+{
+public:
+    bool open(const std::string& path);
+    int peek();
+    int get();
+    long long bytes() const;
+
+private:
+    std::ifstream file;
+    std::vector<char> buffer;
+    size_t at = 0, size = 0;
+    long long consumed = 0;
+
+    bool fill();
+};
+
+inline bool DrawingStream::open(const std::string& path)
+{
+    file.open(path.c_str(), std::ios::in | std::ios::binary);
+    buffer.resize(DRAWING_BUFFER);
+    at = size = 0;
+    consumed = 0;
+    return (bool)file;
+}
+
+// the next byte without taking it, -1 at the end of the file
+inline int DrawingStream::peek()
+{
+    if (at == size && !fill())
+    {
+        return -1;
+    }
+    return (unsigned char)buffer[at];
+}
+
+inline int DrawingStream::get()
+{
+    int c = peek();
+    if (c >= 0)
+    {
+        at++;
+        consumed++;
+    }
+    return c;
+}
+
+inline long long DrawingStream::bytes() const
+{
+    return consumed;
+}
+
+inline bool DrawingStream::fill()
+{
+    if (!file)
+    {
+        return false;
+    }
+    file.read(&buffer[0], buffer.size());
+    size = (size_t)file.gcount();
+    at = 0;
+    return size > 0;
+}
+
+// the target radius at the middle of each of `bins` bins, max-ed over every segment read so far
+class DrawingTarget
+{
+public:
+    std::vector<float> radius;//工件半径单位（1.0是原始半径），DRAWING_NONE是没有线段经过
+    DrawingReport report;
+
+    DrawingTarget(int bins);
+
+    void line(glm::dvec2 a, glm::dvec2 b);
+    void arc(glm::dvec2 centre, double rx, double ry, double phi, double start, double sweep);
+    void cubic(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c, glm::dvec2 d);
+    void error(const std::string& message);
+
+private:
+    int bins;
+    std::vector<glm::vec2> flattened;//一条曲线展平的折线，曲线之间复用
+};
+
+inline DrawingTarget::DrawingTarget(int bins)
+    : radius(std::max(0, bins), DRAWING_NONE), bins(std::max(0, bins))
+{
+}
+
+// a straight segment in drawing millimetres: every bin middle it passes over takes the larger of the two radii
+inline void DrawingTarget::line(glm::dvec2 a, glm::dvec2 b)
+{
+    double u0 = gcode_axial(a.x), u1 = gcode_axial(b.x);
+    if (u1 < u0)
+    {
+        std::swap(u0, u1);
+        std::swap(a, b);
+    }
+    report.segments++;
+    if (std::fabs(a.y) <= DRAWING_TOLERANCE && std::fabs(b.y) <= DRAWING_TOLERANCE)
+    {
+        return;
+    }
+    //竖直的线段不经过任何格子的中点，台阶由两边的线段决定
+    int i0 = std::max(0, (int)std::ceil(u0 * bins - 0.5));
+    int i1 = std::min(bins - 1, (int)std::floor(u1 * bins - 0.5));
+    for (int i = i0; i <= i1 && u1 > u0; i++)
+    {
+        double t = ((i + 0.5) / bins - u0) / (u1 - u0);
+        float r = (float)(std::fabs(a.y + (b.y - a.y) * t) * 2.0 / GCODE_STOCK_DIAMETER);
+        if (radius[i] == DRAWING_NONE)
+        {
+            report.bins_hit++;
+        }
+        radius[i] = std::max(radius[i], r);
+    }
+}
+
+// an elliptical arc (a DXF arc or bulge has rx = ry): centre, radii, rotation of the x radius and the angles in radians,
+// flattened to chords within DRAWING_TOLERANCE
+inline void DrawingTarget::arc(glm::dvec2 centre, double rx, double ry, double phi, double start, double sweep)
+{
+    double r = std::max(rx, ry);
+    double step = r > DRAWING_TOLERANCE ? 2.0 * std::acos(1.0 - DRAWING_TOLERANCE / r) : 2.0 * PI;
+    int n = std::max(1, std::min(BEZIER_MAX_SEGMENTS, (int)std::ceil(std::fabs(sweep) / step)));
+    double c = std::cos(phi), s = std::sin(phi);
+    glm::dvec2 last;
+    for (int i = 0; i <= n; i++)
+    {
+        double t = start + sweep * i / n;
+        glm::dvec2 p(centre.x + rx * std::cos(t) * c - ry * std::sin(t) * s, centre.y + rx * std::cos(t) * s + ry * std::sin(t) * c);
+        if (i > 0)
+        {
+            line(last, p);
+        }
+        last = p;
+    }
+}
+
+// a cubic bezier in drawing millimetres, flattened like a bezier cut (bezier.h) but to DRAWING_TOLERANCE
+inline void DrawingTarget::cubic(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c, glm::dvec2 d)
+{
+    //Bezier是float的，相对首点算，几百毫米的图纸也只差几个nm
+    Bezier curve(glm::vec2(0.0f), glm::vec2(b - a), glm::vec2(c - a), glm::vec2(d - a));
+    curve.flatten(flattened, (float)DRAWING_TOLERANCE);
+    glm::dvec2 last = a;
+    for (size_t i = 1; i < flattened.size(); i++)
+    {
+        glm::dvec2 p = i + 1 < flattened.size() ? a + glm::dvec2(flattened[i]) : d;
+        line(last, p);
+        last = p;
+    }
+}
+
+inline void DrawingTarget::error(const std::string& message)
+{
+    report.errors++;
+    if (report.errors <= DRAWING_MAX_REPORTED_ERRORS)
+    {
+        std::cout << "ERROR::DRAWING::" << message << std::endl;
+    }
+}
+
+// ---- SVG ----
+
+inline bool drawing_space(int c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',';
+}
+
+inline void drawing_skip_space(DrawingStream& in)
+{
+    while (drawing_space(in.peek()))
+    {
+        in.get();
+    }
+}
+
+// one SVG number ("-1.5e-3", and "1.5.5" is 1.5 then .5), false if there is none
+inline bool svg_number(DrawingStream& in, double& value)
+{
+    drawing_skip_space(in);
+    char text[64];
+    size_t n = 0;
+    bool digits = false, dot = false;
+    int c = in.peek();
+    if (c == '+' || c == '-')
+    {
+        text[n++] = (char)in.get();
+    }
+    for (c = in.peek(); c >= 0; c = in.peek())
+    {
+        if (std::isdigit(c))
+        {
+            digits = true;
+        }
+        else if (c == '.' && !dot)
+        {
+            dot = true;
+        }
+        else if ((c == 'e' || c == 'E') && digits)
+        {
+            //指数：后面跟着符号和数字
+            text[n < sizeof(text) - 1 ? n++ : n] = (char)in.get();
+            c = in.peek();
+            if (c == '+' || c == '-')
+            {
+                text[n < sizeof(text) - 1 ? n++ : n] = (char)in.get();
+            }
+            while (std::isdigit(in.peek()))
+            {
+                text[n < sizeof(text) - 1 ? n++ : n] = (char)in.get();
+            }
+            break;
+        }
+        else
+        {
+            break;
+        }
+        text[n < sizeof(text) - 1 ? n++ : n] = (char)in.get();
+    }
+    text[n] = '\0';
+    if (!digits)
+    {
+        return false;
+    }
+    value = std::strtod(text, nullptr);
+    return true;
+}
+
+// an arc flag is a single 0 or 1, "a10 10 0 0110 10" is valid
+inline bool svg_flag(DrawingStream& in, bool& flag)
+{
+    drawing_skip_space(in);
+    int c = in.peek();
+    if (c != '0' && c != '1')
+    {
+        return false;
+    }
+    flag = in.get() == '1';
+    return true;
+}
+
+// SVG arc from its endpoint form to centre form (SVG 1.1 appendix F.6.5)
+inline void svg_arc(DrawingTarget& target, glm::dvec2 p1, double rx, double ry, double degrees, bool large, bool sweep, glm::dvec2 p2)
+{
+    rx = std::fabs(rx);
+    ry = std::fabs(ry);
+    if (p1 == p2)
+    {
+        return;
+    }
+    if (rx == 0.0 || ry == 0.0)
+    {
+        target.line(p1, p2);
+        return;
+    }
+    double phi = degrees * PI / 180.0, c = std::cos(phi), s = std::sin(phi);
+    glm::dvec2 h = (p1 - p2) * 0.5;
+    double x1 = c * h.x + s * h.y, y1 = -s * h.x + c * h.y;
+    double lambda = x1 * x1 / (rx * rx) + y1 * y1 / (ry * ry);
+    if (lambda > 1.0)
+    {
+        rx *= std::sqrt(lambda);
+        ry *= std::sqrt(lambda);
+    }
+    double num = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+    double den = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+    double k = std::sqrt(std::max(0.0, num / den)) * (large != sweep ? 1.0 : -1.0);
+    double cx1 = k * rx * y1 / ry, cy1 = -k * ry * x1 / rx;
+    glm::dvec2 centre(c * cx1 - s * cy1 + (p1.x + p2.x) * 0.5, s * cx1 + c * cy1 + (p1.y + p2.y) * 0.5);
+    double start = std::atan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+    double delta = std::atan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - start;
+    if (sweep && delta < 0.0)
+    {
+        delta += 2.0 * PI;
+    }
+    if (!sweep && delta > 0.0)
+    {
+        delta -= 2.0 * PI;
+    }
+    target.arc(centre, rx, ry, phi, start, delta);
+}
+
+// the path data of one d="..." up to the closing quote, straight into target
+inline void svg_path(DrawingStream& in, DrawingTarget& target, int quote)
+{
+    glm::dvec2 current(0.0), subpath(0.0), control(0.0);
+    int command = 0, previous = 0;
+    double v[7];
+    bool flags[2];
+    for (;;)
+    {
+        drawing_skip_space(in);
+        int c = in.peek();
+        if (c < 0 || c == quote)
+        {
+            break;
+        }
+        if (std::isalpha(c))
+        {
+            command = in.get();
+            if (command == 'Z' || command == 'z')
+            {
+                target.line(current, subpath);
+                current = subpath;
+                previous = command;
+                continue;
+            }
+        }
+        else if (command == 0 || command == 'Z' || command == 'z')
+        {
+            target.error("SVG: number without a path command");
+            while (in.peek() >= 0 && in.peek() != quote)
+            {
+                in.get();
+            }
+            break;
+        }
+        bool relative = std::islower(command) != 0;
+        glm::dvec2 base = relative ? current : glm::dvec2(0.0);
+        int upper = std::toupper(command);
+        int count = upper == 'H' || upper == 'V' ? 1 : (upper == 'M' || upper == 'L' || upper == 'T' ? 2 : (upper == 'S' || upper == 'Q' ? 4 : (upper == 'C' ? 6 : (upper == 'A' ? 7 : 0))));
+        bool ok = count > 0;
+        for (int i = 0; i < count && ok; i++)
+        {
+            ok = upper == 'A' && (i == 3 || i == 4) ? svg_flag(in, flags[i - 3]) : svg_number(in, v[i]);
+        }
+        if (!ok)
+        {
+            target.error(std::string("SVG: bad parameters for command ") + (char)command);
+            while (in.peek() >= 0 && in.peek() != quote)
+            {
+                in.get();
+            }
+            break;
+        }
+        //S和T的第一个控制点是上一条曲线最后一个控制点的镜像，上一条不是同类曲线就是当前点
+        bool smooth_cubic = previous == 'C' || previous == 'c' || previous == 'S' || previous == 's';
+        bool smooth_quad = previous == 'Q' || previous == 'q' || previous == 'T' || previous == 't';
+        glm::dvec2 next;
+        switch (upper)
+        {
+        case 'M':
+            current = subpath = base + glm::dvec2(v[0], v[1]);
+            command = relative ? 'l' : 'L';//后面接着的坐标对是lineto
+            break;
+        case 'L':
+            next = base + glm::dvec2(v[0], v[1]);
+            target.line(current, next);
+            current = next;
+            break;
+        case 'H':
+            next = glm::dvec2(base.x + v[0], current.y);
+            target.line(current, next);
+            current = next;
+            break;
+        case 'V':
+            next = glm::dvec2(current.x, base.y + v[0]);
+            target.line(current, next);
+            current = next;
+            break;
+        case 'C':
+        case 'S':
+        {
+            glm::dvec2 b = upper == 'C' ? base + glm::dvec2(v[0], v[1]) : (smooth_cubic ? 2.0 * current - control : current);
+            int k = upper == 'C' ? 2 : 0;
+            control = base + glm::dvec2(v[k], v[k + 1]);
+            next = base + glm::dvec2(v[k + 2], v[k + 3]);
+            target.cubic(current, b, control, next);
+            current = next;
+            break;
+        }
+        case 'Q':
+        case 'T':
+        {
+            control = upper == 'Q' ? base + glm::dvec2(v[0], v[1]) : (smooth_quad ? 2.0 * current - control : current);
+            int k = upper == 'Q' ? 2 : 0;
+            next = base + glm::dvec2(v[k], v[k + 1]);
+            //二次升成三次
+            target.cubic(current, current + (control - current) * (2.0 / 3.0), next + (control - next) * (2.0 / 3.0), next);
+            current = next;
+            break;
+        }
+        case 'A':
+            next = base + glm::dvec2(v[5], v[6]);
+            svg_arc(target, current, v[0], v[1], v[2], flags[0], flags[1], next);
+            current = next;
+            break;
+        }
+        previous = upper == 'M' ? 'M' : command;
+    }
+}
+
+// skip to the end of a comment, declaration or processing instruction after "<!" or "<?"
+inline void svg_skip_markup(DrawingStream& in)
+{
+    bool comment = false;
+    if (in.peek() == '-')
+    {
+        in.get();
+        comment = in.peek() == '-';
+    }
+    int dashes = 0;
+    for (int c = in.get(); c >= 0; c = in.get())
+    {
+        if (c == '>' && (!comment || dashes >= 2))
+        {
+            return;
+        }
+        dashes = c == '-' ? dashes + 1 : 0;
+    }
+}
+
+// every <path> element's d attribute; everything else is skipped as it streams past
+inline void drawing_read_svg(DrawingStream& in, DrawingTarget& target)
+{
+    char name[16];
+    for (int c = in.get(); c >= 0; c = in.get())
+    {
+        if (c != '<')
+        {
+            continue;
+        }
+        if (in.peek() == '!' || in.peek() == '?')
+        {
+            in.get();
+            svg_skip_markup(in);
+            continue;
+        }
+        size_t n = 0;
+        while (in.peek() >= 0 && (std::isalnum(in.peek()) || in.peek() == ':' || in.peek() == '-'))
+        {
+            name[n < sizeof(name) - 1 ? n++ : n] = (char)in.get();
+        }
+        name[n] = '\0';
+        bool path = std::strcmp(name, "path") == 0 || std::strcmp(name, "svg:path") == 0;
+        if (path)
+        {
+            target.report.entities++;
+        }
+        //属性一个一个过去，只解析path的d
+        for (;;)
+        {
+            while (std::isspace(in.peek()))
+            {
+                in.get();
+            }
+            c = in.peek();
+            if (c < 0 || c == '>' || c == '/')
+            {
+                break;
+            }
+            char attribute[16];
+            n = 0;
+            while (in.peek() >= 0 && in.peek() != '=' && in.peek() != '>' && !std::isspace(in.peek()))
+            {
+                attribute[n < sizeof(attribute) - 1 ? n++ : n] = (char)in.get();
+            }
+            attribute[n] = '\0';
+            while (std::isspace(in.peek()))
+            {
+                in.get();
+            }
+            if (in.peek() != '=')
+            {
+                continue;
+            }
+            in.get();
+            while (std::isspace(in.peek()))
+            {
+                in.get();
+            }
+            int quote = in.get();
+            if (quote != '"' && quote != '\'')
+            {
+                break;
+            }
+            if (path && std::strcmp(attribute, "d") == 0)
+            {
+                svg_path(in, target, quote);
+            }
+            while (in.peek() >= 0 && in.peek() != quote)
+            {
+                in.get();
+            }
+            in.get();
+        }
+    }
+}
+
+// ---- DXF ----
+
+// one line of a DXF group pair, trimmed; longer lines are cut to the buffer (only names and numbers are read)
+inline bool dxf_line(DrawingStream& in, char* out, size_t capacity)
+{
+    if (in.peek() < 0)
+    {
+        return false;
+    }
+    size_t n = 0;
+    for (int c = in.get(); c >= 0 && c != '\n'; c = in.get())
+    {
+        if (n + 1 < capacity && (n > 0 || !std::isspace(c)))
+        {
+            out[n++] = (char)c;
+        }
+    }
+    while (n > 0 && std::isspace((unsigned char)out[n - 1]))
+    {
+        n--;
+    }
+    out[n] = '\0';
+    return true;
+}
+
+enum DxfEntity
+{
+    DXF_NONE = 0,
+    DXF_LINE,
+    DXF_ARC,
+    DXF_LWPOLYLINE
+};
+
+// the entity being read: its group values arrive one pair at a time and it is drawn at the next 0 group
+struct DxfState
+{
+    DxfEntity entity = DXF_NONE;
+    glm::dvec2 a, b;//LINE的两端、ARC的圆心
+    double radius = 0.0, start = 0.0, end = 0.0;
+    double extrusion = 1.0;//ARC的OCS：-1是镜像的
+    int flags = 0;//LWPOLYLINE：1是闭合的
+    int vertices = 0;
+    glm::dvec2 first, last, pending;//多段线：第一个点、上一个点、正在读的点
+    double last_bulge = 0.0, pending_bulge = 0.0;
+    bool has_pending = false;
+};
+
+// a polyline segment: straight, or an arc where bulge = tan(included angle / 4), positive counterclockwise
+inline void dxf_bulge(DrawingTarget& target, glm::dvec2 a, glm::dvec2 b, double bulge)
+{
+    if (std::fabs(bulge) < 1e-12 || a == b)
+    {
+        target.line(a, b);
+        return;
+    }
+    glm::dvec2 chord = b - a;
+    glm::dvec2 left(-chord.y, chord.x);
+    glm::dvec2 centre = (a + b) * 0.5 + left * ((1.0 - bulge * bulge) / (4.0 * bulge));
+    double r = glm::length(a - centre);
+    target.arc(centre, r, r, 0.0, std::atan2(a.y - centre.y, a.x - centre.x), 4.0 * std::atan(bulge));
+}
+
+// the vertex read so far is complete: draw the segment that ends at it
+inline void dxf_vertex(DrawingTarget& target, DxfState& s)
+{
+    if (!s.has_pending)
+    {
+        return;
+    }
+    if (s.vertices == 0)
+    {
+        s.first = s.pending;
+    }
+    else
+    {
+        dxf_bulge(target, s.last, s.pending, s.last_bulge);
+    }
+    s.last = s.pending;
+    s.last_bulge = s.pending_bulge;
+    s.vertices++;
+    s.has_pending = false;
+}
+
+inline void dxf_finish(DrawingTarget& target, DxfState& s)
+{
+    switch (s.entity)
+    {
+    case DXF_LINE:
+        target.line(s.a, s.b);
+        break;
+    case DXF_ARC:
+    {
+        double start = s.start, end = s.end;
+        glm::dvec2 centre = s.a;
+        if (s.extrusion < 0.0)
+        {
+            //OCS的z朝后：x镜像，逆时针变成顺时针
+            centre.x = -centre.x;
+            start = 180.0 - s.end;
+            end = 180.0 - s.start;
+        }
+        double sweep = end - start;
+        while (sweep <= 0.0)
+        {
+            sweep += 360.0;
+        }
+        target.arc(centre, s.radius, s.radius, 0.0, start * PI / 180.0, sweep * PI / 180.0);
+        break;
+    }
+    case DXF_LWPOLYLINE:
+        dxf_vertex(target, s);
+        if ((s.flags & 1) && s.vertices >= 2)
+        {
+            dxf_bulge(target, s.last, s.first, s.last_bulge);
+        }
+        break;
+    default:
+        break;
+    }
+    s = DxfState();
+}
+
+// LINE, ARC and LWPOLYLINE entities of the ENTITIES section (blocks and everything else are skipped)
+inline void drawing_read_dxf(DrawingStream& in, DrawingTarget& target)
+{
+    char code_text[64], value[256];
+    DxfState s;
+    bool entities = false, section = false;
+    while (dxf_line(in, code_text, sizeof(code_text)) && dxf_line(in, value, sizeof(value)))
+    {
+        char* end;
+        long code = std::strtol(code_text, &end, 10);
+        if (end == code_text)
+        {
+            target.error(std::string("DXF: bad group code ") + code_text);
+            return;
+        }
+        if (code == 0)
+        {
+            dxf_finish(target, s);
+            section = std::strcmp(value, "SECTION") == 0;
+            if (std::strcmp(value, "ENDSEC") == 0)
+            {
+                entities = false;
+            }
+            if (std::strcmp(value, "EOF") == 0)
+            {
+                return;
+            }
+            if (entities)
+            {
+                s.entity = std::strcmp(value, "LINE") == 0 ? DXF_LINE : (std::strcmp(value, "ARC") == 0 ? DXF_ARC : (std::strcmp(value, "LWPOLYLINE") == 0 ? DXF_LWPOLYLINE : DXF_NONE));
+                target.report.entities += s.entity != DXF_NONE;
+            }
+            continue;
+        }
+        if (code == 2 && section)
+        {
+            entities = std::strcmp(value, "ENTITIES") == 0;
+            section = false;
+            continue;
+        }
+        if (s.entity == DXF_NONE)
+        {
+            continue;
+        }
+        double x = std::strtod(value, nullptr);
+        if (s.entity == DXF_LWPOLYLINE)
+        {
+            switch (code)
+            {
+            case 70: s.flags = (int)x; break;
+            case 10: dxf_vertex(target, s); s.pending = glm::dvec2(x, 0.0); s.pending_bulge = 0.0; s.has_pending = true; break;
+            case 20: s.pending.y = x; break;
+            case 42: s.pending_bulge = x; break;
+            default: break;
+            }
+            continue;
+        }
+        switch (code)
+        {
+        case 10: s.a.x = x; break;
+        case 20: s.a.y = x; break;
+        case 11: s.b.x = x; break;
+        case 21: s.b.y = x; break;
+        case 40: s.radius = x; break;
+        case 50: s.start = x; break;
+        case 51: s.end = x; break;
+        case 230: s.extrusion = x; break;
+        default: break;
+        }
+    }
+    dxf_finish(target, s);
+}
+
+// ---- both ----
+
+// by the file name's extension
+inline DrawingFormat drawing_format(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+    return extension == "svg" ? DRAWING_SVG : (extension == "dxf" ? DRAWING_DXF : DRAWING_UNKNOWN);
+}
+
+// read an SVG or DXF drawing into the target radius at the middle of each of `bins` bins (DRAWING_NONE where no segment
+// passes), see the comment at the top; report.ok if the file was read and reaches at least one bin
+inline bool drawing_read(const std::string& path, int bins, std::vector<float>& radius, DrawingReport& report)
+{
+    auto begin = std::chrono::steady_clock::now();
+    DrawingTarget target(bins);
+    target.report.format = drawing_format(path);
+    DrawingStream in;
+    if (target.report.format == DRAWING_UNKNOWN)
+    {
+        std::cout << "ERROR::DRAWING::UNKNOWN_FORMAT: " << path << std::endl;
+    }
+    else if (!in.open(path))
+    {
+        std::cout << "ERROR::DRAWING::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+    }
+    else if (target.report.format == DRAWING_SVG)
+    {
+        drawing_read_svg(in, target);
+    }
+    else
+    {
+        drawing_read_dxf(in, target);
+    }
+    report = target.report;
+    report.bytes = in.bytes();
+    report.ok = report.bins_hit > 0;
+    report.read_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    radius.swap(target.radius);
+    return report.ok;
+}
+
+// cut the workpiece straight down to radius[] (drawing_read()): each run of bins the drawing reaches is one envelope
+// through the bin middles, held flat to the run's outer bin edges
+inline float drawing_cut(Workpiece& workpiece, const std::vector<float>& radius)
+{
+    const int bins = (int)radius.size();
+    Profile::KnotList envelope;
+    float mount = 0.0f;
+    for (int i = 0; i < bins; i++)
+    {
+        if (radius[i] == DRAWING_NONE)
+        {
+            continue;
+        }
+        envelope.clear();
+        envelope.push_back(std::make_pair((double)i / bins, ProfileKnot{ radius[i], radius[i] }));
+        for (; i < bins && radius[i] != DRAWING_NONE; i++)
+        {
+            envelope.push_back(std::make_pair((i + 0.5) / bins, ProfileKnot{ radius[i], radius[i] }));
+        }
+        envelope.push_back(std::make_pair((double)i / bins, envelope.back().second));
+        mount = std::max(mount, workpiece.cut_envelope(envelope));
+    }
+    return mount;
+}
+
+// the program a drawing's planned path is written to: target.dxf -> target.nc
+inline std::string drawing_program_path(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    return (dot == std::string::npos ? path : path.substr(0, dot)) + ".nc";
+}
+
+inline void print_drawing_report(const std::string& path, const DrawingReport& report)
+{
+    std::cout << "drawing " << path << ": " << report.bytes / 1024 << " KB, " << report.entities << " entities, "
+        << report.segments << " segments, " << report.bins_hit << " bins, " << report.errors << " errors, read in "
+        << report.read_ms << " ms" << std::endl;
+}
+
+#endif
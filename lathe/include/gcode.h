@@ -0,0 +1,667 @@
+#ifndef GCODE_H
+#define GCODE_H
+
+// 数控程序：两轴车床的G代码（G0/G1/G2/G3、G90/G91、G20/G21、G94/G95、G96/G97、G4、F、S、T、M3/M4/M5/M30）
+// 按行流式读取，整个程序不进内存，几十万行的粗车程序也只占一行的缓冲；每一行解析成若干直线移动（圆弧按GCODE_ARC_TOLERANCE拆成折线）
+// X是直径、Z是轴向，Z0在工件+x一端的端面，往-x（卡盘）方向是-Z；U/W是X/Z的增量写法
+// 两种执行方式：run()全速，每个移动用Cutter::cut_sweep()一次切完；tick()按进给速度实时推进，由模拟线程每个tick调用
+// 同样不依赖glad/GLFW
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+
+#include "workpiece.h"
+#include "cutter.h"
+#include "metrology.h"
+#include "collision.h"
+
+const double GCODE_STOCK_DIAMETER = STOCK_DIAMETER;//毛坯直径（mm），对应半径1.0
+const double GCODE_STOCK_LENGTH = STOCK_LENGTH;//毛坯长度（mm），对应工件全长
+const double GCODE_RAPID_RATE = 5000.0;//G0的速度（mm/min）
+const double GCODE_ARC_TOLERANCE = 0.002;//圆弧拆成折线的最大弦高（mm）
+const double GCODE_ARC_MISMATCH = 0.01;//圆弧起点、终点到圆心距离允许的差（mm）
+const int GCODE_MAX_REPORTED_ERRORS = 10;//只打印前几条错误，后面的只计数
+
+// one straight move, in program millimetres (x is a diameter); a dwell has dwell > 0 and does not move
+struct GcodeMove
+{
+    bool rapid = false;
+    double z0 = 0.0, x0 = 0.0, z1 = 0.0, x1 = 0.0;
+    double feed = 0.0;//mm/min
+    double dwell = 0.0;//秒
+};
+
+// profile coordinates of a program position
+inline double gcode_axial(double z)
+{
+    return 1.0 + z / GCODE_STOCK_LENGTH;
+}
+
+inline float gcode_distance(double x)
+{
+    return (float)(x / GCODE_STOCK_DIAMETER);
+}
+
+// the modal state of the control, fed one line at a time
+class GcodeInterpreter
+{
+public:
+    bool absolute = true;//G90/G91
+    bool per_rev = false;//G94 mm/min，G95 mm/r
+    bool css = false;//G96 恒线速，S是m/min（G20下是ft/min）
+    double unit = 1.0;//G21 mm，G20 inch（每英寸的mm数）
+    int motion = 0;//模态的G0~G3
+    double x = GCODE_STOCK_DIAMETER, z = 0.0;//当前位置（mm）
+    double feed = 0.0;//F，按per_rev解释，已经按unit换算成mm/min或mm/r
+    double spindle = 0.0;//S
+    double max_rpm = 0.0;//G50 S，恒线速时的转速上限，0表示不限
+    bool spindle_on = false;
+    int tool = -1;//最近一次T选的tool_library()下标，-1表示程序没换刀
+    bool finished = false;//M2/M30
+    long long line_number = 0;
+    long long errors = 0;
+    double machine_time = 0.0;//按进给和快移速度算的加工时间（秒）
+
+    void reset(double start_x, double start_z);
+    bool parse_line(const char* line, std::vector<GcodeMove>& out);
+
+private:
+    double rpm(double diameter) const;
+    bool feed_rate(double diameter, double& rate);
+    void arc(bool clockwise, double z1, double x1, bool has_center, double ci, double ck, double radius, double rate, std::vector<GcodeMove>& out);
+    void line(bool rapid, double z1, double x1, double rate, std::vector<GcodeMove>& out);
+    void error(const std::string& message);
+};
+
+inline void GcodeInterpreter::reset(double start_x, double start_z)
+{
+    *this = GcodeInterpreter();
+    x = start_x;
+    z = start_z;
+}
+
+inline void GcodeInterpreter::error(const std::string& message)
+{
+    errors++;
+    if (errors <= GCODE_MAX_REPORTED_ERRORS)
+    {
+        std::cout << "ERROR::GCODE::LINE " << line_number << ": " << message << std::endl;
+    }
+}
+
+// spindle speed (rev/min) at a diameter (mm), G96 keeps the surface speed constant
+// (S in m/min, or in feet/min under G20: 12 inches of unit mm each)
+inline double GcodeInterpreter::rpm(double diameter) const
+{
+    if (!spindle_on)
+    {
+        return 0.0;
+    }
+    if (!css)
+    {
+        return spindle;
+    }
+    double surface = unit == 1.0 ? 1000.0 * spindle : 12.0 * unit * spindle;//mm/min
+    double n = surface / (PI * std::max(diameter, 1.0));
+    return max_rpm > 0.0 ? std::min(n, max_rpm) : n;
+}
+
+// feed in mm/min at a diameter, false (and an error) if there is none
+inline bool GcodeInterpreter::feed_rate(double diameter, double& rate)
+{
+    rate = per_rev ? feed * rpm(diameter) : feed;
+    if (rate > 0.0)
+    {
+        return true;
+    }
+    error(per_rev ? "feed per revolution with the spindle stopped" : "no feed rate (F)");
+    return false;
+}
+
+inline void GcodeInterpreter::line(bool rapid, double z1, double x1, double rate, std::vector<GcodeMove>& out)
+{
+    GcodeMove m;
+    m.rapid = rapid;
+    m.z0 = z;
+    m.x0 = x;
+    m.z1 = z1;
+    m.x1 = x1;
+    m.feed = rate;
+    out.push_back(m);
+    double length = std::sqrt((z1 - z) * (z1 - z) + 0.25 * (x1 - x) * (x1 - x));
+    machine_time += length / rate * 60.0;
+    z = z1;
+    x = x1;
+}
+
+// G2/G3 in the (Z, radius) plane, Z to the right and X up: G2 clockwise, G3 counterclockwise
+// the centre is I (radius) / K from the start point, or found from R (negative R: the arc longer than half a circle)
+inline void GcodeInterpreter::arc(bool clockwise, double z1, double x1, bool has_center, double ci, double ck, double radius, double rate, std::vector<GcodeMove>& out)
+{
+    const double r0 = 0.5 * x, r1 = 0.5 * x1;
+    double cz, cr;
+    if (has_center)
+    {
+        cz = z + ck;
+        cr = r0 + ci;
+    }
+    else
+    {
+        double dz = z1 - z, dr = r1 - r0;
+        double chord = std::sqrt(dz * dz + dr * dr);
+        double half = 0.5 * chord;
+        if (chord <= 0.0 || std::fabs(radius) < half - GCODE_ARC_MISMATCH)
+        {
+            error("arc radius R too small for its end point");
+            return;
+        }
+        double h = std::sqrt(std::max(0.0, radius * radius - half * half));
+        //圆心在弦的左侧是逆时针的短弧
+        double side = (clockwise ? -1.0 : 1.0) * (radius < 0.0 ? -1.0 : 1.0);
+        cz = z + 0.5 * dz - side * h * dr / chord;
+        cr = r0 + 0.5 * dr + side * h * dz / chord;
+    }
+    double rs = std::hypot(z - cz, r0 - cr);
+    double re = std::hypot(z1 - cz, r1 - cr);
+    if (std::fabs(rs - re) > GCODE_ARC_MISMATCH || rs <= 0.0)
+    {
+        error("arc end point is not on the circle");
+        return;
+    }
+    double a0 = std::atan2(r0 - cr, z - cz);
+    double sweep = std::atan2(r1 - cr, z1 - cz) - a0;
+    if (clockwise)
+    {
+        while (sweep >= 0.0)
+        {
+            sweep -= 2.0 * PI;
+        }
+    }
+    else
+    {
+        while (sweep <= 0.0)
+        {
+            sweep += 2.0 * PI;
+        }
+    }
+    double step = 2.0 * std::acos(std::max(-1.0, 1.0 - GCODE_ARC_TOLERANCE / std::max(rs, re)));
+    int n = std::max(1, (int)std::ceil(std::fabs(sweep) / std::max(step, 1e-6)));
+    for (int i = 1; i <= n; i++)
+    {
+        double t = (double)i / n;
+        if (i == n)
+        {
+            line(false, z1, x1, rate, out);
+            break;
+        }
+        double a = a0 + sweep * t;
+        double r = rs + (re - rs) * t;
+        line(false, cz + r * std::cos(a), 2.0 * (cr + r * std::sin(a)), rate, out);
+    }
+}
+
+// the number after a word letter: sign, digits, decimal point, no exponent
+// (strtod would read "G0X10" as the hex number 0X10); false if there are no digits
+inline bool gcode_number(const char*& p, double& value)
+{
+    const char* q = p;
+    while (*q == ' ' || *q == '\t')
+    {
+        q++;
+    }
+    double sign = 1.0;
+    if (*q == '+' || *q == '-')
+    {
+        sign = *q == '-' ? -1.0 : 1.0;
+        q++;
+    }
+    double mantissa = 0.0, scale = 1.0;
+    bool digits = false, point = false;
+    for (; ; q++)
+    {
+        if (*q >= '0' && *q <= '9')
+        {
+            mantissa = mantissa * 10.0 + (*q - '0');
+            if (point)
+            {
+                scale *= 10.0;
+            }
+            digits = true;
+        }
+        else if (*q == '.' && !point)
+        {
+            point = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (!digits)
+    {
+        return false;
+    }
+    value = sign * mantissa / scale;
+    p = q;
+    return true;
+}
+
+// one program line: update the modal state and append the moves it makes (none for most setup lines);
+// false when the line had an error (the line is skipped, the program goes on)
+inline bool GcodeInterpreter::parse_line(const char* text, std::vector<GcodeMove>& out)
+{
+    line_number++;
+    if (finished)
+    {
+        return true;
+    }
+    bool has_x = false, has_z = false, has_u = false, has_w = false, has_i = false, has_k = false, has_r = false;
+    bool has_f = false, has_p = false;
+    double vx = 0.0, vz = 0.0, vu = 0.0, vw = 0.0, vi = 0.0, vk = 0.0, vr = 0.0, vf = 0.0, vp = 0.0;
+    int motion_word = -1;
+    bool dwell_word = false, g50 = false;
+    long long errors_before = errors;
+    for (const char* p = text; *p; )
+    {
+        char c = (char)std::toupper((unsigned char)*p);
+        if (c == '(')
+        {
+            while (*p && *p != ')')
+            {
+                p++;
+            }
+            if (*p)
+            {
+                p++;
+            }
+            continue;
+        }
+        if (c == ';' || c == '%')
+        {
+            break;
+        }
+        if (!std::isalpha((unsigned char)c))
+        {
+            p++;//空白、行首的/、回车
+            continue;
+        }
+        double v;
+        p++;
+        if (!gcode_number(p, v))
+        {
+            error(std::string("word ") + c + " without a number");
+            return false;
+        }
+        int code = (int)std::floor(v + 0.5);
+        switch (c)
+        {
+        case 'G':
+            if (code >= 0 && code <= 3 && v == code)
+            {
+                motion_word = code;
+            }
+            else if (code == 4) { dwell_word = true; }
+            else if (code == 20) { unit = 25.4; }
+            else if (code == 21) { unit = 1.0; }
+            else if (code == 90) { absolute = true; }
+            else if (code == 91) { absolute = false; }
+            else if (code == 94) { per_rev = false; }
+            else if (code == 95) { per_rev = true; }
+            else if (code == 96) { css = true; }
+            else if (code == 97) { css = false; }
+            else if (code == 50) { g50 = true; }
+            else if (code == 18 || code == 40 || code == 80 || (code >= 54 && code <= 59)) {}//只有一个平面，没有刀补和坐标系偏置
+            else
+            {
+                error("unsupported G" + std::to_string(code));
+            }
+            break;
+        case 'M':
+            if (code == 3 || code == 4) { spindle_on = true; }
+            else if (code == 5) { spindle_on = false; }
+            else if (code == 2 || code == 30) { finished = true; }
+            else if (code == 0 || code == 1 || code == 6 || code == 8 || code == 9) {}//暂停、换刀、冷却液：模拟里没有作用
+            else
+            {
+                error("unsupported M" + std::to_string(code));
+            }
+            break;
+        case 'X': has_x = true; vx = v; break;
+        case 'Z': has_z = true; vz = v; break;
+        case 'U': has_u = true; vu = v; break;
+        case 'W': has_w = true; vw = v; break;
+        case 'I': has_i = true; vi = v; break;
+        case 'K': has_k = true; vk = v; break;
+        case 'R': has_r = true; vr = v; break;
+        case 'F': has_f = true; vf = v; break;
+        case 'S':
+            if (g50)
+            {
+                max_rpm = v;
+            }
+            else
+            {
+                spindle = v;
+            }
+            break;
+        case 'P': has_p = true; vp = v; break;
+        case 'T':
+            //T0202：前两位是刀号；刀号就是tool_library()的下标
+            tool = code >= 100 ? code / 100 : code;
+            if (tool >= (int)tool_library().size())
+            {
+                error("no tool " + std::to_string(tool) + " in the library");
+                tool = -1;
+            }
+            break;
+        case 'N': case 'O': break;
+        default:
+            error(std::string("unsupported word ") + c);
+            break;
+        }
+    }
+    if (errors != errors_before)
+    {
+        return false;
+    }
+    //F在整行读完之后换算，同一行的G20/G21也算数
+    if (has_f)
+    {
+        feed = vf * unit;
+    }
+    if (dwell_word)
+    {
+        //G4 P是毫秒，G4 X/U是秒
+        double dwell = has_p ? vp * 0.001 : (has_x ? vx : (has_u ? vu : 0.0));
+        GcodeMove m;
+        m.z0 = m.z1 = z;
+        m.x0 = m.x1 = x;
+        m.dwell = dwell;
+        machine_time += dwell;
+        out.push_back(m);
+        return true;
+    }
+    if (motion_word >= 0)
+    {
+        motion = motion_word;
+    }
+    if (g50 || !(has_x || has_z || has_u || has_w))
+    {
+        return true;
+    }
+    double x1 = x, z1 = z;
+    if (has_x)
+    {
+        x1 = absolute ? vx * unit : x + vx * unit;
+    }
+    if (has_z)
+    {
+        z1 = absolute ? vz * unit : z + vz * unit;
+    }
+    if (has_u)
+    {
+        x1 += vu * unit;
+    }
+    if (has_w)
+    {
+        z1 += vw * unit;
+    }
+    if (motion == 0)
+    {
+        line(true, z1, x1, GCODE_RAPID_RATE, out);
+        return true;
+    }
+    double rate;
+    if (!feed_rate(std::min(x, x1), rate))
+    {
+        return false;
+    }
+    if (motion == 1)
+    {
+        line(false, z1, x1, rate, out);
+        return true;
+    }
+    if (!(has_i || has_k) && !has_r)
+    {
+        error("arc without I/K or R");
+        return false;
+    }
+    arc(motion == 2, z1, x1, has_i || has_k, vi * unit, vk * unit, vr * unit, rate, out);
+    return errors == errors_before;
+}
+
+// what a program run did
+struct GcodeReport
+{
+    long long lines = 0;
+    long long moves = 0;
+    long long errors = 0;
+    long long rapid_collisions = 0;//会切进工件的G0
+    double seconds = 0.0;//墙钟时间
+    double machine_time = 0.0;//程序在机床上要跑多久
+};
+
+inline void print_gcode_report(const GcodeReport& r)
+{
+    std::cout << "gcode: " << r.lines << " lines, " << r.moves << " moves, " << r.errors << " errors, "
+        << r.seconds << " s (" << (r.seconds > 0.0 ? r.lines / r.seconds : 0.0) << " lines/s), machine time " << r.machine_time << " s";
+    if (r.rapid_collisions > 0)
+    {
+        std::cout << ", " << r.rapid_collisions << " rapid moves into the part";
+    }
+    std::cout << std::endl;
+}
+
+// a program file streamed line by line into the cutter
+class GcodeProgram
+{
+public:
+    GcodeInterpreter state;
+    //设了就在每条G0之前检查会不会切进工件（collision.h），按rapid_policy报错或者停下
+    Metrology* guard = nullptr;
+    RapidPolicy rapid_policy = RAPID_STOP;
+
+    bool open(const std::string& path, const Cutter& cutter);
+    void close();
+    bool active() const;
+    bool next_move(GcodeMove& move);
+    GcodeReport run(Workpiece& workpiece, Cutter& cutter);
+    float tick(Workpiece& workpiece, Cutter& cutter, long long tick);
+    GcodeReport report() const;
+
+private:
+    bool rapid_allowed(Workpiece& workpiece, const Cutter& cutter, const GcodeMove& m);
+
+    std::ifstream file;
+    std::string text;
+    std::vector<GcodeMove> pending;
+    size_t pending_next = 0;
+    long long moves = 0;
+    long long collisions = 0;
+    std::chrono::steady_clock::time_point start_time;
+
+    //tick()：正在走的移动和走过的长度（mm）/停留的时间
+    bool moving = false;
+    GcodeMove move;
+    double done = 0.0;
+};
+
+// start a program at the knife's current position
+inline bool GcodeProgram::open(const std::string& path, const Cutter& cutter)
+{
+    close();
+    file.open(path);
+    if (!file)
+    {
+        std::cout << "ERROR::GCODE::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    state.reset(cutter.knife_distance * GCODE_STOCK_DIAMETER, (cutter.knife_axial() - 1.0) * GCODE_STOCK_LENGTH);
+    moves = 0;
+    collisions = 0;
+    start_time = std::chrono::steady_clock::now();
+    return true;
+}
+
+inline void GcodeProgram::close()
+{
+    if (file.is_open())
+    {
+        file.close();
+    }
+    file.clear();
+    pending.clear();
+    pending_next = 0;
+    moving = false;
+}
+
+inline bool GcodeProgram::active() const
+{
+    return file.is_open();
+}
+
+// the next move of the program, reading as many lines as it takes; false at the end (M30 or end of file)
+inline bool GcodeProgram::next_move(GcodeMove& next)
+{
+    while (pending_next >= pending.size())
+    {
+        pending.clear();
+        pending_next = 0;
+        if (state.finished || !std::getline(file, text))
+        {
+            return false;
+        }
+        state.parse_line(text.c_str(), pending);
+    }
+    next = pending[pending_next++];
+    moves++;
+    return true;
+}
+
+// the whole program at full speed: every move cut at once, the knife ends where the program does
+inline GcodeReport GcodeProgram::run(Workpiece& workpiece, Cutter& cutter)
+{
+    GcodeMove m;
+    while (next_move(m))
+    {
+        if (state.tool >= 0)
+        {
+            cutter.tool = state.tool;
+        }
+        if (m.dwell > 0.0)
+        {
+            continue;
+        }
+        if (m.rapid && !rapid_allowed(workpiece, cutter, m))
+        {
+            cutter.set_position(gcode_axial(m.z0), gcode_distance(m.x0));
+            GcodeReport r = report();
+            close();
+            return r;
+        }
+        cutter.cut_sweep(workpiece, gcode_axial(m.z0), gcode_distance(m.x0), gcode_axial(m.z1), gcode_distance(m.x1));
+    }
+    cutter.set_position(gcode_axial(state.z), gcode_distance(state.x));
+    GcodeReport r = report();
+    close();
+    return r;
+}
+
+// real-time pace: move the knife along the program for one motion tick at the programmed feed
+// (carrying over into the next move when one ends inside the tick) and cut each piece with Cutter::cut_move(),
+// so the spindle angles and the particles work as with the arrow keys; the program closes itself at the end
+inline float GcodeProgram::tick(Workpiece& workpiece, Cutter& cutter, long long tick)
+{
+    double budget = 1.0 / MOTION_TICK_RATE;
+    float mount = 0.0f;
+    while (budget > 0.0 && active())
+    {
+        if (!moving)
+        {
+            if (!next_move(move))
+            {
+                print_gcode_report(report());
+                close();
+                break;
+            }
+            if (state.tool >= 0)
+            {
+                cutter.tool = state.tool;
+            }
+            if (move.rapid && !rapid_allowed(workpiece, cutter, move))
+            {
+                print_gcode_report(report());
+                close();
+                break;
+            }
+            moving = true;
+            done = 0.0;
+        }
+        if (move.dwell > 0.0)
+        {
+            double t = std::min(budget, move.dwell - done);
+            done += t;
+            budget -= t;
+            moving = done < move.dwell;
+            continue;
+        }
+        double length = std::sqrt((move.z1 - move.z0) * (move.z1 - move.z0) + 0.25 * (move.x1 - move.x0) * (move.x1 - move.x0));
+        double speed = move.feed / 60.0;
+        double t = std::min(budget, (length - done) / speed);
+        budget -= t;
+        done += t * speed;
+        double s = 1.0;
+        if (done >= length || budget > 0.0)
+        {
+            moving = false;
+        }
+        else
+        {
+            s = done / length;
+        }
+        double from = cutter.knife_axial();
+        float from_distance = cutter.knife_distance;
+        cutter.set_position(gcode_axial(move.z0 + (move.z1 - move.z0) * s), gcode_distance(move.x0 + (move.x1 - move.x0) * s));
+        mount = std::max(mount, cutter.cut_move(workpiece, tick, from, from_distance));
+    }
+    return mount;
+}
+
+inline GcodeReport GcodeProgram::report() const
+{
+    GcodeReport r;
+    r.lines = state.line_number;
+    r.moves = moves;
+    r.errors = state.errors;
+    r.rapid_collisions = collisions;
+    r.machine_time = state.machine_time;
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return r;
+}
+
+// check a G0 before it moves (with a guard set): a hit is reported with the line, false if the program has to stop there
+inline bool GcodeProgram::rapid_allowed(Workpiece& workpiece, const Cutter& cutter, const GcodeMove& m)
+{
+    RapidCollision hit;
+    if (!guard || rapid_policy == RAPID_IGNORE
+        || !rapid_collision(*guard, workpiece, tool_library()[cutter.tool], gcode_axial(m.z0), gcode_distance(m.x0), gcode_axial(m.z1), gcode_distance(m.x1), hit))
+    {
+        return true;
+    }
+    collisions++;
+    if (collisions <= GCODE_MAX_REPORTED_ERRORS)
+    {
+        std::cout << "ERROR::GCODE::LINE " << state.line_number << ": rapid move into the part at Z" << (hit.u - 1.0) * GCODE_STOCK_LENGTH
+            << ", " << hit.depth * GCODE_STOCK_DIAMETER * 0.5 << " mm deep" << (rapid_policy == RAPID_STOP ? ", program stopped" : "") << std::endl;
+    }
+    return rapid_policy != RAPID_STOP;
+}
+
+#endif
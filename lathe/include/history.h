@@ -0,0 +1,315 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+// 撤销/重做：工件状态的快照，写时复制
+// 轮廓按轴向分成HISTORY_CHUNKS块，二维半径场按FIELD_TILE块，每块是一个共享的只读副本（shared_ptr）；
+// 新快照先共享上一份的所有块，只有上次快照之后改过的范围（Workpiece::changed_u0/u1）里内容真的变了的块才复制一份新的
+// 恢复时只改写和当前状态不同的块，对应的segment走mark_dirty()，点阵按dirty范围重建、只上传改过的部分
+// 同样不依赖glad/GLFW
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+
+#include "workpiece.h"
+
+const int HISTORY_CHUNKS = 32;//轮廓分成的块数，块u在[k/HISTORY_CHUNKS, (k+1)/HISTORY_CHUNKS)
+const int HISTORY_LEVELS = 256;//最多保留的步数，更早的丢掉
+
+typedef std::shared_ptr<const Profile::KnotList> ProfileChunk;
+typedef std::shared_ptr<const std::vector<float> > FieldTile;
+
+// one level: every chunk and tile shared with the neighbouring levels unless it changed in between
+struct WorkpieceSnapshot
+{
+    std::vector<ProfileChunk> chunks;
+    bool field_enabled = false;
+    int field_y = 0;
+    int field_theta = 0;
+    std::vector<FieldTile> tiles;
+};
+
+class History
+{
+public:
+    void clear(Workpiece& workpiece);
+    bool checkpoint(Workpiece& workpiece);
+    bool undo(Workpiece& workpiece);
+    bool redo(Workpiece& workpiece);
+    int levels() const;
+    int position() const;
+    size_t bytes() const;
+
+private:
+    std::vector<WorkpieceSnapshot> snapshots;
+    int current = -1;//工件现在（加上changed范围里的改动）等于哪一份
+
+    void capture(Workpiece& workpiece, const WorkpieceSnapshot* base, WorkpieceSnapshot& out) const;
+    void restore(Workpiece& workpiece, const WorkpieceSnapshot& from, const WorkpieceSnapshot& to);
+};
+
+inline double history_chunk_u0(int k)
+{
+    return (double)k / HISTORY_CHUNKS;
+}
+
+// the last chunk also holds the knot at u = 1
+inline double history_chunk_u1(int k)
+{
+    return k == HISTORY_CHUNKS - 1 ? 2.0 : (double)(k + 1) / HISTORY_CHUNKS;
+}
+
+// start over with the workpiece as it is now as the only level
+inline void History::clear(Workpiece& workpiece)
+{
+    snapshots.clear();
+    snapshots.push_back(WorkpieceSnapshot());
+    capture(workpiece, nullptr, snapshots.back());
+    current = 0;
+}
+
+// call before anything that may cut: if the workpiece changed since the current level it becomes a new level
+// (dropping what could be redone); false when nothing changed
+inline bool History::checkpoint(Workpiece& workpiece)
+{
+    if (current < 0)
+    {
+        clear(workpiece);
+        return true;
+    }
+    if (workpiece.changed_u0 > workpiece.changed_u1)
+    {
+        return false;
+    }
+    WorkpieceSnapshot next;
+    capture(workpiece, &snapshots[current], next);
+    snapshots.resize(current + 1);
+    snapshots.push_back(next);
+    if ((int)snapshots.size() > HISTORY_LEVELS)
+    {
+        snapshots.erase(snapshots.begin());
+    }
+    current = (int)snapshots.size() - 1;
+    return true;
+}
+
+// go back one level, the changes since the last checkpoint count as a level of their own
+inline bool History::undo(Workpiece& workpiece)
+{
+    checkpoint(workpiece);
+    if (current <= 0)
+    {
+        return false;
+    }
+    current--;
+    restore(workpiece, snapshots[current + 1], snapshots[current]);
+    return true;
+}
+
+inline bool History::redo(Workpiece& workpiece)
+{
+    if (current < 0 || current + 1 >= (int)snapshots.size() || workpiece.changed_u0 <= workpiece.changed_u1)
+    {
+        return false;//撤销之后又切过，重做的那些已经不算了（下一次checkpoint会丢掉）
+    }
+    current++;
+    restore(workpiece, snapshots[current - 1], snapshots[current]);
+    return true;
+}
+
+inline int History::levels() const
+{
+    return (int)snapshots.size();
+}
+
+inline int History::position() const
+{
+    return current;
+}
+
+// memory held by all the levels, each shared chunk and tile counted once
+inline size_t History::bytes() const
+{
+    std::vector<std::pair<const void*, size_t> > blocks;
+    size_t total = 0;
+    for (size_t i = 0; i < snapshots.size(); i++)
+    {
+        const WorkpieceSnapshot& s = snapshots[i];
+        total += sizeof(WorkpieceSnapshot) + s.chunks.capacity() * sizeof(ProfileChunk) + s.tiles.capacity() * sizeof(FieldTile);
+        for (size_t k = 0; k < s.chunks.size(); k++)
+        {
+            blocks.push_back(std::make_pair((const void*)s.chunks[k].get(),
+                sizeof(Profile::KnotList) + s.chunks[k]->capacity() * sizeof(Profile::KnotList::value_type)));
+        }
+        for (size_t n = 0; n < s.tiles.size(); n++)
+        {
+            blocks.push_back(std::make_pair((const void*)s.tiles[n].get(), sizeof(std::vector<float>) + s.tiles[n]->capacity() * sizeof(float)));
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        if (i == 0 || blocks[i].first != blocks[i - 1].first)
+        {
+            total += blocks[i].second;
+        }
+    }
+    return total;
+}
+
+inline bool history_same_knots(const Profile::KnotList& a, const Profile::KnotList& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].first != b[i].first || a[i].second.left != b[i].second.left || a[i].second.right != b[i].second.right
+            || a[i].second.error != b[i].second.error)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// widen [u0, u1) to the knots just outside it: a cut may merge away one knot on each side of its span,
+// and the segments between those knots and the span are interpolated across it
+inline void history_knot_range(const Profile& profile, double& u0, double& u1)
+{
+    Profile::KnotMap::const_iterator it = profile.knots.lower_bound(u0);
+    if (it != profile.knots.begin())
+    {
+        u0 = std::prev(it)->first;
+    }
+    it = profile.knots.lower_bound(u1);
+    u1 = it != profile.knots.end() ? it->first : 1.0;
+}
+
+// a snapshot sharing base's chunks and tiles, copying only those inside the changed range whose contents differ
+// (without a base, or when the 2D field was switched or resized, everything is copied); clears the changed range
+inline void History::capture(Workpiece& workpiece, const WorkpieceSnapshot* base, WorkpieceSnapshot& out) const
+{
+    double u0 = workpiece.changed_u0, u1 = workpiece.changed_u1;
+    history_knot_range(workpiece.profile, u0, u1);
+    out.chunks.resize(HISTORY_CHUNKS);
+    Profile::KnotList knots;
+    for (int k = 0; k < HISTORY_CHUNKS; k++)
+    {
+        if (base && (u0 >= history_chunk_u1(k) || u1 < history_chunk_u0(k)))
+        {
+            out.chunks[k] = base->chunks[k];
+            continue;
+        }
+        workpiece.profile.copy_knots(history_chunk_u0(k), history_chunk_u1(k), knots);
+        if (base && history_same_knots(*base->chunks[k], knots))
+        {
+            out.chunks[k] = base->chunks[k];
+            continue;
+        }
+        out.chunks[k] = std::make_shared<const Profile::KnotList>(knots);
+    }
+    out.field_enabled = workpiece.field_enabled;
+    out.field_y = 0;
+    out.field_theta = 0;
+    out.tiles.clear();
+    if (workpiece.field_enabled)
+    {
+        const RadiusField& field = workpiece.field;
+        out.field_y = field.y_segments;
+        out.field_theta = field.theta_segments;
+        bool same_field = base && base->field_enabled && base->field_y == field.y_segments && base->field_theta == field.theta_segments;
+        //半径场的行和segment一一对应，没改过的行所在的块直接共享
+        int tile_first = (int)std::floor(std::max(0.0, workpiece.changed_u0) * field.y_segments) / FIELD_TILE;
+        int tile_last = (int)std::ceil(std::min(1.0, workpiece.changed_u1) * field.y_segments) / FIELD_TILE;
+        const size_t cells = FIELD_TILE * FIELD_TILE;
+        out.tiles.resize(field.tiles_y * field.tiles_theta);
+        for (int n = 0; n < field.tiles_y * field.tiles_theta; n++)
+        {
+            int row = n / field.tiles_theta;
+            if (same_field && (row < tile_first || row > tile_last
+                || std::memcmp(base->tiles[n]->data(), field.tile(n), cells * sizeof(float)) == 0))
+            {
+                out.tiles[n] = base->tiles[n];
+                continue;
+            }
+            out.tiles[n] = std::make_shared<const std::vector<float> >(field.tile(n), field.tile(n) + cells);
+        }
+    }
+    workpiece.changed_u0 = 2.0;
+    workpiece.changed_u1 = -1.0;
+}
+
+// resample and mark dirty the segments under the profile range [u0, u1) (after history_knot_range())
+inline void history_resample(Workpiece& workpiece, double u0, double u1)
+{
+    history_knot_range(workpiece.profile, u0, u1);
+    int first = std::max(0, std::min(workpiece.y_segments - 1, (int)std::floor(u0 * workpiece.y_segments)));
+    int last = std::max(first, std::min(workpiece.y_segments - 1, (int)std::ceil(u1 * workpiece.y_segments)));
+    workpiece.profile.mean_radii(first, last - first + 1, workpiece.y_segments, &workpiece.radius[first]);
+    workpiece.mark_dirty(first, last);
+}
+
+// turn the workpiece, which equals snapshot from, into snapshot to: only the chunks and tiles that are not shared
+// between the two are rewritten, and only the segments under them are resampled and marked dirty,
+// so the mesh is rebuilt and uploaded through the usual dirty range instead of from scratch
+inline void History::restore(Workpiece& workpiece, const WorkpieceSnapshot& from, const WorkpieceSnapshot& to)
+{
+    bool same_field = from.field_enabled == to.field_enabled && from.field_y == to.field_y && from.field_theta == to.field_theta
+        && workpiece.field_enabled == to.field_enabled && (!to.field_enabled || workpiece.field.y_segments == to.field_y);
+    if (!same_field && workpiece.field_enabled && !to.field_enabled)
+    {
+        workpiece.set_field_enabled(false);//关掉时会把半径场切进轮廓里，所以先关，下面再整个换掉轮廓
+    }
+    for (int k = 0; k < HISTORY_CHUNKS; )
+    {
+        if (same_field && from.chunks[k] == to.chunks[k])
+        {
+            k++;
+            continue;
+        }
+        int run = k;//连续几块一起换、一起重采样
+        while (run < HISTORY_CHUNKS && !(same_field && from.chunks[run] == to.chunks[run]))
+        {
+            workpiece.profile.replace_knots(history_chunk_u0(run), history_chunk_u1(run), *to.chunks[run]);
+            run++;
+        }
+        history_resample(workpiece, history_chunk_u0(k), std::min(1.0, history_chunk_u1(run - 1)));
+        k = run;
+    }
+    if (to.field_enabled)
+    {
+        if (!workpiece.field_enabled)
+        {
+            workpiece.set_field_enabled(true, to.field_theta);
+        }
+        RadiusField& field = workpiece.field;
+        if (field.y_segments == to.field_y && field.theta_segments == to.field_theta)
+        {
+            for (int n = 0; n < (int)to.tiles.size(); n++)
+            {
+                if (same_field && from.tiles[n] == to.tiles[n])
+                {
+                    continue;
+                }
+                field.set_tile(n, to.tiles[n]->data());
+                int y, theta;
+                field.tile_origin(n, y, theta);
+                workpiece.mark_dirty(y, std::min(field.y_segments, y + FIELD_TILE) - 1);
+            }
+        }
+        else
+        {
+            //分辨率换过了，块对不上，只能按轮廓重新开始
+            field.init(workpiece.y_segments, workpiece.x_segments, &workpiece.radius[0]);
+            workpiece.mark_dirty(0, workpiece.y_segments);
+        }
+    }
+    workpiece.changed_u0 = 2.0;
+    workpiece.changed_u1 = -1.0;
+}
+
+#endif
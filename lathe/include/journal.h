@@ -0,0 +1,392 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+// 会话记录：所有影响模拟的输入（方向键、Shift、重置、换分辨率、二维模式、换刀、bezier、样条、图纸目标、G代码、材质、撤销/重做、走刀规划）
+// 按模拟线程的tick记进一个紧凑的二进制文件；重放时按同样的tick顺序重新执行，切出的radius[]逐位相同
+// 格式：8字节"LATHEJNL"、4字节版本，然后一条条记录：tick增量（varint）、类型（1字节）、内容
+// 整数是varint，浮点数按小端原样写入，字符串是varint长度加字节
+// 同样不依赖glad/GLFW
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "workpiece.h"
+
+const char JOURNAL_MAGIC[8] = { 'L', 'A', 'T', 'H', 'E', 'J', 'N', 'L' };
+const uint32_t JOURNAL_VERSION = 1;
+
+enum JournalRecordType {
+    JOURNAL_SETUP = 1,//开始记录时的状态
+    JOURNAL_INPUT,//方向键、走刀倍率变了
+    JOURNAL_COMMAND,//一条SimulationCommand
+    JOURNAL_END//结束：总tick数和radius[]的哈希
+};
+
+enum SimulationCommandType {
+    COMMAND_RESET = 1,
+    COMMAND_RESOLUTION,//value：y_segments
+    COMMAND_FIELD,//value：1打开二维半径场，0关掉
+    COMMAND_TOOL,//value：tool_library()的下标，-1是下一把
+    COMMAND_BEZIER,//points：四个控制点
+    COMMAND_GCODE,//path：程序文件，value：1全速；程序在跑时停止它
+    COMMAND_MATERIAL,//value：材质（metrology_materials()的下标），影响绘制和切削遥测的比切削能
+    COMMAND_UNDO,//撤销一步（history.h）
+    COMMAND_REDO,
+    COMMAND_PLAN,//points：bezier目标，value：粗车策略，path：写出的程序；规划后按进给实时跑（planner.h）
+    COMMAND_SPLINE,//spline：控制点（spline.h），value：-1一次切到位，否则和COMMAND_PLAN一样按这种粗车策略规划，path：写出的程序
+    COMMAND_DRAWING//path：SVG/DXF图纸（drawing.h），value和COMMAND_SPLINE一样，程序写在drawing_program_path(path)；重放时重新读图纸
+};
+
+// a change to the simulation from the user, as data so it can be journaled and replayed
+struct SimulationCommand
+{
+    int type = 0;
+    int value = 0;
+    glm::vec2 points[4];
+    std::vector<glm::vec2> spline;
+    std::string path;
+};
+
+// the state the recording starts from
+struct JournalSetup
+{
+    int y_segments = Y_SEGMENTS;
+    int x_segments = X_SEGMENTS;
+    int r_segments = R_SEGMENTS;
+    bool field_enabled = false;
+    int tool = 0;
+    double spindle_speed = 0.0;
+    double spindle_phase = 0.0;
+};
+
+// one record read back
+struct JournalRecord
+{
+    int type = 0;
+    long long tick = 0;
+    JournalSetup setup;
+    int axial_dir = 0;
+    int radial_dir = 0;
+    float feed_scale = 1.0f;
+    SimulationCommand command;
+    int y_segments = 0;
+    uint64_t hash = 0;
+};
+
+// FNV-1a over the bytes of radius[] (and the 2D field when it is on): equal only for a bit-identical part
+inline uint64_t workpiece_hash(const Workpiece& workpiece)
+{
+    uint64_t h = 14695981039346656037ull;
+    auto add = [&h](const void* data, size_t size) {
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            h = (h ^ p[i]) * 1099511628211ull;
+        }
+    };
+    add(workpiece.radius.data(), workpiece.radius.size() * sizeof(float));
+    if (workpiece.field_enabled)
+    {
+        add(workpiece.field.data.data(), workpiece.field.data.size() * sizeof(float));
+    }
+    return h;
+}
+
+class JournalWriter
+{
+public:
+    bool open(const std::string& path, const JournalSetup& setup);
+    void close(long long tick, const Workpiece& workpiece);
+    bool recording() const;
+    void input(long long tick, int axial_dir, int radial_dir, float feed_scale);
+    void command(long long tick, const SimulationCommand& command);
+    size_t bytes() const;
+
+private:
+    std::ofstream file;
+    std::vector<unsigned char> buffer;//一条记录
+    long long last_tick = 0;
+    size_t written = 0;
+
+    void begin(long long tick, int type);
+    void put_varint(uint64_t v);
+    void put_int(long long v);
+    void put_raw(const void* data, size_t size);
+    void flush_record();
+};
+
+inline bool JournalWriter::open(const std::string& path, const JournalSetup& setup)
+{
+    file.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::JOURNAL::FILE_NOT_SUCCESFULLY_OPENED: " << path << std::endl;
+        return false;
+    }
+    file.write(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    file.write((const char*)&JOURNAL_VERSION, sizeof(JOURNAL_VERSION));
+    written = sizeof(JOURNAL_MAGIC) + sizeof(JOURNAL_VERSION);
+    last_tick = 0;
+    begin(0, JOURNAL_SETUP);
+    put_int(setup.y_segments);
+    put_int(setup.x_segments);
+    put_int(setup.r_segments);
+    put_int(setup.field_enabled);
+    put_int(setup.tool);
+    put_raw(&setup.spindle_speed, sizeof(double));
+    put_raw(&setup.spindle_phase, sizeof(double));
+    flush_record();
+    return true;
+}
+
+// the end record lets a replay check it ended with the same part
+inline void JournalWriter::close(long long tick, const Workpiece& workpiece)
+{
+    if (!recording())
+    {
+        return;
+    }
+    begin(tick, JOURNAL_END);
+    put_int(workpiece.y_segments);
+    uint64_t hash = workpiece_hash(workpiece);
+    put_raw(&hash, sizeof(hash));
+    flush_record();
+    file.close();
+}
+
+inline bool JournalWriter::recording() const
+{
+    return file.is_open();
+}
+
+inline void JournalWriter::input(long long tick, int axial_dir, int radial_dir, float feed_scale)
+{
+    if (!recording())
+    {
+        return;
+    }
+    begin(tick, JOURNAL_INPUT);
+    put_int(axial_dir);
+    put_int(radial_dir);
+    put_raw(&feed_scale, sizeof(float));
+    flush_record();
+}
+
+inline void JournalWriter::command(long long tick, const SimulationCommand& c)
+{
+    if (!recording())
+    {
+        return;
+    }
+    begin(tick, JOURNAL_COMMAND);
+    put_int(c.type);
+    put_int(c.value);
+    if (c.type == COMMAND_BEZIER || c.type == COMMAND_PLAN)
+    {
+        put_raw(c.points, sizeof(c.points));
+    }
+    if (c.type == COMMAND_SPLINE)
+    {
+        put_varint(c.spline.size());
+        put_raw(c.spline.data(), c.spline.size() * sizeof(glm::vec2));
+    }
+    if (c.type == COMMAND_GCODE || c.type == COMMAND_PLAN || c.type == COMMAND_SPLINE || c.type == COMMAND_DRAWING)
+    {
+        put_varint(c.path.size());
+        put_raw(c.path.data(), c.path.size());
+    }
+    flush_record();
+    file.flush();//命令很少，及时写出去，程序崩溃时记录也是完整的
+}
+
+inline size_t JournalWriter::bytes() const
+{
+    return written;
+}
+
+inline void JournalWriter::begin(long long tick, int type)
+{
+    buffer.clear();
+    put_varint((uint64_t)(tick - last_tick));
+    buffer.push_back((unsigned char)type);
+    last_tick = tick;
+}
+
+inline void JournalWriter::put_varint(uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        buffer.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    buffer.push_back((unsigned char)v);
+}
+
+// signed values zigzag-encoded, so -1 is one byte
+inline void JournalWriter::put_int(long long v)
+{
+    put_varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+inline void JournalWriter::put_raw(const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    buffer.insert(buffer.end(), p, p + size);
+}
+
+inline void JournalWriter::flush_record()
+{
+    file.write((const char*)buffer.data(), buffer.size());
+    written += buffer.size();
+}
+
+class JournalReader
+{
+public:
+    bool open(const std::string& path);
+    bool next(JournalRecord& record);
+    bool failed() const;
+
+private:
+    std::ifstream file;
+    long long tick = 0;
+    bool bad = false;
+
+    bool get_varint(uint64_t& v);
+    bool get_int(long long& v);
+    bool get_raw(void* data, size_t size);
+};
+
+inline bool JournalReader::open(const std::string& path)
+{
+    file.open(path.c_str(), std::ios::in | std::ios::binary);
+    char magic[sizeof(JOURNAL_MAGIC)];
+    uint32_t version = 0;
+    if (!file || !get_raw(magic, sizeof(magic)) || std::memcmp(magic, JOURNAL_MAGIC, sizeof(magic)) != 0
+        || !get_raw(&version, sizeof(version)) || version != JOURNAL_VERSION)
+    {
+        std::cout << "ERROR::JOURNAL::NOT_A_JOURNAL: " << path << std::endl;
+        return false;
+    }
+    tick = 0;
+    bad = false;
+    return true;
+}
+
+// the next record, false at the end of the file (or on a damaged record, see failed())
+inline bool JournalReader::next(JournalRecord& r)
+{
+    uint64_t delta;
+    if (!get_varint(delta))
+    {
+        return false;
+    }
+    unsigned char type;
+    long long a = 0, b = 0, c = 0, d = 0, e = 0;
+    bool ok = get_raw(&type, 1);
+    tick += (long long)delta;
+    r.type = type;
+    r.tick = tick;
+    switch (type)
+    {
+    case JOURNAL_SETUP:
+        ok = ok && get_int(a) && get_int(b) && get_int(c) && get_int(d) && get_int(e)
+            && get_raw(&r.setup.spindle_speed, sizeof(double)) && get_raw(&r.setup.spindle_phase, sizeof(double));
+        r.setup.y_segments = (int)a;
+        r.setup.x_segments = (int)b;
+        r.setup.r_segments = (int)c;
+        r.setup.field_enabled = d != 0;
+        r.setup.tool = (int)e;
+        break;
+    case JOURNAL_INPUT:
+        ok = ok && get_int(a) && get_int(b) && get_raw(&r.feed_scale, sizeof(float));
+        r.axial_dir = (int)a;
+        r.radial_dir = (int)b;
+        break;
+    case JOURNAL_COMMAND:
+        ok = ok && get_int(a) && get_int(b);
+        r.command = SimulationCommand();
+        r.command.type = (int)a;
+        r.command.value = (int)b;
+        if (ok && (a == COMMAND_BEZIER || a == COMMAND_PLAN))
+        {
+            ok = get_raw(r.command.points, sizeof(r.command.points));
+        }
+        if (ok && a == COMMAND_SPLINE)
+        {
+            uint64_t size;
+            ok = get_varint(size) && size < 65536;
+            r.command.spline.resize(ok ? (size_t)size : 0);
+            ok = ok && (size == 0 || get_raw(&r.command.spline[0], (size_t)size * sizeof(glm::vec2)));
+        }
+        if (ok && (a == COMMAND_GCODE || a == COMMAND_PLAN || a == COMMAND_SPLINE || a == COMMAND_DRAWING))
+        {
+            uint64_t size;
+            ok = get_varint(size) && size < 4096;
+            r.command.path.resize(ok ? (size_t)size : 0);
+            ok = ok && (size == 0 || get_raw(&r.command.path[0], (size_t)size));
+        }
+        break;
+    case JOURNAL_END:
+        ok = ok && get_int(a) && get_raw(&r.hash, sizeof(r.hash));
+        r.y_segments = (int)a;
+        break;
+    default:
+        ok = false;
+        break;
+    }
+    if (!ok)
+    {
+        std::cout << "ERROR::JOURNAL::DAMAGED_RECORD at tick " << tick << std::endl;
+        bad = true;
+    }
+    return ok;
+}
+
+inline bool JournalReader::failed() const
+{
+    return bad;
+}
+
+inline bool JournalReader::get_varint(uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = file.get();
+        if (c == EOF)
+        {
+            return false;
+        }
+        v |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool JournalReader::get_int(long long& v)
+{
+    uint64_t u;
+    if (!get_varint(u))
+    {
+        return false;
+    }
+    v = (long long)(u >> 1) ^ -(long long)(u & 1);
+    return true;
+}
+
+inline bool JournalReader::get_raw(void* data, size_t size)
+{
+    file.read((char*)data, size);
+    return (size_t)file.gcount() == size;
+}
+
+#endif
@@ -0,0 +1,433 @@
+#ifndef MESH_ENVELOPE_H
+#define MESH_ENVELOPE_H
+
+// 从三角网格（OBJ/STL）求车削的目标轮廓：绕一根轴，每个轴向格子里网格离轴最远的距离（最大半径包络），也就是能车出这个零件的最细的回转体
+// 离轴的距离是凸函数，三角形和一个格子的交是凸多边形，最大值一定在它的顶点上：格子里的三角形顶点，或者三角形和格子两个端面的交线的两端
+// 每个三角形按轴向排好三个顶点，端面上的交线每个算一次，所以一个三角形的代价是它跨过的格子数加一
+// 三角形按线程数分段，每个线程有自己的一份包络，最后取最大值合并（max和顺序无关，线程数不同结果逐位相同）；网格的体积在同一遍里按散度定理累加
+// 零件按比例放进毛坯（或者按给定的比例，比如CAD的毫米），较大的一端在Z0；可车性 = 网格体积 / 包络转出来的体积，完全回转对称的零件是1
+// 网格读取不用assimp：OBJ的v/f（多边形按扇形拆成三角形，支持负下标）和二进制/ASCII的STL，材质、法线、贴图坐标都不要
+// 同样不依赖glad/GLFW
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#include "workpiece.h"
+
+const float MESH_NONE = -1.0f;//没有三角形经过的格子
+const int MESH_MAX_THREADS = 64;
+
+// a triangle mesh, three indices per triangle
+struct TriangleMesh
+{
+    std::vector<glm::vec3> vertices;
+    std::vector<unsigned int> indices;
+
+    size_t triangles() const { return indices.size() / 3; }
+};
+
+// the axis a part is turned about: a point on it and its direction (the larger end goes to Z0)
+struct TurningAxis
+{
+    glm::dvec3 origin = glm::dvec3(0.0);
+    glm::dvec3 direction = glm::dvec3(0.0, 1.0, 0.0);
+};
+
+// the envelope and what it says about the part
+struct MeshEnvelope
+{
+    std::vector<float> radius;//每个格子的最大半径（工件半径单位，1.0是毛坯半径），MESH_NONE是没有三角形
+    TurningAxis axis;
+    double length = 0.0, diameter = 0.0;//网格单位：沿轴的长度、离轴最远处的直径
+    double scale = 0.0;//网格单位换成毫米
+    double volume = 0.0;//网格的体积（mm³，封闭、法向一致时才有意义）
+    double envelope_volume = 0.0;//包络转出来的体积（mm³）
+    double turnability = 0.0;//volume / envelope_volume
+    long long triangles = 0;
+    int threads = 0;
+    double ms = 0.0;
+};
+
+// ---- reading ----
+
+// "v x y z" and "f a b c ..." lines (a, a/t, a//n, a/t/n, negative counts from the end)
+inline bool mesh_load_obj(const std::string& path, TriangleMesh& mesh)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        std::cout << "ERROR::MESH::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    mesh = TriangleMesh();
+    std::string text;
+    std::vector<unsigned int> face;
+    long long bad = 0;
+    while (std::getline(file, text))
+    {
+        const char* s = text.c_str();
+        while (*s == ' ' || *s == '\t')
+        {
+            s++;
+        }
+        if (s[0] == 'v' && (s[1] == ' ' || s[1] == '\t'))
+        {
+            char* end;
+            float x = std::strtof(s + 2, &end);
+            float y = std::strtof(end, &end);
+            float z = std::strtof(end, &end);
+            mesh.vertices.push_back(glm::vec3(x, y, z));
+            continue;
+        }
+        if (s[0] != 'f' || (s[1] != ' ' && s[1] != '\t'))
+        {
+            continue;
+        }
+        face.clear();
+        s += 2;
+        for (;;)
+        {
+            char* end;
+            long k = std::strtol(s, &end, 10);
+            if (end == s)
+            {
+                break;
+            }
+            long index = k > 0 ? k - 1 : (long)mesh.vertices.size() + k;
+            if (index < 0 || index >= (long)mesh.vertices.size())
+            {
+                bad++;
+                face.clear();
+                break;
+            }
+            face.push_back((unsigned int)index);
+            //跳过/t/n
+            s = end;
+            while (*s && *s != ' ' && *s != '\t')
+            {
+                s++;
+            }
+        }
+        for (size_t i = 2; i < face.size(); i++)
+        {
+            mesh.indices.push_back(face[0]);
+            mesh.indices.push_back(face[i - 1]);
+            mesh.indices.push_back(face[i]);
+        }
+    }
+    if (bad > 0)
+    {
+        std::cout << "ERROR::MESH::OBJ: " << bad << " faces with a vertex index out of range skipped" << std::endl;
+    }
+    return mesh.triangles() > 0;
+}
+
+// binary STL (80 byte header, a count, 50 bytes per triangle) if the size matches, else ASCII "vertex x y z" lines
+inline bool mesh_load_stl(const std::string& path, TriangleMesh& mesh)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        std::cout << "ERROR::MESH::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    mesh = TriangleMesh();
+    long long size = (long long)file.tellg();
+    file.seekg(0);
+    char header[84];
+    uint32_t count = 0;
+    if (size >= 84 && file.read(header, 84))
+    {
+        std::memcpy(&count, header + 80, sizeof(count));
+    }
+    if (size >= 84 && size == 84 + 50LL * count)
+    {
+        mesh.vertices.resize((size_t)count * 3);
+        mesh.indices.resize((size_t)count * 3);
+        char record[50];
+        for (uint32_t t = 0; t < count && file.read(record, 50); t++)
+        {
+            //法线12字节，三个顶点各12字节，属性2字节
+            std::memcpy(&mesh.vertices[t * 3], record + 12, 36);
+            for (int k = 0; k < 3; k++)
+            {
+                mesh.indices[t * 3 + k] = t * 3 + k;
+            }
+        }
+        return count > 0 && (bool)file;
+    }
+    file.clear();
+    file.seekg(0);
+    std::string text;
+    while (std::getline(file, text))
+    {
+        const char* s = text.c_str();
+        while (*s == ' ' || *s == '\t')
+        {
+            s++;
+        }
+        if (std::strncmp(s, "vertex", 6) != 0)
+        {
+            continue;
+        }
+        char* end;
+        float x = std::strtof(s + 6, &end);
+        float y = std::strtof(end, &end);
+        float z = std::strtof(end, &end);
+        mesh.vertices.push_back(glm::vec3(x, y, z));
+    }
+    mesh.vertices.resize(mesh.vertices.size() / 3 * 3);
+    mesh.indices.resize(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        mesh.indices[i] = (unsigned int)i;
+    }
+    return mesh.triangles() > 0;
+}
+
+// the file name's extension in lower case
+inline std::string mesh_extension(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+    return extension;
+}
+
+inline bool mesh_format(const std::string& path)
+{
+    return mesh_extension(path) == "obj" || mesh_extension(path) == "stl";
+}
+
+// an .obj or .stl file
+inline bool mesh_load(const std::string& path, TriangleMesh& mesh)
+{
+    if (!mesh_format(path))
+    {
+        std::cout << "ERROR::MESH::UNKNOWN_FORMAT: " << path << std::endl;
+        return false;
+    }
+    return mesh_extension(path) == "obj" ? mesh_load_obj(path, mesh) : mesh_load_stl(path, mesh);
+}
+
+// ---- the envelope ----
+
+// run fn(first, last, thread) over [0, count) split into `threads` equal ranges, one std::thread each
+template <typename F>
+inline void mesh_parallel(size_t count, int threads, F fn)
+{
+    if (threads <= 1)
+    {
+        fn((size_t)0, count, 0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.push_back(std::thread(fn, count * t / threads, count * (t + 1) / threads, t));
+    }
+    for (size_t t = 0; t < workers.size(); t++)
+    {
+        workers[t].join();
+    }
+}
+
+inline int mesh_threads(int threads)
+{
+    if (threads <= 0)
+    {
+        threads = (int)std::thread::hardware_concurrency();
+    }
+    return std::max(1, std::min(MESH_MAX_THREADS, threads));
+}
+
+// a vertex in turning coordinates: x = position along the bar (u, 0~1), yz = offset from the axis in radius units
+struct MeshFrame
+{
+    glm::dvec3 origin, axis, side, up;
+    double axial_scale = 1.0, axial_offset = 0.0, radial_scale = 1.0;
+
+    glm::vec3 map(const glm::vec3& v) const
+    {
+        glm::dvec3 d = glm::dvec3(v) - origin;
+        return glm::vec3((float)(glm::dot(d, axis) * axial_scale + axial_offset), (float)(glm::dot(d, side) * radial_scale), (float)(glm::dot(d, up) * radial_scale));
+    }
+};
+
+inline float mesh_radius(const glm::vec3& p)
+{
+    return std::sqrt(p.y * p.y + p.z * p.z);
+}
+
+// the part of a's and b's segment at u (a.x <= u <= b.x)
+inline glm::vec3 mesh_at(const glm::vec3& a, const glm::vec3& b, float u)
+{
+    return b.x > a.x ? a + (b - a) * ((u - a.x) / (b.x - a.x)) : a;
+}
+
+// the largest radius of triangle a, b, c in every bin it touches, max-ed into envelope[]
+// (a part longer than the bar is folded into the end bins)
+inline void mesh_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, int bins, float* envelope)
+{
+    if (b.x < a.x) std::swap(a, b);
+    if (c.x < b.x) std::swap(b, c);
+    if (b.x < a.x) std::swap(a, b);
+    const int ia = std::max(0, std::min(bins - 1, (int)std::floor(a.x * bins)));
+    const int ib = std::max(0, std::min(bins - 1, (int)std::floor(b.x * bins)));
+    const int ic = std::max(0, std::min(bins - 1, (int)std::floor(c.x * bins)));
+    const float rb = mesh_radius(b);
+    float left = mesh_radius(a);//第一个格子里是a，后面的格子是左端面的交线
+    for (int i = ia; i <= ic; i++)
+    {
+        float m = left;
+        if (i == ib) m = std::max(m, rb);
+        if (i == ic)
+        {
+            envelope[i] = std::max(envelope[i], std::max(m, mesh_radius(c)));
+            break;
+        }
+        //右端面的交线：一端在ac上，另一端在ab或bc上
+        float u = (float)(i + 1) / bins;
+        left = std::max(mesh_radius(mesh_at(a, c, u)), mesh_radius(u <= b.x ? mesh_at(a, b, u) : mesh_at(b, c, u)));
+        envelope[i] = std::max(envelope[i], std::max(m, left));
+    }
+}
+
+// the frame for axis with the part scaled into the bar (scale 0) or by scale (mm per mesh unit), larger end at Z0;
+// also the part's length and diameter in mesh units
+inline MeshFrame mesh_frame(const TriangleMesh& mesh, const TurningAxis& axis, double scale, int threads, double& length, double& diameter)
+{
+    MeshFrame f;
+    f.origin = axis.origin;
+    f.axis = glm::normalize(axis.direction);
+    glm::dvec3 other = std::fabs(f.axis.x) < 0.9 ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+    f.side = glm::normalize(glm::cross(f.axis, other));
+    f.up = glm::cross(f.axis, f.side);
+    //轴向范围和最大半径：只用到三角形的顶点
+    std::vector<glm::dvec3> extent(threads, glm::dvec3(1e300, -1e300, 0.0));
+    mesh_parallel(mesh.indices.size(), threads, [&](size_t first, size_t last, int t)
+    {
+        glm::dvec3 e = extent[t];
+        for (size_t i = first; i < last; i++)
+        {
+            glm::vec3 p = f.map(mesh.vertices[mesh.indices[i]]);//还没缩放，axial_scale = radial_scale = 1
+            e.x = std::min(e.x, (double)p.x);
+            e.y = std::max(e.y, (double)p.x);
+            e.z = std::max(e.z, (double)mesh_radius(p));
+        }
+        extent[t] = e;
+    });
+    glm::dvec3 e(1e300, -1e300, 0.0);
+    for (size_t t = 0; t < extent.size(); t++)
+    {
+        e = glm::dvec3(std::min(e.x, extent[t].x), std::max(e.y, extent[t].y), std::max(e.z, extent[t].z));
+    }
+    length = std::max(0.0, e.y - e.x);
+    diameter = 2.0 * e.z;
+    if (scale <= 0.0)
+    {
+        scale = std::min(length > 0.0 ? STOCK_LENGTH / length : 1e300, e.z > 0.0 ? STOCK_DIAMETER / diameter : 1e300);
+        scale = scale < 1e300 ? scale : 1.0;
+    }
+    f.axial_scale = scale / STOCK_LENGTH;
+    f.axial_offset = 1.0 - e.y * f.axial_scale;
+    f.radial_scale = scale * 2.0 / STOCK_DIAMETER;
+    return f;
+}
+
+// the max-radius envelope of mesh about axis in `bins` bins along the bar, over `threads` threads (0: one per core)
+inline MeshEnvelope mesh_envelope(const TriangleMesh& mesh, const TurningAxis& axis, int bins, int threads = 0, double scale = 0.0)
+{
+    auto begin = std::chrono::steady_clock::now();
+    MeshEnvelope result;
+    result.axis = axis;
+    result.threads = threads = mesh_threads(threads);
+    result.triangles = (long long)mesh.triangles();
+    bins = std::max(1, bins);
+    MeshFrame f = mesh_frame(mesh, axis, scale, threads, result.length, result.diameter);
+    result.scale = f.axial_scale * STOCK_LENGTH;
+    //每个线程一份包络和体积
+    std::vector<std::vector<float> > partial(threads, std::vector<float>(bins, MESH_NONE));
+    std::vector<double> volume(threads, 0.0);
+    mesh_parallel(mesh.triangles(), threads, [&](size_t first, size_t last, int t)
+    {
+        float* envelope = &partial[t][0];
+        double v = 0.0;
+        for (size_t k = first; k < last; k++)
+        {
+            const glm::vec3& A = mesh.vertices[mesh.indices[k * 3]];
+            const glm::vec3& B = mesh.vertices[mesh.indices[k * 3 + 1]];
+            const glm::vec3& C = mesh.vertices[mesh.indices[k * 3 + 2]];
+            v += glm::dot(glm::dvec3(A), glm::cross(glm::dvec3(B), glm::dvec3(C)));
+            mesh_triangle(f.map(A), f.map(B), f.map(C), bins, envelope);
+        }
+        volume[t] = v;
+    });
+    result.radius.assign(bins, MESH_NONE);
+    double v = 0.0;
+    for (int t = 0; t < threads; t++)
+    {
+        for (int i = 0; i < bins; i++)
+        {
+            result.radius[i] = std::max(result.radius[i], partial[t][i]);
+        }
+        v += volume[t];
+    }
+    result.volume = std::fabs(v) / 6.0 * result.scale * result.scale * result.scale;
+    const double h = STOCK_LENGTH / bins, mm = STOCK_DIAMETER / 2.0;
+    for (int i = 0; i < bins; i++)
+    {
+        if (result.radius[i] != MESH_NONE)
+        {
+            result.envelope_volume += PI * (result.radius[i] * mm) * (result.radius[i] * mm) * h;
+        }
+    }
+    result.turnability = result.envelope_volume > 0.0 ? result.volume / result.envelope_volume : 0.0;
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+// the x, y and z axes through the middle of the bounding box, the one with the highest turnability
+inline MeshEnvelope mesh_envelope_best_axis(const TriangleMesh& mesh, int bins, int threads = 0, double scale = 0.0)
+{
+    glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        low = glm::min(low, mesh.vertices[i]);
+        high = glm::max(high, mesh.vertices[i]);
+    }
+    MeshEnvelope best;
+    for (int k = 0; k < 3; k++)
+    {
+        TurningAxis axis;
+        axis.origin = glm::dvec3(low + high) * 0.5;
+        axis.direction = glm::dvec3(0.0);
+        axis.direction[k] = 1.0;
+        MeshEnvelope e = mesh_envelope(mesh, axis, bins, threads, scale);
+        if (k == 0 || e.turnability > best.turnability)
+        {
+            best = e;
+        }
+    }
+    return best;
+}
+
+inline void print_mesh_report(const std::string& path, const MeshEnvelope& e)
+{
+    std::cout << "mesh " << path << ": " << e.triangles << " triangles, axis (" << e.axis.direction.x << ", " << e.axis.direction.y << ", "
+        << e.axis.direction.z << "), length " << e.length << ", diameter " << e.diameter << " (mesh units), " << e.scale << " mm per unit, turnability "
+        << e.turnability << ", envelope in " << e.ms << " ms on " << e.threads << " threads" << std::endl;
+}
+
+#endif
@@ -0,0 +1,432 @@
+#ifndef METROLOGY_H
+#define METROLOGY_H
+
+// 测量：体积、质量、转动惯量、直径，每次切削之后按改过的segment增量更新，查询O(log n)
+// 每个segment是一段回转体（一维按折点轮廓精确积分，二维模式下按角度分成扇形、每个扇形一段圆柱求和），它的体积、体积对z的一阶矩、∫r²dV和最小/最大半径
+// 是一棵线段树的叶子，父节点是两个子节点的和（半径取min/max）
+// 切一刀只重算dirty范围里的叶子和它们的祖先，O(k + log n)；父节点每次从子节点重新求和而不是像Fenwick树那样累加差值，
+// 切上百万刀也不会累积浮点误差
+// 最大半径的那一半同时是快移碰撞检查用的区间最大值查询：first_above()跳过最高点都在刀路下面的子树（见collision.h）
+// 长度单位mm（毛坯尺寸见workpiece.h），体积mm³，质量g，转动惯量kg·cm²
+// 同样不依赖glad/GLFW
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include <algorithm>
+
+#include "workpiece.h"
+
+struct MetrologyMaterial
+{
+    const char* name;
+    double density;//g/cm³
+    double specific_energy;//比切削能（J/mm³），切掉1mm³要的功，见telemetry.h
+};
+
+//0、1和lathe.cpp里的material_switch一致（木头、银）
+const int METROLOGY_MATERIALS = 5;
+inline const MetrologyMaterial* metrology_materials()
+{
+    static const MetrologyMaterial materials[METROLOGY_MATERIALS] = {
+        { "wood", 0.70, 0.05 },
+        { "silver", 10.49, 1.5 },
+        { "steel", 7.85, 3.0 },
+        { "aluminium", 2.70, 0.7 },
+        { "brass", 8.50, 1.2 },
+    };
+    return materials;
+}
+
+// one node of the tree: sums over its segments, radius extremes in radius units (1.0 is the stock);
+// the extremes are the profile's inside each segment (a thin groove or ridge counts), the sums integrate the profile
+// (in 2D mode the field)
+struct MeasureNode
+{
+    double volume = 0.0;//mm³
+    double moment = 0.0;//∫z dV，mm⁴，除以体积是重心（G代码的z）
+    double inertia = 0.0;//∫r² dV，mm⁵，乘密度是绕主轴的转动惯量
+    float min_radius = std::numeric_limits<float>::max();
+    float max_radius = 0.0f;
+};
+
+inline MeasureNode measure_merge(const MeasureNode& a, const MeasureNode& b)
+{
+    MeasureNode m;
+    m.volume = a.volume + b.volume;
+    m.moment = a.moment + b.moment;
+    m.inertia = a.inertia + b.inertia;
+    m.min_radius = std::min(a.min_radius, b.min_radius);
+    m.max_radius = std::max(a.max_radius, b.max_radius);
+    return m;
+}
+
+class Metrology
+{
+public:
+    void build(Workpiece& workpiece);
+    void update(Workpiece& workpiece);
+    int bins() const;
+    MeasureNode query(int first, int last) const;
+    MeasureNode query(double u0, double u1) const;
+    const MeasureNode& total() const;
+    double stock_volume() const;
+    double volume() const;
+    double removed_volume() const;
+    double mass(int material) const;
+    double inertia(int material) const;
+    double center_of_mass() const;
+    double min_diameter(double u0, double u1) const;
+    double max_diameter(double u0, double u1) const;
+    int first_above(const Workpiece& workpiece, double u0, float d0, double u1, float d1, float tolerance, float& excess) const;
+
+private:
+    int n = 0;//segment数
+    int size = 1;//叶子层的宽度，2的幂，叶子i在nodes[size + i]
+    bool field = false;//按二维半径场建的
+    std::vector<MeasureNode> nodes;
+
+    MeasureNode leaf(const Workpiece& workpiece, int y) const;
+    int above(int node, int lo, int hi, const Workpiece& workpiece, double u0, float d0, double u1, float d1, float tolerance, float& excess) const;
+    float leaf_above(const Workpiece& workpiece, int y, double u0, float d0, double u1, float d1) const;
+};
+
+const double METROLOGY_EDGE = 1e-7;//刀路正好在台阶上时，台阶按离开刀路的那一边算（u）
+
+inline double measure_stock_volume()
+{
+    return PI * STOCK_DIAMETER * STOCK_DIAMETER * 0.25 * STOCK_LENGTH;
+}
+
+// g, density in g/cm³ = 1e-3 g/mm³
+inline double measure_mass(const MeasureNode& m, int material)
+{
+    return m.volume * metrology_materials()[material].density * 1e-3;
+}
+
+// about the spindle axis, kg·cm²: g·mm² * 1e-3 kg/g * 1e-2 cm²/mm²
+inline double measure_inertia(const MeasureNode& m, int material)
+{
+    return m.inertia * metrology_materials()[material].density * 1e-3 * 1e-5;
+}
+
+// axial centre of mass in G-code z (mm, 0 at the u = 1 end of the bar, see gcode_axial())
+inline double measure_center(const MeasureNode& m)
+{
+    return m.volume > 0.0 ? m.moment / m.volume : 0.0;
+}
+
+// lowest and highest radius over [u0, u1]: from the right-hand value at u0 to the left-hand value at u1,
+// both sides of every step in between (Profile::max_radius() would also take the outer side of the bar's end faces)
+inline void profile_extremes(const Profile& profile, double u0, double u1, float& lowest, float& highest)
+{
+    float r = profile.radius_at(u0);
+    lowest = r;
+    highest = r;
+    Profile::KnotMap::const_iterator it = profile.knots.upper_bound(u0);
+    for (; it != profile.knots.end() && it->first < u1; ++it)
+    {
+        lowest = std::min(lowest, std::min(it->second.left, it->second.right));
+        highest = std::max(highest, std::max(it->second.left, it->second.right));
+    }
+    r = it != profile.knots.end() && it->first == u1 ? it->second.left : profile.radius_at(u1);
+    lowest = std::min(lowest, r);
+    highest = std::max(highest, r);
+}
+
+// ∫r² du, ∫r⁴ du and ∫u r² du over [u0, u1] (radius units), exact for the piecewise linear profile:
+// walks the knots like Profile::mean_radii(), each straight piece from ra to rb over length l gives
+// l(ra² + ra rb + rb²)/3, l(ra⁴ + ra³rb + ra²rb² + ra rb³ + rb⁴)/5 and ua∫r² + l²(ra² + 2ra rb + 3rb²)/12
+inline void profile_powers(const Profile& profile, double u0, double u1, double& r2, double& r4, double& ur2)
+{
+    r2 = 0.0;
+    r4 = 0.0;
+    ur2 = 0.0;
+    double u = u0;
+    double a = profile.radius_at(u0);
+    Profile::KnotMap::const_iterator it = profile.knots.upper_bound(u0);
+    while (u < u1)
+    {
+        double next, b, after;
+        if (it != profile.knots.end() && it->first < u1)
+        {
+            next = it->first;
+            b = it->second.left;
+            after = it->second.right;
+            ++it;
+        }
+        else
+        {
+            next = u1;
+            b = it != profile.knots.end() && it->first == u1 ? it->second.left : profile.radius_at(u1);
+            after = b;
+        }
+        const double l = next - u;
+        const double s2 = l * (a * a + a * b + b * b) / 3.0;
+        r2 += s2;
+        r4 += l * (a * a * a * a + a * a * a * b + a * a * b * b + a * b * b * b + b * b * b * b) / 5.0;
+        ur2 += u * s2 + l * l * (a * a + 2.0 * a * b + 3.0 * b * b) / 12.0;
+        u = next;
+        a = after;
+    }
+}
+
+// segment y as a solid of revolution: the profile integrated exactly between its knots,
+// or in 2D mode one sector per column (a sector of radius R and angle a holds a*R²/2 of area and a*R⁴/4 of ∫r² dA)
+inline MeasureNode Metrology::leaf(const Workpiece& workpiece, int y) const
+{
+    const double h = STOCK_LENGTH / workpiece.y_segments;
+    const double scale = STOCK_DIAMETER * 0.5;
+    MeasureNode m;
+    if (workpiece.field_enabled)
+    {
+        const RadiusField& f = workpiece.field;
+        double r2 = 0.0, r4 = 0.0;
+        for (int t = 0; t < f.theta_segments; t++)
+        {
+            float r = f.at(y, t);
+            double R2 = (double)r * r * scale * scale;
+            r2 += R2;
+            r4 += R2 * R2;
+            m.min_radius = std::min(m.min_radius, r);
+            m.max_radius = std::max(m.max_radius, r);
+        }
+        r2 /= f.theta_segments;
+        r4 /= f.theta_segments;
+        double z = ((y + 0.5) / workpiece.y_segments - 1.0) * STOCK_LENGTH;
+        m.volume = PI * r2 * h;
+        m.moment = m.volume * z;
+        m.inertia = 0.5 * PI * r4 * h;
+        return m;
+    }
+    double u0 = (double)y / workpiece.y_segments, u1 = (double)(y + 1) / workpiece.y_segments;
+    double r2, r4, ur2;
+    profile_powers(workpiece.profile, u0, u1, r2, r4, ur2);
+    profile_extremes(workpiece.profile, u0, u1, m.min_radius, m.max_radius);
+    //dz = STOCK_LENGTH du，z = (u - 1) STOCK_LENGTH
+    const double area = PI * scale * scale * STOCK_LENGTH;
+    m.volume = area * r2;
+    m.moment = area * STOCK_LENGTH * (ur2 - r2);
+    m.inertia = 0.5 * PI * scale * scale * scale * scale * STOCK_LENGTH * r4;
+    return m;
+}
+
+// every segment from scratch (a new resolution, 2D mode switched), clears the workpiece's pending range
+inline void Metrology::build(Workpiece& workpiece)
+{
+    n = workpiece.y_segments;
+    field = workpiece.field_enabled;
+    size = 1;
+    while (size < n)
+    {
+        size *= 2;
+    }
+    nodes.assign(2 * size, MeasureNode());
+    for (int y = 0; y < n; y++)
+    {
+        nodes[size + y] = leaf(workpiece, y);
+    }
+    for (int i = size - 1; i >= 1; i--)
+    {
+        nodes[i] = measure_merge(nodes[2 * i], nodes[2 * i + 1]);
+    }
+    workpiece.clear_measure();
+}
+
+// take the segments the workpiece changed since the last update (see Workpiece::pending_measure()):
+// their leaves are recomputed, then each level above only between the ancestors of the first and the last one
+// (one Metrology per workpiece, the pending range is cleared here)
+inline void Metrology::update(Workpiece& workpiece)
+{
+    if (n != workpiece.y_segments || field != workpiece.field_enabled)
+    {
+        build(workpiece);
+        return;
+    }
+    int first, count;
+    if (!workpiece.pending_measure(first, count))
+    {
+        return;
+    }
+    int last = std::min(first + count - 1, n - 1);
+    for (int y = first; y <= last; y++)
+    {
+        nodes[size + y] = leaf(workpiece, y);
+    }
+    for (int lo = (size + first) / 2, hi = (size + last) / 2; lo >= 1; lo /= 2, hi /= 2)
+    {
+        for (int i = lo; i <= hi; i++)
+        {
+            nodes[i] = measure_merge(nodes[2 * i], nodes[2 * i + 1]);
+        }
+    }
+    workpiece.clear_measure();
+}
+
+inline int Metrology::bins() const
+{
+    return n;
+}
+
+// segments [first, last], bottom up: O(log n) nodes
+inline MeasureNode Metrology::query(int first, int last) const
+{
+    MeasureNode left, right;
+    first = std::max(0, first);
+    last = std::min(n - 1, last);
+    if (first > last)
+    {
+        return left;
+    }
+    for (int lo = size + first, hi = size + last + 1; lo < hi; lo /= 2, hi /= 2)
+    {
+        if (lo & 1)
+        {
+            left = measure_merge(left, nodes[lo++]);
+        }
+        if (hi & 1)
+        {
+            right = measure_merge(nodes[--hi], right);
+        }
+    }
+    return measure_merge(left, right);
+}
+
+// the segments touching the axial range [u0, u1] (0~1 along the bar)
+inline MeasureNode Metrology::query(double u0, double u1) const
+{
+    int first = (int)std::floor(u0 * n);
+    int last = std::max(first, (int)std::ceil(u1 * n) - 1);
+    return query(first, last);
+}
+
+// the whole bar (an empty node before the first build())
+inline const MeasureNode& Metrology::total() const
+{
+    static const MeasureNode empty;
+    return nodes.empty() ? empty : nodes[1];
+}
+
+inline double Metrology::stock_volume() const
+{
+    return measure_stock_volume();
+}
+
+inline double Metrology::volume() const
+{
+    return total().volume;
+}
+
+inline double Metrology::removed_volume() const
+{
+    return stock_volume() - volume();
+}
+
+inline double Metrology::mass(int material) const
+{
+    return measure_mass(total(), material);
+}
+
+inline double Metrology::inertia(int material) const
+{
+    return measure_inertia(total(), material);
+}
+
+inline double Metrology::center_of_mass() const
+{
+    return measure_center(total());
+}
+
+inline double Metrology::min_diameter(double u0, double u1) const
+{
+    return query(u0, u1).min_radius * STOCK_DIAMETER;
+}
+
+inline double Metrology::max_diameter(double u0, double u1) const
+{
+    return query(u0, u1).max_radius * STOCK_DIAMETER;
+}
+
+// the first segment under the straight line from (u0, d0) to (u1, d1) where the part rises more than tolerance above it
+// (-1 if none, excess is by how much): subtrees whose highest point stays below the lowest point of the line over them
+// are skipped, so a move in the clear costs O(log n); the segments that are not skipped are checked exactly
+inline int Metrology::first_above(const Workpiece& workpiece, double u0, float d0, double u1, float d1, float tolerance, float& excess) const
+{
+    if (u1 < u0)
+    {
+        std::swap(u0, u1);
+        std::swap(d0, d1);
+    }
+    excess = 0.0f;
+    if (n == 0 || u1 < 0.0 || u0 > 1.0)
+    {
+        return -1;//不在工件上方
+    }
+    return above(1, 0, size - 1, workpiece, u0, d0, u1, d1, tolerance, excess);
+}
+
+inline int Metrology::above(int node, int lo, int hi, const Workpiece& workpiece, double u0, float d0, double u1, float d1, float tolerance, float& excess) const
+{
+    double a = std::max(u0, (double)lo / n);
+    double b = std::min(u1, (double)(hi + 1) / n);
+    if (lo >= n || a > b)
+    {
+        return -1;
+    }
+    //这一段直线上最低的点在两端之一
+    auto line = [&](double u) { return u1 > u0 ? d0 + (d1 - d0) * (float)((u - u0) / (u1 - u0)) : std::min(d0, d1); };
+    if (nodes[node].max_radius <= std::min(line(a), line(b)) + tolerance)
+    {
+        return -1;
+    }
+    if (node >= size)
+    {
+        excess = leaf_above(workpiece, lo, u0, d0, u1, d1);
+        return excess > tolerance ? lo : -1;
+    }
+    int mid = (lo + hi) / 2;
+    int hit = above(2 * node, lo, mid, workpiece, u0, d0, u1, d1, tolerance, excess);
+    return hit >= 0 ? hit : above(2 * node + 1, mid + 1, hi, workpiece, u0, d0, u1, d1, tolerance, excess);
+}
+
+// how far the part rises above the line inside segment y: the profile and the line are both piecewise linear,
+// so the largest difference is at a knot or at an end (in 2D mode the highest column of the row against the lowest end)
+inline float Metrology::leaf_above(const Workpiece& workpiece, int y, double u0, float d0, double u1, float d1) const
+{
+    double a = std::max(u0, (double)y / n);
+    double b = std::min(u1, (double)(y + 1) / n);
+    auto line = [&](double u) { return u1 > u0 ? d0 + (d1 - d0) * (float)((u - u0) / (u1 - u0)) : std::min(d0, d1); };
+    if (workpiece.field_enabled)
+    {
+        return nodes[size + y].max_radius - std::min(line(a), line(b));
+    }
+    const Profile& profile = workpiece.profile;
+    if (b - a <= 2.0 * METROLOGY_EDGE)
+    {
+        //竖直的一段：刀尖贴着台阶上下时按低的一边
+        float r = std::min(profile.radius_at(a - METROLOGY_EDGE), profile.radius_at(b + METROLOGY_EDGE));
+        return r - std::min(line(a), line(b));
+    }
+    float excess = std::max(profile.radius_at(a + METROLOGY_EDGE) - line(a + METROLOGY_EDGE), profile.radius_at(b - METROLOGY_EDGE) - line(b - METROLOGY_EDGE));
+    Profile::KnotMap::const_iterator it = profile.knots.upper_bound(a + METROLOGY_EDGE);
+    for (; it != profile.knots.end() && it->first < b - METROLOGY_EDGE; ++it)
+    {
+        excess = std::max(excess, std::max(it->second.left, it->second.right) - line(it->first));
+    }
+    return excess;
+}
+
+// volume, removed volume, diameter range, centre of mass, and mass and inertia for every material (the current one marked)
+inline void print_metrology_report(const MeasureNode& all, int material)
+{
+    std::cout << "metrology: volume " << all.volume / 1000.0 << " cm3, removed " << (measure_stock_volume() - all.volume) / 1000.0
+        << " cm3, diameter " << all.min_radius * STOCK_DIAMETER << "~" << all.max_radius * STOCK_DIAMETER
+        << " mm, centre of mass z " << measure_center(all) << " mm" << std::endl;
+    for (int m = 0; m < METROLOGY_MATERIALS; m++)
+    {
+        std::cout << (m == material ? " * " : "   ") << metrology_materials()[m].name << ": mass " << measure_mass(all, m)
+            << " g, inertia " << measure_inertia(all, m) << " kg*cm2" << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,97 @@
+//Particles.h
+// 粒子的数据和运动（生成、重力、生命周期），不依赖glad/GLFW，模拟线程里更新
+// 绘制见particlesystem2.h
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+
+float gravity = 9.8f;
+
+struct Particle
+{
+	glm::vec3 speed = glm::vec3(0.0f);
+	glm::vec3 pos = glm::vec3(0.0f);
+	glm::vec3 scale = glm::vec3(0.0f);
+	float lifetime = 5.0f;
+	Particle(glm::vec3 apos, glm::vec3 aspeed, glm::vec3 ascale) {
+		pos = apos;
+		speed = aspeed;
+		scale = ascale;
+	}
+};
+
+class ParticleSystem
+{
+public:
+	std::vector<Particle> particles;
+	ParticleSystem();
+	~ParticleSystem();
+
+	void create_particles(glm::vec3 knife_pos, float mount);
+	void update(float deltaTime);
+private:
+
+};
+
+inline ParticleSystem::ParticleSystem()
+{
+	srand(unsigned(time(NULL)));
+	//std::cout << "load particlesystem" << std::endl;
+	//Particle tmp(glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(1.0f));
+	//particles.push_back(tmp);
+}
+
+inline ParticleSystem::~ParticleSystem()
+{
+	particles.clear();
+}
+
+inline void ParticleSystem::create_particles(glm::vec3 knife_pos, float mount)
+{
+	//std::cout << "create particlesystem mount:" << mount << std::endl;
+	if (mount==0.0f)
+	{
+		return;
+	}
+	int amount = mount * 2;
+	if (amount<1)
+	{
+		amount = 1;//保底生成一个方块
+	}
+	for (int i = 0; i < amount; i++)
+	{
+		float fnum = (rand() % 2000) / 1000.0 - 1; //产生-1~1的浮点数
+		//std::cout << "create particlesystem" << std::endl;
+		glm::vec3 speed = glm::vec3(fnum * 3.0f, fnum * 2.0f, -fnum * 4.0 - 6.0f);
+		Particle tmp(knife_pos, speed, glm::vec3(mount*0.3f));
+		particles.push_back(tmp);
+	}
+}
+
+inline void ParticleSystem::update(float deltaTime)
+{
+	if (particles.size() == 0)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < particles.size(); ){
+		particles[i].lifetime -= deltaTime;
+		particles[i].pos += particles[i].speed * deltaTime;
+		particles[i].speed.y -= gravity * deltaTime;
+		//std::cout << particles[i].lifetime << std::endl;
+		if (particles[i].lifetime<=0.0f)
+		{
+			particles.erase(particles.begin() + i);
+			//std::cout << "erase particle " << std::endl;
+			continue;
+		}
+		i++;
+	}
+}
+
+#endif
@@ -10,101 +10,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
-#include <random>
 #include "shader.h"
-#include <ctime>
+#include "particles.h"
 
-float gravity = 9.8f;
-
-struct Particle
-{
-	glm::vec3 speed = glm::vec3(0.0f);
-	glm::vec3 pos = glm::vec3(0.0f);
-	glm::vec3 scale = glm::vec3(0.0f);
-	float lifetime = 5.0f;
-	Particle(glm::vec3 apos, glm::vec3 aspeed, glm::vec3 ascale) {
-		pos = apos;
-		speed = aspeed;
-		scale = ascale;
-	}
-};
-
-class ParticleSystem
-{
-public:
-	std::vector<Particle> particles;
-	ParticleSystem();
-	~ParticleSystem();
-
-	void create_particles(glm::vec3 knife_pos, float mount);
-	void destroy_particles(int index);
-	void update(float deltaTime);
-	void draw_particles(Shader shader, unsigned int VAO, glm::mat4 projection, glm::mat4 view, glm::vec3 lightPos);
-private:
-
-};
-
-ParticleSystem::ParticleSystem()
-{
-	srand(unsigned(time(NULL)));
-	//std::cout << "load particlesystem" << std::endl;
-	//Particle tmp(glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(1.0f));
-	//particles.push_back(tmp);
-}
-
-ParticleSystem::~ParticleSystem()
-{
-	particles.clear();
-}
-
-inline void ParticleSystem::create_particles(glm::vec3 knife_pos, float mount)
-{
-	//std::cout << "create particlesystem mount:" << mount << std::endl;
-	if (mount==0.0f)
-	{
-		return;
-	}
-	int amount = mount * 2;
-	if (amount<1)
-	{
-		amount = 1;//һ
-	}
-	for (int i = 0; i < amount; i++)
-	{
-		float fnum = (rand() % 2000) / 1000.0 - 1; //-1~1ĸ
-		//std::cout << "create particlesystem" << std::endl;
-		glm::vec3 speed = glm::vec3(fnum * 3.0f, fnum * 2.0f, -fnum * 4.0 - 6.0f);
-		Particle tmp(knife_pos, speed, glm::vec3(mount*0.3f));
-		particles.push_back(tmp);
-	}
-}
-
-inline void ParticleSystem::destroy_particles(int index)
-{
-}
-
-inline void ParticleSystem::update(float deltaTime)
-{
-	if (particles.size() == 0)
-	{
-		return;
-	}
-
-	for (int i = 0; i < particles.size(); i++){
-		particles[i].lifetime -= deltaTime;
-		particles[i].pos += particles[i].speed * deltaTime;
-		particles[i].speed.y -= gravity * deltaTime;
-		//std::cout << particles[i].lifetime << std::endl;
-		if (particles[i].lifetime<=0.0f)
-		{
-			particles.erase(particles.begin() + i);
-			//std::cout << "erase particle " << std::endl;
-			i--;
-		}
-	}
-}
-
-inline void ParticleSystem::draw_particles(Shader shader, unsigned int VAO, glm::mat4 projection, glm::mat4 view, glm::vec3 lightPos)
+//draw the particles published by the simulation thread
+inline void draw_particles(const std::vector<Particle>& particles, Shader shader, unsigned int VAO, glm::mat4 projection, glm::mat4 view, glm::vec3 lightPos)
 {
 	for (int i = 0; i < particles.size(); i++)
 	{
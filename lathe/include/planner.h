@@ -0,0 +1,530 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+// 走刀路线规划：给一条目标轮廓（bezier、折线、文件），从工件现在的样子算出多刀粗车加一刀精车的路线
+// 目标和毛坯都按bins个等分的轴向格子采样（一般就是y_segments）：目标取格子中点的半径，毛坯取格子里轮廓的最大半径
+// 刀具补偿：刀尖在格子i里任何位置、深度d时刀刃不能低于任何格子中点的目标，所以刀尖最低到 d_i = max_j(target[i+j] - edge[j])，
+// edge[j]是刀尖在格子里走动时刀刃在相对它第j个格子中点上方的最低点（理想刀尖点只有edge[0] = 0，d_i就是目标本身）；
+// 刀尖在两个格子中点之间走直线时高度不低于两端较低的那个，刀刃不能低于这一段的下限 s_i = max_j(target[i+1+j] - edge'[j])，
+// 两端较低的那个够不着s_i的地方（陡的目标旁边）就走台阶：水平到格子边上，竖直升降，再水平到下一个中点
+// 粗车三种策略：轴向分层（G71那样一层一层往下车，每层不超过depth）、仿形（精车路线往外偏移depth的整数倍，G73那样）、
+// 径向切入（切槽刀一下一下往下扎，轴向步距depth）；每刀只切还有料的地方，之间按G0抬到安全高度
+// 路线是一串GcodeMove（毫米、X是直径），估算的加工时间和G代码的算法一样；plan_execute()全速切完，
+// plan_write_gcode()写成程序，交给GcodeProgram按进给速度实时跑
+// 同样不依赖glad/GLFW
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "workpiece.h"
+#include "cutter.h"
+#include "gcode.h"
+#include "drawing.h"
+#include "mesh_envelope.h"
+
+enum PlanStrategy {
+    PLAN_AXIAL = 0,//轴向分层
+    PLAN_CONTOUR,//仿形
+    PLAN_PLUNGE,//径向切入
+    PLAN_STRATEGIES
+};
+const char* const PLAN_STRATEGY_NAMES[PLAN_STRATEGIES] = { "axial", "contour", "plunge" };
+const double PLAN_APPROACH = 0.5;//快移接近到离毛坯多远（mm），剩下的按进给切入
+const float PLAN_EPSILON = 1e-6f;//比这还薄的余料不算
+
+struct PlanSettings
+{
+    int strategy = PLAN_AXIAL;
+    int tool = 0;//tool_library()的下标
+    double depth = 2.0;//粗车每刀最大切深（mm，半径方向）；径向切入时是轴向步距
+    double allowance = 0.2;//粗车给精车留的余量（mm，半径方向）
+    double rough_feed = 300.0;//mm/min
+    double finish_feed = 120.0;
+    double clearance = 1.0;//两刀之间退到毛坯最高处上方多少（mm）
+    bool finish = true;
+};
+
+// a planned path and its estimate
+struct ToolPath
+{
+    std::vector<GcodeMove> moves;
+    int tool = 0;
+    int strategy = PLAN_AXIAL;
+    int passes = 0;//粗车的刀数（不算精车）
+    double cut_length = 0.0;//进给移动的总长（mm）
+    double rapid_length = 0.0;
+    double cycle_time = 0.0;//按进给和快移速度估算的加工时间（秒）
+    double plan_ms = 0.0;//规划本身花的时间
+};
+
+// program millimetres of a profile position (inverse of gcode_axial()/gcode_distance())
+inline double plan_z(double u)
+{
+    return (u - 1.0) * GCODE_STOCK_LENGTH;
+}
+
+inline double plan_x(double distance)
+{
+    return distance * GCODE_STOCK_DIAMETER;
+}
+
+// millimetres on the radius to profile radius units
+inline float plan_radius(double mm)
+{
+    return (float)(mm * 2.0 / GCODE_STOCK_DIAMETER);
+}
+
+// target radius at the middle of each of `bins` bins from a polyline of (u, radius) points sorted by u;
+// bins outside the polyline keep the workpiece as it is (the target there is the current radius)
+inline void plan_target_polyline(const std::vector<glm::dvec2>& points, const Workpiece& workpiece, int bins, std::vector<float>& target)
+{
+    target.resize(bins);
+    size_t k = 0;
+    for (int i = 0; i < bins; i++)
+    {
+        double u = (i + 0.5) / bins;
+        if (points.size() < 2 || u < points.front().x || u > points.back().x)
+        {
+            target[i] = workpiece.profile.max_radius((double)i / bins, (double)(i + 1) / bins);
+            continue;
+        }
+        while (k + 2 < points.size() && points[k + 1].x < u)
+        {
+            k++;
+        }
+        const glm::dvec2& a = points[k];
+        const glm::dvec2& b = points[k + 1];
+        double t = b.x > a.x ? (u - a.x) / (b.x - a.x) : 1.0;
+        target[i] = (float)std::max(0.0, a.y + (b.y - a.y) * std::max(0.0, std::min(1.0, t)));
+    }
+}
+
+// a flattened curve in the (-1,1)x(-1,1) half-section space (the same mapping as bezier_cut())
+inline void plan_target_curve(const std::vector<glm::vec2>& curve, const Workpiece& workpiece, int bins, std::vector<float>& target)
+{
+    std::vector<glm::dvec2> points;
+    points.reserve(curve.size());
+    for (size_t i = 0; i < curve.size(); i++)
+    {
+        glm::dvec2 p(bezier_axial(curve[i]), bezier_radius(curve[i]));
+        //x往回走的地方（曲线打了个结）保留较小的半径，目标仍然是u的函数
+        if (!points.empty() && p.x <= points.back().x)
+        {
+            points.back().y = std::min(points.back().y, p.y);
+            continue;
+        }
+        points.push_back(p);
+    }
+    plan_target_polyline(points, workpiece, bins, target);
+}
+
+// the cubic bezier A,B,C,D in the half-section space
+inline void plan_target_bezier(glm::vec2 A, glm::vec2 B, glm::vec2 C, glm::vec2 D, const Workpiece& workpiece, int bins, std::vector<float>& target)
+{
+    std::vector<glm::vec2> curve;
+    Bezier(A, B, C, D).flatten(curve);
+    plan_target_curve(curve, workpiece, bins, target);
+}
+
+// an SVG or DXF drawing (drawing.h); bins the drawing does not reach keep the workpiece as it is, like plan_target_polyline()
+inline bool plan_target_drawing(const std::string& path, const Workpiece& workpiece, int bins, std::vector<float>& target)
+{
+    DrawingReport report;
+    drawing_read(path, bins, target, report);
+    print_drawing_report(path, report);
+    for (int i = 0; i < bins; i++)
+    {
+        if (target[i] == DRAWING_NONE)
+        {
+            target[i] = workpiece.profile.max_radius((double)i / bins, (double)(i + 1) / bins);
+        }
+    }
+    return report.ok;
+}
+
+// the max-radius envelope of an OBJ/STL mesh (mesh_envelope.h) about whichever of its x, y, z axes turns it best,
+// scaled into the bar; bins outside the part keep the workpiece as it is
+inline bool plan_target_mesh(const std::string& path, const Workpiece& workpiece, int bins, std::vector<float>& target)
+{
+    TriangleMesh mesh;
+    if (!mesh_load(path, mesh))
+    {
+        return false;
+    }
+    MeshEnvelope envelope = mesh_envelope_best_axis(mesh, bins);
+    print_mesh_report(path, envelope);
+    target.swap(envelope.radius);
+    for (int i = 0; i < bins; i++)
+    {
+        if (target[i] == MESH_NONE)
+        {
+            target[i] = workpiece.profile.max_radius((double)i / bins, (double)(i + 1) / bins);
+        }
+    }
+    return true;
+}
+
+// a text file of "Z X" lines in program millimetres (X a diameter, Z0 at the +x end like G-code), '#' comments;
+// .svg and .dxf files are read as drawings, .obj and .stl as meshes
+inline bool plan_target_file(const std::string& path, const Workpiece& workpiece, int bins, std::vector<float>& target)
+{
+    if (drawing_format(path) != DRAWING_UNKNOWN)
+    {
+        return plan_target_drawing(path, workpiece, bins, target);
+    }
+    if (mesh_format(path))
+    {
+        return plan_target_mesh(path, workpiece, bins, target);
+    }
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        std::cout << "ERROR::PLANNER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    std::vector<glm::dvec2> points;
+    std::string text;
+    while (std::getline(file, text))
+    {
+        double z, x;
+        if (text.empty() || text[0] == '#' || std::sscanf(text.c_str(), "%lf %lf", &z, &x) != 2)
+        {
+            continue;
+        }
+        points.push_back(glm::dvec2(gcode_axial(z), gcode_distance(x)));
+    }
+    std::sort(points.begin(), points.end(), [](const glm::dvec2& a, const glm::dvec2& b) { return a.x < b.x; });
+    plan_target_polyline(points, workpiece, bins, target);
+    return points.size() >= 2;
+}
+
+// lowest point of the tool edge in each bin around the tip, see the comment at the top: with `tip` 0.5 the tip is in the
+// middle of bin `reach` and edge[j] covers the tip anywhere in its bin, with `tip` 0 the tip is on the left edge of bin `reach`
+// and edge[j] covers the tip anywhere between two bin middles; a point only cuts right under itself, so it needs no
+// segment edge (empty): between two middles its tip never goes below both ends
+inline void plan_tool_edge(const Tool& tool, int bins, double tip, std::vector<float>& edge, int& reach)
+{
+    if (tool.is_point())
+    {
+        edge.assign(tip > 0.0 ? 1 : 0, 0.0f);
+        reach = 0;
+        return;
+    }
+    const int c = bins / 2;
+    Profile::KnotList envelope;
+    tool.envelope((c + tip) / bins, 0.0f, envelope);
+    int first = std::max(0, (int)std::floor(envelope.front().first * bins));
+    int last = std::min(bins - 1, (int)std::ceil(envelope.back().first * bins) - 1);
+    edge.resize(last - first + 1);
+    envelope_min_rows(envelope, first, last - first + 1, bins, &edge[0]);
+    reach = c - first;
+}
+
+// append a straight move to the path and its time to the estimate (zero-length moves are dropped)
+inline void plan_move(ToolPath& path, bool rapid, double u0, float d0, double u1, float d1, double feed)
+{
+    GcodeMove m;
+    m.rapid = rapid;
+    m.z0 = plan_z(u0);
+    m.x0 = plan_x(d0);
+    m.z1 = plan_z(u1);
+    m.x1 = plan_x(d1);
+    m.feed = rapid ? GCODE_RAPID_RATE : feed;
+    double length = std::sqrt((m.z1 - m.z0) * (m.z1 - m.z0) + 0.25 * (m.x1 - m.x0) * (m.x1 - m.x0));
+    if (length <= 0.0)
+    {
+        return;
+    }
+    (rapid ? path.rapid_length : path.cut_length) += length;
+    path.cycle_time += length / m.feed * 60.0;
+    path.moves.push_back(m);
+}
+
+// the knife position at the end of the path so far
+inline void plan_position(const ToolPath& path, double& u, float& d)
+{
+    u = gcode_axial(path.moves.back().z1);
+    d = gcode_distance(path.moves.back().x1);
+}
+
+// one pass: the tip follows height[] (in the middle of each bin) wherever stock[] is above it, from the +x end
+// towards the chuck; each stretch with material is approached by G0 from `clear`, cut at feed and left by G0 up to clear
+// between bins i and i + 1 it goes straight unless the lower end is under segment[i], then in a step on the bin edge;
+// stock[] is lowered to what the pass leaves; false if there was nothing to cut
+inline bool plan_pass(ToolPath& path, std::vector<float>& stock, const std::vector<float>& height, const std::vector<float>& segment, float clear, double feed)
+{
+    const int bins = (int)stock.size();
+    const float approach = plan_radius(PLAN_APPROACH);
+    bool cut = false;
+    std::vector<glm::dvec2> points;
+    for (int b = bins - 1; b >= 0; )
+    {
+        if (stock[b] <= height[b] + PLAN_EPSILON)
+        {
+            b--;
+            continue;
+        }
+        int a = b;
+        while (a > 0 && stock[a - 1] > height[a - 1] + PLAN_EPSILON)
+        {
+            a--;
+        }
+        //折点：右端格子的边、每个格子的中点（台阶是格子边上的两个点）、左端格子的边，共线的合并掉
+        auto add = [&points](glm::dvec2 p) {
+            if (points.size() >= 2)
+            {
+                glm::dvec2 o = points[points.size() - 2], q = points.back();
+                if (std::fabs((q.x - o.x) * (p.y - o.y) - (q.y - o.y) * (p.x - o.x)) < 1e-12)
+                {
+                    points.back() = p;
+                    return;
+                }
+            }
+            points.push_back(p);
+        };
+        points.clear();
+        points.push_back(glm::dvec2((double)(b + 1) / bins, height[b]));
+        for (int i = b; i >= a; i--)
+        {
+            if (i < b && std::min(height[i], height[i + 1]) < segment[i])
+            {
+                add(glm::dvec2((double)(i + 1) / bins, height[i + 1]));
+                add(glm::dvec2((double)(i + 1) / bins, height[i]));
+            }
+            add(glm::dvec2((i + 0.5) / bins, height[i]));
+        }
+        add(glm::dvec2((double)a / bins, height[a]));
+        double u;
+        float d;
+        plan_position(path, u, d);
+        if (d < clear)
+        {
+            plan_move(path, true, u, d, u, clear, 0.0);
+        }
+        float entry = std::min(clear, std::max(stock[b], (float)points.front().y) + approach);
+        plan_move(path, true, u, clear, points.front().x, clear, 0.0);
+        plan_move(path, true, points.front().x, clear, points.front().x, entry, 0.0);
+        plan_move(path, false, points.front().x, entry, points.front().x, (float)points.front().y, feed);
+        for (size_t i = 1; i < points.size(); i++)
+        {
+            plan_move(path, false, points[i - 1].x, (float)points[i - 1].y, points[i].x, (float)points[i].y, feed);
+        }
+        plan_move(path, true, points.back().x, (float)points.back().y, points.back().x, clear, 0.0);
+        for (int i = a; i <= b; i++)
+        {
+            stock[i] = std::min(stock[i], height[i]);
+        }
+        cut = true;
+        b = a - 1;
+    }
+    return cut;
+}
+
+// plunges straight down to height[] every `step` bins where there is material above it (a grooving tool's roughing)
+inline bool plan_plunges(ToolPath& path, std::vector<float>& stock, const std::vector<float>& height, float clear, double feed, int step, int width)
+{
+    const int bins = (int)stock.size();
+    const float approach = plan_radius(PLAN_APPROACH);
+    bool cut = false;
+    for (int c = bins - 1; c >= 0; c -= step)
+    {
+        if (stock[c] <= height[c] + PLAN_EPSILON)
+        {
+            continue;
+        }
+        double u;
+        float d;
+        plan_position(path, u, d);
+        double uc = (c + 0.5) / bins;
+        if (d < clear)
+        {
+            plan_move(path, true, u, d, u, clear, 0.0);
+        }
+        plan_move(path, true, u, clear, uc, clear, 0.0);
+        plan_move(path, true, uc, clear, uc, std::min(clear, stock[c] + approach), 0.0);
+        plan_move(path, false, uc, std::min(clear, stock[c] + approach), uc, height[c], feed);
+        plan_move(path, true, uc, height[c], uc, clear, 0.0);
+        //刀片有宽度的话它扫过的格子都切到了这个深度
+        for (int i = std::max(0, c - width); i <= std::min(bins - 1, c + width); i++)
+        {
+            stock[i] = std::min(stock[i], std::max(height[c], height[i]));
+        }
+        cut = true;
+    }
+    return cut;
+}
+
+// plan roughing and finishing from the workpiece as it is now to target[] (radius in the middle of each bin, see
+// plan_target_polyline()), starting with the knife at (u, distance)
+inline ToolPath plan_toolpath(const Workpiece& workpiece, const std::vector<float>& target, const PlanSettings& settings, double u, float distance)
+{
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    ToolPath path;
+    path.tool = settings.tool;
+    path.strategy = settings.strategy;
+    const int bins = (int)target.size();
+    if (bins == 0)
+    {
+        return path;
+    }
+    std::vector<float> stock(bins), lowest(bins), height(bins);
+    float top = 0.0f;
+    for (int i = 0; i < bins; i++)
+    {
+        stock[i] = workpiece.profile.max_radius((double)i / bins, (double)(i + 1) / bins);
+        top = std::max(top, stock[i]);
+    }
+    //刀尖能到的最低处
+    std::vector<float> edge;
+    int reach;
+    const Tool& tool = tool_library()[std::max(0, std::min((int)tool_library().size() - 1, settings.tool))];
+    plan_tool_edge(tool, bins, 0.5, edge, reach);
+    for (int i = 0; i < bins; i++)
+    {
+        float d = 0.0f;
+        for (int j = 0; j < (int)edge.size(); j++)
+        {
+            int k = i + j - reach;
+            if (k >= 0 && k < bins)
+            {
+                d = std::max(d, target[k] - edge[j]);
+            }
+        }
+        lowest[i] = d;
+    }
+    //刀尖在格子i和i + 1中点之间走直线时的下限
+    std::vector<float> segment(bins, 0.0f);
+    plan_tool_edge(tool, bins, 0.0, edge, reach);
+    for (int i = 0; i + 1 < bins; i++)
+    {
+        for (int j = 0; j < (int)edge.size(); j++)
+        {
+            int k = i + 1 + j - reach;
+            if (k >= 0 && k < bins)
+            {
+                segment[i] = std::max(segment[i], target[k] - edge[j]);
+            }
+        }
+    }
+    const float clear = std::max(top, distance) + plan_radius(settings.clearance);
+    const float step = plan_radius(std::max(0.01, settings.depth));
+    const float allowance = plan_radius(std::max(0.0, settings.allowance));
+    //从刀具现在的位置开始，先径向退到安全高度；起点当作一个不动的移动放在最前面给plan_position()用，最后去掉
+    GcodeMove origin;
+    origin.z0 = origin.z1 = plan_z(u);
+    origin.x0 = origin.x1 = plan_x(distance);
+    path.moves.push_back(origin);
+    plan_move(path, true, u, distance, u, std::max(distance, clear), 0.0);
+
+    if (settings.strategy == PLAN_AXIAL)
+    {
+        for (float level = top - step; ; level -= step)
+        {
+            bool last = true;
+            for (int i = 0; i < bins; i++)
+            {
+                height[i] = std::max(level, lowest[i] + allowance);
+                last = last && height[i] > level;
+            }
+            path.passes += plan_pass(path, stock, height, segment, clear, settings.rough_feed);
+            if (last || level <= 0.0f)
+            {
+                break;
+            }
+        }
+    }
+    else if (settings.strategy == PLAN_CONTOUR)
+    {
+        float deepest = 0.0f;
+        for (int i = 0; i < bins; i++)
+        {
+            deepest = std::max(deepest, stock[i] - lowest[i] - allowance);
+        }
+        for (int k = (int)std::ceil(deepest / step) - 1; k >= 0; k--)
+        {
+            for (int i = 0; i < bins; i++)
+            {
+                height[i] = lowest[i] + allowance + k * step;
+            }
+            path.passes += plan_pass(path, stock, height, segment, clear, settings.rough_feed);
+        }
+    }
+    else
+    {
+        int every = std::max(1, (int)std::floor(settings.depth / GCODE_STOCK_LENGTH * bins));
+        int width = std::max(0, (int)std::floor(tool.width * 0.5 / (2.0 * length_k) * bins));
+        for (int i = 0; i < bins; i++)
+        {
+            height[i] = lowest[i] + allowance;
+        }
+        path.passes += plan_plunges(path, stock, height, clear, settings.rough_feed, every, width);
+    }
+    if (settings.finish)
+    {
+        plan_pass(path, stock, lowest, segment, clear, settings.finish_feed);
+    }
+    path.moves.erase(path.moves.begin());
+    path.plan_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    return path;
+}
+
+// cut the whole path at full speed through the same engine as a G-code program, the knife ends where the path does
+inline float plan_execute(const ToolPath& path, Workpiece& workpiece, Cutter& cutter)
+{
+    cutter.tool = path.tool;
+    float mount = 0.0f;
+    for (size_t i = 0; i < path.moves.size(); i++)
+    {
+        const GcodeMove& m = path.moves[i];
+        mount = std::max(mount, cutter.cut_sweep(workpiece, gcode_axial(m.z0), gcode_distance(m.x0), gcode_axial(m.z1), gcode_distance(m.x1)));
+    }
+    if (!path.moves.empty())
+    {
+        cutter.set_position(gcode_axial(path.moves.back().z1), gcode_distance(path.moves.back().x1));
+    }
+    return mount;
+}
+
+// write the path as a G-code program (absolute, mm/min) that GcodeProgram runs like any other
+inline bool plan_write_gcode(const ToolPath& path, const std::string& file_path)
+{
+    std::ofstream out(file_path.c_str(), std::ios::out | std::ios::trunc);
+    if (!out)
+    {
+        std::cout << "ERROR::PLANNER::FILE_NOT_SUCCESFULLY_WRITTEN: " << file_path << std::endl;
+        return false;
+    }
+    out << "(" << PLAN_STRATEGY_NAMES[path.strategy] << " roughing, " << path.passes << " passes, estimated " << path.cycle_time << " s)\n";
+    out << "G21 G90 G94\nT" << path.tool << "\n" << std::fixed << std::setprecision(4);
+    double feed = -1.0;
+    for (size_t i = 0; i < path.moves.size(); i++)
+    {
+        const GcodeMove& m = path.moves[i];
+        out << (m.rapid ? "G0" : "G1") << " X" << m.x1 << " Z" << m.z1;
+        if (!m.rapid && m.feed != feed)
+        {
+            feed = m.feed;
+            out << " F" << feed;
+        }
+        out << "\n";
+    }
+    out << "M30\n";
+    return true;
+}
+
+inline void print_plan_report(const ToolPath& path)
+{
+    std::cout << "plan " << PLAN_STRATEGY_NAMES[path.strategy] << " (" << tool_library()[path.tool].name << "): "
+        << path.passes << " roughing passes, " << path.moves.size() << " moves, cutting " << path.cut_length << " mm, rapid "
+        << path.rapid_length << " mm, estimated cycle time " << path.cycle_time << " s, planned in " << path.plan_ms << " ms" << std::endl;
+}
+
+#endif
@@ -0,0 +1,497 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// 工件轮廓：按轴向位置排序的折点（std::map），折点之间线性插值
+// 轴向位置u是double，0~1对应工件的一端到另一端，精度不受分段数限制；平直的一段只需要两端两个折点
+// 台阶（刀具切出的竖直边）用同一个折点的left/right两个值表示
+// 查询、切削都是O(log n + k)，k是被切到的区间里的折点数
+// 合并掉的折点不会累积误差：每个折点记着它左边这一段离真正切出来的轮廓最多差多少，合并时加上去，总和不超过merge_tolerance
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <utility>
+
+struct ProfileKnot
+{
+    float left;//从左边趋近这个位置的半径
+    float right;//这个位置以及右边的半径
+    float error = 0.0f;//从上一个折点到这里的线段和合并之前的轮廓最多差多少（合并掉的折点累积下来的）
+};
+
+class Profile
+{
+public:
+    typedef std::map<double, ProfileKnot> KnotMap;
+    typedef std::vector<std::pair<double, ProfileKnot> > KnotList;//按u递增的折线，和KnotMap一样可以有台阶
+    KnotMap knots;//首尾在u=0和u=1，总是存在
+    float merge_tolerance = 1e-6f;//合并掉的折点累积起来离前后两个折点连线的误差不超过这个值才合并
+
+    Profile(float r = 1.0f);
+
+    void reset(float r);
+    float radius_at(double u) const;
+    float min_radius(double u0, double u1) const;
+    float max_radius(double u0, double u1) const;
+    float mean_radius(double u0, double u1) const;
+    void mean_radii(int first, int count, int bins, float* out) const;
+    float cut(double u0, double u1, float distance);
+    float cut(double u0, double u1, float d0, float d1);
+    float cut_envelope(const KnotList& envelope);
+    size_t knot_count() const;
+    void copy_knots(double u0, double u1, KnotList& out) const;
+    void replace_knots(double u0, double u1, const KnotList& list);
+
+private:
+    std::vector<KnotMap::iterator> added;//这一刀split()和刀刃折点加进来的折点，刀没碰到工件时原样去掉
+
+    KnotMap::iterator split(double u);
+    void merge(KnotMap::iterator first, KnotMap::iterator last);
+    float finish_cut(KnotMap::iterator first, KnotMap::iterator last, float mount);
+};
+
+inline Profile::Profile(float r)
+{
+    reset(r);
+}
+
+inline void Profile::reset(float r)
+{
+    knots.clear();
+    knots[0.0] = ProfileKnot{ r, r };
+    knots[1.0] = ProfileKnot{ r, r };
+}
+
+// radius at axial position u (the right-hand value on a step)
+inline float Profile::radius_at(double u) const
+{
+    u = std::max(0.0, std::min(1.0, u));
+    KnotMap::const_iterator next = knots.upper_bound(u);
+    if (next == knots.end())
+    {
+        return knots.rbegin()->second.right;
+    }
+    KnotMap::const_iterator prev = std::prev(next);
+    if (prev->first == u)
+    {
+        return prev->second.right;
+    }
+    double t = (u - prev->first) / (next->first - prev->first);
+    return (float)(prev->second.right + (next->second.left - prev->second.right) * t);
+}
+
+// smallest radius over [u0, u1), this is what a render segment shows so thin grooves never disappear
+inline float Profile::min_radius(double u0, double u1) const
+{
+    float r = radius_at(u0);
+    KnotMap::const_iterator it = knots.upper_bound(u0);
+    for (; it != knots.end() && it->first < u1; ++it)
+    {
+        r = std::min(r, std::min(it->second.left, it->second.right));
+    }
+    //u1处从左边趋近的值
+    if (it != knots.end() && it->first == u1)
+    {
+        return std::min(r, it->second.left);
+    }
+    return std::min(r, radius_at(u1));
+}
+
+// largest radius over [u0, u1]
+inline float Profile::max_radius(double u0, double u1) const
+{
+    float r = std::max(radius_at(u0), radius_at(u1));
+    KnotMap::const_iterator it = knots.upper_bound(u0);
+    for (; it != knots.end() && it->first <= u1; ++it)
+    {
+        r = std::max(r, std::max(it->second.left, it->second.right));
+    }
+    return r;
+}
+
+// average radius over [u0, u1] (integral of the piecewise linear profile / length)
+inline float Profile::mean_radius(double u0, double u1) const
+{
+    if (u1 <= u0)
+    {
+        return radius_at(u0);
+    }
+    double area = 0.0;
+    double u = u0;
+    double r = radius_at(u0);
+    KnotMap::const_iterator it = knots.upper_bound(u0);
+    for (; it != knots.end() && it->first < u1; ++it)
+    {
+        area += (it->first - u) * (r + it->second.left) * 0.5;
+        u = it->first;
+        r = it->second.right;
+    }
+    double r1 = it != knots.end() && it->first == u1 ? it->second.left : radius_at(u1);
+    area += (u1 - u) * (r + r1) * 0.5;
+    return (float)(area / (u1 - u0));
+}
+
+// the average radius of bins first ~ first+count-1 out of `bins` equal bins, in one sweep over the knots
+// (what mean_radius() gives per bin, without a map lookup for every bin)
+inline void Profile::mean_radii(int first, int count, int bins, float* out) const
+{
+    double u = (double)first / bins;
+    double r = radius_at(u);
+    KnotMap::const_iterator it = knots.upper_bound(u);
+    for (int i = 0; i < count; i++)
+    {
+        const double u0 = u;
+        const double u1 = (double)(first + i + 1) / bins;
+        double area = 0.0;
+        for (; it != knots.end() && it->first < u1; ++it)
+        {
+            area += (it->first - u) * (r + it->second.left) * 0.5;
+            u = it->first;
+            r = it->second.right;
+        }
+        double r1 = r;
+        if (it != knots.end())
+        {
+            r1 = it->first == u1 ? it->second.left : r + (it->second.left - r) * ((u1 - u) / (it->first - u));
+        }
+        area += (u1 - u) * (r + r1) * 0.5;
+        out[i] = (float)(area / (u1 - u0));
+        u = u1;
+        r = r1;
+        if (it != knots.end() && it->first == u1)
+        {
+            r = it->second.right;
+            ++it;
+        }
+    }
+}
+
+// cut [u0, u1] down to distance, returns the largest removed radius (0 if the knife does not touch)
+inline float Profile::cut(double u0, double u1, float distance)
+{
+    return cut(u0, u1, distance, distance);
+}
+
+// cut [u0, u1] down to the line from d0 (at u0) to d1 (at u1): the path of a knife tip moving axially and radially
+// at the same time; with d0 == d1 this is the flat cut above
+inline float Profile::cut(double u0, double u1, float d0, float d1)
+{
+    const double line_u0 = u0;
+    const double line_du = u1 - u0;
+    auto line = [&](double u) { return d0 == d1 ? d0 : (float)(d0 + (d1 - d0) * ((u - line_u0) / line_du)); };
+    u0 = std::max(0.0, u0);
+    u1 = std::min(1.0, u1);
+    if (u1 <= u0 || max_radius(u0, u1) <= std::min(d0, d1))
+    {
+        return 0.0f;
+    }
+    KnotMap::iterator first = split(u0);
+    KnotMap::iterator last = split(u1);
+    //线性段和切削线相交的地方加一个折点，这样切完之后每段仍然是线性的
+    for (KnotMap::iterator it = first; it != last; )
+    {
+        KnotMap::iterator next = std::next(it);
+        float a = it->second.right - line(it->first);
+        float b = next->second.left - line(next->first);
+        if ((a > 0.0f && b < 0.0f) || (a < 0.0f && b > 0.0f))
+        {
+            double u = it->first + (next->first - it->first) * (a / (a - b));
+            if (u > it->first && u < next->first)
+            {
+                float r = line(u);
+                knots.insert(next, KnotMap::value_type(u, ProfileKnot{ r, r, next->second.error }));
+            }
+        }
+        it = next;
+    }
+    float mount = 0.0f;
+    for (KnotMap::iterator it = first; ; ++it)
+    {
+        float r = line(it->first);
+        if (it != first)
+        {
+            mount = std::max(mount, it->second.left - r);
+            it->second.left = std::min(it->second.left, r);
+        }
+        if (it == last)
+        {
+            break;
+        }
+        mount = std::max(mount, it->second.right - r);
+        it->second.right = std::min(it->second.right, r);
+    }
+    return finish_cut(first, last, mount);
+}
+
+// left/right value of the polyline envelope at u (inside its range)
+inline void envelope_at(const Profile::KnotList& envelope, double u, float& left, float& right)
+{
+    Profile::KnotList::const_iterator next = std::lower_bound(envelope.begin(), envelope.end(), u,
+        [](const std::pair<double, ProfileKnot>& knot, double value) { return knot.first < value; });
+    if (next != envelope.end() && next->first == u)
+    {
+        left = next->second.left;
+        right = next->second.right;
+        return;
+    }
+    if (next == envelope.begin() || next == envelope.end())
+    {
+        left = right = next == envelope.begin() ? envelope.front().second.right : envelope.back().second.left;
+        return;
+    }
+    Profile::KnotList::const_iterator prev = std::prev(next);
+    double t = (u - prev->first) / (next->first - prev->first);
+    left = right = (float)(prev->second.right + (next->second.left - prev->second.right) * t);
+}
+
+// lowest value of the envelope inside each of the bins first ~ first+count-1 out of `bins` (clipped to its range),
+// one sweep over the envelope knots
+inline void envelope_min_rows(const Profile::KnotList& envelope, int first, int count, int bins, float* out)
+{
+    const size_t m = envelope.size();
+    size_t j = 0;
+    for (int i = 0; i < count; i++)
+    {
+        double a = std::max((double)(first + i) / bins, envelope.front().first);
+        double b = std::max(a, std::min((double)(first + i + 1) / bins, envelope.back().first));
+        while (j < m && envelope[j].first <= a)
+        {
+            j++;
+        }
+        //a处从右边取的值
+        float r;
+        if (envelope[j - 1].first == a || j == m)
+        {
+            r = envelope[j - 1].second.right;
+        }
+        else
+        {
+            double t = (a - envelope[j - 1].first) / (envelope[j].first - envelope[j - 1].first);
+            r = (float)(envelope[j - 1].second.right + (envelope[j].second.left - envelope[j - 1].second.right) * t);
+        }
+        size_t k = j;
+        for (; k < m && envelope[k].first < b; k++)
+        {
+            r = std::min(r, std::min(envelope[k].second.left, envelope[k].second.right));
+        }
+        //b处从左边取的值
+        if (k < m && k > 0 && b > a)
+        {
+            if (envelope[k].first == b)
+            {
+                r = std::min(r, envelope[k].second.left);
+            }
+            else
+            {
+                double t = (b - envelope[k - 1].first) / (envelope[k].first - envelope[k - 1].first);
+                r = std::min(r, (float)(envelope[k - 1].second.right + (envelope[k].second.left - envelope[k - 1].second.right) * t));
+            }
+        }
+        out[i] = r;
+    }
+}
+
+// cut the profile down to a piecewise linear envelope (a tool's edge, see tool.h) over the envelope's range:
+// one merge pass over the profile knots and the envelope knots, with a knot added wherever the two cross,
+// so a tool of any number of edges costs O(k + m log m) instead of one cut() per edge
+inline float Profile::cut_envelope(const KnotList& envelope)
+{
+    if (envelope.size() < 2)
+    {
+        return 0.0f;
+    }
+    const double ua = std::max(0.0, envelope.front().first);
+    const double ub = std::min(1.0, envelope.back().first);
+    float lowest = envelope.front().second.right;
+    for (size_t i = 0; i < envelope.size(); i++)
+    {
+        lowest = std::min(lowest, std::min(envelope[i].second.left, envelope[i].second.right));
+    }
+    if (ub <= ua || max_radius(ua, ub) <= lowest)
+    {
+        return 0.0f;
+    }
+    KnotMap::iterator first = split(ua);
+    KnotMap::iterator last = split(ub);
+
+    //按u合并两组折点：原有的折点就地取两者的较小值，刀刃的折点和两条线段的交点插进去
+    float mount = 0.0f;
+    KnotMap::iterator p = first;//下一个要处理的原有折点
+    double prev_knot_u = ua;//上一个原有折点和它改之前的右侧值，刀刃折点处的轮廓值由它插值
+    float prev_knot_right = first->second.right;
+    size_t e = std::upper_bound(envelope.begin(), envelope.end(), ua,
+        [](double value, const std::pair<double, ProfileKnot>& knot) { return value < knot.first; }) - envelope.begin();
+    double prev_u = ua;
+    float prev_profile = 0.0f;
+    float prev_envelope = 0.0f;
+    for (bool start = true; ; start = false)
+    {
+        KnotMap::iterator at = knots.end();
+        double u;
+        float pl, pr;
+        if (e >= envelope.size() || envelope[e].first >= ub || p->first <= envelope[e].first)
+        {
+            at = p;
+            u = p->first;
+            pl = p->second.left;
+            pr = p->second.right;
+            if (e < envelope.size() && envelope[e].first == u)
+            {
+                e++;
+            }
+            prev_knot_u = u;
+            prev_knot_right = pr;
+            ++p;
+        }
+        else
+        {
+            u = envelope[e].first;
+            double t = (u - prev_knot_u) / (p->first - prev_knot_u);
+            pl = pr = (float)(prev_knot_right + (p->second.left - prev_knot_right) * t);
+            e++;
+        }
+        KnotMap::iterator next = at != knots.end() ? at : p;//在u之前插入用的位置
+        float el, er;
+        envelope_at(envelope, u, el, er);
+        if (!start)
+        {
+            float a = prev_profile - prev_envelope;
+            float b = pl - el;
+            if ((a > 0.0f && b < 0.0f) || (a < 0.0f && b > 0.0f))
+            {
+                double t = a / (a - b);
+                double x = prev_u + (u - prev_u) * t;
+                if (x > prev_u && x < u)
+                {
+                    float r = (float)(prev_profile + (pl - prev_profile) * t);
+                    knots.insert(next, KnotMap::value_type(x, ProfileKnot{ r, r, next->second.error }));
+                }
+            }
+        }
+        bool at_end = u >= ub;
+        float left = start ? pl : std::min(pl, el);
+        float right = at_end ? pr : std::min(pr, er);
+        mount = std::max(mount, std::max(pl - left, pr - right));
+        if (at != knots.end())
+        {
+            at->second.left = left;
+            at->second.right = right;
+        }
+        else
+        {
+            added.push_back(knots.insert(next, KnotMap::value_type(u, ProfileKnot{ left, right, next->second.error })));
+        }
+        if (at_end)
+        {
+            break;
+        }
+        prev_u = u;
+        prev_profile = pr;
+        prev_envelope = er;
+    }
+    return finish_cut(first, last, mount);
+}
+
+// after a cut over [first, last]: merge if anything was cut; otherwise take out only the knots the cut added
+// (the profile is unchanged then, and nothing outside what the workpiece marks as changed may move, see history.h)
+// a miss only adds knots on the existing lines, the crossings come with a cut
+inline float Profile::finish_cut(KnotMap::iterator first, KnotMap::iterator last, float mount)
+{
+    if (mount > 0.0f)
+    {
+        merge(first, last);
+    }
+    else
+    {
+        for (size_t i = 0; i < added.size(); i++)
+        {
+            knots.erase(added[i]);
+        }
+    }
+    added.clear();
+    return mount;
+}
+
+inline size_t Profile::knot_count() const
+{
+    return knots.size();
+}
+
+// the knots with u0 <= u < u1 (a chunk of the profile, see history.h)
+inline void Profile::copy_knots(double u0, double u1, KnotList& out) const
+{
+    out.assign(knots.lower_bound(u0), knots.lower_bound(u1));
+}
+
+// put back a chunk taken with copy_knots() over the same [u0, u1)
+inline void Profile::replace_knots(double u0, double u1, const KnotList& list)
+{
+    KnotMap::iterator it = knots.erase(knots.lower_bound(u0), knots.lower_bound(u1));
+    for (size_t i = 0; i < list.size(); i++)
+    {
+        knots.insert(it, list[i]);
+    }
+}
+
+// make sure there is a knot at u and return it
+// (a knot inserted into a line keeps the error bound of the line on both sides, see merge())
+inline Profile::KnotMap::iterator Profile::split(double u)
+{
+    KnotMap::iterator it = knots.lower_bound(u);
+    if (it != knots.end() && it->first == u)
+    {
+        return it;
+    }
+    float r = radius_at(u);
+    it = knots.insert(it, KnotMap::value_type(u, ProfileKnot{ r, r, it != knots.end() ? it->second.error : 0.0f }));
+    added.push_back(it);
+    return it;
+}
+
+// drop the knots in [first, last] (and one on each side) that lie on the line through their neighbours;
+// the new line is off by at most the dropped knot's distance from it plus the larger error already on its two lines
+// (both old lines stay within that distance of the new one), so a knot is only dropped while that sum is within
+// merge_tolerance: knots merged away one cut at a time cannot drift further than merge_tolerance in all
+// (cutting keeps the bound: min(profile, knife) moves no further than the profile itself)
+inline void Profile::merge(KnotMap::iterator first, KnotMap::iterator last)
+{
+    if (first != knots.begin())
+    {
+        --first;
+    }
+    if (last != knots.end() && std::next(last) != knots.end())
+    {
+        ++last;
+    }
+    KnotMap::iterator it = std::next(first);
+    while (it != knots.end() && it != std::next(last) && std::next(it) != knots.end())
+    {
+        KnotMap::iterator prev = std::prev(it);
+        KnotMap::iterator next = std::next(it);
+        bool removable = false;
+        float error = 0.0f;
+        if (std::fabs(it->second.left - it->second.right) <= merge_tolerance)
+        {
+            double t = (it->first - prev->first) / (next->first - prev->first);
+            float line = (float)(prev->second.right + (next->second.left - prev->second.right) * t);
+            error = std::max(it->second.error, next->second.error)
+                + std::max(std::fabs(it->second.right - line), std::fabs(it->second.left - line));
+            removable = error <= merge_tolerance;
+        }
+        if (!removable)
+        {
+            ++it;
+            continue;
+        }
+        next->second.error = error;
+        bool at_last = it == last;
+        it = knots.erase(it);
+        if (at_last)
+        {
+            break;
+        }
+    }
+}
+
+#endif
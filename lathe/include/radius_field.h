@@ -0,0 +1,264 @@
+#ifndef RADIUS_FIELD_H
+#define RADIUS_FIELD_H
+
+// 二维半径场 radius[y][theta]：每个segment、每个角度一个半径，可以表示偏心、铣平面、键槽、走刀纹
+// 按FIELD_TILE x FIELD_TILE的块存储，一个块（1KB）在内存里是连续的：
+// 切削只碰到刀具附近的几个块，上传时每个脏块直接作为一个glTexSubImage2D的子图
+// 一行在一个块里的16个角度是连续的，切削按这样的连续段用SSE2一次取4个的min（LATHE_SSE2见ring_generator.h）
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+const int FIELD_TILE = 16;
+const int FIELD_THETA_SEGMENTS = 256;//默认的角度分段数
+
+class RadiusField
+{
+public:
+    int y_segments = 0;//行数（和Workpiece的segment对应）
+    int theta_segments = 0;//列数，第c列在角度 c * 2PI / theta_segments
+    int tiles_y = 0;
+    int tiles_theta = 0;
+    std::vector<float> data;//按块存储，见index()
+    std::vector<unsigned char> tile_dirty;//改过、还没上传的块
+    std::vector<int> dirty_tiles;//同上，按加入顺序
+
+    void init(int y_segments, int theta_segments, const float* rows);
+    float at(int y, int theta) const;
+    void set(int y, int theta, float r);
+    float cut(int y_first, int y_last, double theta0, double theta1, float distance);
+    float cut_rows(int y_first, int y_last, const float* distance, double theta0, double theta1);
+    float cut_row_scalar(int y, long long c0, long long c1, float distance);
+#ifdef LATHE_SSE2
+    float cut_row_sse(int y, long long c0, long long c1, float distance);
+#endif
+    float row_max(int y) const;
+    const float* tile(int n) const;
+    void set_tile(int n, const float* cells);
+    void tile_origin(int n, int& y, int& theta) const;
+    void clear_dirty();
+
+private:
+    size_t index(int y, int theta) const;
+    void mark_tile(int y, int theta);
+    void sweep_columns(double theta0, double theta1, long long& c0, long long& c1) const;
+    float cut_row(int y, long long c0, long long c1, float distance);
+};
+
+// rows[y] is the starting radius of row y (the axisymmetric profile), every angle starts the same
+inline void RadiusField::init(int rows_count, int columns, const float* rows)
+{
+    y_segments = rows_count;
+    theta_segments = columns;
+    tiles_y = (y_segments + FIELD_TILE - 1) / FIELD_TILE;
+    tiles_theta = (theta_segments + FIELD_TILE - 1) / FIELD_TILE;
+    data.assign((size_t)tiles_y * tiles_theta * FIELD_TILE * FIELD_TILE, 0.0f);
+    for (int y = 0; y < y_segments; y++)
+    {
+        for (int t = 0; t < theta_segments; t++)
+        {
+            data[index(y, t)] = rows[y];
+        }
+    }
+    tile_dirty.assign(tiles_y * tiles_theta, 0);
+    dirty_tiles.clear();
+}
+
+// tile (y / FIELD_TILE, theta / FIELD_TILE), row major inside the tile
+inline size_t RadiusField::index(int y, int theta) const
+{
+    size_t tile = (size_t)(y / FIELD_TILE) * tiles_theta + theta / FIELD_TILE;
+    return tile * FIELD_TILE * FIELD_TILE + (y % FIELD_TILE) * FIELD_TILE + theta % FIELD_TILE;
+}
+
+// theta wraps around, y is clamped to the field
+inline float RadiusField::at(int y, int theta) const
+{
+    y = std::max(0, std::min(y, y_segments - 1));
+    theta = ((theta % theta_segments) + theta_segments) % theta_segments;
+    return data[index(y, theta)];
+}
+
+inline void RadiusField::set(int y, int theta, float r)
+{
+    data[index(y, theta)] = r;
+    mark_tile(y, theta);
+}
+
+// cut rows [y_first, y_last] down to distance for the spindle angles swept from theta0 to theta1 (radians, theta1 >= theta0)
+// a column is cut when its angular cell [c - 0.5, c + 0.5] overlaps the sweep; returns the largest removed radius
+inline float RadiusField::cut(int y_first, int y_last, double theta0, double theta1, float distance)
+{
+    y_first = std::max(0, y_first);
+    y_last = std::min(y_segments - 1, y_last);
+    long long c0, c1;
+    sweep_columns(theta0, theta1, c0, c1);
+    float mount = 0.0f;
+    for (int y = y_first; y <= y_last; y++)
+    {
+        mount = std::max(mount, cut_row(y, c0, c1, distance));
+    }
+    return mount;
+}
+
+// same with a depth per row: distance[y - y_first] (a tool envelope, see Workpiece::cut_field_envelope())
+inline float RadiusField::cut_rows(int y_first, int y_last, const float* distance, double theta0, double theta1)
+{
+    long long c0, c1;
+    sweep_columns(theta0, theta1, c0, c1);
+    float mount = 0.0f;
+    for (int y = std::max(0, y_first); y <= std::min(y_segments - 1, y_last); y++)
+    {
+        mount = std::max(mount, cut_row(y, c0, c1, distance[y - y_first]));
+    }
+    return mount;
+}
+
+// columns c0~c1 (not wrapped yet) under the sweep, at most one revolution
+inline void RadiusField::sweep_columns(double theta0, double theta1, long long& c0, long long& c1) const
+{
+    const double step = 2.0 * 3.14159265358979323846 / theta_segments;
+    c0 = (long long)std::floor(theta0 / step + 0.5);
+    c1 = (long long)std::floor(theta1 / step + 0.5);
+    if (c1 - c0 >= theta_segments)
+    {
+        c1 = c0 + theta_segments - 1;//转了一整圈
+    }
+}
+
+inline float RadiusField::cut_row(int y, long long c0, long long c1, float distance)
+{
+#ifdef LATHE_SSE2
+    return cut_row_sse(y, c0, c1, distance);
+#else
+    return cut_row_scalar(y, c0, c1, distance);
+#endif
+}
+
+// columns c0~c1 of row y, walked as runs that are contiguous in memory (inside one tile, no wrap)
+inline float RadiusField::cut_row_scalar(int y, long long c0, long long c1, float distance)
+{
+    float mount = 0.0f;
+    int t = (int)(((c0 % theta_segments) + theta_segments) % theta_segments);
+    for (long long left = c1 - c0 + 1; left > 0; )
+    {
+        int n = (int)std::min<long long>(std::min((t / FIELD_TILE + 1) * FIELD_TILE, theta_segments) - t, left);
+        float* cells = &data[index(y, t)];
+        bool changed = false;
+        for (int i = 0; i < n; i++)
+        {
+            if (cells[i] > distance)
+            {
+                mount = std::max(mount, cells[i] - distance);
+                cells[i] = distance;
+                changed = true;
+            }
+        }
+        if (changed)
+        {
+            mark_tile(y, t);
+        }
+        left -= n;
+        t = t + n == theta_segments ? 0 : t + n;
+    }
+    return mount;
+}
+
+#ifdef LATHE_SSE2
+// 4 cells per min; the removed radius is kept as a vector for the whole row and reduced once
+inline float RadiusField::cut_row_sse(int y, long long c0, long long c1, float distance)
+{
+    const __m128 d = _mm_set1_ps(distance);
+    __m128 removed = _mm_setzero_ps();
+    float mount = 0.0f;
+    int t = (int)(((c0 % theta_segments) + theta_segments) % theta_segments);
+    for (long long left = c1 - c0 + 1; left > 0; )
+    {
+        int n = (int)std::min<long long>(std::min((t / FIELD_TILE + 1) * FIELD_TILE, theta_segments) - t, left);
+        float* cells = &data[index(y, t)];
+        __m128 above = _mm_setzero_ps();
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 r = _mm_loadu_ps(cells + i);
+            above = _mm_or_ps(above, _mm_cmpgt_ps(r, d));
+            removed = _mm_max_ps(removed, _mm_sub_ps(r, d));
+            _mm_storeu_ps(cells + i, _mm_min_ps(r, d));
+        }
+        bool changed = _mm_movemask_ps(above) != 0;
+        for (; i < n; i++)
+        {
+            if (cells[i] > distance)
+            {
+                mount = std::max(mount, cells[i] - distance);
+                cells[i] = distance;
+                changed = true;
+            }
+        }
+        if (changed)
+        {
+            mark_tile(y, t);
+        }
+        left -= n;
+        t = t + n == theta_segments ? 0 : t + n;
+    }
+    removed = _mm_max_ps(removed, _mm_movehl_ps(removed, removed));
+    removed = _mm_max_ss(removed, _mm_shuffle_ps(removed, removed, 1));
+    return std::max(mount, _mm_cvtss_f32(removed));
+}
+#endif
+
+// largest radius of row y over all angles (the envelope an axisymmetric view would keep)
+inline float RadiusField::row_max(int y) const
+{
+    float r = 0.0f;
+    for (int t = 0; t < theta_segments; t++)
+    {
+        r = std::max(r, data[index(y, t)]);
+    }
+    return r;
+}
+
+// the FIELD_TILE * FIELD_TILE floats of tile n, contiguous
+inline const float* RadiusField::tile(int n) const
+{
+    return &data[(size_t)n * FIELD_TILE * FIELD_TILE];
+}
+
+// overwrite tile n with FIELD_TILE * FIELD_TILE floats (a tile copied from another field of the same size)
+inline void RadiusField::set_tile(int n, const float* cells)
+{
+    std::copy(cells, cells + FIELD_TILE * FIELD_TILE, data.begin() + (size_t)n * FIELD_TILE * FIELD_TILE);
+    if (!tile_dirty[n])
+    {
+        tile_dirty[n] = 1;
+        dirty_tiles.push_back(n);
+    }
+}
+
+inline void RadiusField::tile_origin(int n, int& y, int& theta) const
+{
+    y = n / tiles_theta * FIELD_TILE;
+    theta = n % tiles_theta * FIELD_TILE;
+}
+
+inline void RadiusField::clear_dirty()
+{
+    for (size_t i = 0; i < dirty_tiles.size(); i++)
+    {
+        tile_dirty[dirty_tiles[i]] = 0;
+    }
+    dirty_tiles.clear();
+}
+
+inline void RadiusField::mark_tile(int y, int theta)
+{
+    int n = y / FIELD_TILE * tiles_theta + theta / FIELD_TILE;
+    if (!tile_dirty[n])
+    {
+        tile_dirty[n] = 1;
+        dirty_tiles.push_back(n);
+    }
+}
+
+#endif
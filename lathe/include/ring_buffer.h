@@ -0,0 +1,70 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+// 无锁环形缓冲：一个线程写、一个线程读，双方都不会等对方
+// 和三缓冲不同，每一条都要交给读线程（遥测的每个tick），不能只留最新的一份
+// 满了写线程直接丢掉这一条并计数，不等读线程；head只有写线程改，tail只有读线程改
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t N>
+class RingBuffer
+{
+public:
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+    bool push(const T& value);
+    bool pop(T& value);
+    size_t size() const;
+    unsigned long long dropped() const;
+
+private:
+    T slots[N];
+    std::atomic<size_t> head{ 0 };//下一个写的位置（一直递增，取模N）
+    std::atomic<size_t> tail{ 0 };//下一个读的位置
+    std::atomic<unsigned long long> lost{ 0 };//满了丢掉的条数
+};
+
+// producer: false (and counted as dropped) when the consumer has fallen N entries behind
+template <typename T, size_t N>
+inline bool RingBuffer<T, N>::push(const T& value)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N)
+    {
+        lost.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    slots[h & (N - 1)] = value;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+// consumer: the oldest entry, false if there is none
+template <typename T, size_t N>
+inline bool RingBuffer<T, N>::pop(T& value)
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    value = slots[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+// entries waiting, exact only on the consumer side
+template <typename T, size_t N>
+inline size_t RingBuffer<T, N>::size() const
+{
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+template <typename T, size_t N>
+inline unsigned long long RingBuffer<T, N>::dropped() const
+{
+    return lost.load(std::memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef RING_GENERATOR_H
+#define RING_GENERATOR_H
+
+// 生成一个ring上所有点的坐标和法向量（PackedVertex格式）
+// 角度只和列x有关，cos/sin表按分辨率算一次，坐标和法向量共用这两张表
+// generate_sse()一次算4列，generate_scalar()是逐列的参考实现，两者输出逐字节一致
+// 由workpiece.h在PackedVertex定义之后include，不要单独include
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LATHE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+class RingGenerator
+{
+public:
+    int columns = 0;//每个ring的点数 = x_segments + 1
+    std::vector<float> cos_table;//长度补齐到4的倍数
+    std::vector<float> sin_table;
+
+    RingGenerator(int x_segments = 0);
+
+    void init(int x_segments);
+    // r: 半径（工件坐标，1.0是原始半径）, y: 已压缩的轴向坐标
+    // k, ny: 法向量 = (cos*k, ny, sin*k)，由调用者按相邻ring的半径差算好
+    void generate(float r, int16_t y, float k, float ny, uint8_t state, PackedVertex* out) const;
+    void generate_scalar(float r, int16_t y, float k, float ny, uint8_t state, PackedVertex* out) const;
+#ifdef LATHE_SSE2
+    void generate_sse(float r, int16_t y, float k, float ny, uint8_t state, PackedVertex* out) const;
+#endif
+};
+
+inline RingGenerator::RingGenerator(int x_segments)
+{
+    if (x_segments > 0)
+    {
+        init(x_segments);
+    }
+}
+
+inline void RingGenerator::init(int x_segments)
+{
+    columns = x_segments + 1;
+    int padded = (columns + 3) / 4 * 4;
+    cos_table.assign(padded, 0.0f);
+    sin_table.assign(padded, 0.0f);
+    for (int x = 0; x < columns; x++)
+    {
+        float xSegment = (float)x / (float)x_segments;
+        cos_table[x] = std::cos(xSegment * 2.0f * PI);
+        sin_table[x] = std::sin(xSegment * 2.0f * PI);
+    }
+}
+
+inline void RingGenerator::generate(float r, int16_t y, float k, float ny, uint8_t state, PackedVertex* out) const
+{
+#ifdef LATHE_SSE2
+    generate_sse(r, y, k, ny, state, out);
+#else
+    generate_scalar(r, y, k, ny, state, out);
+#endif
+}
+
+// snorm16 packing with round-to-nearest-even, the same rounding _mm_cvtps_epi32 uses
+inline int16_t ring_snorm16(float v)
+{
+    v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+    return (int16_t)std::nearbyint(v * 32767.0f);
+}
+
+inline void RingGenerator::generate_scalar(float r, int16_t y, float k, float ny, uint8_t state, PackedVertex* out) const
+{
+    float abs_ny = std::fabs(ny);
+    for (int x = 0; x < columns; x++)
+    {
+        float c = cos_table[x];
+        float s = sin_table[x];
+        //八面体编码，见oct_encode()
+        float nx = c * k;
+        float nz = s * k;
+        float l1 = std::fabs(nx) + abs_ny + std::fabs(nz);
+        float ex = nx / l1;
+        float ey = ny / l1;
+        if (nz < 0.0f)
+        {
+            float fx = (1.0f - std::fabs(ey)) * (ex >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - std::fabs(ex)) * (ey >= 0.0f ? 1.0f : -1.0f);
+            ex = fx;
+            ey = fy;
+        }
+        out[x].pos[0] = ring_snorm16(r * c);
+        out[x].pos[1] = y;
+        out[x].pos[2] = ring_snorm16(r * s);
+        out[x].state = state;
+        out[x].deviation = 0;
+        out[x].normal[0] = ring_snorm16(ex);
+        out[x].normal[1] = ring_snorm16(ey);
+    }
+}
+
+#ifdef LATHE_SSE2
+inline void RingGenerator::generate_sse(float r, int16_t y, float k, float ny, uint8_t state, PackedVertex* out) const
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 vr = _mm_set1_ps(r);
+    const __m128 vk = _mm_set1_ps(k);
+    const __m128 vny = _mm_set1_ps(ny);
+    const __m128 abs_ny = _mm_and_ps(vny, abs_mask);
+
+    int16_t px[4], pz[4], ex16[4], ey16[4];
+    for (int x = 0; x < columns; x += 4)
+    {
+        __m128 c = _mm_loadu_ps(&cos_table[x]);
+        __m128 s = _mm_loadu_ps(&sin_table[x]);
+        __m128 nx = _mm_mul_ps(c, vk);
+        __m128 nz = _mm_mul_ps(s, vk);
+        __m128 l1 = _mm_add_ps(_mm_add_ps(_mm_and_ps(nx, abs_mask), abs_ny), _mm_and_ps(nz, abs_mask));
+        __m128 ex = _mm_div_ps(nx, l1);
+        __m128 ey = _mm_div_ps(vny, l1);
+        //下半球折叠到外侧
+        __m128 sign_x = _mm_cmpge_ps(ex, zero);
+        sign_x = _mm_or_ps(_mm_and_ps(sign_x, one), _mm_andnot_ps(sign_x, minus_one));
+        __m128 sign_y = _mm_cmpge_ps(ey, zero);
+        sign_y = _mm_or_ps(_mm_and_ps(sign_y, one), _mm_andnot_ps(sign_y, minus_one));
+        __m128 fx = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(ey, abs_mask)), sign_x);
+        __m128 fy = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(ex, abs_mask)), sign_y);
+        __m128 lower = _mm_cmplt_ps(nz, zero);
+        ex = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, ex));
+        ey = _mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, ey));
+
+        //clamp到[-1,1]后转成16位整数
+        __m128 pos_x = _mm_max_ps(minus_one, _mm_min_ps(one, _mm_mul_ps(vr, c)));
+        __m128 pos_z = _mm_max_ps(minus_one, _mm_min_ps(one, _mm_mul_ps(vr, s)));
+        ex = _mm_max_ps(minus_one, _mm_min_ps(one, ex));
+        ey = _mm_max_ps(minus_one, _mm_min_ps(one, ey));
+        __m128i ixz = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(pos_x, scale)), _mm_cvtps_epi32(_mm_mul_ps(pos_z, scale)));
+        __m128i ie = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(ex, scale)), _mm_cvtps_epi32(_mm_mul_ps(ey, scale)));
+        _mm_storel_epi64((__m128i*)px, ixz);
+        _mm_storel_epi64((__m128i*)pz, _mm_srli_si128(ixz, 8));
+        _mm_storel_epi64((__m128i*)ex16, ie);
+        _mm_storel_epi64((__m128i*)ey16, _mm_srli_si128(ie, 8));
+
+        int n = columns - x < 4 ? columns - x : 4;
+        for (int i = 0; i < n; i++)
+        {
+            PackedVertex& v = out[x + i];
+            v.pos[0] = px[i];
+            v.pos[1] = y;
+            v.pos[2] = pz[i];
+            v.state = state;
+            v.deviation = 0;
+            v.normal[0] = ex16[i];
+            v.normal[1] = ey16[i];
+        }
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,715 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+// 模拟线程：刀具运动、切削、粒子按固定的MOTION_TICK_RATE（1kHz）推进，和渲染循环互不阻塞
+// 每个tick之后把半径集合、二维半径场、刀具位置和粒子写进三缓冲发布出去，渲染线程每帧sync()取最新的一份，
+// 同步到自己的Workpiece（只读它的radius/field生成点阵、纹理），两边都不加锁
+// 修改工件的操作（重置、换分辨率、二维模式、bezier、全速跑G代码）用post()交给模拟线程在下一个tick之前执行；
+// 实时跑的G代码程序打开后由每个tick推进，代替方向键的输入
+// 用户的操作都是SimulationCommand，和每个tick读到的方向键一起按tick记进会话记录（journal.h），replay()按同样的顺序重新执行
+// 每条命令之前、每次方向键从松开到按下时记一个撤销点（history.h），撤销/重做也是命令
+// 每个tick切掉的体积、去除率、切削力和功率写进无锁环形缓冲（telemetry.h），渲染线程取走
+// 同一份Metrology也是G代码快移的碰撞检查（collision.h），测量结果随每一帧发布
+// bezier、样条、图纸的切削和规划命令同时设置偏差分析的目标轮廓（deviation.h），每个tick和测量一起增量更新，
+// 每个segment的分类跟着它的半径一起发布
+// 同样不依赖glad/GLFW
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+#include "workpiece.h"
+#include "cutter.h"
+#include "particles.h"
+#include "triple_buffer.h"
+#include "gcode.h"
+#include "journal.h"
+#include "history.h"
+#include "planner.h"
+#include "metrology.h"
+#include "telemetry.h"
+#include "spline.h"
+#include "deviation.h"
+
+const int DUST_TICKS = MOTION_TICK_RATE / 60;//多少个tick生成一批切削粒子
+
+// what a replay() did
+struct ReplayReport
+{
+    long long ticks = 0;
+    long long inputs = 0;
+    long long commands = 0;
+    bool ended = false;//记录里有结束记录（正常退出的会话）
+    bool identical = false;//切出的零件和记录时逐位相同
+    double seconds = 0.0;
+};
+
+// 一份发布给渲染线程的状态
+struct SimulationFrame
+{
+    long long tick = 0;
+    unsigned layout = 0;//分辨率、二维模式变了或者重置时加一，渲染线程整份重新同步
+    int y_segments = 0;
+    int x_segments = 0;
+    bool field_enabled = false;
+    std::vector<float> radius;
+    std::vector<unsigned> radius_revision;//每个元素最后一次改动的版本，渲染线程只拷贝版本变了的
+    std::vector<float> field;//RadiusField::data，按块存储
+    std::vector<unsigned> tile_revision;//每个块最后一次改动的版本
+    glm::vec3 knife_pos = knife_pos_reset;
+    float knife_distance = 1.0f;
+    int tool = 0;
+    MeasureNode measure;//整根工件的测量（metrology.h），标题栏和M键的报告用
+    std::vector<uint8_t> deviation;//每个segment的偏差分类，和radius一起按radius_revision拷贝
+    DeviationNode deviation_total;//整根工件和目标的偏差，没有目标时deviation_bins是0
+    int deviation_bins = 0;
+    std::vector<DeviationRange> deviation_ranges;//超出公差的区间（最多DEVIATION_RANGE_LIMIT个）
+    int deviation_range_count = 0;
+    std::vector<Particle> particles;
+};
+
+class Simulation
+{
+public:
+    //只属于模拟线程：线程跑起来之后只能在post()的命令里访问
+    Workpiece workpiece;
+    Cutter cutter;
+    ParticleSystem particles;
+    GcodeProgram program;//打开时（实时）每个tick按程序走刀
+    History history;//撤销/重做
+    Metrology metrology;//模拟工件的体积，每个tick按改过的segment更新，前后的差就是这个tick切掉的
+    int material = 0;//metrology_materials()的下标，COMMAND_MATERIAL设置，决定遥测的比切削能
+    Deviation deviation;//和目标轮廓的偏差，每个tick按改过的segment更新
+
+    //模拟线程每个tick写一条、渲染线程读
+    TelemetryBuffer telemetry;
+
+    //渲染线程写、模拟线程每个tick读
+    std::atomic<int> axial_dir{ 0 };
+    std::atomic<int> radial_dir{ 0 };
+    std::atomic<float> feed_scale{ 1.0f };
+
+    Simulation(int y_segments = Y_SEGMENTS, int x_segments = X_SEGMENTS);
+    ~Simulation();
+
+    void start();
+    void stop();
+    bool running() const;
+    void post(std::function<void(Simulation&)> command);
+    void post(const SimulationCommand& command);
+    void apply(const SimulationCommand& command);
+    void plan(const SimulationCommand& command, const std::vector<float>& target);
+    void compare(const std::vector<float>& target);
+    bool record(const std::string& path);
+    bool replay(const std::string& path, ReplayReport& report);
+    void step();
+    void publish();
+    bool sync(Workpiece& view, bool& relayout);
+    const SimulationFrame& frame() const;
+    long long ticks_behind() const;
+
+private:
+    std::thread thread;
+    std::atomic<bool> active{ false };
+    std::atomic<long long> behind{ 0 };
+    std::mutex command_mutex;
+    std::vector<std::function<void(Simulation&)> > commands;
+    TripleBuffer<SimulationFrame> frames;
+    JournalWriter journal;//只在模拟线程（或者线程没跑时）写
+
+    //模拟线程
+    float dust_mount = 0.0f;//还没生成粒子的切削量（最近几个tick里最大的）
+    double measured_volume = 0.0;//上一个tick之后工件的体积（mm³）
+    unsigned layout = 1;
+    unsigned revision = 0;
+    std::vector<unsigned> radius_revision;
+    std::vector<unsigned> tile_revision;
+
+    //渲染线程
+    unsigned view_layout = 0;
+    std::vector<unsigned> view_radius_revision;
+    std::vector<unsigned> view_tile_revision;
+
+    void run();
+    bool run_commands();
+    void commands_done(int y_segments, int x_segments, bool field_enabled);
+    void relayout();
+    void track_changes();
+    void remeasure();
+};
+
+// the simulation's own workpiece never builds a mesh, the renderer meshes its synced copy
+inline Simulation::Simulation(int y_segments, int x_segments)
+    : workpiece(y_segments, x_segments)
+{
+    workpiece.set_mesh_enabled(false);
+    history.clear(workpiece);
+    program.guard = &metrology;//G0切进工件时停下
+    relayout();
+}
+
+inline Simulation::~Simulation()
+{
+    stop();
+}
+
+// start ticking in real time; the motion clock starts at tick 0 now
+inline void Simulation::start()
+{
+    if (active)
+    {
+        return;
+    }
+    active = true;
+    publish();
+    thread = std::thread(&Simulation::run, this);
+}
+
+inline void Simulation::stop()
+{
+    active = false;
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+    run_commands();
+    journal.close(cutter.motion_tick, workpiece);
+}
+
+inline bool Simulation::running() const
+{
+    return active;
+}
+
+// queue a change to the workpiece/cutter, it runs on the simulation thread before the next tick
+// (right away when the thread is not running)
+inline void Simulation::post(std::function<void(Simulation&)> command)
+{
+    if (!active)
+    {
+        int y = workpiece.y_segments, x = workpiece.x_segments;
+        bool field = workpiece.field_enabled;
+        command(*this);
+        commands_done(y, x, field);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(command_mutex);
+    commands.push_back(command);
+}
+
+// a user command: journaled at the tick it runs before, so a replay applies it at the same point
+inline void Simulation::post(const SimulationCommand& command)
+{
+    post([command](Simulation& sim) {
+        sim.journal.command(sim.cutter.motion_tick < 0 ? 0 : sim.cutter.motion_tick, command);
+        sim.apply(command);
+    });
+}
+
+// a command is an undo level of its own: whatever was cut before it becomes a level first
+inline void Simulation::apply(const SimulationCommand& command)
+{
+    if (command.type != COMMAND_UNDO && command.type != COMMAND_REDO)
+    {
+        history.checkpoint(workpiece);
+    }
+    switch (command.type)
+    {
+    case COMMAND_RESET:
+        program.close();
+        cutter.reset();
+        workpiece.reset();
+        break;
+    case COMMAND_RESOLUTION:
+        workpiece.set_resolution(command.value, workpiece.x_segments);
+        break;
+    case COMMAND_FIELD:
+        workpiece.set_field_enabled(command.value != 0);
+        break;
+    case COMMAND_TOOL:
+        cutter.tool = command.value >= 0 ? command.value : cutter.tool + 1;
+        cutter.tool %= (int)tool_library().size();
+        break;
+    case COMMAND_BEZIER:
+    {
+        std::vector<float> target;
+        plan_target_bezier(command.points[0], command.points[1], command.points[2], command.points[3], workpiece, workpiece.y_segments, target);
+        compare(target);
+        bezier_cut(workpiece, command.points[0], command.points[1], command.points[2], command.points[3]);
+        break;
+    }
+    case COMMAND_GCODE:
+        //程序在跑时停止，否则从刀具当前位置开始
+        if (program.active())
+        {
+            print_gcode_report(program.report());
+            program.close();
+        }
+        else if (program.open(command.path, cutter) && command.value)
+        {
+            print_gcode_report(program.run(workpiece, cutter));
+        }
+        break;
+    case COMMAND_PLAN:
+    {
+        std::vector<float> target;
+        plan_target_bezier(command.points[0], command.points[1], command.points[2], command.points[3], workpiece, workpiece.y_segments, target);
+        plan(command, target);
+        break;
+    }
+    case COMMAND_SPLINE:
+    {
+        SplineEditor spline(workpiece.y_segments);
+        spline.assign(command.spline);
+        int first, last;
+        spline.update(first, last);
+        std::vector<glm::vec2> curve;
+        spline.polyline(curve);
+        std::vector<float> target;
+        plan_target_curve(curve, workpiece, workpiece.y_segments, target);
+        if (command.value < 0)
+        {
+            compare(target);
+            polyline_cut(workpiece, curve);
+            break;
+        }
+        plan(command, target);
+        break;
+    }
+    case COMMAND_DRAWING:
+    {
+        if (command.value < 0)
+        {
+            std::vector<float> radius;
+            DrawingReport report;
+            drawing_read(command.path, workpiece.y_segments, radius, report);
+            print_drawing_report(command.path, report);
+            compare(radius);//图纸没画到的segment不比较
+            drawing_cut(workpiece, radius);
+            break;
+        }
+        std::vector<float> target;
+        if (plan_target_drawing(command.path, workpiece, workpiece.y_segments, target))
+        {
+            SimulationCommand planned = command;
+            planned.path = drawing_program_path(command.path);
+            plan(planned, target);
+        }
+        break;
+    }
+    case COMMAND_UNDO:
+        program.close();
+        history.undo(workpiece);
+        break;
+    case COMMAND_REDO:
+        program.close();
+        history.redo(workpiece);
+        break;
+    case COMMAND_MATERIAL:
+        material = std::max(0, std::min(METROLOGY_MATERIALS - 1, command.value));//绘制之外只影响遥测
+        break;
+    default:
+        break;
+    }
+}
+
+// plan every roughing strategy to target (the bezier, spline or drawing of the command) from the part as it is now (reported side by side),
+// write the one in command.value to command.path and run it at feed pace like a G-code program
+inline void Simulation::plan(const SimulationCommand& command, const std::vector<float>& target)
+{
+    program.close();
+    compare(target);
+    PlanSettings settings;
+    settings.tool = cutter.tool;
+    ToolPath chosen;
+    for (int strategy = 0; strategy < PLAN_STRATEGIES; strategy++)
+    {
+        settings.strategy = strategy;
+        ToolPath path = plan_toolpath(workpiece, target, settings, cutter.knife_axial(), cutter.knife_distance);
+        print_plan_report(path);
+        if (strategy == command.value)
+        {
+            chosen = path;
+        }
+    }
+    if (plan_write_gcode(chosen, command.path))
+    {
+        program.open(command.path, cutter);
+    }
+}
+
+// the part is compared against target from now on (the default band); every segment goes out again with its new class
+inline void Simulation::compare(const std::vector<float>& target)
+{
+    deviation.set_target(workpiece, target);
+    revision++;
+    std::fill(radius_revision.begin(), radius_revision.end(), revision);
+}
+
+// journal everything from now on to path (call before start(), after the initial resolution and spindle are set);
+// the journal is finished with the final part's hash in stop()
+inline bool Simulation::record(const std::string& path)
+{
+    JournalSetup setup;
+    setup.y_segments = workpiece.y_segments;
+    setup.x_segments = workpiece.x_segments;
+    setup.r_segments = cutter.r_segments;
+    setup.field_enabled = workpiece.field_enabled;
+    setup.tool = cutter.tool;
+    setup.spindle_speed = cutter.spindle_speed;
+    setup.spindle_phase = cutter.spindle_phase;
+    history.clear(workpiece);//重放从这个状态开始，撤销不能越过它
+    return journal.open(path, setup);
+}
+
+// run a journal again without the thread, as fast as possible: the same commands and inputs before the same ticks
+// give the same part bit for bit (a G-code program is read again from its path)
+inline bool Simulation::replay(const std::string& path, ReplayReport& report)
+{
+    report = ReplayReport();
+    JournalReader reader;
+    JournalRecord r;
+    if (active || !reader.open(path) || !reader.next(r) || r.type != JOURNAL_SETUP)
+    {
+        return false;
+    }
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    program.close();
+    cutter = Cutter();
+    workpiece.set_field_enabled(false);
+    workpiece.set_resolution(r.setup.y_segments, r.setup.field_enabled ? workpiece.x_segments : r.setup.x_segments);
+    workpiece.reset();
+    if (r.setup.field_enabled)
+    {
+        workpiece.set_field_enabled(true, r.setup.x_segments);
+    }
+    cutter.r_segments = r.setup.r_segments;
+    cutter.tool = r.setup.tool;
+    cutter.spindle_speed = r.setup.spindle_speed;
+    cutter.spindle_phase = r.setup.spindle_phase;
+    cutter.motion_tick = 0;
+    material = 0;
+    deviation.clear();
+    particles.particles.clear();
+    axial_dir = 0;
+    radial_dir = 0;
+    feed_scale = 1.0f;
+    history.clear(workpiece);
+    relayout();
+    while (reader.next(r))
+    {
+        while (cutter.motion_tick < r.tick)
+        {
+            step();
+        }
+        if (r.type == JOURNAL_INPUT)
+        {
+            axial_dir = r.axial_dir;
+            radial_dir = r.radial_dir;
+            feed_scale = r.feed_scale;
+            report.inputs++;
+        }
+        else if (r.type == JOURNAL_COMMAND)
+        {
+            int y = workpiece.y_segments, x = workpiece.x_segments;
+            bool field = workpiece.field_enabled;
+            apply(r.command);
+            commands_done(y, x, field);
+            report.commands++;
+        }
+        else if (r.type == JOURNAL_END)
+        {
+            report.ended = true;
+            report.identical = r.y_segments == workpiece.y_segments && r.hash == workpiece_hash(workpiece);
+            break;
+        }
+    }
+    report.ticks = cutter.motion_tick;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return !reader.failed();
+}
+
+// the thread: sleep until the next tick is due, then run every due tick and publish once
+// a slow tick (or a resolution change) only makes it catch up, the ticks and the part stay the same
+inline void Simulation::run()
+{
+    typedef std::chrono::steady_clock SimClock;
+    const SimClock::time_point start_time = SimClock::now();
+    const SimClock::duration tick_length = std::chrono::duration_cast<SimClock::duration>(std::chrono::duration<double>(1.0 / MOTION_TICK_RATE));
+    cutter.motion_tick = 0;
+    while (active)
+    {
+        if (run_commands())
+        {
+            publish();
+        }
+        long long due = (SimClock::now() - start_time) / tick_length;
+        if (cutter.motion_tick >= due)
+        {
+            std::this_thread::sleep_until(start_time + tick_length * (cutter.motion_tick + 1));
+            continue;
+        }
+        behind = due - cutter.motion_tick;
+        while (cutter.motion_tick < due)
+        {
+            step();
+        }
+        publish();
+    }
+}
+
+inline bool Simulation::run_commands()
+{
+    std::vector<std::function<void(Simulation&)> > pending;
+    {
+        std::lock_guard<std::mutex> lock(command_mutex);
+        pending.swap(commands);
+    }
+    if (pending.empty())
+    {
+        return false;
+    }
+    int y = workpiece.y_segments, x = workpiece.x_segments;
+    bool field = workpiece.field_enabled;
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        pending[i](*this);
+    }
+    commands_done(y, x, field);
+    return true;
+}
+
+// after commands: a new layout only when the resolution or the 2D mode changed, otherwise the changed segments
+// and tiles go out like a tick's (an undo then only remeshes what it restored)
+inline void Simulation::commands_done(int y_segments, int x_segments, bool field_enabled)
+{
+    if (workpiece.y_segments != y_segments || workpiece.x_segments != x_segments || workpiece.field_enabled != field_enabled)
+    {
+        relayout();
+        return;
+    }
+    track_changes();
+    remeasure();
+}
+
+// one tick: read the input, move and cut (Cutter::motion_step, or the running G-code program), spawn and move the dust
+inline void Simulation::step()
+{
+    int axial = axial_dir, radial = radial_dir;
+    float scale = feed_scale;
+    if (axial != cutter.axial_dir || radial != cutter.radial_dir || scale != cutter.feed_scale)
+    {
+        journal.input(cutter.motion_tick, axial, radial, scale);
+    }
+    if ((axial || radial) && !cutter.axial_dir && !cutter.radial_dir && !program.active())
+    {
+        history.checkpoint(workpiece);//方向键按下：上一次按住时切掉的算一步
+    }
+    cutter.axial_dir = axial;
+    cutter.radial_dir = radial;
+    cutter.feed_scale = scale;
+    float mount = program.active() ? program.tick(workpiece, cutter, cutter.motion_tick) : cutter.motion_step(workpiece, cutter.motion_tick);
+    //遥测：只更新这个tick改过的segment，满了就丢，不等渲染线程
+    metrology.update(workpiece);
+    deviation.update(workpiece);
+    double volume = metrology.volume();
+    telemetry.push(telemetry_sample(cutter.motion_tick, measured_volume - volume, cutter.knife_distance * GCODE_STOCK_DIAMETER * 0.5,
+        cutter.spindle_speed, metrology_materials()[material]));
+    measured_volume = volume;
+    cutter.motion_tick++;
+    //粒子按原来每帧一次的节奏生成（每DUST_TICKS个tick一批），否则每个tick一个粒子，数量是原来的十几倍
+    dust_mount = std::max(dust_mount, mount);
+    if (cutter.motion_tick % DUST_TICKS == 0 && dust_mount > 0.0f)
+    {
+        particles.create_particles(cutter.knife_pos, dust_mount);
+        dust_mount = 0.0f;
+    }
+    particles.update(1.0f / MOTION_TICK_RATE);
+    track_changes();
+}
+
+// after a command: the renderer copies the whole state once
+inline void Simulation::relayout()
+{
+    layout++;
+    radius_revision.assign(workpiece.radius.size(), 0);
+    tile_revision.assign(workpiece.field_enabled ? workpiece.field.tiles_y * workpiece.field.tiles_theta : 0, 0);
+    workpiece.clear_profile();
+    workpiece.field.clear_dirty();
+    remeasure();
+}
+
+// what commands did to the part is not cut by the knife: the next tick measures from here
+inline void Simulation::remeasure()
+{
+    metrology.update(workpiece);
+    deviation.update(workpiece);
+    measured_volume = metrology.volume();
+}
+
+// stamp the segments and tiles the last tick changed with a new revision
+inline void Simulation::track_changes()
+{
+    int first, count;
+    bool rows = workpiece.pending_profile(first, count);
+    bool tiles = workpiece.field_enabled && !workpiece.field.dirty_tiles.empty();
+    if (!rows && !tiles)
+    {
+        return;
+    }
+    revision++;
+    if (rows)
+    {
+        std::fill(radius_revision.begin() + first, radius_revision.begin() + first + count, revision);
+        workpiece.clear_profile();
+    }
+    if (tiles)
+    {
+        for (size_t i = 0; i < workpiece.field.dirty_tiles.size(); i++)
+        {
+            tile_revision[workpiece.field.dirty_tiles[i]] = revision;
+        }
+    }
+    workpiece.field.clear_dirty();
+}
+
+// fill the back buffer and hand it over; the buffer was last written two publishes ago,
+// so only what changed since then is copied (everything after a relayout)
+inline void Simulation::publish()
+{
+    SimulationFrame& f = frames.write_buffer();
+    f.tick = cutter.motion_tick;
+    f.knife_pos = cutter.knife_pos;
+    f.knife_distance = cutter.knife_distance;
+    f.tool = cutter.tool;
+    f.measure = metrology.total();
+    f.deviation_total = deviation.total();
+    f.deviation_bins = deviation.bins();
+    f.deviation_range_count = deviation.ranges(f.deviation_ranges);
+    f.particles = particles.particles;
+    if (f.layout != layout)
+    {
+        f.layout = layout;
+        f.y_segments = workpiece.y_segments;
+        f.x_segments = workpiece.x_segments;
+        f.field_enabled = workpiece.field_enabled;
+        f.radius = workpiece.radius;
+        f.deviation.resize(workpiece.radius.size());
+        for (size_t i = 0; i < f.deviation.size(); i++)
+        {
+            f.deviation[i] = deviation.state((int)i);
+        }
+        f.radius_revision = radius_revision;
+        if (workpiece.field_enabled)
+        {
+            f.field = workpiece.field.data;
+        }
+        else
+        {
+            f.field.clear();
+        }
+        f.tile_revision = tile_revision;
+        frames.publish();
+        return;
+    }
+    for (size_t i = 0; i < radius_revision.size(); i++)
+    {
+        if (f.radius_revision[i] != radius_revision[i])
+        {
+            f.radius[i] = workpiece.radius[i];
+            f.deviation[i] = deviation.state((int)i);
+            f.radius_revision[i] = radius_revision[i];
+        }
+    }
+    const size_t tile_cells = FIELD_TILE * FIELD_TILE;
+    for (size_t n = 0; n < tile_revision.size(); n++)
+    {
+        if (f.tile_revision[n] != tile_revision[n])
+        {
+            std::copy(workpiece.field.data.begin() + n * tile_cells, workpiece.field.data.begin() + (n + 1) * tile_cells, f.field.begin() + n * tile_cells);
+            f.tile_revision[n] = tile_revision[n];
+        }
+    }
+    frames.publish();
+}
+
+// render thread: bring view up to the newest published frame, false if nothing new was published
+// relayout is set when the resolution or the 2D mode changed (the GPU buffers have to be reallocated)
+inline bool Simulation::sync(Workpiece& view, bool& relayout)
+{
+    relayout = false;
+    if (!frames.acquire())
+    {
+        return false;
+    }
+    const SimulationFrame& f = frames.read_buffer();
+    if (f.layout != view_layout)
+    {
+        relayout = view.y_segments != f.y_segments || view.x_segments != f.x_segments || view.field_enabled != f.field_enabled;
+        if (view.field_enabled != f.field_enabled)
+        {
+            view.set_field_enabled(f.field_enabled, f.x_segments);
+        }
+        if (view.y_segments != f.y_segments || view.x_segments != f.x_segments)
+        {
+            view.set_resolution(f.y_segments, f.x_segments);
+        }
+        view.radius = f.radius;
+        view.deviation = f.deviation;
+        if (f.field_enabled)
+        {
+            for (int n = 0; n < view.field.tiles_y * view.field.tiles_theta; n++)
+            {
+                view.field.set_tile(n, &f.field[(size_t)n * FIELD_TILE * FIELD_TILE]);
+            }
+        }
+        view.mark_dirty(0, view.y_segments);
+        view_layout = f.layout;
+        view_radius_revision = f.radius_revision;
+        view_tile_revision = f.tile_revision;
+        return true;
+    }
+    int first = MAX_Y_SEGMENTS + 1;
+    int last = -1;
+    for (size_t i = 0; i < view_radius_revision.size(); i++)
+    {
+        if (view_radius_revision[i] != f.radius_revision[i])
+        {
+            view.radius[i] = f.radius[i];
+            view.deviation[i] = f.deviation[i];
+            view_radius_revision[i] = f.radius_revision[i];
+            first = std::min(first, (int)i);
+            last = (int)i;
+        }
+    }
+    for (size_t n = 0; n < view_tile_revision.size(); n++)
+    {
+        if (view_tile_revision[n] != f.tile_revision[n])
+        {
+            view.field.set_tile((int)n, &f.field[n * FIELD_TILE * FIELD_TILE]);
+            view_tile_revision[n] = f.tile_revision[n];
+        }
+    }
+    if (first <= last)
+    {
+        view.mark_dirty(first, last);
+    }
+    return true;
+}
+
+// the frame the last sync() took (knife, particles)
+inline const SimulationFrame& Simulation::frame() const
+{
+    return frames.read_buffer();
+}
+
+// how many ticks the thread had to catch up at once the last time it woke up (1 when it keeps up)
+inline long long Simulation::ticks_behind() const
+{
+    return behind;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef SPLINE_H
+#define SPLINE_H
+
+// 样条轮廓编辑器：bezier模式原来只能点四个点就切，真的轴要几十处台阶、圆角、锥面
+// 这里是任意多个控制点的均匀三次B样条（(-1,1)半截面坐标，和bezier一样），两端的点重复三次，曲线从第一个点开始、到最后一个点结束
+// B样条是局部的：一个控制点只影响相邻的4段，拖动一个点只把这几段换成bezier重新展平（bezier.h），
+// 只重新光栅化这几段前后经过的格子；update()返回变了的格子范围，渲染线程只重建这些ring（Workpiece::set_preview()）
+// 加点、删点会让后面的段整体移一位，整条曲线重新算一次（100个点约0.2ms）
+// 同样不依赖glad/GLFW
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "bezier.h"
+
+class SplineEditor
+{
+public:
+    std::vector<float> lowest;//每个格子里曲线的最低半径（工件单位，1.0是原始半径），BEZIER_NONE是曲线没经过
+
+    SplineEditor(int bins = 0);
+
+    void clear(int bins);
+    void resize(int bins);
+    void assign(const std::vector<glm::vec2>& points);
+    int size() const;
+    const glm::vec2& point(int k) const;
+    const std::vector<glm::vec2>& points() const;
+    int add(glm::vec2 p);
+    void move(int k, glm::vec2 p);
+    void erase(int k);
+    int nearest(glm::vec2 p, float within) const;
+    bool update(int& first, int& last);
+    void polyline(std::vector<glm::vec2>& out) const;
+    long long evaluated() const;
+
+private:
+    int bins = 0;
+    std::vector<glm::vec2> control;
+    std::vector<std::vector<glm::vec2> > spans;//每一段展平后的折线
+    std::vector<int> span_first, span_last;//每一段经过的格子，span_first > span_last是一个都没有
+    int stale_first = 0, stale_last = -1;//要重新展平的段
+    int changed_first = 0, changed_last = -1;//要重新光栅化的格子（已经包括了旧折线经过的）
+    bool rebuild = false;//段数变了
+    long long flattened = 0;//展平过的段数，统计增量更新用
+
+    glm::vec2 padded(int i) const;
+    void touch(int first_span, int last_span);
+    void change(int first, int last);
+};
+
+inline SplineEditor::SplineEditor(int bins)
+{
+    clear(bins);
+}
+
+inline void SplineEditor::clear(int bin_count)
+{
+    bins = std::max(0, bin_count);
+    change(0, bins - 1);//以前画过的格子都要清掉
+    control.clear();
+    spans.clear();
+    span_first.clear();
+    span_last.clear();
+    lowest.assign(bins, BEZIER_NONE);
+    stale_first = 0;
+    stale_last = -1;
+    rebuild = false;
+}
+
+// a new bin count (the bar's resolution changed): the same curve rasterized again
+inline void SplineEditor::resize(int bin_count)
+{
+    bins = std::max(0, bin_count);
+    lowest.assign(bins, BEZIER_NONE);
+    changed_first = 0;
+    changed_last = bins - 1;
+    rebuild = true;
+}
+
+// take the control points as they are, in this order (a journaled COMMAND_SPLINE)
+inline void SplineEditor::assign(const std::vector<glm::vec2>& points)
+{
+    control = points;
+    rebuild = true;
+}
+
+inline int SplineEditor::size() const
+{
+    return (int)control.size();
+}
+
+inline const glm::vec2& SplineEditor::point(int k) const
+{
+    return control[k];
+}
+
+inline const std::vector<glm::vec2>& SplineEditor::points() const
+{
+    return control;
+}
+
+// insert p between the control points around its x (a profile is drawn from one end of the bar to the other),
+// returns its index
+inline int SplineEditor::add(glm::vec2 p)
+{
+    int k = (int)(std::upper_bound(control.begin(), control.end(), p,
+        [](const glm::vec2& a, const glm::vec2& b) { return a.x < b.x; }) - control.begin());
+    control.insert(control.begin() + k, p);
+    rebuild = true;
+    return k;
+}
+
+// the spans control point k takes part in: padded index i is point clamp(i - 2), span j uses padded j..j+3
+inline void SplineEditor::move(int k, glm::vec2 p)
+{
+    if (k < 0 || k >= size() || control[k] == p)
+    {
+        return;
+    }
+    control[k] = p;
+    int n = size();
+    int lo = k == 0 ? 0 : k + 2;
+    int hi = k == n - 1 ? n + 3 : k + 2;
+    touch(lo - 3, hi);
+}
+
+inline void SplineEditor::erase(int k)
+{
+    if (k < 0 || k >= size())
+    {
+        return;
+    }
+    control.erase(control.begin() + k);
+    rebuild = true;
+}
+
+// the control point closest to p if it is within `within`, else -1
+inline int SplineEditor::nearest(glm::vec2 p, float within) const
+{
+    int best = -1;
+    float best_distance = within;
+    for (int k = 0; k < size(); k++)
+    {
+        float d = glm::length(control[k] - p);
+        if (d <= best_distance)
+        {
+            best = k;
+            best_distance = d;
+        }
+    }
+    return best;
+}
+
+// re-flatten the stale spans and re-rasterize the bins they covered before and cover now:
+// true and the changed bins [first, last] if anything in lowest[] may have changed
+inline bool SplineEditor::update(int& first, int& last)
+{
+    int n = size();
+    int count = n >= 2 ? n + 1 : 0;
+    if (rebuild || (int)spans.size() != count)
+    {
+        for (size_t j = 0; j < spans.size(); j++)
+        {
+            change(span_first[j], span_last[j]);
+        }
+        spans.assign(count, std::vector<glm::vec2>());
+        span_first.assign(count, bins);
+        span_last.assign(count, -1);
+        stale_first = 0;
+        stale_last = count - 1;
+        rebuild = false;
+    }
+    for (int j = std::max(0, stale_first); j <= std::min(stale_last, count - 1); j++)
+    {
+        //均匀B样条的一段换成bezier
+        glm::vec2 q0 = padded(j), q1 = padded(j + 1), q2 = padded(j + 2), q3 = padded(j + 3);
+        Bezier curve((q0 + 4.0f * q1 + q2) / 6.0f, (2.0f * q1 + q2) / 3.0f, (q1 + 2.0f * q2) / 3.0f, (q1 + 4.0f * q2 + q3) / 6.0f);
+        curve.flatten(spans[j]);
+        flattened++;
+        double lo = 1.0, hi = 0.0;
+        for (size_t i = 0; i < spans[j].size(); i++)
+        {
+            lo = std::min(lo, bezier_axial(spans[j][i]));
+            hi = std::max(hi, bezier_axial(spans[j][i]));
+        }
+        span_first[j] = std::max(0, (int)std::floor(lo * bins));
+        span_last[j] = std::min(bins - 1, std::max((int)std::floor(lo * bins), (int)std::ceil(hi * bins) - 1));
+        change(span_first[j], span_last[j]);
+    }
+    stale_first = 0;
+    stale_last = -1;
+    if (changed_first > changed_last)
+    {
+        return false;
+    }
+    first = changed_first;
+    last = changed_last;
+    changed_first = 0;
+    changed_last = -1;
+    //这些格子从头算：经过它们的每一段（没变的段写到范围外的格子也只是和原来一样的值再取一次min）
+    std::fill(lowest.begin() + first, lowest.begin() + last + 1, BEZIER_NONE);
+    for (int j = 0; j < count; j++)
+    {
+        if (span_first[j] <= last && span_last[j] >= first)
+        {
+            int a = bins, b = -1;
+            bezier_rasterize(&spans[j][0], spans[j].size(), bins, &lowest[0], a, b);
+        }
+    }
+    return true;
+}
+
+// the whole curve as one polyline (the joints once), to cut or plan to
+inline void SplineEditor::polyline(std::vector<glm::vec2>& out) const
+{
+    out.clear();
+    for (size_t j = 0; j < spans.size(); j++)
+    {
+        out.insert(out.end(), spans[j].begin() + (out.empty() ? 0 : 1), spans[j].end());
+    }
+}
+
+// spans flattened so far
+inline long long SplineEditor::evaluated() const
+{
+    return flattened;
+}
+
+inline glm::vec2 SplineEditor::padded(int i) const
+{
+    return control[std::max(0, std::min(size() - 1, i - 2))];
+}
+
+// spans first_span..last_span have to be flattened again; the bins they covered are re-rasterized
+inline void SplineEditor::touch(int first_span, int last_span)
+{
+    first_span = std::max(0, first_span);
+    last_span = std::min((int)spans.size() - 1, last_span);
+    for (int j = first_span; j <= last_span; j++)
+    {
+        change(span_first[j], span_last[j]);
+    }
+    if (first_span > last_span)
+    {
+        return;
+    }
+    if (stale_first > stale_last)
+    {
+        stale_first = first_span;
+        stale_last = last_span;
+        return;
+    }
+    stale_first = std::min(stale_first, first_span);
+    stale_last = std::max(stale_last, last_span);
+}
+
+inline void SplineEditor::change(int first, int last)
+{
+    first = std::max(0, first);
+    last = std::min(bins - 1, last);
+    if (first > last)
+    {
+        return;
+    }
+    if (changed_first > changed_last)
+    {
+        changed_first = first;
+        changed_last = last;
+        return;
+    }
+    changed_first = std::min(changed_first, first);
+    changed_last = std::max(changed_last, last);
+}
+
+#endif
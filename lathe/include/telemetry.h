@@ -0,0 +1,99 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+// 切削遥测：模拟线程每个tick算一条切掉的体积、材料去除率、主切削力和主轴切削功率，写进无锁环形缓冲，
+// 渲染线程（标题栏的主轴负载、日志文件）每帧取走；写满时丢掉新的那条并计数，切削循环从不等读的一方
+// 切掉的体积是Metrology（metrology.h）在这个tick前后的差，按dirty范围增量更新，不用整根重新求和
+// 功率 = 比切削能 × 去除率，力 = 功率 / 切削速度（主轴角速度 × 刀尖所在的半径）
+// 同样不依赖glad/GLFW
+#include <iostream>
+#include <algorithm>
+
+#include "ring_buffer.h"
+#include "cutter.h"
+#include "metrology.h"
+
+const size_t TELEMETRY_SAMPLES = 4096;//环形缓冲能存的tick数，1kHz下约4秒，渲染线程卡住这么久才会丢
+const double TELEMETRY_SPINDLE_SPEED = 2.0 * 3.14159265358979323846 * 1000.0 / 60.0;//没设主轴转速（无窗口）时按1000rpm算切削速度
+
+// one tick of cutting
+struct TelemetrySample
+{
+    long long tick = 0;
+    float removed = 0.0f;//这个tick切掉的体积（mm³）
+    float mrr = 0.0f;//材料去除率（mm³/s）
+    float force = 0.0f;//主切削力（N）
+    float power = 0.0f;//切削功率（W）
+};
+
+typedef RingBuffer<TelemetrySample, TELEMETRY_SAMPLES> TelemetryBuffer;
+
+// removed mm³ in one tick at cutting radius cut_radius (mm), spindle in rad/s
+inline TelemetrySample telemetry_sample(long long tick, double removed, double cut_radius, double spindle_speed, const MetrologyMaterial& material)
+{
+    TelemetrySample s;
+    s.tick = tick;
+    s.removed = (float)std::max(0.0, removed);
+    s.mrr = s.removed * MOTION_TICK_RATE;
+    s.power = (float)(material.specific_energy * s.mrr);
+    double speed = (spindle_speed > 0.0 ? spindle_speed : TELEMETRY_SPINDLE_SPEED) * cut_radius * 1e-3;//m/s
+    s.force = speed > 0.0 ? (float)(s.power / speed) : 0.0f;
+    return s;
+}
+
+// what the reader makes of the samples it took: totals and peaks since the last clear()
+struct TelemetryMeter
+{
+    long long ticks = 0;
+    double removed = 0.0;//mm³
+    double energy = 0.0;//J
+    float peak_power = 0.0f;
+    float peak_force = 0.0f;
+
+    void add(const TelemetrySample& s);
+    double mrr() const;
+    double mean_power() const;
+    void clear();
+};
+
+inline void TelemetryMeter::add(const TelemetrySample& s)
+{
+    ticks++;
+    removed += s.removed;
+    energy += (double)s.power / MOTION_TICK_RATE;
+    peak_power = std::max(peak_power, s.power);
+    peak_force = std::max(peak_force, s.force);
+}
+
+// mm³/s averaged over the ticks taken
+inline double TelemetryMeter::mrr() const
+{
+    return ticks > 0 ? removed * MOTION_TICK_RATE / ticks : 0.0;
+}
+
+// W averaged over the ticks taken
+inline double TelemetryMeter::mean_power() const
+{
+    return ticks > 0 ? energy * MOTION_TICK_RATE / ticks : 0.0;
+}
+
+inline void TelemetryMeter::clear()
+{
+    *this = TelemetryMeter();
+}
+
+// a CSV log: one line per tick that cut something
+inline void telemetry_write_header(std::ostream& out)
+{
+    out << "tick,removed_mm3,mrr_mm3_s,force_N,power_W\n";
+}
+
+inline void telemetry_write(std::ostream& out, const TelemetrySample& s)
+{
+    if (s.removed > 0.0f)
+    {
+        out << s.tick << ',' << s.removed << ',' << s.mrr << ',' << s.force << ',' << s.power << '\n';
+    }
+}
+
+#endif
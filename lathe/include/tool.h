@@ -0,0 +1,183 @@
+#ifndef TOOL_H
+#define TOOL_H
+
+// 刀具库：刀尖圆弧半径、主偏角（lead，+x一侧的刀刃）、副偏角（trail，-x一侧的刀刃）、刀片宽度
+// 角度是刀刃和工件轴线的夹角，90°是竖直的刀刃；宽度是两个刀尖圆弧之间平直刀刃的长度（切槽、切断刀）
+// 刀刃的下边缘预先算成一条折线（世界坐标，相对刀尖），切削时平移到刀尖位置，用Profile::cut_envelope()一次切进轮廓
+// 同样不依赖glad/GLFW
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include "workpiece.h"
+
+const float TOOL_HEIGHT = 0.6f;//刀刃的高度（世界坐标），比工件半径大，切断刀切到中心时刀刃也够得着外圆
+const float TOOL_ARC_TOLERANCE = 1e-4f;//刀尖圆弧用折线近似的最大误差（世界坐标）
+
+class Tool
+{
+public:
+    std::string name;
+    float nose_radius = 0.0f;//刀尖圆弧半径（世界坐标）
+    float lead_angle = 90.0f;//+x一侧刀刃和轴线的夹角（度）
+    float trail_angle = 90.0f;//-x一侧刀刃和轴线的夹角（度）
+    float width = 0.0f;//刀片宽度（世界坐标）
+    std::vector<glm::vec2> contour;//刀刃下边缘，(x, 高度)，相对刀尖，x不减；竖直的刀刃是x相同的两个点
+
+    Tool(const std::string& name, float nose_radius, float lead_angle, float trail_angle, float width);
+
+    bool is_point() const;
+    void envelope(double u, float distance, Profile::KnotList& out) const;
+    void swept_envelope(double u0, float d0, double u1, float d1, Profile::KnotList& out) const;
+
+private:
+    void build();
+};
+
+inline Tool::Tool(const std::string& tool_name, float nose, float lead, float trail, float insert_width)
+    : name(tool_name), nose_radius(nose), lead_angle(lead), trail_angle(trail), width(insert_width)
+{
+    build();
+}
+
+// an ideal point: it only cuts the path its tip sweeps (Cutter::motion_step())
+inline bool Tool::is_point() const
+{
+    return contour.size() < 2;
+}
+
+// contour from the top of the trail edge, around the trail nose arc, along the flat bottom,
+// around the lead nose arc and up the lead edge
+inline void Tool::build()
+{
+    contour.clear();
+    if (nose_radius <= 0.0f && width <= 0.0f && lead_angle >= 90.0f && trail_angle >= 90.0f)
+    {
+        contour.push_back(glm::vec2(0.0f));
+        return;
+    }
+    const float deg = PI / 180.0f;
+    //一侧：圆心(center, nose_radius)，从最低点转过angle到和刀刃相切，再沿刀刃升到TOOL_HEIGHT；side = +1/-1
+    auto side_points = [&](float center, float angle, float side, std::vector<glm::vec2>& out) {
+        float a = std::max(1.0f, std::min(90.0f, angle)) * deg;
+        int n = 0;
+        if (nose_radius > 0.0f)
+        {
+            float step = 2.0f * std::acos(std::max(0.0f, 1.0f - TOOL_ARC_TOLERANCE / nose_radius));
+            n = std::max(1, (int)std::ceil(a / std::max(step, 1e-3f)));
+        }
+        out.push_back(glm::vec2(center, 0.0f));
+        for (int i = 1; i <= n; i++)
+        {
+            float phi = a * i / n;
+            out.push_back(glm::vec2(center + side * nose_radius * std::sin(phi), nose_radius * (1.0f - std::cos(phi))));
+        }
+        glm::vec2 end = out.back();
+        float t = (TOOL_HEIGHT - end.y) / std::sin(a);
+        float c = angle >= 90.0f ? 0.0f : std::cos(a);//竖直的刀刃x严格不变
+        out.push_back(glm::vec2(end.x + side * t * c, TOOL_HEIGHT));
+    };
+    std::vector<glm::vec2> trail, lead;
+    side_points(-0.5f * width, trail_angle, -1.0f, trail);
+    side_points(0.5f * width, lead_angle, 1.0f, lead);
+    contour.assign(trail.rbegin(), trail.rend());
+    if (width <= 0.0f)
+    {
+        contour.pop_back();//刀尖只留一个点
+    }
+    contour.insert(contour.end(), lead.begin(), lead.end());
+}
+
+// the contour placed with its tip at profile position u and depth distance, in profile coordinates
+// (u along the bar 0~1, radius 1.0 = the original bar); points with the same x become one knot with a step
+inline void Tool::envelope(double u, float distance, Profile::KnotList& out) const
+{
+    out.clear();
+    if (is_point())
+    {
+        return;
+    }
+    for (size_t i = 0; i < contour.size(); i++)
+    {
+        double x = u + contour[i].x / (2.0 * length_k);
+        float r = distance + contour[i].y / radius_k;
+        if (!out.empty() && out.back().first >= x)
+        {
+            out.back().second.right = r;//竖直的刀刃
+            continue;
+        }
+        out.push_back(std::make_pair(x, ProfileKnot{ r, r }));
+    }
+}
+
+// everything the tool passes moving in a straight line from (u0, d0) to (u1, d1): the edge is convex,
+// so the lower side of the swept area is the lower convex hull of the contour at both ends
+// (exact for a move of any length, a G-code move is cut in one go instead of tick by tick)
+inline void Tool::swept_envelope(double u0, float d0, double u1, float d1, Profile::KnotList& out) const
+{
+    out.clear();
+    if (is_point())
+    {
+        return;
+    }
+    //两端的刀刃按x归并，x相同时低的在前
+    std::vector<glm::dvec2> points;
+    points.reserve(contour.size() * 2);
+    size_t a = 0, b = 0;
+    while (a < contour.size() || b < contour.size())
+    {
+        glm::dvec2 pa, pb;
+        if (a < contour.size())
+        {
+            pa = glm::dvec2(u0 + contour[a].x / (2.0 * length_k), (double)d0 + contour[a].y / radius_k);
+        }
+        if (b < contour.size())
+        {
+            pb = glm::dvec2(u1 + contour[b].x / (2.0 * length_k), (double)d1 + contour[b].y / radius_k);
+        }
+        bool take_a = b >= contour.size() || (a < contour.size() && (pa.x < pb.x || (pa.x == pb.x && pa.y <= pb.y)));
+        glm::dvec2 p = take_a ? pa : pb;
+        take_a ? a++ : b++;
+        //下凸包（Andrew单调链）
+        while (points.size() >= 2)
+        {
+            glm::dvec2 o = points[points.size() - 2];
+            glm::dvec2 q = points.back();
+            if ((q.x - o.x) * (p.y - o.y) - (q.y - o.y) * (p.x - o.x) > 0.0)
+            {
+                break;
+            }
+            points.pop_back();
+        }
+        points.push_back(p);
+    }
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        float r = (float)points[i].y;
+        if (!out.empty() && out.back().first >= points[i].x)
+        {
+            out.back().second.right = r;
+            continue;
+        }
+        out.push_back(std::make_pair(points[i].x, ProfileKnot{ r, r }));
+    }
+}
+
+// the tool library, index 0 is the ideal point the lathe always used
+inline const std::vector<Tool>& tool_library()
+{
+    static const std::vector<Tool> tools = {
+        Tool("point", 0.0f, 90.0f, 90.0f, 0.0f),
+        Tool("turning", 0.02f, 75.0f, 30.0f, 0.0f),
+        Tool("finishing", 0.05f, 60.0f, 15.0f, 0.0f),
+        Tool("grooving", 0.005f, 90.0f, 90.0f, 0.1f),
+        Tool("parting", 0.002f, 90.0f, 90.0f, 0.04f),
+        Tool("form", 0.25f, 90.0f, 90.0f, 0.5f),
+    };
+    return tools;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// 无锁三缓冲：一个线程写、一个线程读，双方都不会等对方
+// 写线程在back上写完后publish()，和中间的缓冲交换；读线程acquire()时如果中间的缓冲有新数据就和front交换
+// 读到的总是最新一次publish的完整数据，中间来不及读的会被跳过
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    T& write_buffer();
+    void publish();
+    bool acquire();
+    const T& read_buffer() const;
+
+private:
+    static const int FRESH = 4;//中间的缓冲有还没被读走的数据
+    T buffers[3];
+    std::atomic<int> middle{ 1 };//中间缓冲的下标 | FRESH
+    int back = 0;//只有写线程访问
+    int front = 2;//只有读线程访问
+};
+
+// the buffer the producer fills next, it is not visible to the consumer until publish()
+template <typename T>
+inline T& TripleBuffer<T>::write_buffer()
+{
+    return buffers[back];
+}
+
+template <typename T>
+inline void TripleBuffer<T>::publish()
+{
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+}
+
+// take the newest published buffer, false (and read_buffer() unchanged) if nothing was published since the last acquire()
+template <typename T>
+inline bool TripleBuffer<T>::acquire()
+{
+    if (!(middle.load(std::memory_order_relaxed) & FRESH))
+    {
+        return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+    return true;
+}
+
+template <typename T>
+inline const T& TripleBuffer<T>::read_buffer() const
+{
+    return buffers[front];
+}
+
+#endif
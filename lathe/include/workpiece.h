@@ -0,0 +1,818 @@
+#ifndef WORKPIECE_H
+#define WORKPIECE_H
+
+// 工件模型：半径集合 + 圆柱点阵数据集
+// 不依赖glad/GLFW，可以在没有窗口的情况下使用（见lathe_headless.cpp）
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cfloat>
+#include <algorithm>
+
+// cylinder data config
+//默认点阵精细度，运行时可以换（Workpiece::set_resolution、Cutter::r_segments）
+const int Y_SEGMENTS = 400;
+const int X_SEGMENTS = 50;
+const int R_SEGMENTS = 100;
+const int MIN_Y_SEGMENTS = 8;
+const int MAX_Y_SEGMENTS = 8192;
+const int MIN_X_SEGMENTS = 3;
+const int MAX_X_SEGMENTS = 512;
+//空间参数设置
+const float PI = 3.14159265358979323846f;
+const float radius_k = 0.5f;//半径系数，用于调节整个圆柱的半径
+const float length_k = 2.0f;//半径系数，用于调节整个圆柱的长度
+//毛坯的实际尺寸（mm）：半径1.0是直径STOCK_DIAMETER，整根长STOCK_LENGTH，G代码、测量都按这个换算
+const double STOCK_DIAMETER = 50.0;
+const double STOCK_LENGTH = 200.0;
+//每个点解压后的数据：pos(3) normal(3) polished_bit(1)，print_vertics()输出的就是这个格式
+const int VERTEX_FLOATS = 7;
+
+//压缩后的点，12字节（原来7个float是28字节）
+//pos：相对工件包围盒(radius_k, length_k, radius_k)的16位归一化坐标
+//normal：八面体编码的法向量，2个16位归一化分量
+//state：表面状态位，见STATE_POLISHED
+//deviation：这个ring所在segment和目标轮廓的比较（deviation.h的DEVIATION_*），cylinder.fs按它上色
+struct PackedVertex
+{
+    int16_t pos[3];
+    uint8_t state;
+    uint8_t deviation;
+    int16_t normal[2];
+};
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must stay 12 bytes, the attribute offsets in cylinder_buffer_init() depend on it");
+const uint8_t STATE_POLISHED = 1;//被切削过（更光滑）
+
+#include "ring_generator.h"
+#include "profile.h"
+#include "radius_field.h"
+
+int16_t pack_snorm16(float v);
+float unpack_snorm16(int16_t v);
+glm::vec2 oct_encode(glm::vec3 n);
+glm::vec3 oct_decode(glm::vec2 e);
+
+class Workpiece
+{
+public:
+    int y_segments = 0;//轴向分段数，radius有y_segments+1个元素
+    int x_segments = 0;//每个ring的分段数
+    Profile profile;//工件轮廓，切削直接作用在这上面，精度不受分段数限制
+    std::vector<float> radius;//半径数组，每个segment取profile在这一段里的平均半径，点阵和半径纹理都从这里生成
+    std::vector<float> preview;//样条编辑器的预览（spline.h），空的时候没有：绘制的是radius和它的较小值，切削不受影响
+    std::vector<uint8_t> deviation;//每个segment的偏差分类（deviation.h），由模拟线程发布过来，和radius一样长，0是没有目标
+    std::vector<PackedVertex> all_data;//圆柱点阵，(y_segments+1)个ring，每个ring (x_segments+1)个点，点之间共享
+    std::vector<unsigned int> indices;//圆柱点绘制index集，只连接lod_rings里的ring
+    //被修改过、还没重建点阵的ring范围 [dirty_first, dirty_last]，dirty_first > dirty_last表示没有
+    int dirty_first = MAX_Y_SEGMENTS + 1;
+    int dirty_last = -1;
+    //重建过、还没上传到显存的ring范围 [upload_first, upload_last]
+    int upload_first = MAX_Y_SEGMENTS + 1;
+    int upload_last = -1;
+    //半径改过、还没上传的segment范围 [profile_first, profile_last]，给只上传半径集合的渲染方式用
+    int profile_first = MAX_Y_SEGMENTS + 1;
+    int profile_last = -1;
+    //改过、还没重新测量的segment范围 [measure_first, measure_last]，见metrology.h
+    int measure_first = MAX_Y_SEGMENTS + 1;
+    int measure_last = -1;
+    //改过、还没重新和目标比较的segment范围 [deviation_first, deviation_last]，见deviation.h
+    int deviation_first = MAX_Y_SEGMENTS + 1;
+    int deviation_last = -1;
+    //上次History快照（或者撤销）之后改过的轴向范围（0~1），changed_u0 > changed_u1表示没有
+    double changed_u0 = 2.0;
+    double changed_u1 = -1.0;
+    //false时不在CPU上生成点阵，all_data释放掉
+    bool mesh_enabled = true;
+    RingGenerator ring_generator;//cos/sin表，按x_segments算一次
+
+    //轴向LOD：只画一部分ring，刀具附近和半径变化剧烈的地方全分辨率，平直的地方跳过中间的ring
+    //每个ring都是x_segments+1个点，相邻两段共享整个ring，所以不会有T型接缝（裂缝）
+    //切削和半径集合始终是全分辨率的，LOD只影响绘制
+    bool lod_enabled = false;
+    float lod_tolerance = 0.002f;//跳过的ring到两端ring连线的最大半径误差（1.0是原始半径）
+    int lod_max_step = 16;//最多合并多少个segment
+    int lod_window = 16;//刀具所在的块和左右各一块，块大小lod_window个ring，全分辨率
+    std::vector<int> lod_rings;//当前绘制用到的ring，递增，首尾是0和y_segments
+    bool indices_dirty = true;//indices变了、还没上传
+
+    //二维半径场模式：每个角度单独一个半径，切削按主轴转过的角度积分（见cut_field()）
+    //这个模式下点阵的列和半径场的列一一对应（x_segments == field.theta_segments），不做LOD
+    bool field_enabled = false;
+    RadiusField field;
+
+    Workpiece(int y_segments = Y_SEGMENTS, int x_segments = X_SEGMENTS);
+
+    void set_resolution(int y_segments, int x_segments);
+    void reset();
+    float cut(int seg, float distance);
+    float cut_span(double u0, double u1, float distance);
+    float cut_span(double u0, double u1, float d0, float d1);
+    float cut_field(double u0, double u1, double theta0, double theta1, float distance);
+    float cut_field(double u0, double u1, double theta0, double theta1, float d0, float d1);
+    float cut_envelope(const Profile::KnotList& envelope);
+    float cut_field_envelope(const Profile::KnotList& envelope, double theta0, double theta1);
+    void set_field_enabled(bool enabled, int theta_segments = FIELD_THETA_SEGMENTS);
+    void mark_dirty(int first, int last);
+    bool is_dirty() const;
+    void update_mesh();
+    void update_lod(int focus);
+    void set_lod_enabled(bool enabled);
+    int index_count() const;
+    bool pending_upload(size_t& offset, size_t& size) const;
+    void clear_upload();
+    bool pending_profile(int& first, int& count) const;
+    void clear_profile();
+    bool pending_measure(int& first, int& count) const;
+    void clear_measure();
+    bool pending_deviation(int& first, int& count) const;
+    void clear_deviation();
+    void set_mesh_enabled(bool enabled);
+    void vertex_data(int i, float* out) const;
+    void ring_params(int y, float& r, float& k, float& ny, uint8_t& state) const;
+    float shown_radius(int y) const;
+    void set_preview(const std::vector<float>& lowest, int first, int last);
+    void clear_preview();
+
+private:
+    int lod_focus = 0;
+    int lod_block = -1;//上次选ring时刀具所在的块
+    bool lod_stale = true;//半径或设置变了，要重新选ring
+    int axial_x_segments = X_SEGMENTS;//进入二维模式前的x_segments，退出时恢复
+    std::vector<float> row_depth;//二维切削里每个segment的切削深度（刀具包络或斜线在这一段里的最低点）
+    void envelope_rows(const Profile::KnotList& envelope, int& first, int& last);
+    void line_rows(double u0, double u1, float d0, float d1, int& first, int& last);
+    void update_ring(int y);
+    void update_field_ring(int y);
+    void resample(int first, int last);
+    void select_lod_rings(std::vector<int>& rings) const;
+    void build_indices();
+};
+
+inline Workpiece::Workpiece(int y_segments, int x_segments)
+{
+    set_resolution(y_segments, x_segments);
+    reset();
+}
+
+// change the grid resolution, the segments are resampled from the profile
+// (and in 2D mode the radius field is resampled by nearest cell, its columns follow new_x)
+inline void Workpiece::set_resolution(int new_y, int new_x)
+{
+    int old_y = y_segments;
+    y_segments = std::max(MIN_Y_SEGMENTS, std::min(MAX_Y_SEGMENTS, new_y));
+    x_segments = std::max(MIN_X_SEGMENTS, std::min(MAX_X_SEGMENTS, new_x));
+    radius.assign(y_segments + 1, 0.0f);
+    deviation.assign(y_segments + 1, 0);
+    preview.clear();
+    resample(0, y_segments - 1);
+    if (field_enabled && (field.y_segments != y_segments || field.theta_segments != x_segments))
+    {
+        RadiusField old = field;
+        field.init(y_segments, x_segments, &radius[0]);
+        for (int y = 0; y < y_segments; y++)
+        {
+            for (int t = 0; t < x_segments; t++)
+            {
+                field.set(y, t, old.at((int)((long long)y * old_y / y_segments), (int)((long long)t * old.theta_segments / x_segments)));
+            }
+        }
+    }
+    ring_generator.init(x_segments);
+    lod_rings.clear();
+    lod_focus = std::min(lod_focus, y_segments);
+    build_indices();
+    clear_upload();
+    clear_profile();
+    mark_dirty(0, y_segments);
+    set_mesh_enabled(mesh_enabled);
+}
+
+//init radius vector
+inline void Workpiece::reset()
+{
+    profile.reset(1.0f);
+    resample(0, y_segments - 1);
+    if (field_enabled)
+    {
+        field.init(y_segments, x_segments, &radius[0]);
+    }
+    mark_dirty(0, y_segments);
+}
+
+// cut segment seg down to distance, returns the removed radius (0 if the knife does not touch)
+inline float Workpiece::cut(int seg, float distance)
+{
+    if (seg < 0 || seg >= y_segments)
+    {
+        return 0.0f;
+    }
+    return cut_span((double)seg / y_segments, (double)(seg + 1) / y_segments, distance);
+}
+
+// cut the axial span [u0, u1] (0~1 along the bar, any precision) down to distance
+// (in 2D mode the radius field is cut over the whole revolution as well)
+inline float Workpiece::cut_span(double u0, double u1, float distance)
+{
+    return cut_span(u0, u1, distance, distance);
+}
+
+// cut [u0, u1] down to the line from d0 to d1 (the knife moving in and along at once);
+// the 2D field is cut over the whole revolution, each row to the lowest point of the line inside it
+inline float Workpiece::cut_span(double u0, double u1, float d0, float d1)
+{
+    float mount = profile.cut(u0, u1, d0, d1);
+    int first, last;
+    line_rows(u0, u1, d0, d1, first, last);
+    if (field_enabled)
+    {
+        mount = std::max(mount, field.cut_rows(first, last, &row_depth[0], 0.0, 2.0 * PI));
+    }
+    if (mount <= 0.0f)
+    {
+        return 0.0f;
+    }
+    resample(first, last);
+    mark_dirty(first, last);
+    return mount;
+}
+
+// 2D mode: cut the segments under [u0, u1] down to distance, but only for the spindle angles theta0~theta1 (radians)
+// that passed under the knife; the 1D profile is left alone until the field is switched off
+inline float Workpiece::cut_field(double u0, double u1, double theta0, double theta1, float distance)
+{
+    return cut_field(u0, u1, theta0, theta1, distance, distance);
+}
+
+// 2D mode: the line from d0 at u0 to d1 at u1 (u0 <= u1) for the spindle angles theta0~theta1
+inline float Workpiece::cut_field(double u0, double u1, double theta0, double theta1, float d0, float d1)
+{
+    if (!field_enabled)
+    {
+        return 0.0f;
+    }
+    int first, last;
+    line_rows(u0, u1, d0, d1, first, last);
+    float mount = field.cut_rows(first, last, &row_depth[0], theta0, theta1);
+    if (mount > 0.0f)
+    {
+        mark_dirty(first, last);
+    }
+    return mount;
+}
+
+// cut down to a tool envelope (absolute profile coordinates, see Tool::envelope()); in 2D mode the rows under it are
+// cut over the whole revolution, each to the deepest point of the envelope inside the row
+inline float Workpiece::cut_envelope(const Profile::KnotList& envelope)
+{
+    if (envelope.size() < 2 || envelope.back().first <= 0.0 || envelope.front().first >= 1.0)
+    {
+        return 0.0f;
+    }
+    float mount = profile.cut_envelope(envelope);
+    int first, last;
+    envelope_rows(envelope, first, last);
+    if (field_enabled)
+    {
+        mount = std::max(mount, field.cut_rows(first, last, &row_depth[0], 0.0, 2.0 * PI));
+    }
+    if (mount <= 0.0f)
+    {
+        return 0.0f;
+    }
+    resample(first, last);
+    mark_dirty(first, last);
+    return mount;
+}
+
+// 2D mode: the tool envelope only for the spindle angles theta0~theta1
+inline float Workpiece::cut_field_envelope(const Profile::KnotList& envelope, double theta0, double theta1)
+{
+    if (!field_enabled || envelope.size() < 2 || envelope.back().first <= 0.0 || envelope.front().first >= 1.0)
+    {
+        return 0.0f;
+    }
+    int first, last;
+    envelope_rows(envelope, first, last);
+    float mount = field.cut_rows(first, last, &row_depth[0], theta0, theta1);
+    if (mount > 0.0f)
+    {
+        mark_dirty(first, last);
+    }
+    return mount;
+}
+
+// segments under the envelope, and the lowest envelope value inside each of them in row_depth
+inline void Workpiece::envelope_rows(const Profile::KnotList& envelope, int& first, int& last)
+{
+    double u0 = std::max(0.0, envelope.front().first);
+    double u1 = std::min(1.0, envelope.back().first);
+    first = std::max(0, std::min(y_segments - 1, (int)std::floor(u0 * y_segments)));
+    last = std::max(first, std::min(y_segments - 1, (int)std::ceil(u1 * y_segments) - 1));
+    row_depth.resize(last - first + 1);
+    envelope_min_rows(envelope, first, last - first + 1, y_segments, &row_depth[0]);
+}
+
+// segments under [u0, u1], and the lowest point of the line from d0 to d1 inside each of them in row_depth
+// (a line is lowest at one of its ends, so only the row's ends clipped to [u0, u1] are looked at)
+inline void Workpiece::line_rows(double u0, double u1, float d0, float d1, int& first, int& last)
+{
+    first = std::max(0, std::min(y_segments - 1, (int)std::floor(u0 * y_segments)));
+    last = std::max(first, std::min(y_segments - 1, (int)std::ceil(u1 * y_segments) - 1));
+    row_depth.resize(last - first + 1);
+    for (int y = first; y <= last; y++)
+    {
+        if (u1 <= u0)
+        {
+            row_depth[y - first] = std::min(d0, d1);
+            continue;
+        }
+        double a = std::max(u0, (double)y / y_segments);
+        double b = std::max(a, std::min(u1, (double)(y + 1) / y_segments));
+        float da = (float)(d0 + (d1 - d0) * (a - u0) / (u1 - u0));
+        float db = (float)(d0 + (d1 - d0) * (b - u0) / (u1 - u0));
+        row_depth[y - first] = std::min(da, db);
+    }
+}
+
+// switching on copies the current profile into every angle; switching off keeps, for each segment,
+// the largest radius left at any angle in the 1D profile (the envelope of what was cut)
+inline void Workpiece::set_field_enabled(bool enabled, int theta_segments)
+{
+    if (enabled == field_enabled)
+    {
+        return;
+    }
+    if (enabled)
+    {
+        axial_x_segments = x_segments;
+        field_enabled = true;
+        theta_segments = std::max(MIN_X_SEGMENTS, std::min(MAX_X_SEGMENTS, theta_segments));
+        field.init(y_segments, theta_segments, &radius[0]);
+        set_resolution(y_segments, theta_segments);
+        return;
+    }
+    for (int y = 0; y < y_segments; y++)
+    {
+        //整圈都切过的segment才会比原来的半径小，没切过的保留profile里的细节
+        float envelope = field.row_max(y);
+        if (envelope < radius[y])
+        {
+            profile.cut((double)y / y_segments, (double)(y + 1) / y_segments, envelope);
+        }
+    }
+    field_enabled = false;
+    field = RadiusField();
+    set_resolution(y_segments, axial_x_segments);
+}
+
+// radius[first..last] = average profile radius of each segment
+// (not the minimum: a knife position a few ulp past a segment boundary would otherwise show up as a whole cut segment)
+inline void Workpiece::resample(int first, int last)
+{
+    profile.mean_radii(first, last - first + 1, y_segments, &radius[first]);
+}
+
+inline void Workpiece::mark_dirty(int first, int last)
+{
+    profile_first = std::min(profile_first, first);
+    profile_last = std::max(profile_last, last);
+    measure_first = std::min(measure_first, first);
+    measure_last = std::max(measure_last, last);
+    deviation_first = std::min(deviation_first, first);
+    deviation_last = std::max(deviation_last, last);
+    changed_u0 = std::min(changed_u0, (double)first / y_segments);
+    changed_u1 = std::max(changed_u1, (double)(last + 1) / y_segments);
+    lod_stale = true;
+    if (!is_dirty())
+    {
+        dirty_first = first;
+        dirty_last = last;
+        return;
+    }
+    dirty_first = std::min(dirty_first, first);
+    dirty_last = std::max(dirty_last, last);
+}
+
+inline bool Workpiece::is_dirty() const
+{
+    return dirty_first <= dirty_last;
+}
+
+//caculate the vertex and anormal vec of target cylinder
+//只重建dirty的ring：ring y的半径变了会影响ring y的坐标，以及ring y-1、y+1的法向量，其他点原样保留
+inline void Workpiece::update_mesh()
+{
+    if (!is_dirty())
+    {
+        return;
+    }
+    //半径变了，LOD选的ring可能跟着变
+    if (lod_enabled)
+    {
+        update_lod(lod_focus);
+    }
+    if (!mesh_enabled)
+    {
+        return;
+    }
+    int first = std::max(dirty_first - 1, 0);
+    int last = std::min(dirty_last + 1, y_segments);
+    for (int y = first; y <= last; y++)
+    {
+        update_ring(y);
+    }
+    upload_first = std::min(upload_first, first);
+    upload_last = std::max(upload_last, last);
+    dirty_first = MAX_Y_SEGMENTS + 1;
+    dirty_last = -1;
+}
+
+// pos, normal and surface state of the x_segments+1 points of ring y
+inline void Workpiece::update_ring(int y)
+{
+    if (field_enabled && y > 0 && y < y_segments)
+    {
+        update_field_ring(y);
+        return;
+    }
+    float r, k, ny;
+    uint8_t state;
+    ring_params(y, r, k, ny, state);
+    float ySegment = (float)y / (float)y_segments;
+    PackedVertex* out = &all_data[y * (x_segments + 1)];
+    ring_generator.generate(r, pack_snorm16(2.0f * ySegment - 1.0f), k, ny, state, out);
+    //偏差分类不在RingGenerator里（它每个ring只有一个状态字节），有目标的时候再补上
+    uint8_t compared = deviation[std::min(y, y_segments - 1)];
+    if (compared)
+    {
+        for (int x = 0; x <= x_segments; x++)
+        {
+            out[x].deviation = compared;
+        }
+    }
+}
+
+// 2D mode: every column has its own radius, the normal also depends on dr/dtheta
+// (cross product of the axial and the angular tangent, scalar, the SIMD ring generator assumes one radius per ring)
+inline void Workpiece::update_field_ring(int y)
+{
+    int below = std::max(y - 1, 1);
+    int above = std::min(y + 1, y_segments - 1);
+    float dY = length_k * 2.0f * (above - below) / y_segments;
+    float dtheta = 2.0f * PI / field.theta_segments;
+    int16_t pos_y = pack_snorm16(2.0f * y / y_segments - 1.0f);
+    PackedVertex* out = &all_data[y * (x_segments + 1)];
+    for (int x = 0; x <= x_segments; x++)
+    {
+        float c = ring_generator.cos_table[x];
+        float s = ring_generator.sin_table[x];
+        float r = field.at(y, x);
+        float dr_dtheta = (field.at(y, x + 1) - field.at(y, x - 1)) / (2.0f * dtheta);
+        float dR = radius_k * (field.at(above, x) - field.at(below, x));
+        //轴向切线 (dR*c, dY, dR*s)，角向切线 radius_k * (dr*c - r*s, 0, dr*s + r*c)
+        float bx = radius_k * (dr_dtheta * c - r * s);
+        float bz = radius_k * (dr_dtheta * s + r * c);
+        glm::vec3 normal(dY * bz, dR * s * bx - dR * c * bz, -dY * bx);
+        if (glm::dot(normal, normal) < 1e-12f)
+        {
+            normal = glm::vec3(c * dY, -dR, s * dY);
+        }
+        glm::vec2 oct = oct_encode(normal);
+        out[x].pos[0] = pack_snorm16(r * c);
+        out[x].pos[1] = pos_y;
+        out[x].pos[2] = pack_snorm16(r * s);
+        out[x].state = r < 1.0f ? STATE_POLISHED : 0;
+        out[x].deviation = deviation[y];
+        out[x].normal[0] = pack_snorm16(oct.x);
+        out[x].normal[1] = pack_snorm16(oct.y);
+    }
+}
+
+// RingGenerator inputs of ring y: radius r, normal (cos*k, ny, sin*k), surface state
+inline void Workpiece::ring_params(int y, float& r, float& k, float& ny, uint8_t& state) const
+{
+    //半径越小说明切的越多，要改光照效果
+    state = shown_radius(std::min(y, y_segments - 1)) < 1.0f ? STATE_POLISHED : 0;
+    //两端的ring收缩到轴上，法向量朝外
+    if (y == 0 || y == y_segments)
+    {
+        r = 0.0f;
+        k = 0.0f;
+        ny = y == 0 ? -1.0f : 1.0f;
+        return;
+    }
+    //法向量由相邻两个ring的半径差决定（旋转面）
+    int below = std::max(y - 1, 1);
+    int above = std::min(y + 1, y_segments - 1);
+    float dR = radius_k * (shown_radius(above) - shown_radius(below));
+    float dY = length_k * 2.0f * (above - below) / y_segments;
+    float len = std::sqrt(dR * dR + dY * dY);
+    r = shown_radius(y);
+    k = dY / len;
+    ny = -dR / len;
+}
+
+// the radius segment y is drawn with: the spline preview where it is below the part
+inline float Workpiece::shown_radius(int y) const
+{
+    return preview.empty() ? radius[y] : std::min(radius[y], preview[y]);
+}
+
+// show the part as it would be cut down to lowest[] (one value per segment, FLT_MAX where nothing is cut) over
+// segments first..last; only those rings are rebuilt, the cutting state is not touched
+inline void Workpiece::set_preview(const std::vector<float>& lowest, int first, int last)
+{
+    if (preview.empty())
+    {
+        preview.assign(y_segments + 1, FLT_MAX);
+    }
+    first = std::max(0, first);
+    last = std::min(std::min(y_segments, (int)lowest.size()) - 1, last);
+    if (first > last)
+    {
+        return;
+    }
+    for (int y = first; y <= last; y++)
+    {
+        preview[y] = std::max(0.0f, lowest[y]);
+    }
+    mark_dirty(first, last);
+}
+
+// back to drawing the part itself, rebuilding only the rings the preview changed
+inline void Workpiece::clear_preview()
+{
+    int first = y_segments, last = -1;
+    for (int y = 0; y < (int)preview.size(); y++)
+    {
+        if (preview[y] < radius[y])
+        {
+            first = std::min(first, y);
+            last = y;
+        }
+    }
+    preview.clear();
+    if (first <= last)
+    {
+        mark_dirty(first, last);
+    }
+}
+
+// pick the drawn rings around segment `focus` (the knife), rebuilds indices only if the selection changed
+// cheap enough to call every frame: nothing happens while the knife stays in the same block and no radius changed
+inline void Workpiece::update_lod(int focus)
+{
+    lod_focus = std::max(0, std::min(focus, y_segments));
+    int block = lod_focus / lod_window;
+    if (!lod_stale && block == lod_block)
+    {
+        return;
+    }
+    lod_block = block;
+    lod_stale = false;
+    std::vector<int> rings;
+    select_lod_rings(rings);
+    if (rings != lod_rings)
+    {
+        lod_rings.swap(rings);
+        build_indices();
+    }
+}
+
+inline void Workpiece::set_lod_enabled(bool enabled)
+{
+    lod_enabled = enabled;
+    lod_stale = true;
+    update_lod(lod_focus);
+}
+
+// greedy decimation: from each kept ring go as far as possible while every skipped ring stays
+// within lod_tolerance of the straight line between the two kept rings
+inline void Workpiece::select_lod_rings(std::vector<int>& rings) const
+{
+    rings.clear();
+    if (!lod_enabled || field_enabled)
+    {
+        for (int y = 0; y <= y_segments; y++)
+        {
+            rings.push_back(y);
+        }
+        return;
+    }
+    //刀具所在块的前后各一块全分辨率；按块取整，刀具在块内移动时选择不变
+    int block = lod_focus / lod_window;
+    int fine_first = (block - 1) * lod_window;
+    int fine_last = (block + 2) * lod_window;
+    int a = 0;
+    rings.push_back(0);
+    while (a < y_segments)
+    {
+        int b = a + 1;
+        //端面的ring 0-1、y_segments-1 - y_segments不合并
+        if (a >= 1)
+        {
+            int limit = std::min(a + lod_max_step, y_segments - 1);
+            for (int next = a + 2; next <= limit; next++)
+            {
+                //next-1是这一步新跳过的ring
+                if (next - 1 >= fine_first && next - 1 <= fine_last)
+                {
+                    break;
+                }
+                bool ok = true;
+                for (int m = a + 1; m < next && ok; m++)
+                {
+                    float t = (float)(m - a) / (float)(next - a);
+                    float line = shown_radius(a) + (shown_radius(next) - shown_radius(a)) * t;
+                    ok = std::fabs(shown_radius(m) - line) <= lod_tolerance;
+                }
+                if (!ok)
+                {
+                    break;
+                }
+                b = next;
+            }
+        }
+        rings.push_back(b);
+        a = b;
+    }
+}
+
+//一个面两个三角形，六个点（四个不同点）；LOD时相邻两个被选中的ring之间连一段
+//两个三角形的最后一个点都在ring i上：flat的deviation取最后一个点（provoking vertex）的值，这样这一段用的是自己的分类
+inline void Workpiece::build_indices()
+{
+    if (lod_rings.empty())
+    {
+        for (int y = 0; y <= y_segments; y++)
+        {
+            lod_rings.push_back(y);
+        }
+    }
+    const unsigned int row = x_segments + 1;
+    indices.clear();
+    indices.reserve((lod_rings.size() - 1) * x_segments * 6);
+    for (size_t n = 0; n + 1 < lod_rings.size(); n++)
+    {
+        unsigned int i = lod_rings[n];
+        unsigned int i1 = lod_rings[n + 1];
+        for (unsigned int j = 0; j < (unsigned int)x_segments; j++)
+        {
+            indices.push_back(i1 * row + j);
+            indices.push_back(i1 * row + j + 1);
+            indices.push_back(i * row + j);
+            indices.push_back(i * row + j);
+            indices.push_back(i1 * row + j + 1);
+            indices.push_back(i * row + j + 1);
+        }
+    }
+    indices_dirty = true;
+}
+
+inline int Workpiece::index_count() const
+{
+    return (int)indices.size();
+}
+
+// byte range of all_data rewritten since the last clear_upload(), false if nothing changed
+inline bool Workpiece::pending_upload(size_t& offset, size_t& size) const
+{
+    if (upload_first > upload_last)
+    {
+        return false;
+    }
+    const size_t ring_bytes = (x_segments + 1) * sizeof(PackedVertex);
+    offset = upload_first * ring_bytes;
+    size = (upload_last - upload_first + 1) * ring_bytes;
+    return true;
+}
+
+inline void Workpiece::clear_upload()
+{
+    upload_first = MAX_Y_SEGMENTS + 1;
+    upload_last = -1;
+}
+
+// segments of radius changed since the last clear_profile(), false if nothing changed
+inline bool Workpiece::pending_profile(int& first, int& count) const
+{
+    if (profile_first > profile_last)
+    {
+        return false;
+    }
+    first = std::max(profile_first, 0);
+    count = std::min(profile_last, y_segments) - first + 1;
+    return true;
+}
+
+inline void Workpiece::clear_profile()
+{
+    profile_first = MAX_Y_SEGMENTS + 1;
+    profile_last = -1;
+}
+
+// segments changed since the last clear_measure(), false if nothing changed
+inline bool Workpiece::pending_measure(int& first, int& count) const
+{
+    if (measure_first > measure_last)
+    {
+        return false;
+    }
+    first = std::max(measure_first, 0);
+    count = std::min(measure_last, y_segments - 1) - first + 1;
+    return count > 0;
+}
+
+inline void Workpiece::clear_measure()
+{
+    measure_first = MAX_Y_SEGMENTS + 1;
+    measure_last = -1;
+}
+
+// segments changed since the last clear_deviation(), the same range as pending_measure() for a second consumer
+inline bool Workpiece::pending_deviation(int& first, int& count) const
+{
+    if (deviation_first > deviation_last)
+    {
+        return false;
+    }
+    first = std::max(deviation_first, 0);
+    count = std::min(deviation_last, y_segments - 1) - first + 1;
+    return count > 0;
+}
+
+inline void Workpiece::clear_deviation()
+{
+    deviation_first = MAX_Y_SEGMENTS + 1;
+    deviation_last = -1;
+}
+
+// switching the CPU mesh off frees it; switching it back on rebuilds everything on the next update_mesh()
+inline void Workpiece::set_mesh_enabled(bool enabled)
+{
+    mesh_enabled = enabled;
+    if (!enabled)
+    {
+        std::vector<PackedVertex>().swap(all_data);
+        clear_upload();
+        return;
+    }
+    all_data.assign((y_segments + 1) * (x_segments + 1), PackedVertex());
+    dirty_first = 0;
+    dirty_last = y_segments;
+}
+
+// decode point i back to pos(3) normal(3) polished_bit(1)
+inline void Workpiece::vertex_data(int i, float* out) const
+{
+    const PackedVertex& v = all_data[i];
+    glm::vec3 normal = oct_decode(glm::vec2(unpack_snorm16(v.normal[0]), unpack_snorm16(v.normal[1])));
+    out[0] = unpack_snorm16(v.pos[0]) * radius_k;
+    out[1] = unpack_snorm16(v.pos[1]) * length_k;
+    out[2] = unpack_snorm16(v.pos[2]) * radius_k;
+    out[3] = normal.x;
+    out[4] = normal.y;
+    out[5] = normal.z;
+    out[6] = (v.state & STATE_POLISHED) ? 1.0f : 0.5f;
+}
+
+// [-1,1] float <-> 16 bit normalized integer
+inline int16_t pack_snorm16(float v)
+{
+    v = std::max(-1.0f, std::min(1.0f, v));
+    return (int16_t)std::lround(v * 32767.0f);
+}
+
+inline float unpack_snorm16(int16_t v)
+{
+    return std::max(-1.0f, v / 32767.0f);
+}
+
+// octahedral normal encoding: project onto the octahedron |x|+|y|+|z|=1, fold the lower half over
+inline glm::vec2 oct_encode(glm::vec3 n)
+{
+    n /= std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        e.x = (1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        e.y = (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return e;
+}
+
+inline glm::vec3 oct_decode(glm::vec2 e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    if (n.z < 0.0f)
+    {
+        n.x = (1.0f - std::fabs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+        n.y = (1.0f - std::fabs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return glm::normalize(n);
+}
+
+#endif
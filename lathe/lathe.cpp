@@ -14,6 +14,12 @@
 #include "include/camera.h"
 #include "include/skybox.h"
 #include "include/particlesystem2.h"
+#include "include/workpiece.h"
+#include "include/cutter.h"
+#include "include/simulation.h"
+#include "include/metrology.h"
+#include "include/deviation.h"
+#include "include/spline.h"
 /*
 Proj:A Lathe Simulator by openGL
 Author: Macbeth Yueyi Shaw
@@ -34,11 +40,31 @@ void print_vertics();
 void skybox_draw(Shader skyboxShader, unsigned int skyboxVAO, unsigned int cubemapTexture);
 void model_draw(Shader shader, Model mymodel, glm::vec3 position = glm::vec3(0.0f), glm::vec3 scale = glm::vec3(1.0f), glm::vec3 rotate_axe = glm::vec3(0.0f, 1.0f, 0.0f), float radians = 0.0f);
 //model caculate func
-void cylinder_radius_vector_init();
-void cylinder_data_update(float mount);
-void cylinder_buffer_update(unsigned int cylinderVAO, unsigned int cylinderVBO);
+void cylinder_data_update();
+void cylinder_buffer_init(unsigned int cylinderVAO, unsigned int cylinderVBO, unsigned int cylinderEBO);
+void cylinder_buffer_update(unsigned int cylinderVAO, unsigned int cylinderVBO, unsigned int cylinderEBO);
+void cylinder_shader_config(Shader& cylinderShader);
+void profile_texture_init(unsigned int profileTexture, unsigned int deviationTexture);
+void profile_texture_update(unsigned int profileTexture, unsigned int deviationTexture);
+const float* profile_texels(int first, int count);
+void procedural_switch(bool on);
+void resolution_switch(int y_segments);
+void field_switch(bool on);
+void field_texture_init(unsigned int fieldTexture);
+void field_texture_update(unsigned int fieldTexture);
+void lod_update();
+void update_window_title(GLFWwindow* window);
+void gcode_run(bool full_speed);
+void drawing_run();
+void material_change(bool silver);
 void bezier_mode(GLFWwindow* window);
 void bezier_caculate();
+void bezier_leave(GLFWwindow* window);
+glm::vec2 bezier_point(double xpos, double ypos);
+void spline_update();
+void plan_switch();
+void telemetry_update();
+void telemetry_log_switch();
 ///////////////////////////////////////////GLOBAL VALUE/////////////////////////////////////////////
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -57,27 +83,22 @@ glm::vec3 lightPos(0.0f, 2.0f, -2.0f);
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-// cylinder data config
-//点阵精细度设置
-const int Y_SEGMENTS = 400;
-const int X_SEGMENTS = 50;
-const int R_SEGMENTS = 100;
-//空间参数设置
-const GLfloat PI = 3.14159265358979323846f;
+// cylinder data config (点阵精细度与尺寸系数见workpiece.h)
 //const glm::vec3 cylinder_pos=glm::vec3(-2.0f, 5.0f, -0.5f);//空间位置
 const glm::vec3 cylinder_pos = glm::vec3(0.0f, 0.0f, 0.0f);//空间位置
 const float rotate_speed = 5.0f;//圆柱转速倍率
-const float radius_k = 0.5f;//半径系数，用于调节整个圆柱的半径
-const float length_k = 2.0f;//半径系数，用于调节整个圆柱的长度
-float radius[Y_SEGMENTS + 1] = { 0.0f };//半径数组，记录对应segment位置圆柱的半径，用于记录切削效果
-std::vector<float> cylinderVertices;//圆柱点集
-//std::vector<int> cylinderIndices;//圆柱点绘制index集 <- 改良之后莫得必要
-std::vector<float> cylinderAllData;//圆柱绘制数据集
-
-//切削刀具设置(刀用一个倒四棱锥表示)
-const glm::vec3 knife_pos_reset(-2.0f, 0.55f, 0.0f);
-glm::vec3 knife_pos = glm::vec3(-2.0f, 0.55f, 0.0f);//空间位置
-float knife_distance = 1.0f;
+Simulation simulation;//模拟线程：切削、刀具运动、粒子，见simulation.h
+Workpiece workpiece;//渲染用的工件：每帧从simulation同步半径集合，生成圆柱点阵数据集
+size_t cylinder_upload_bytes = 0;//本帧上传到cylinderVBO的字节数
+size_t cylinder_upload_total = 0;//累计上传字节数
+bool procedural_on = false;//V键切换：只上传半径集合，由cylinder.vs生成圆柱，CPU上不再生成点阵
+const int PROFILE_TEXTURE_UNIT = 4;//半径集合纹理所在的纹理单元，避开模型和天空盒用的单元
+const int FIELD_TEXTURE_UNIT = 5;//二维半径场纹理所在的纹理单元
+const int DEVIATION_TEXTURE_UNIT = 6;//每个segment偏差分类的纹理所在的纹理单元（procedural模式上色用）
+bool cylinder_buffer_stale = false;//分辨率换了，显存里的点阵、index集和半径纹理要重新分配
+
+//切削刀具(刀用一个倒四棱锥表示)，渲染用的副本，位置每帧从simulation同步
+Cutter cutter;
 
 //材质表 取自http://www.it.hiof.no/~borres/j3d/explain/light/p-materials.html
 //silver
@@ -109,22 +130,38 @@ float tin_shine =11.264f;
 
 //设置开关
 bool material_switch = 0; //0:wood , 1:silver
-
-//particle system
-ParticleSystem particlesystem;
+bool deviation_on = false;//O键切换：按和目标轮廓的偏差给工件上色（绿色在公差带里，红色超差，蓝色欠差）
+const char* gcode_path = "program.nc";//G键运行的数控程序
+const char* drawing_path = "target.dxf";//I键按这张图纸（SVG或DXF，drawing.h）的外轮廓切，切法和bezier一样按N键选
+const char* journal_path = "session.jnl";//会话记录，每次启动覆盖，lathe_headless replay重放
+const char* telemetry_path = "telemetry.csv";//E键开关：每个切到东西的tick一行
+std::ofstream telemetry_log;
+TelemetryMeter telemetry_meter;//上次刷新标题之后取走的遥测，标题栏显示平均功率和去除率
 
 //Bezier
 bool bezier_on = false;
-int selected_point = 0;
-glm::vec2 A;
-glm::vec2 B;
-glm::vec2 C;
-glm::vec2 D;
+int bezier_plan = -1;//N键切换：-1是bezier一次切到位，否则按这种粗车策略规划走刀路线（planner.h）
+const std::string plan_path = "plan.nc";//规划出的程序写在这里，再按进给实时运行
+//样条轮廓编辑器（spline.h）：左键加点或拖动控制点，右键删点，Enter按当前的切法切，Backspace放弃
+SplineEditor spline;
+int spline_drag = -1;//正在拖的控制点
+const float spline_pick = 0.03f;//离控制点这么近（半截面坐标）就是拖它，不是加点
 
 
 ////////////////////////////////////////////////MAIN/////////////////////////////////////////////////
-int main()
+//usage: lathe [y_segments] [x_segments] [r_segments]，不带参数就用workpiece.h里的默认精细度
+int main(int argc, char** argv)
 {
+    if (argc > 1)
+    {
+        simulation.workpiece.set_resolution(atoi(argv[1]), argc > 2 ? atoi(argv[2]) : X_SEGMENTS);
+        workpiece.set_resolution(atoi(argv[1]), argc > 2 ? atoi(argv[2]) : X_SEGMENTS);
+    }
+    if (argc > 3 && atoi(argv[3]) > 0)
+    {
+        simulation.cutter.r_segments = atoi(argv[3]);
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -343,8 +380,7 @@ int main()
         1.0f,1.0f,-1.0f,0.0f,-1.0f,-1.0f,
         0.0f,-1.0f,0.0f,0.0f,-1.0f,-1.0f,
     };
-    cylinder_radius_vector_init();//初始化半径集合
-    cylinder_data_update(0.0f);//依据radius集合生成cylinder点阵数据集，必须在init之后
+    cylinder_data_update();//依据radius集合生成cylinder点阵数据集
     
     ////////////////////////////////////////////BIND VAO/VBO/EBO//////////////////////////////////////////////
     // skybox VAO
@@ -423,13 +459,23 @@ int main()
     glEnableVertexAttribArray(1);
 
     /*cylinder数据处理*/
-    unsigned int cylinderVBO, cylinderVAO;
+    unsigned int cylinderVBO, cylinderVAO, cylinderEBO;
     /*culinder数据处理*/
     glGenVertexArrays(1, &cylinderVAO);
     glGenBuffers(1, &cylinderVBO);
-    //GLuint element_buffer_object;//EBO
-    //glGenBuffers(1, &element_buffer_object);
-    //cylinder_buffer_update(cylinderVAO, cylinderVBO);
+    glGenBuffers(1, &cylinderEBO);
+    cylinder_buffer_init(cylinderVAO, cylinderVBO, cylinderEBO);
+    //procedural模式：半径集合存成1D纹理，绘制时只绑定同一个EBO，不绑定任何顶点缓冲
+    unsigned int profileTexture, proceduralVAO, fieldTexture, deviationTexture;
+    glGenTextures(1, &profileTexture);
+    glGenTextures(1, &fieldTexture);
+    glGenTextures(1, &deviationTexture);
+    glGenVertexArrays(1, &proceduralVAO);
+    glBindVertexArray(proceduralVAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cylinderEBO);
+    profile_texture_init(profileTexture, deviationTexture);
+    field_texture_init(fieldTexture);
+    cylinder_shader_config(cylinderShader);
 
     // ParticleSystem
 
@@ -437,6 +483,12 @@ int main()
     ///////////////////////////////////////////////SHADING/////////////////////////////////////////////////
     // render loop
     // -----------
+    //二维模式按主轴转角切削：工件角度和绘制用的model矩阵一致，先绕z轴转-90°，再绕x轴转rotate_speed * t，
+    //刀在+y一侧，对应工件角度 rotate_speed * t + PI；模拟线程的tick 0是现在
+    simulation.cutter.spindle_speed = rotate_speed;
+    simulation.cutter.spindle_phase = PI + rotate_speed * glfwGetTime();
+    simulation.record(journal_path);
+    simulation.start();
     while (!glfwWindowShouldClose(window))
     {
         // per-frame time logic
@@ -447,8 +499,32 @@ int main()
 
         // input
         // -----
+        //取模拟线程最新发布的状态：改过的半径、刀具位置、粒子
+        bool relayout = false;
+        if (simulation.sync(workpiece, relayout))
+        {
+            cutter.knife_pos = simulation.frame().knife_pos;
+            cutter.knife_distance = simulation.frame().knife_distance;
+            cutter.tool = simulation.frame().tool;
+            cylinder_buffer_stale = cylinder_buffer_stale || relayout;
+            cylinder_data_update();
+        }
         processInput(window);
-        cylinder_buffer_update(cylinderVAO, cylinderVBO);
+        spline_update();
+        if (cylinder_buffer_stale)
+        {
+            cylinder_buffer_init(cylinderVAO, cylinderVBO, cylinderEBO);
+            profile_texture_init(profileTexture, deviationTexture);
+            field_texture_init(fieldTexture);
+            cylinder_shader_config(cylinderShader);
+            cylinder_buffer_stale = false;
+        }
+        lod_update();
+        telemetry_update();
+        cylinder_buffer_update(cylinderVAO, cylinderVBO, cylinderEBO);
+        profile_texture_update(profileTexture, deviationTexture);
+        field_texture_update(fieldTexture);
+        update_window_title(window);
 
         // render
         // ------
@@ -502,9 +578,10 @@ int main()
         //开启面剔除(只需要展示一个面，否则会有重合)
         //glEnable(GL_CULL_FACE);
         //glCullFace(GL_BACK);
-        glBindVertexArray(cylinderVAO);
-        glDrawArrays(GL_TRIANGLES, 0, X_SEGMENTS * Y_SEGMENTS * 6);
-        //glDrawElements(GL_TRIANGLES, X_SEGMENTS* Y_SEGMENTS * 6, GL_UNSIGNED_INT, 0);
+        cylinderShader.setBool("procedural", procedural_on);
+        cylinderShader.setBool("deviation_overlay", deviation_on);
+        glBindVertexArray(procedural_on ? proceduralVAO : cylinderVAO);
+        glDrawElements(GL_TRIANGLES, workpiece.index_count(), GL_UNSIGNED_INT, 0);
 
         //draw knife
         knifeShader.use();
@@ -524,7 +601,7 @@ int main()
         knifeShader.setMat4("projection", projection);
         knifeShader.setMat4("view", view);
         model = glm::mat4(1.0f);
-        model = glm::translate(model, knife_pos);
+        model = glm::translate(model, cutter.knife_pos);
         model = glm::scale(model, glm::vec3(0.05f)); // a smaller cube
         //model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));//rotate
         knifeShader.setMat4("model", model);
@@ -546,8 +623,7 @@ int main()
         //draw skybox
         skybox_draw(skyboxShader,skyboxVAO, cubemapTexture);
 
-        //particlesystem draw
-        particlesystem.update(deltaTime);
+        //particlesystem draw（粒子的运动在模拟线程里更新）
         dustShader.use();
         dustShader.setVec3("light.ambient", ambientColor);
         dustShader.setVec3("light.diffuse", diffuseColor);
@@ -568,7 +644,7 @@ int main()
             dustShader.setVec3("material.specular", log_specular);
             dustShader.setFloat("material.shininess", log_shine);
         }
-        particlesystem.draw_particles(dustShader, dustVAO, projection, view, lightPos);
+        draw_particles(simulation.frame().particles, dustShader, dustVAO, projection, view, lightPos);
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -588,8 +664,13 @@ int main()
     glDeleteBuffers(1, &skyboxVBO);
     glDeleteVertexArrays(1, &cylinderVAO);
     glDeleteBuffers(1, &cylinderVBO);
-   //lDeleteBuffers(1, &element_buffer_object);
+    glDeleteBuffers(1, &cylinderEBO);
+    glDeleteVertexArrays(1, &proceduralVAO);
+    glDeleteTextures(1, &profileTexture);
+    glDeleteTextures(1, &fieldTexture);
+    glDeleteTextures(1, &deviationTexture);
 
+    simulation.stop();
     glfwTerminate();
     return 0;
 }
@@ -613,61 +694,31 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS){
         camera.ProcessKeyboard(RIGHT, deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-        knife_pos.y = knife_pos.y + 0.5f / R_SEGMENTS;
-        knife_distance += 1.0f / R_SEGMENTS;
-    }
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-        //std::cout << "distance: " << knife_distance << "    knife_pos.y: " << knife_pos.y << std::endl;
-        if (knife_pos.y > 0.05f)
-        {
-            knife_pos.y = knife_pos.y - 0.5f / R_SEGMENTS;
-            knife_distance -= 1.0f / R_SEGMENTS;
-            if (knife_distance<0)
-            {
-                knife_distance = 0.0f;
-            }
-        }
-    }
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-        if (knife_pos.x<2.0f)
-        {
-            knife_pos.x = knife_pos.x + 4.0f / Y_SEGMENTS;
-            int x_seg = (int)((knife_pos.x + 2.0f) * Y_SEGMENTS / 4.0f);
-            //std::cout << "distance: " << knife_distance << "    x_seg: " << x_seg << "    radius[x_seg]: " << radius[x_seg] << std::endl;
-            if (radius[x_seg]>knife_distance)
-            {
-                float mount = radius[x_seg] - knife_distance;
-                radius[x_seg] = knife_distance;
-                cylinder_data_update(mount);
-            }
-        }   
-    }
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-        if (knife_pos.x > -2.0f)
-        {
-            knife_pos.x = knife_pos.x - 4.0f / Y_SEGMENTS;
-            int x_seg = (int)((knife_pos.x + 2.0f) * Y_SEGMENTS / 4.0f);
-            //std::cout << "distance: " << knife_distance << "    x_seg: " << x_seg << "    radius[x_seg]: " << radius[x_seg] << std::endl;
-            if (radius[x_seg] > knife_distance)
-            {
-                float mount = radius[x_seg] - knife_distance;
-                radius[x_seg] = knife_distance;
-                cylinder_data_update(mount);
-            }
-        }
-    }
+    //方向键只设置刀具的运动方向，移动和切削由模拟线程按固定时间步推进
+    simulation.radial_dir = (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) - (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS);
+    simulation.axial_dir = (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) - (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS);
+    //按住左Shift时走刀速度降到1/16
+    simulation.feed_scale = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ? 1.0f / 16.0f : 1.0f;
     if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
-        material_switch = 1;
+        material_change(1);
         return;
     }
     if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) {
-        material_switch = 0;
+        material_change(0);
         return;
     }
+    //R键重置只在按下的那一帧执行一次，按住不会每帧都发COMMAND_RESET
+    static bool r_down = false;
     if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
-        game_reset();
-        return;
+        if (!r_down)
+        {
+            r_down = true;
+            game_reset();
+            return;
+        }
+    }
+    else {
+        r_down = false;
     }
     if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) {
         print_vertics();
@@ -677,15 +728,220 @@ void processInput(GLFWwindow* window)
         bezier_mode(window);
         return;
     }
+    //编辑样条时Enter切、Backspace放弃，按下的那一帧执行一次
+    static bool enter_down = false;
+    if (glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) {
+        if (!enter_down && bezier_on)
+        {
+            bezier_caculate();
+            bezier_leave(window);
+        }
+        enter_down = true;
+    }
+    else {
+        enter_down = false;
+    }
+    if (glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_PRESS && bezier_on) {
+        bezier_leave(window);
+        return;
+    }
+    //V键按下的那一帧切换一次
+    static bool v_down = false;
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
+        if (!v_down)
+        {
+            procedural_switch(!procedural_on);
+        }
+        v_down = true;
+    }
+    else {
+        v_down = false;
+    }
+    //L键切换轴向LOD
+    static bool l_down = false;
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) {
+        if (!l_down)
+        {
+            workpiece.set_lod_enabled(!workpiece.lod_enabled);
+        }
+        l_down = true;
+    }
+    else {
+        l_down = false;
+    }
+    //[ ]键把轴向精细度减半/加倍
+    static bool bracket_down = false;
+    bool left_bracket = glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS;
+    bool right_bracket = glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS;
+    if (left_bracket || right_bracket) {
+        if (!bracket_down)
+        {
+            resolution_switch(right_bracket ? workpiece.y_segments * 2 : workpiece.y_segments / 2);
+        }
+        bracket_down = true;
+    }
+    else {
+        bracket_down = false;
+    }
+    //F键切换二维半径场
+    static bool f_down = false;
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) {
+        if (!f_down)
+        {
+            field_switch(!workpiece.field_enabled);
+        }
+        f_down = true;
+    }
+    else {
+        f_down = false;
+    }
+    //T键换刀（刀具库见tool.h）
+    static bool t_down = false;
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS) {
+        if (!t_down)
+        {
+            SimulationCommand command;
+            command.type = COMMAND_TOOL;
+            command.value = -1;
+            simulation.post(command);
+        }
+        t_down = true;
+    }
+    else {
+        t_down = false;
+    }
+    //G键按进给速度实时运行数控程序（再按一次停止），按住左Shift时全速一次切完
+    static bool g_down = false;
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
+        if (!g_down)
+        {
+            gcode_run(glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS);
+        }
+        g_down = true;
+    }
+    else {
+        g_down = false;
+    }
+    //I键按图纸切
+    static bool i_down = false;
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) {
+        if (!i_down)
+        {
+            drawing_run();
+        }
+        i_down = true;
+    }
+    else {
+        i_down = false;
+    }
+    //N键切换bezier的切法：一次切到位，或者按三种粗车策略规划
+    static bool n_down = false;
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) {
+        if (!n_down)
+        {
+            plan_switch();
+        }
+        n_down = true;
+    }
+    else {
+        n_down = false;
+    }
+    //Z键撤销、Y键重做（每次松开方向键之后、每条命令之前记一个撤销点）
+    static bool undo_down = false;
+    bool undo_key = glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS;
+    bool redo_key = glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS;
+    if (undo_key || redo_key) {
+        if (!undo_down)
+        {
+            SimulationCommand command;
+            command.type = redo_key ? COMMAND_REDO : COMMAND_UNDO;
+            simulation.post(command);
+        }
+        undo_down = true;
+    }
+    else {
+        undo_down = false;
+    }
+    //E键开关遥测日志
+    static bool e_down = false;
+    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+        if (!e_down)
+        {
+            telemetry_log_switch();
+        }
+        e_down = true;
+    }
+    else {
+        e_down = false;
+    }
+    //M键打印测量报告：体积、切掉的体积、直径、重心，每种材料的质量和转动惯量
+    static bool m_down = false;
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS) {
+        if (!m_down)
+        {
+            print_metrology_report(simulation.frame().measure, material_switch ? 1 : 0);
+        }
+        m_down = true;
+    }
+    else {
+        m_down = false;
+    }
+    //O键开关偏差上色，同时打印偏差报告：最大超差、欠差，超出公差带的区间
+    static bool o_down = false;
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) {
+        if (!o_down)
+        {
+            deviation_on = !deviation_on;
+            const SimulationFrame& f = simulation.frame();
+            print_deviation_report(f.deviation_total, f.deviation_ranges, f.deviation_range_count, f.deviation_bins);
+        }
+        o_down = true;
+    }
+    else {
+        o_down = false;
+    }
 
 }
+//run gcode_path from where the knife is: at real-time pace on the simulation thread's ticks, or all at once
+void gcode_run(bool full_speed)
+{
+    SimulationCommand command;
+    command.type = COMMAND_GCODE;
+    command.value = full_speed;
+    command.path = gcode_path;
+    simulation.post(command);
+}
+
+//cut to the outline of drawing_path, or plan to it with the strategy picked with N (the program goes next to the drawing)
+void drawing_run()
+{
+    SimulationCommand command;
+    command.type = COMMAND_DRAWING;
+    command.value = bezier_plan;
+    command.path = drawing_path;
+    simulation.post(command);
+}
+
 //reset game
 void game_reset()
 {
-    knife_distance = 1.0f;
-    knife_pos = knife_pos_reset;
-    cylinder_radius_vector_init();
-    cylinder_data_update(0.0f);
+    SimulationCommand command;
+    command.type = COMMAND_RESET;
+    simulation.post(command);
+}
+
+//switch the material, journaled (only when it changes, the keys are read every frame)
+void material_change(bool silver)
+{
+    if (material_switch == silver)
+    {
+        return;
+    }
+    material_switch = silver;
+    SimulationCommand command;
+    command.type = COMMAND_MATERIAL;
+    command.value = silver;
+    simulation.post(command);
 }
 
 //print current vertics
@@ -693,15 +949,27 @@ void print_vertics()
 {
     ofstream outfile;
     outfile.open("data.dat", ios::out | ios::trunc);
-    for (int i = 0; i < cylinderAllData.size() ; i += 7)
+    //procedural模式下CPU上没有点阵，LOD模式下indices只连着选中的ring，都临时生成一份完整的
+    Workpiece snapshot(workpiece.y_segments, workpiece.x_segments);
+    const Workpiece* source = &workpiece;
+    if (!workpiece.mesh_enabled || workpiece.lod_enabled)
+    {
+        snapshot.radius = workpiece.radius;
+        snapshot.update_mesh();
+        source = &snapshot;
+    }
+    //和原来一样是三角形列表：按indices每个三角形输出三个点，点阵是压缩存储的，逐个解压成pos normal polished_bit
+    float data[VERTEX_FLOATS];
+    for (size_t i = 0; i < source->indices.size(); i++)
     {
-        outfile << cylinderAllData[i] << " ";
-        outfile << cylinderAllData[i+1] << " ";
-        outfile << cylinderAllData[i+2] << " ";
-        outfile << cylinderAllData[i+3] << " ";
-        outfile << cylinderAllData[i+4] << " ";
-        outfile << cylinderAllData[i+5] << " ";
-        outfile << cylinderAllData[i + 6] << std::endl;
+        source->vertex_data(source->indices[i], data);
+        outfile << data[0] << " ";
+        outfile << data[1] << " ";
+        outfile << data[2] << " ";
+        outfile << data[3] << " ";
+        outfile << data[4] << " ";
+        outfile << data[5] << " ";
+        outfile << data[6] << std::endl;
     }
     outfile.close();
 }
@@ -721,7 +989,11 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
     if (bezier_on)
     {
-        //std::cout << "mouse_x:" << xpos << "  mouse_y:" << ypos << std::endl;
+        //拖着控制点走，只重新算它影响的那几段（spline_update()）
+        if (spline_drag >= 0)
+        {
+            spline.move(spline_drag, bezier_point(xpos, ypos));
+        }
         return;
     }
 
@@ -749,46 +1021,28 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
     }
 
     double clickPointX, clickPointY;
-    if (action == GLFW_PRESS) switch(button)
+    glfwGetCursorPos(window, &clickPointX, &clickPointY);
+    glm::vec2 p = bezier_point(clickPointX, clickPointY);
+    if (button == GLFW_MOUSE_BUTTON_LEFT)
     {
-    case GLFW_MOUSE_BUTTON_LEFT:
-        glfwGetCursorPos(window, &clickPointX, &clickPointY); {
-            //std::cout << "click : mouse_x:" << clickPointX << "  mouse_y:" << clickPointY << std::endl;
-            switch (selected_point)
+        //点在控制点上是拖它，否则按x插进相邻两个点之间
+        if (action == GLFW_PRESS)
+        {
+            spline_drag = spline.nearest(p, spline_pick);
+            if (spline_drag < 0)
             {
-            case 0: {
-                A.x = -(float)((clickPointX - SCR_WIDTH / 2.0f) / (SCR_WIDTH/2.0f));
-                A.y = -(float)((clickPointY - SCR_HEIGHT / 2.0f) / (SCR_HEIGHT / 2.0f));
-                selected_point++;
-                break;
-            }
-            case 1: {
-                B.x = -(float)((clickPointX - SCR_WIDTH / 2.0f) / (SCR_WIDTH / 2.0f));
-                B.y = -(float)((clickPointY - SCR_HEIGHT / 2.0f) / (SCR_HEIGHT / 2.0f));
-                selected_point++;
-                break;
-            }
-            case 2: {
-                C.x = -(float)((clickPointX - SCR_WIDTH / 2.0f) / (SCR_WIDTH / 2.0f));
-                C.y = -(float)((clickPointY - SCR_HEIGHT / 2.0f) / (SCR_HEIGHT / 2.0f));
-                selected_point++;
-                break;
-            }
-            case 3: {
-                D.x = -(float)((clickPointX - SCR_WIDTH / 2.0f) / (SCR_WIDTH / 2.0f));
-                D.y = -(float)((clickPointY - SCR_HEIGHT / 2.0f) / (SCR_HEIGHT / 2.0f));
-                selected_point++;
-                break;
-            }
+                spline_drag = spline.add(p);
             }
         }
+        else if (action == GLFW_RELEASE)
+        {
+            spline_drag = -1;
+        }
     }
-    if (selected_point==4)
+    else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
     {
-        selected_point = 0;
-        bezier_on = false;
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-        bezier_caculate();
+        spline.erase(spline.nearest(p, spline_pick));
+        spline_drag = -1;
     }
 }
 
@@ -846,309 +1100,356 @@ void model_draw(Shader shader,Model mymodel, glm::vec3 position, glm::vec3 scale
     // draw model with the shader
     mymodel.Draw(shader);
 }
-//init radius vector
-void cylinder_radius_vector_init()
+//rebuild the cylinder data set from the radius vector (only the rings the simulation changed)
+void cylinder_data_update()
+{
+    workpiece.update_mesh();
+}
+//allocate cylinder's VBO and EBO for the current resolution and set the vertex attribute pointers, called again only when the resolution changes
+void cylinder_buffer_init(unsigned int cylinderVAO, unsigned int cylinderVBO, unsigned int cylinderEBO)
+{
+    //生成并绑定圆柱的VAO、VBO和EBO
+    glBindVertexArray(cylinderVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cylinderVBO);
+    //整个数据集只在这里上传一次，之后只上传改动的部分（procedural模式下CPU上没有点阵，只分配）
+    size_t vertex_bytes = (size_t)(workpiece.y_segments + 1) * (workpiece.x_segments + 1) * sizeof(PackedVertex);
+    glBufferData(GL_ARRAY_BUFFER, vertex_bytes, workpiece.all_data.empty() ? NULL : &workpiece.all_data[0], GL_DYNAMIC_DRAW);
+    workpiece.clear_upload();
+    //点之间共享，按全分辨率的index数分配，LOD换ring时在cylinder_buffer_update()里重新上传
+    size_t index_bytes = (size_t)workpiece.y_segments * workpiece.x_segments * 6 * sizeof(unsigned int);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cylinderEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, workpiece.indices.size() * sizeof(unsigned int), &workpiece.indices[0]);
+    workpiece.indices_dirty = false;
+
+    //设置顶点属性指针（PackedVertex：16位归一化坐标、八面体编码法向量、1字节表面状态、1字节偏差分类）
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, pos));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_BYTE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, state));
+    glEnableVertexAttribArray(2);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_BYTE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, deviation));
+    glEnableVertexAttribArray(3);
+}
+//upload the rings of cylinder data rebuilt since last frame and the index set if the LOD changed, nothing when no cut happened
+void cylinder_buffer_update(unsigned int cylinderVAO, unsigned int cylinderVBO, unsigned int cylinderEBO)
 {
-    for (int i = 0; i < Y_SEGMENTS; i++)
+    cylinder_upload_bytes = 0;
+    if (workpiece.indices_dirty)
+    {
+        //EBO绑定是VAO状态的一部分，先绑cylinderVAO（procedural VAO用的是同一个EBO）
+        size_t index_bytes = workpiece.indices.size() * sizeof(unsigned int);
+        glBindVertexArray(cylinderVAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cylinderEBO);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, index_bytes, &workpiece.indices[0]);
+        workpiece.indices_dirty = false;
+        cylinder_upload_bytes += index_bytes;
+        cylinder_upload_total += index_bytes;
+    }
+    size_t offset, size;
+    if (!workpiece.pending_upload(offset, size))
     {
-        radius[i] = 1.0f;
+        return;
     }
+    glBindBuffer(GL_ARRAY_BUFFER, cylinderVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, (const char*)&workpiece.all_data[0] + offset);
+    workpiece.clear_upload();
+    cylinder_upload_bytes += size;
+    cylinder_upload_total += size;
 }
-//caculate the vertex and anormal vec of target cylinder
-void cylinder_data_update(float mount)
+//uniforms of cylinder.vs that only depend on the resolution
+void cylinder_shader_config(Shader& cylinderShader)
 {
-    //cylinderIndices.clear();
-    cylinderVertices.clear();
-    cylinderAllData.clear();
-    //draw a sphere
-    /*
-    for (int y = 0; y <= Y_SEGMENTS; y++)
+    cylinderShader.use();
+    cylinderShader.setInt("profile", PROFILE_TEXTURE_UNIT);
+    cylinderShader.setInt("x_segments", workpiece.x_segments);
+    cylinderShader.setInt("y_segments", workpiece.y_segments);
+    cylinderShader.setFloat("radius_k", radius_k);
+    cylinderShader.setFloat("length_k", length_k);
+    cylinderShader.setVec3("bounds", radius_k, length_k, radius_k);
+    cylinderShader.setInt("field", FIELD_TEXTURE_UNIT);
+    cylinderShader.setInt("deviation_classes", DEVIATION_TEXTURE_UNIT);
+    cylinderShader.setBool("field_mode", workpiece.field_enabled);
+}
+//the radius segments first..first+count-1 as drawn: the radius vector itself unless the spline preview is on
+const float* profile_texels(int first, int count)
+{
+    if (workpiece.preview.empty())
     {
-        for (int x = 0; x <= X_SEGMENTS; x++)
-        {
-            float xSegment = (float)x / (float)X_SEGMENTS;
-            float ySegment = (float)y / (float)Y_SEGMENTS;
-            float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-            float yPos = std::cos(ySegment * PI);
-            float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-            cylinderVertices.push_back(xPos);
-            cylinderVertices.push_back(yPos);
-            cylinderVertices.push_back(zPos);
-            std::cout <<y* X_SEGMENTS + x<<": "<< xPos << " " << yPos << " "<< zPos<< std::endl;
-        }
+        return &workpiece.radius[first];
     }
-    for (int i = 0; i < Y_SEGMENTS; i++)
+    static std::vector<float> texels;
+    texels.resize(count);
+    for (int i = 0; i < count; i++)
     {
-        for (int j = 0; j < X_SEGMENTS; j++)
-        {
-            cylinderIndices.push_back(i * (X_SEGMENTS + 1) + j);
-            cylinderIndices.push_back((i + 1) * (X_SEGMENTS + 1) + j);
-            cylinderIndices.push_back((i + 1) * (X_SEGMENTS + 1) + j + 1);
-            cylinderIndices.push_back(i * (X_SEGMENTS + 1) + j);
-            cylinderIndices.push_back((i + 1) * (X_SEGMENTS + 1) + j + 1);
-            cylinderIndices.push_back(i * (X_SEGMENTS + 1) + j + 1);
-        }
-    }*/
-    //draw cylinder
-    for (int y = 0; y <= Y_SEGMENTS; y++)
+        texels[i] = workpiece.shown_radius(first + i);
+    }
+    return &texels[0];
+}
+//create the 1D R32F texture holding the radius vector, one texel per segment, and next to it the 1D R8UI texture
+//of the segments' deviation classes (they are synced with the radius, so they share its dirty range)
+void profile_texture_init(unsigned int profileTexture, unsigned int deviationTexture)
+{
+    glActiveTexture(GL_TEXTURE0 + PROFILE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_1D, profileTexture);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_R32F, (GLsizei)workpiece.radius.size(), 0, GL_RED, GL_FLOAT, profile_texels(0, (int)workpiece.radius.size()));
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0 + DEVIATION_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_1D, deviationTexture);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_R8UI, (GLsizei)workpiece.deviation.size(), 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &workpiece.deviation[0]);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+    workpiece.clear_profile();
+}
+//upload the changed radius segments and their deviation classes, a cut costs a few bytes here
+void profile_texture_update(unsigned int profileTexture, unsigned int deviationTexture)
+{
+    int first, count;
+    if (!workpiece.pending_profile(first, count))
     {
-        //std::cout <<y << ": " << radius[y] << std::endl;
-        for (int x = 0; x <= X_SEGMENTS; x++)
-        {
-            //aPos
-            float xSegment = (float)x / (float)X_SEGMENTS;
-            float ySegment = (float)y / (float)Y_SEGMENTS;
-            float xPos = radius_k * radius[y] * std::cos(xSegment * 2.0f * PI);
-            float yPos = length_k * ( 2.0f* ySegment -1.0f );
-            float zPos = radius_k * radius[y] * std::sin(xSegment * 2.0f * PI);
-            if (y == 0 || y == Y_SEGMENTS) {
-                xPos = 0;
-                zPos = 0;
-            }
-            cylinderVertices.push_back(xPos);
-            cylinderVertices.push_back(yPos);
-            cylinderVertices.push_back(zPos);
-            //std::cout << y * (X_SEGMENTS+1) + x << ": " << xPos << " " << yPos << " " << zPos << std::endl;
-            //aNormal
-
-        }
+        return;
     }
-    /* 输入EBO <- 在启用多组属性时，禁用
-    for (int i = 0; i < Y_SEGMENTS; i++)
+    glActiveTexture(GL_TEXTURE0 + PROFILE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_1D, profileTexture);
+    glTexSubImage1D(GL_TEXTURE_1D, 0, first, count, GL_RED, GL_FLOAT, profile_texels(first, count));
+    glActiveTexture(GL_TEXTURE0 + DEVIATION_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_1D, deviationTexture);
+    glTexSubImage1D(GL_TEXTURE_1D, 0, first, count, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &workpiece.deviation[first]);
+    glActiveTexture(GL_TEXTURE0);
+    workpiece.clear_profile();
+    cylinder_upload_bytes += count * (sizeof(float) + sizeof(uint8_t));
+    cylinder_upload_total += count * (sizeof(float) + sizeof(uint8_t));
+}
+//switch between the CPU mesh and the procedural (profile only) rendering
+void procedural_switch(bool on)
+{
+    procedural_on = on;
+    workpiece.set_mesh_enabled(!on);
+    workpiece.update_mesh();
+}
+//change the axial resolution on the simulation thread, the buffers are reallocated when the new layout is synced
+void resolution_switch(int y_segments)
+{
+    SimulationCommand command;
+    command.type = COMMAND_RESOLUTION;
+    command.value = y_segments;
+    simulation.post(command);
+}
+//switch the 2D radius field on/off on the simulation thread, x_segments follows the field columns so the buffers are reallocated when it is synced
+void field_switch(bool on)
+{
+    SimulationCommand command;
+    command.type = COMMAND_FIELD;
+    command.value = on;
+    simulation.post(command);
+}
+//create the 2D R32F texture of the radius field (padded to whole tiles), a 1x1 placeholder when the field is off
+void field_texture_init(unsigned int fieldTexture)
+{
+    glActiveTexture(GL_TEXTURE0 + FIELD_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, fieldTexture);
+    const RadiusField& field = workpiece.field;
+    if (workpiece.field_enabled)
     {
-        for (int j = 0; j < X_SEGMENTS; j++)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, field.tiles_theta * FIELD_TILE, field.tiles_y * FIELD_TILE, 0, GL_RED, GL_FLOAT, NULL);
+        for (int n = 0; n < field.tiles_y * field.tiles_theta; n++)
         {
-            std::cout << "index order:" 
-                << i * (X_SEGMENTS + 1) + j << "   " 
-                << (i + 1) * (X_SEGMENTS + 1) + j << "   "
-                << (i + 1) * (X_SEGMENTS + 1) + j + 1 << "   "
-                <<  i * (X_SEGMENTS + 1) + j << "   "
-                << (i + 1) * (X_SEGMENTS + 1) + j + 1 << "   "
-                <<  i * (X_SEGMENTS + 1) + j + 1 << "   "
-                << std::endl;
-            cylinderIndices.push_back(i * (X_SEGMENTS + 1) + j);
-            cylinderIndices.push_back((i + 1) * (X_SEGMENTS + 1) + j);
-            cylinderIndices.push_back((i + 1) * (X_SEGMENTS + 1) + j + 1);
-            cylinderIndices.push_back(i * (X_SEGMENTS + 1) + j);
-            cylinderIndices.push_back((i + 1) * (X_SEGMENTS + 1) + j + 1);
-            cylinderIndices.push_back(i * (X_SEGMENTS + 1) + j + 1);
+            int y, theta;
+            field.tile_origin(n, y, theta);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, theta, y, FIELD_TILE, FIELD_TILE, GL_RED, GL_FLOAT, field.tile(n));
         }
-    }*/
-
-    for (int i = 0; i < Y_SEGMENTS; i++)
+    }
+    else
     {
-        for (int j = 0; j < X_SEGMENTS; j++)
-        {
-            /*
-            std::cout << "index order:"
-                << i * (X_SEGMENTS + 1) + j << "   "
-                << (i + 1) * (X_SEGMENTS + 1) + j << "   "
-                << (i + 1) * (X_SEGMENTS + 1) + j + 1 << "   "
-                << i * (X_SEGMENTS + 1) + j << "   "
-                << (i + 1) * (X_SEGMENTS + 1) + j + 1 << "   "
-                << i * (X_SEGMENTS + 1) + j + 1 << "   "
-                << std::endl;
-            std::cout << cylinderVertices[3*(i * (X_SEGMENTS + 1) + j)]<< cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j)+1]<< cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j)+2] << "   "
-                << cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j)] << cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j) + 1] << cylinderVertices[3 * ((i+1) * (X_SEGMENTS + 1) + j) + 2] << "   "
-                << cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j+1)] << cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j+1) + 1] << cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j+1) + 2] << "   "
-                << std::endl;
-            */
-            //input first 3 vertics
-            float x1 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j)];
-            float y1 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j)+1];
-            float z1 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j)+2];
-            float x2 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j)];
-            float y2 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j) + 1];
-            float z2 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j) + 2];
-            float x3 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j + 1)];
-            float y3 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j + 1) + 1];
-            float z3 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j + 1) + 2];
-
-            float x4 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j)];
-            float y4 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j) + 1];
-            float z4 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j) + 2];
-            float x5 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j + 1)];
-            float y5 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j + 1) + 1];
-            float z5 = cylinderVertices[3 * ((i + 1) * (X_SEGMENTS + 1) + j + 1) + 2];
-            float x6 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j + 1)];
-            float y6 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j + 1) + 1];
-            float z6 = cylinderVertices[3 * (i * (X_SEGMENTS + 1) + j + 1) + 2];
-            //caculate normal
-            glm::vec3 normal(0.0f);
-            if (i == 0) {
-                normal = glm::vec3(0.0f,-1.0f,0.0f);
-            }
-            else if (i == (Y_SEGMENTS - 1)) {
-                normal = glm::vec3(0.0f, 1.0f, 0.0f);
-            }
-            else {
-                glm::vec3 AB(x2 - x1, y2 - y1, z2 - z1);
-                glm::vec3 AC(x3 - x1, y3 - y1, z3 - z1);
-                normal = glm::normalize(glm::cross(AB, AC));
-            }
-            //std::cout << "the normal:" << normal.x << normal.y << normal.z <<endl;
-            float polished_bit = 0.5f;
-            if (radius[i]<1.0f)
-            {
-                polished_bit = 1.0f;
-            }
-            //std::cout << "the polished_bit:" << polished_bit <<endl;
-            cylinderAllData.push_back(x1);
-            cylinderAllData.push_back(y1);
-            cylinderAllData.push_back(z1);
-
-            cylinderAllData.push_back(normal.x);
-            cylinderAllData.push_back(normal.y);
-            cylinderAllData.push_back(normal.z);
-            cylinderAllData.push_back(polished_bit);
-
-            cylinderAllData.push_back(x2);
-            cylinderAllData.push_back(y2);
-            cylinderAllData.push_back(z2);
-
-            cylinderAllData.push_back(normal.x);
-            cylinderAllData.push_back(normal.y);
-            cylinderAllData.push_back(normal.z);
-            cylinderAllData.push_back(polished_bit);
-
-            cylinderAllData.push_back(x3);
-            cylinderAllData.push_back(y3);
-            cylinderAllData.push_back(z3);
-
-            cylinderAllData.push_back(normal.x);
-            cylinderAllData.push_back(normal.y);
-            cylinderAllData.push_back(normal.z);
-            cylinderAllData.push_back(polished_bit);
-
-            cylinderAllData.push_back(x4);
-            cylinderAllData.push_back(y4);
-            cylinderAllData.push_back(z4);
-
-            cylinderAllData.push_back(normal.x);
-            cylinderAllData.push_back(normal.y);
-            cylinderAllData.push_back(normal.z);
-            cylinderAllData.push_back(polished_bit);
-
-            cylinderAllData.push_back(x5);
-            cylinderAllData.push_back(y5);
-            cylinderAllData.push_back(z5);
-
-            cylinderAllData.push_back(normal.x);
-            cylinderAllData.push_back(normal.y);
-            cylinderAllData.push_back(normal.z);
-            cylinderAllData.push_back(polished_bit);
-
-            cylinderAllData.push_back(x6);
-            cylinderAllData.push_back(y6);
-            cylinderAllData.push_back(z6);
-        
-            cylinderAllData.push_back(normal.x);
-            cylinderAllData.push_back(normal.y);
-            cylinderAllData.push_back(normal.z);
-            cylinderAllData.push_back(polished_bit);
-        }
+        float placeholder = 0.0f;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, 1, 1, 0, GL_RED, GL_FLOAT, &placeholder);
     }
-    particlesystem.create_particles(knife_pos,mount);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+    workpiece.field.clear_dirty();
 }
-//update cylinder's VAO,VBO,EBO
-void cylinder_buffer_update(unsigned int cylinderVAO, unsigned int cylinderVBO)
+//upload only the tiles of the radius field the knife touched, each tile is contiguous so it goes up as one sub-image
+void field_texture_update(unsigned int fieldTexture)
 {
-    
-    //生成并绑定球体的VAO和VBO
-    glBindBuffer(GL_ARRAY_BUFFER, cylinderVBO);
-    glBindVertexArray(cylinderVAO);
-    //将顶点数据绑定至当前默认的缓冲中
-    glBufferData(GL_ARRAY_BUFFER, cylinderAllData.size() * sizeof(float), &cylinderAllData[0], GL_STATIC_DRAW);
-
-    //EBO  <- 改良之后并不需要这一步
-    //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer_object);
-    //glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylinderIndices.size() * sizeof(int), &cylinderIndices[0], GL_STATIC_DRAW);
-
-    //设置顶点属性指针
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    //解绑VAO和VBO <- 没必要
-    //glBindBuffer(GL_ARRAY_BUFFER, 0);
-    //glBindVertexArray(0);
-    //std::cout << "Did here" << endl;
+    RadiusField& field = workpiece.field;
+    if (field.dirty_tiles.empty())
+    {
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0 + FIELD_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, fieldTexture);
+    for (size_t i = 0; i < field.dirty_tiles.size(); i++)
+    {
+        int y, theta;
+        field.tile_origin(field.dirty_tiles[i], y, theta);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, theta, y, FIELD_TILE, FIELD_TILE, GL_RED, GL_FLOAT, field.tile(field.dirty_tiles[i]));
+    }
+    glActiveTexture(GL_TEXTURE0);
+    size_t bytes = field.dirty_tiles.size() * FIELD_TILE * FIELD_TILE * sizeof(float);
+    cylinder_upload_bytes += bytes;
+    cylinder_upload_total += bytes;
+    field.clear_dirty();
+}
+//LOD跟着刀具走，刀具换了块才会重新选ring（半径变了的情况在update_mesh()里处理）
+void lod_update()
+{
+    if (workpiece.lod_enabled)
+    {
+        workpiece.update_lod(cutter.knife_segment(workpiece));
+    }
+}
+//show fps and cylinder upload statistics in the window title, refreshed once per second
+void update_window_title(GLFWwindow* window)
+{
+    static float last_time = 0.0f;
+    static int frames = 0;
+    static size_t max_upload = 0;
+    frames++;
+    max_upload = std::max(max_upload, cylinder_upload_bytes);
+    if (lastFrame - last_time < 1.0f)
+    {
+        return;
+    }
+    //测量由模拟线程按改过的segment增量更新，随每一帧发布
+    const MeasureNode& part = simulation.frame().measure;
+    char measure[128];
+    snprintf(measure, sizeof(measure), " | diameter: %.2f~%.2f mm | removed: %.1f cm3 | mass: %.0f g",
+        part.min_radius * STOCK_DIAMETER, part.max_radius * STOCK_DIAMETER,
+        (measure_stock_volume() - part.volume) / 1000.0, measure_mass(part, material_switch ? 1 : 0));
+    const DeviationNode& off = simulation.frame().deviation_total;
+    char deviation[128] = "";
+    if (simulation.frame().deviation_bins > 0)
+    {
+        snprintf(deviation, sizeof(deviation), " | deviation: +%.3f/-%.3f mm, %d out", std::max(0.0f, off.over), std::max(0.0f, off.under), off.out);
+    }
+    char load[128];
+    snprintf(load, sizeof(load), " | spindle: %.0f W (peak %.0f W), %.2f cm3/min",
+        telemetry_meter.mean_power(), telemetry_meter.peak_power, telemetry_meter.mrr() * 60.0 / 1000.0);
+    telemetry_meter.clear();
+    std::string title = "LearnOpenGL | fps: " + std::to_string(frames)
+        + " | upload max: " + std::to_string(max_upload) + " B/frame"
+        + " | upload total: " + std::to_string(cylinder_upload_total / 1024) + " KB"
+        + " | grid: " + std::to_string(workpiece.y_segments) + "x" + std::to_string(workpiece.x_segments)
+        + (workpiece.lod_enabled ? " | lod" : "") + (workpiece.field_enabled ? " | 2D" : "") + " | triangles: " + std::to_string(workpiece.index_count() / 3)
+        + " | tool: " + tool_library()[cutter.tool].name
+        + " | bezier: " + (bezier_plan < 0 ? "direct" : PLAN_STRATEGY_NAMES[bezier_plan])
+        + (bezier_on ? " (editing, " + std::to_string(spline.size()) + " points)" : "") + measure + deviation + load;
+    glfwSetWindowTitle(window, title.c_str());
+    last_time = lastFrame;
+    frames = 0;
+    max_upload = 0;
 }
 
-//access bezier
+//access the spline profile editor (B key), the part shows what the curve would cut while editing
 void bezier_mode(GLFWwindow* window)
 {
-    /*
-    std::cout << "计算bezier曲线，请按顺序依次输入四个点的数据，请务必保证：" << std::endl
-        << "x范围在-1.0f~" << 1.0f << std::endl
-        << "y范围在-1.0f~" << 1.0f << std::endl;
-   
-    std::cout << "A.x:" << std::endl;
-    std::cin >> A.x;
-    std::cout << "A.y:" << std::endl;
-    std::cin >> A.y;
-    std::cout << "B.x:" << std::endl;
-    std::cin >> B.x;
-    std::cout << "B.y:" << std::endl;
-    std::cin >> B.y;
-    std::cout << "C.x:" << std::endl;
-    std::cin >> C.x;
-    std::cout << "C.y:" << std::endl;
-    std::cin >> C.y;
-    std::cout << "D.x:" << std::endl;
-    std::cin >> D.x;
-    std::cout << "D.y:" << std::endl;
-    std::cin >> D.y;
-    */
+    if (bezier_on)
+    {
+        return;
+    }
+    std::cout << "样条轮廓：左键加点（按x插在相邻两点之间）或拖动控制点，右键删点，Enter切，Backspace放弃" << std::endl;
+    spline.clear(workpiece.y_segments);
+    spline_drag = -1;
     bezier_on = true;
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-    //bezier_caculate();
 }
 
-//caculate and apply data
+//cut the edited spline, or plan to it with the strategy picked with N
 void bezier_caculate()
 {
-    
-    std::cout << A.x << std::endl;
-    std::cout << A.y << std::endl;
-    std::cout << B.x << std::endl;
-    std::cout << B.y << std::endl;
-    std::cout << C.x << std::endl;
-    std::cout << C.y << std::endl;
-    std::cout << D.x << std::endl;
-    std::cout << D.y << std::endl;
-    
+    if (spline.size() < 2)
+    {
+        std::cout << "spline: at least two points are needed" << std::endl;
+        return;
+    }
+    std::cout << "spline: " << spline.size() << " points, " << spline.evaluated() << " spans evaluated while editing" << std::endl;
+    SimulationCommand command;
+    command.type = COMMAND_SPLINE;
+    command.value = bezier_plan;
+    command.path = plan_path;
+    command.spline = spline.points();
+    simulation.post(command);
+}
 
-    float ps[Y_SEGMENTS+1][2];
+//leave the editor: the preview rings go back to the part
+void bezier_leave(GLFWwindow* window)
+{
+    bezier_on = false;
+    spline_drag = -1;
+    workpiece.clear_preview();
+    cylinder_data_update();
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    firstMouse = true;
+}
 
-    int i = 0;
-    for (float t = 0.0f; t <= 1.0f; t += 1.0f/Y_SEGMENTS)
-    {
+//window pixel -> the (-1,1)x(-1,1) half-section space (the mapping the four-point bezier used)
+glm::vec2 bezier_point(double xpos, double ypos)
+{
+    return glm::vec2(-(float)((xpos - SCR_WIDTH / 2.0f) / (SCR_WIDTH / 2.0f)), -(float)((ypos - SCR_HEIGHT / 2.0f) / (SCR_HEIGHT / 2.0f)));
+}
 
-        float a1 = pow((1.0f - t), 3);
-        float a2 = pow((1.0f - t), 2) * 3 * t;
-        float a3 = 3.0f * t * t * (1.0f - t);
-        float a4 = t * t * t;
-        ps[i][0] = a1 * A.x + a2 * B.x + a3 * C.x + a4 * D.x;
-        ps[i][1] = a1 * A.y + a2 * B.y + a3 * C.y + a4 * D.y;
-        //std::cout << i << " "<< ps[i][0] << " " << ps[i][1] << std::endl;
-        i = i + 1;
+//re-rasterize what the last edits changed and rebuild only those rings of the preview
+void spline_update()
+{
+    if (!bezier_on)
+    {
+        return;
+    }
+    if ((int)spline.lowest.size() != workpiece.y_segments)
+    {
+        spline.resize(workpiece.y_segments);
     }
-    ps[Y_SEGMENTS][0] = D.x;
-    ps[Y_SEGMENTS][1] = D.y;
-    //std::cout << ps[Y_SEGMENTS][0] << " " << ps[Y_SEGMENTS][1] << std::endl;
+    int first, last;
+    if (spline.update(first, last))
+    {
+        workpiece.set_preview(spline.lowest, first, last);
+        cylinder_data_update();
+    }
+}
 
-    for (int i = 0; i <= Y_SEGMENTS; i++)
+//cycle how a bezier is cut: all at once, or planned as roughing passes of each strategy plus a finishing pass
+void plan_switch()
+{
+    bezier_plan = bezier_plan + 1 < PLAN_STRATEGIES ? bezier_plan + 1 : -1;
+    std::cout << "bezier: " << (bezier_plan < 0 ? "direct" : PLAN_STRATEGY_NAMES[bezier_plan]) << std::endl;
+}
+
+//take every tick of cutting telemetry the simulation wrote since the last frame (the ring buffer never blocks it)
+void telemetry_update()
+{
+    TelemetrySample sample;
+    while (simulation.telemetry.pop(sample))
     {
-        int index = (ps[i][0] + 1.0f) * Y_SEGMENTS / 2;
-        float bezier_radius = (ps[i][1] + 1.0f) / 2.0f;
-        if (radius[index] > bezier_radius)
+        telemetry_meter.add(sample);
+        if (telemetry_log.is_open())
         {
-            radius[index] = bezier_radius;
+            telemetry_write(telemetry_log, sample);
         }
     }
-    cylinder_data_update(0.0f);
+}
+
+void telemetry_log_switch()
+{
+    if (telemetry_log.is_open())
+    {
+        telemetry_log.close();
+        std::cout << "telemetry log closed" << std::endl;
+        return;
+    }
+    telemetry_log.open(telemetry_path, std::ios::out | std::ios::trunc);
+    if (!telemetry_log)
+    {
+        std::cout << "ERROR::TELEMETRY::CANNOT_OPEN " << telemetry_path << std::endl;
+        return;
+    }
+    telemetry_write_header(telemetry_log);
+    std::cout << "telemetry log: " << telemetry_path << std::endl;
 }
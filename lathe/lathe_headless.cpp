@@ -0,0 +1,3006 @@
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include "include/workpiece.h"
+#include "include/cutter.h"
+#include "include/simulation.h"
+#include "include/gcode.h"
+#include "include/planner.h"
+#include "include/metrology.h"
+#include "include/telemetry.h"
+#include "include/collision.h"
+#include "include/bezier.h"
+#include "include/spline.h"
+#include "include/drawing.h"
+#include "include/mesh_envelope.h"
+#include "include/deviation.h"
+/*
+Headless lathe: 不开窗口，直接跑切削与重建点阵的逻辑
+usage:
+    lathe_headless bench [passes] [y_segments] [x_segments]    切削若干趟并统计耗时
+    lathe_headless ring [rounds] [x_segments]                  ring生成器：标量/SSE两条路径的吞吐，并检查输出一致
+    lathe_headless lod [y_segments]                            轴向LOD：绘制的ring/三角形数量和误差
+    lathe_headless profile [cuts]                              折点轮廓：随机切削后和逐点暴力结果对比，统计折点数与每次操作耗时；沿曲线斜着切很多小段，合并的误差不累积
+    lathe_headless field [theta_segments]                      二维半径场：按主轴转角切削，每帧耗时和上传的块数
+    lathe_headless motion                                      连续走刀：同一段按键输入在不同帧率下切出的零件是否完全一致
+    lathe_headless sim [seconds]                               模拟线程：1kHz切削，另一个线程按60fps（偶尔卡顿）同步、重建点阵
+    lathe_headless tool [y_segments]                           刀具库：每把刀切一次的耗时、和逐点暴力结果对比，二维半径场SSE2/标量对比
+    lathe_headless journal [seconds]                           会话记录：模拟线程实时跑一段随机输入和命令并记录，再无线程重放，检查radius[]逐位相同
+    lathe_headless replay file.jnl                             重放一个会话记录（比如lathe.exe写的session.jnl），统计重放速度，检查结果和记录时相同
+    lathe_headless gcode [moves | file.nc]                     G代码：生成一个粗车+精车程序（或者读给定的程序）全速流式执行，统计每秒行数；生成的程序再按实时节奏逐tick执行并对比
+    lathe_headless undo [strokes]                              撤销/重做：随机切削若干步，一直撤销到底再重做回来，每一步和当时的状态对比，统计快照内存和重建的ring数
+    lathe_headless plan [bins]                                 走刀路线规划：一条bezier目标，每把刀、每种粗车策略的规划耗时、估算的加工时间，切完检查有没有过切、每刀切深和精度
+    lathe_headless measure [cuts]                              测量：随机切削，每刀之后增量更新体积/质量/转动惯量/直径，和每次从头求和的结果对比、比较耗时
+    lathe_headless telemetry [seconds]                         切削遥测：每个tick切掉的体积加起来和工件少掉的体积对比，换材质功率按比切削能变；模拟线程实时跑，另一个线程按60fps（偶尔卡顿）取走，统计丢掉的条数
+    lathe_headless collision [moves]                           快移碰撞检查：随机G0和逐个折点暴力比较的结果对比、比较耗时；G代码程序带不带检查的速度，撞进工件的程序在那条G0之前停下
+    lathe_headless bezier [curves]                             bezier光栅化：随机曲线，原来按固定t步长取点漏掉的格子数、折线离曲线的最大距离、SSE2/标量求值对比，求值、光栅化、切削的耗时
+    lathe_headless spline [points]                             样条轮廓编辑器：随机拖动控制点，每次只重新算受影响的几段、几个格子、几个ring，和从头算的结果逐位对比，统计每次拖动的耗时
+    lathe_headless drawing [kilobytes]                         图纸目标：手写的SVG和DXF逐格子和已知轮廓对比；生成几MB的图纸统计流式读取的速度，通过COMMAND_DRAWING切和规划
+    lathe_headless mesh [triangles]                            网格的车削包络：随机三角形和逐格子裁剪的结果对比，车出来的零件和各圈半径对比，单线程和多线程逐位相同、吞吐，OBJ/STL读回来，茶壶选哪根轴
+    lathe_headless deviation [cuts]                            偏差分析：随机切削，每刀之后增量更新超差/欠差/超出公差的区间，和每次从头扫一遍的结果对比、比较耗时；规划的程序跑完之后整根零件在公差带里
+*/
+
+//////////////////////////////////////////////FUNCTION//////////////////////////////////////////////
+int bench(int passes, int y_segments, int x_segments);
+int ring_bench(int rounds, int x_segments);
+int lod_bench(int y_segments);
+int profile_bench(int cuts);
+int field_bench(int theta_segments);
+int motion_bench();
+int simulation_bench(double seconds);
+int tool_bench(int y_segments);
+int gcode_bench(const std::string& file, int moves);
+int journal_bench(double seconds);
+int replay(const std::string& path);
+int undo_bench(int strokes);
+int plan_bench(int bins);
+int metrology_bench(int cuts);
+int telemetry_bench(double seconds);
+int collision_bench(int moves);
+int bezier_bench(int curves);
+int spline_bench(int points);
+int drawing_bench(int kilobytes);
+int mesh_bench(int triangles);
+int deviation_bench(int cuts);
+void print_usage();
+
+// timing helper
+typedef std::chrono::high_resolution_clock Clock;
+double elapsed_ms(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+////////////////////////////////////////////////MAIN/////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 1 ? argv[1] : "bench";
+    if (mode == "bench")
+    {
+        int passes = argc > 2 ? std::atoi(argv[2]) : 5;
+        int y_segments = argc > 3 ? std::atoi(argv[3]) : Y_SEGMENTS;
+        int x_segments = argc > 4 ? std::atoi(argv[4]) : X_SEGMENTS;
+        return bench(passes > 0 ? passes : 5, y_segments, x_segments);
+    }
+    if (mode == "ring")
+    {
+        int rounds = argc > 2 ? std::atoi(argv[2]) : 200;
+        int x_segments = argc > 3 ? std::atoi(argv[3]) : X_SEGMENTS;
+        return ring_bench(rounds > 0 ? rounds : 200, x_segments);
+    }
+    if (mode == "lod")
+    {
+        int y_segments = argc > 2 ? std::atoi(argv[2]) : Y_SEGMENTS;
+        return lod_bench(y_segments);
+    }
+    if (mode == "profile")
+    {
+        int cuts = argc > 2 ? std::atoi(argv[2]) : 20000;
+        return profile_bench(cuts > 0 ? cuts : 20000);
+    }
+    if (mode == "field")
+    {
+        int theta_segments = argc > 2 ? std::atoi(argv[2]) : FIELD_THETA_SEGMENTS;
+        return field_bench(theta_segments);
+    }
+    if (mode == "motion")
+    {
+        return motion_bench();
+    }
+    if (mode == "sim")
+    {
+        double seconds = argc > 2 ? std::atof(argv[2]) : 2.0;
+        return simulation_bench(seconds > 0.0 ? seconds : 2.0);
+    }
+    if (mode == "tool")
+    {
+        int y_segments = argc > 2 ? std::atoi(argv[2]) : 800;
+        return tool_bench(y_segments);
+    }
+    if (mode == "gcode")
+    {
+        std::string arg = argc > 2 ? argv[2] : "";
+        int moves = std::atoi(arg.c_str());
+        if (moves > 0 || arg.empty())
+        {
+            return gcode_bench("", moves > 0 ? moves : 200000);
+        }
+        return gcode_bench(arg, 0);
+    }
+    if (mode == "journal")
+    {
+        double seconds = argc > 2 ? std::atof(argv[2]) : 3.0;
+        return journal_bench(seconds > 0.0 ? seconds : 3.0);
+    }
+    if (mode == "replay" && argc > 2)
+    {
+        return replay(argv[2]);
+    }
+    if (mode == "undo")
+    {
+        int strokes = argc > 2 ? std::atoi(argv[2]) : 300;
+        return undo_bench(strokes > 0 ? strokes : 300);
+    }
+    if (mode == "plan")
+    {
+        int bins = argc > 2 ? std::atoi(argv[2]) : Y_SEGMENTS;
+        return plan_bench(bins >= MIN_Y_SEGMENTS ? bins : Y_SEGMENTS);
+    }
+    if (mode == "measure")
+    {
+        int cuts = argc > 2 ? std::atoi(argv[2]) : 5000;
+        return metrology_bench(cuts > 0 ? cuts : 5000);
+    }
+    if (mode == "telemetry")
+    {
+        double seconds = argc > 2 ? std::atof(argv[2]) : 2.0;
+        return telemetry_bench(seconds > 0.0 ? seconds : 2.0);
+    }
+    if (mode == "collision")
+    {
+        int moves = argc > 2 ? std::atoi(argv[2]) : 100000;
+        return collision_bench(moves > 0 ? moves : 100000);
+    }
+    if (mode == "bezier")
+    {
+        int curves = argc > 2 ? std::atoi(argv[2]) : 2000;
+        return bezier_bench(curves > 0 ? curves : 2000);
+    }
+    if (mode == "spline")
+    {
+        int points = argc > 2 ? std::atoi(argv[2]) : 100;
+        return spline_bench(points >= 2 ? points : 100);
+    }
+    if (mode == "drawing")
+    {
+        int kilobytes = argc > 2 ? std::atoi(argv[2]) : 4096;
+        return drawing_bench(kilobytes > 0 ? kilobytes : 4096);
+    }
+    if (mode == "mesh")
+    {
+        int triangles = argc > 2 ? std::atoi(argv[2]) : 2000000;
+        return mesh_bench(triangles > 0 ? triangles : 2000000);
+    }
+    if (mode == "deviation")
+    {
+        int cuts = argc > 2 ? std::atoi(argv[2]) : 5000;
+        return deviation_bench(cuts > 0 ? cuts : 5000);
+    }
+    print_usage();
+    return 1;
+}
+
+void print_usage()
+{
+    std::cout << "usage:" << std::endl
+        << "  lathe_headless bench [passes] [y_segments] [x_segments]" << std::endl
+        << "  lathe_headless ring [rounds] [x_segments]" << std::endl
+        << "  lathe_headless lod [y_segments]" << std::endl
+        << "  lathe_headless profile [cuts]" << std::endl
+        << "  lathe_headless field [theta_segments]" << std::endl
+        << "  lathe_headless motion" << std::endl
+        << "  lathe_headless sim [seconds]" << std::endl
+        << "  lathe_headless tool [y_segments]" << std::endl
+        << "  lathe_headless gcode [moves | file.nc]" << std::endl
+        << "  lathe_headless journal [seconds]" << std::endl
+        << "  lathe_headless replay file.jnl" << std::endl
+        << "  lathe_headless undo [strokes]" << std::endl
+        << "  lathe_headless plan [bins]" << std::endl
+        << "  lathe_headless measure [cuts]" << std::endl
+        << "  lathe_headless telemetry [seconds]" << std::endl
+        << "  lathe_headless collision [moves]" << std::endl
+        << "  lathe_headless bezier [curves]" << std::endl
+        << "  lathe_headless spline [points]" << std::endl
+        << "  lathe_headless drawing [kilobytes]" << std::endl
+        << "  lathe_headless mesh [triangles]" << std::endl
+        << "  lathe_headless deviation [cuts]" << std::endl;
+}
+
+// sweep the knife across the whole bar `passes` times, one step deeper each pass,
+// remeshing after every cut exactly like the interactive processInput() does
+int bench(int passes, int y_segments, int x_segments)
+{
+    Workpiece workpiece(y_segments, x_segments);
+    Cutter cutter;
+    std::cout << "resolution: " << workpiece.y_segments << " x " << workpiece.x_segments << std::endl;
+
+    Clock::time_point start = Clock::now();
+    workpiece.update_mesh();
+    size_t vertex_bytes = workpiece.all_data.size() * sizeof(PackedVertex);
+    size_t index_bytes = workpiece.indices.size() * sizeof(unsigned int);
+    //展开成每个面六个点的旧格式、未压缩的float点阵需要的字节数，用来对比
+    size_t soup_bytes = (size_t)workpiece.index_count() * VERTEX_FLOATS * sizeof(float);
+    size_t float_bytes = workpiece.all_data.size() * VERTEX_FLOATS * sizeof(float);
+    std::cout << "initial mesh: " << elapsed_ms(start) << " ms, "
+        << vertex_bytes << " vertex bytes + " << index_bytes << " index bytes"
+        << " (float vertices: " << float_bytes << " bytes, 6-vertices-per-quad soup: " << soup_bytes << " bytes)" << std::endl;
+
+    workpiece.clear_upload();
+    workpiece.clear_profile();
+
+    int cuts = 0;
+    size_t upload_bytes = 0;
+    size_t profile_bytes = 0;
+    double cut_ms = 0.0;
+    double mesh_ms = 0.0;
+    float removed = 0.0f;
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            cutter.move_down();
+        }
+        //偶数趟向左走刀，奇数趟向右走刀
+        bool leftward = pass % 2 == 0;
+        while (leftward ? cutter.knife_pos.x < 2.0f : cutter.knife_pos.x > -2.0f)
+        {
+            Clock::time_point t0 = Clock::now();
+            float mount = leftward ? cutter.move_left(workpiece) : cutter.move_right(workpiece);
+            cut_ms += elapsed_ms(t0);
+            if (mount > 0.0f)
+            {
+                t0 = Clock::now();
+                workpiece.update_mesh();
+                mesh_ms += elapsed_ms(t0);
+                //渲染循环里每帧要上传到显存的字节数
+                size_t offset, size;
+                if (workpiece.pending_upload(offset, size))
+                {
+                    upload_bytes += size;
+                    workpiece.clear_upload();
+                }
+                //procedural模式只需要上传改动的半径
+                int first, count;
+                if (workpiece.pending_profile(first, count))
+                {
+                    profile_bytes += count * sizeof(float);
+                    workpiece.clear_profile();
+                }
+                removed += mount;
+                cuts++;
+            }
+        }
+    }
+
+    std::cout << "passes: " << passes << ", cuts: " << cuts << ", removed radius sum: " << removed << std::endl;
+    std::cout << "cut: " << cut_ms << " ms total" << std::endl;
+    std::cout << "remesh: " << mesh_ms << " ms total, "
+        << (cuts > 0 ? mesh_ms / cuts : 0.0) << " ms per cut" << std::endl;
+    std::cout << "upload: " << upload_bytes << " bytes total, "
+        << (cuts > 0 ? upload_bytes / cuts : 0) << " bytes per cut" << std::endl;
+    std::cout << "profile knots: " << workpiece.profile.knot_count() << " (" << workpiece.y_segments << " segments)" << std::endl;
+    std::cout << "procedural upload: " << profile_bytes << " bytes total, "
+        << (cuts > 0 ? profile_bytes / cuts : 0) << " bytes per cut" << std::endl;
+
+    //增量重建的结果必须和从头重建一致
+    Workpiece reference(workpiece.y_segments, workpiece.x_segments);
+    reference.radius = workpiece.radius;
+    reference.mark_dirty(0, reference.y_segments);
+    reference.update_mesh();
+    bool same = std::memcmp(&reference.all_data[0], &workpiece.all_data[0], workpiece.all_data.size() * sizeof(PackedVertex)) == 0;
+    std::cout << "incremental mesh matches full rebuild: " << (same ? "yes" : "NO") << std::endl;
+    return same ? 0 : 1;
+}
+
+// regenerate every ring of a cut-looking profile `rounds` times with each ring generator path
+int ring_bench(int rounds, int x_segments)
+{
+    Workpiece workpiece(Y_SEGMENTS, x_segments);
+    const int rows = workpiece.y_segments + 1;
+    const int row = workpiece.x_segments + 1;
+    //一个有台阶和斜面的半径集合，法向量四个象限都会出现
+    for (int y = 0; y < workpiece.y_segments; y++)
+    {
+        workpiece.radius[y] = 0.6f + 0.3f * std::sin(y * 0.05f) + (y % 40 < 20 ? 0.05f : 0.0f);
+    }
+    //每个ring的参数和update_ring()一样
+    std::vector<float> rs(rows), ks(rows), nys(rows);
+    for (int y = 0; y < rows; y++)
+    {
+        uint8_t state;
+        workpiece.ring_params(y, rs[y], ks[y], nys[y], state);
+    }
+
+    const RingGenerator& generator = workpiece.ring_generator;
+    std::vector<PackedVertex> scalar_out(workpiece.all_data.size());
+    std::vector<PackedVertex> simd_out(workpiece.all_data.size());
+    long long vertices = (long long)rounds * rows * row;
+
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int y = 0; y < rows; y++)
+        {
+            generator.generate_scalar(rs[y], (int16_t)y, ks[y], nys[y], 0, &scalar_out[y * row]);
+        }
+    }
+    double scalar_ms = elapsed_ms(start);
+    std::cout << "scalar: " << scalar_ms << " ms, " << vertices / scalar_ms * 1000.0 << " vertices/s" << std::endl;
+
+#ifdef LATHE_SSE2
+    start = Clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int y = 0; y < rows; y++)
+        {
+            generator.generate_sse(rs[y], (int16_t)y, ks[y], nys[y], 0, &simd_out[y * row]);
+        }
+    }
+    double simd_ms = elapsed_ms(start);
+    std::cout << "sse2:   " << simd_ms << " ms, " << vertices / simd_ms * 1000.0 << " vertices/s"
+        << " (" << scalar_ms / simd_ms << "x)" << std::endl;
+    bool same = std::memcmp(&scalar_out[0], &simd_out[0], scalar_out.size() * sizeof(PackedVertex)) == 0;
+    std::cout << "sse2 output matches scalar: " << (same ? "yes" : "NO") << std::endl;
+    return same ? 0 : 1;
+#else
+    std::cout << "sse2: not available in this build" << std::endl;
+    return 0;
+#endif
+}
+
+// draw-side cost of the axial LOD on a turned profile: long straight stretches, a taper, a few grooves
+int lod_bench(int y_segments)
+{
+    Workpiece workpiece(y_segments, X_SEGMENTS);
+    const int segments = workpiece.y_segments;
+    for (int y = 0; y < segments; y++)
+    {
+        float x = (float)y / segments;
+        float r = x < 0.3f ? 0.8f : (x < 0.6f ? 0.8f - (x - 0.3f) * 0.5f : 0.65f);
+        if (std::fmod(x, 0.2f) < 0.01f)
+        {
+            r -= 0.1f;
+        }
+        workpiece.radius[y] = r;
+    }
+    workpiece.mark_dirty(0, segments);
+    workpiece.update_mesh();
+    size_t full_indices = workpiece.indices.size();
+    std::cout << "resolution: " << segments << " x " << workpiece.x_segments
+        << ", full: " << workpiece.lod_rings.size() << " rings, " << full_indices / 3 << " triangles" << std::endl;
+
+    workpiece.set_lod_enabled(true);
+    bool ok = true;
+    int focuses[] = { 0, segments / 4, segments / 2, segments - 1 };
+    for (int f = 0; f < 4; f++)
+    {
+        Clock::time_point start = Clock::now();
+        workpiece.update_lod(focuses[f]);
+        double ms = elapsed_ms(start);
+        //跳过的ring到所在段两端连线的最大误差，刀具附近必须是全分辨率
+        float max_error = 0.0f;
+        const std::vector<int>& rings = workpiece.lod_rings;
+        for (size_t n = 0; n + 1 < rings.size(); n++)
+        {
+            int a = rings[n], b = rings[n + 1];
+            for (int m = a + 1; m < b; m++)
+            {
+                float line = workpiece.radius[a] + (workpiece.radius[b] - workpiece.radius[a]) * (m - a) / (float)(b - a);
+                max_error = std::max(max_error, std::fabs(workpiece.radius[m] - line));
+                if (std::abs(m - focuses[f]) < workpiece.lod_window)
+                {
+                    ok = false;
+                }
+            }
+        }
+        //每段都连接两个完整的ring，index数必须正好是段数 * x_segments * 6
+        ok = ok && rings.front() == 0 && rings.back() == segments
+            && workpiece.indices.size() == (rings.size() - 1) * workpiece.x_segments * 6;
+        ok = ok && max_error <= workpiece.lod_tolerance;
+        std::cout << "focus " << focuses[f] << ": " << rings.size() << " rings, " << workpiece.indices.size() / 3 << " triangles ("
+            << 100.0 * workpiece.indices.size() / full_indices << "%), max radius error " << max_error
+            << ", selection " << ms << " ms" << std::endl;
+    }
+    //刀具走一趟：只有跨过块边界时才重建、重新上传indices
+    int rebuilds = 0;
+    size_t index_bytes = 0;
+    workpiece.indices_dirty = false;
+    for (int focus = 0; focus < segments; focus++)
+    {
+        workpiece.update_lod(focus);
+        if (workpiece.indices_dirty)
+        {
+            rebuilds++;
+            index_bytes += workpiece.indices.size() * sizeof(unsigned int);
+            workpiece.indices_dirty = false;
+        }
+    }
+    std::cout << "knife sweep over " << segments << " segments: " << rebuilds << " index rebuilds, "
+        << index_bytes / segments << " index bytes per step" << std::endl;
+    std::cout << "lod checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// random flat-bottomed cuts at arbitrary axial positions: the profile must match a brute-force
+// "min over all cuts covering u" everywhere, and a sub-micron groove must survive
+int profile_bench(int cuts)
+{
+    Profile profile(1.0f);
+    std::vector<double> cut_u0(cuts), cut_u1(cuts);
+    std::vector<float> cut_depth(cuts);
+    srand(7);
+    for (int i = 0; i < cuts; i++)
+    {
+        double u = (double)rand() / RAND_MAX;
+        double width = (double)rand() / RAND_MAX * 0.02;
+        cut_u0[i] = u;
+        cut_u1[i] = u + width;
+        cut_depth[i] = 0.3f + 0.7f * (float)rand() / RAND_MAX;
+    }
+
+    Clock::time_point start = Clock::now();
+    size_t max_knots = 0;
+    for (int i = 0; i < cuts; i++)
+    {
+        profile.cut(cut_u0[i], cut_u1[i], cut_depth[i]);
+        max_knots = std::max(max_knots, profile.knot_count());
+    }
+    double cut_ms = elapsed_ms(start);
+
+    const int samples = 100000;
+    start = Clock::now();
+    float checksum = 0.0f;
+    for (int i = 0; i < samples; i++)
+    {
+        checksum += profile.radius_at((double)i / samples);
+    }
+    double query_ms = elapsed_ms(start);
+
+    float max_error = 0.0f;
+    for (int i = 0; i < 20000; i++)
+    {
+        double u = (double)rand() / RAND_MAX;
+        float expect = 1.0f;
+        for (int c = 0; c < cuts; c++)
+        {
+            if (u >= cut_u0[c] && u < cut_u1[c])
+            {
+                expect = std::min(expect, cut_depth[c]);
+            }
+        }
+        max_error = std::max(max_error, std::fabs(profile.radius_at(u) - expect));
+    }
+    std::cout << cuts << " cuts: " << cut_ms * 1000.0 / cuts << " us per cut, "
+        << query_ms * 1000.0 / samples << " us per query, " << profile.knot_count() << " knots (max " << max_knots << ")" << std::endl;
+    std::cout << "max error vs brute force: " << max_error << " (checksum " << checksum << ")" << std::endl;
+
+    //0.1微米宽的槽（按工件全长400mm算，u上是2.5e-7），分段数再高也表示不出来
+    Profile fine(1.0f);
+    double groove = 0.123456789;
+    fine.cut(groove, groove + 2.5e-7, 0.5f);
+    bool fine_ok = fine.radius_at(groove + 1.25e-7) == 0.5f && fine.radius_at(groove - 1e-9) == 1.0f
+        && fine.radius_at(groove + 2.6e-7) == 1.0f && fine.knot_count() == 4;
+    //一段一段把整根切平，合并之后只剩首尾两个折点
+    Profile flat(1.0f);
+    for (int i = 0; i < 4000; i++)
+    {
+        flat.cut(i / 4000.0, (i + 1) / 4000.0, 0.8f);
+    }
+    fine_ok = fine_ok && flat.knot_count() == 2;
+    std::cout << "sub-micron groove: " << fine.knot_count() << " knots, 4000 adjacent cuts: " << flat.knot_count() << " knots" << std::endl;
+
+    //沿着一条曲线一小段一小段斜着切：每次合并只差一点点，合并掉的折点累积起来也不能超过merge_tolerance
+    //（float插值本身有1e-7左右的舍入，给一倍的余量）
+    Profile drift(1.0f);
+    const int strokes = std::max(cuts, 20000) * 5;
+    auto curve = [](double u) { return (float)(0.8 + 0.05 * std::sin(PI * u)); };
+    start = Clock::now();
+    for (int i = 0; i < strokes; i++)
+    {
+        drift.cut((double)i / strokes, (double)(i + 1) / strokes, curve((double)i / strokes), curve((double)(i + 1) / strokes));
+    }
+    double drift_ms = elapsed_ms(start);
+    float drift_error = 0.0f;
+    for (int i = 0; i < 20000; i++)
+    {
+        double u = (double)rand() / RAND_MAX;
+        int k = std::min(strokes - 1, (int)(u * strokes));
+        double t = u * strokes - k;
+        float expect = (float)(curve((double)k / strokes) + (curve((double)(k + 1) / strokes) - curve((double)k / strokes)) * t);
+        drift_error = std::max(drift_error, std::fabs(drift.radius_at(u) - expect));
+    }
+    bool drift_ok = drift_error <= 2.0f * drift.merge_tolerance;
+    std::cout << strokes << " sloped cuts along a sine: " << drift_ms * 1000.0 / strokes << " us per cut, " << drift.knot_count()
+        << " knots, max error " << drift_error << " (tolerance " << drift.merge_tolerance << ") " << (drift_ok ? "ok" : "FAILED") << std::endl;
+
+    bool ok = max_error <= 1e-6f && fine_ok && drift_ok;
+    std::cout << "profile checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// 2D mode at 60 frames/s with the GUI's spindle speed (5 rad/s): the knife feeds one segment per frame,
+// so what is left is a helical feed mark; then a dwell, a keyway, and switching the field off again
+int field_bench(int theta_segments)
+{
+    Workpiece workpiece(Y_SEGMENTS, X_SEGMENTS);
+    Cutter cutter;
+    workpiece.set_field_enabled(true, theta_segments);
+    workpiece.update_mesh();
+    workpiece.clear_upload();
+    workpiece.field.clear_dirty();
+    const RadiusField& field = workpiece.field;
+    size_t texture_bytes = field.data.size() * sizeof(float);
+    std::cout << "field: " << field.y_segments << " x " << field.theta_segments << ", "
+        << field.tiles_y * field.tiles_theta << " tiles, " << texture_bytes << " texture bytes" << std::endl;
+
+    const double frame = 1.0 / 60.0;
+    const double spindle_speed = 5.0;
+    double angle = PI;
+    int frames = 0;
+    double frame_ms = 0.0;
+    size_t tile_bytes = 0;
+    size_t ring_bytes = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        cutter.move_down();
+    }
+    while (cutter.knife_pos.x < 2.0f)
+    {
+        Clock::time_point t0 = Clock::now();
+        double from = cutter.knife_axial();
+        cutter.move_left(workpiece);
+        cutter.spindle_cut(workpiece, from, angle, angle + spindle_speed * frame);
+        workpiece.update_mesh();
+        frame_ms += elapsed_ms(t0);
+        angle += spindle_speed * frame;
+        size_t offset, size;
+        if (workpiece.pending_upload(offset, size))
+        {
+            ring_bytes += size;
+            workpiece.clear_upload();
+        }
+        tile_bytes += field.dirty_tiles.size() * FIELD_TILE * FIELD_TILE * sizeof(float);
+        workpiece.field.clear_dirty();
+        frames++;
+    }
+    std::cout << "feed pass: " << frames << " frames, " << frame_ms / frames << " ms cut+remesh per frame, "
+        << tile_bytes / frames << " tile bytes per frame (procedural), " << ring_bytes / frames << " vertex bytes per frame" << std::endl;
+
+    //刀不动，主轴转一整圈：这一个segment整圈都切到
+    cutter.knife_pos.x = 0.0f;
+    int seg = cutter.knife_segment(workpiece);
+    float depth = cutter.knife_distance - 0.1f;
+    cutter.knife_distance = depth;
+    for (int i = 0; i < 80; i++)
+    {
+        cutter.spindle_cut(workpiece, cutter.knife_axial(), angle, angle + spindle_speed * frame);
+        angle += spindle_speed * frame;
+    }
+    bool ok = true;
+    for (int t = 0; t < field.theta_segments; t++)
+    {
+        ok = ok && field.at(seg, t) == depth && field.at(seg + 1, t) > depth;
+    }
+    std::cout << "dwell for one revolution: " << (ok ? "ok" : "FAILED") << std::endl;
+
+    //键槽：主轴不转，只切0~0.3弧度
+    bool keyway_ok = true;
+    workpiece.cut_field(0.8, 0.9, 0.0, 0.3, 0.5f);
+    int row = (int)(0.85 * workpiece.y_segments);
+    keyway_ok = field.at(row, 0) == 0.5f && field.at(row, (int)(0.3 / (2.0 * PI) * field.theta_segments)) == 0.5f
+        && field.at(row, field.theta_segments / 2) > 0.5f;
+    std::cout << "keyway: " << (keyway_ok ? "ok" : "FAILED") << std::endl;
+
+    //增量重建和整体重建一致
+    workpiece.update_mesh();
+    std::vector<PackedVertex> incremental = workpiece.all_data;
+    workpiece.mark_dirty(0, workpiece.y_segments);
+    workpiece.update_mesh();
+    bool mesh_ok = std::memcmp(&incremental[0], &workpiece.all_data[0], incremental.size() * sizeof(PackedVertex)) == 0;
+    std::cout << "incremental mesh matches full rebuild: " << (mesh_ok ? "yes" : "NO") << std::endl;
+
+    //退出二维模式：整圈切过的segment进入profile，键槽不算
+    workpiece.set_field_enabled(false);
+    bool envelope_ok = workpiece.x_segments == X_SEGMENTS
+        && std::fabs(workpiece.profile.radius_at((seg + 0.5) / workpiece.y_segments) - depth) < 1e-6f
+        && workpiece.profile.radius_at(0.85) > 0.5f;
+    std::cout << "1D envelope after switching off: " << (envelope_ok ? "ok" : "FAILED") << std::endl;
+
+    ok = ok && keyway_ok && mesh_ok && envelope_ok;
+    return ok ? 0 : 1;
+}
+
+// one held key combination of the scripted input: from time `start` on (seconds)
+struct MotionInput
+{
+    double start;
+    int axial_dir;
+    int radial_dir;
+    float feed_scale;
+};
+
+// play the input script frame by frame at `fps` the way the GUI loop does (advance, then read the input)
+// and return the time spent cutting
+double motion_run(Workpiece& workpiece, Cutter& cutter, const std::vector<MotionInput>& script, double end, int fps)
+{
+    Clock::time_point t0 = Clock::now();
+    size_t next = 0;
+    for (long long frame = 0; ; frame++)
+    {
+        double now = (double)frame / fps;
+        cutter.advance(workpiece, now);
+        workpiece.update_mesh();
+        if (now >= end)
+        {
+            break;
+        }
+        while (next < script.size() && script[next].start <= now)
+        {
+            cutter.axial_dir = script[next].axial_dir;
+            cutter.radial_dir = script[next].radial_dir;
+            cutter.feed_scale = script[next].feed_scale;
+            next++;
+        }
+    }
+    return elapsed_ms(t0);
+}
+
+// largest difference between the 2D field and a straight cut from (u0, d0) to (u1, d1) (u0 < u1, d0 < d1):
+// every row under the line must be at the line's value where the row starts (its lowest point inside the row)
+float field_taper_error(const Workpiece& workpiece, double u0, float d0, double u1, float d1)
+{
+    const RadiusField& field = workpiece.field;
+    int first = (int)std::floor(u0 * field.y_segments);
+    int last = (int)std::ceil(u1 * field.y_segments) - 1;
+    float error = 0.0f;
+    for (int y = first; y <= last; y++)
+    {
+        double a = std::max(u0, (double)y / field.y_segments);
+        float line = (float)(d0 + (d1 - d0) * (a - u0) / (u1 - u0));
+        float expected = std::min(1.0f, line);
+        for (int t = 0; t < field.theta_segments; t++)
+        {
+            error = std::max(error, std::fabs(field.at(y, t) - expected));
+        }
+    }
+    return error;
+}
+
+// the same key presses (plunge, feed, a taper with both keys held, a fine pass, a retracting taper)
+// played at several frame rates: the knife follows the fixed 1 kHz motion clock, so every part must be identical,
+// in the 1D profile, in 2D mode with the spindle turning, and with a turning tool instead of the point
+int motion_bench()
+{
+    std::vector<MotionInput> script;
+    script.push_back(MotionInput{ 0.0, 0, -1, 1.0f });
+    script.push_back(MotionInput{ 0.5, 1, 0, 1.0f });
+    script.push_back(MotionInput{ 3.0, -1, -1, 1.0f });
+    script.push_back(MotionInput{ 3.5, -1, 0, 1.0f / 16.0f });
+    script.push_back(MotionInput{ 5.0, 1, 1, 1.0f });
+    const double end = 6.0;
+    const int rates[] = { 30, 60, 144, 240 };
+    const int rate_count = sizeof(rates) / sizeof(rates[0]);
+
+    bool ok = true;
+    const char* labels[] = { "1D  ", "2D  ", "1D turning tool  " };
+    for (int pass = 0; pass < 3; pass++)
+    {
+        bool field_mode = pass == 1;
+        Profile reference;
+        std::vector<float> reference_field;
+        for (int i = 0; i < rate_count; i++)
+        {
+            Workpiece workpiece(Y_SEGMENTS, X_SEGMENTS);
+            Cutter cutter;
+            cutter.spindle_speed = 5.0;
+            cutter.spindle_phase = PI;
+            cutter.tool = pass == 2 ? 1 : 0;
+            if (field_mode)
+            {
+                workpiece.set_field_enabled(true);
+            }
+            double ms = motion_run(workpiece, cutter, script, end, rates[i]);
+            bool same = true;
+            if (i == 0)
+            {
+                reference = workpiece.profile;
+                reference_field = workpiece.field.data;
+            }
+            else
+            {
+                same = workpiece.profile.knots.size() == reference.knots.size()
+                    && workpiece.field.data == reference_field;
+                Profile::KnotMap::const_iterator a = workpiece.profile.knots.begin();
+                Profile::KnotMap::const_iterator b = reference.knots.begin();
+                for (; same && a != workpiece.profile.knots.end(); ++a, ++b)
+                {
+                    same = a->first == b->first && a->second.left == b->second.left && a->second.right == b->second.right;
+                }
+            }
+            ok = ok && same;
+            std::cout << labels[pass] << rates[i] << " fps: " << cutter.motion_tick << " ticks, "
+                << ms << " ms, " << workpiece.profile.knot_count() << " knots, knife at ("
+                << cutter.knife_pos.x << ", " << cutter.knife_distance << ")"
+                << (i == 0 ? "" : (same ? ", identical" : ", DIFFERENT")) << std::endl;
+        }
+        if (pass == 0)
+        {
+            //两个键一起按的那半秒是一条斜线：刀尖从x=-0.5、半径0.7走到x=-0.8、半径0.4，中点半径0.55
+            float r = reference.radius_at((-0.65 + 2.0) / 4.0);
+            bool taper_ok = std::fabs(r - 0.55f) < 1e-3f;
+            std::cout << "taper: " << (taper_ok ? "ok" : "FAILED") << " (" << r << ")" << std::endl;
+            ok = ok && taper_ok;
+        }
+    }
+    //二维模式下的斜线：每一行都要切到斜线在这一行里的最低点，而不是整段都切到较深的一端；
+    //一次切完（G-code全速模式）和一个tick里主轴转满一圈的cut_move()各试一次
+    for (int pass = 0; pass < 2; pass++)
+    {
+        Workpiece workpiece(400, 64);
+        workpiece.set_field_enabled(true);
+        Cutter cutter;
+        if (pass == 0)
+        {
+            cutter.cut_sweep(workpiece, 0.9, 1.0f, 0.1, 0.2f);
+        }
+        else
+        {
+            cutter.spindle_speed = 2.0 * PI * MOTION_TICK_RATE;
+            cutter.set_position(0.1, 0.2f);
+            cutter.cut_move(workpiece, 0, 0.9, 1.0f);
+        }
+        float error = field_taper_error(workpiece, 0.1, 0.2f, 0.9, 1.0f);
+        bool taper_ok = error < 1e-4f;
+        std::cout << (pass == 0 ? "2D taper sweep: " : "2D taper tick: ") << (taper_ok ? "ok" : "FAILED")
+            << " (" << error << ")" << std::endl;
+        ok = ok && taper_ok;
+    }
+    std::cout << "motion checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// the simulation thread cuts at 1 kHz while this thread plays the renderer: sync + remesh at 60 frames/s,
+// with a 50 ms stall every second frame-second; halfway the resolution changes and later the 2D field is switched on.
+// the simulation has to keep its tick rate whatever the renderer does, and after stopping the synced copy must match
+int simulation_bench(double seconds)
+{
+    Simulation simulation;
+    Workpiece view;
+    simulation.cutter.spindle_speed = 5.0;
+    simulation.radial_dir = -1;
+    simulation.start();
+    Clock::time_point start = Clock::now();
+    int frames = 0;
+    int relayouts = 0;
+    long long max_behind = 0;
+    double sync_ms = 0.0;
+    bool resized = false;
+    bool field = false;
+    for (;;)
+    {
+        double t = elapsed_ms(start) / 1000.0;
+        if (t >= seconds)
+        {
+            break;
+        }
+        //输入：先进刀0.3秒，再往+x走刀，到头了往回走
+        if (t > 0.3)
+        {
+            simulation.radial_dir = 0;
+            simulation.axial_dir = (int)(t / 1.5) % 2 == 0 ? 1 : -1;
+        }
+        if (!resized && t > seconds * 0.4)
+        {
+            simulation.post([](Simulation& sim) { sim.workpiece.set_resolution(800, X_SEGMENTS); });
+            resized = true;
+        }
+        if (!field && t > seconds * 0.7)
+        {
+            simulation.post([](Simulation& sim) { sim.workpiece.set_field_enabled(true); });
+            field = true;
+        }
+        Clock::time_point t0 = Clock::now();
+        bool relayout = false;
+        if (simulation.sync(view, relayout))
+        {
+            view.update_mesh();
+            view.clear_upload();
+            view.clear_profile();
+            view.field.clear_dirty();
+        }
+        sync_ms += elapsed_ms(t0);
+        relayouts += relayout ? 1 : 0;
+        max_behind = std::max(max_behind, simulation.ticks_behind());
+        frames++;
+        //渲染：一帧16ms，每60帧卡一次50ms
+        std::this_thread::sleep_for(std::chrono::milliseconds(frames % 60 == 0 ? 50 : 16));
+    }
+    simulation.stop();
+    double elapsed = elapsed_ms(start) / 1000.0;
+    long long ticks = simulation.cutter.motion_tick;
+    simulation.publish();
+    bool relayout = false;
+    simulation.sync(view, relayout);
+    view.update_mesh();
+
+    std::cout << "simulation: " << ticks << " ticks in " << elapsed << " s (" << ticks / elapsed << " ticks/s), "
+        << "largest catch-up " << max_behind << " ticks" << std::endl;
+    std::cout << "renderer: " << frames << " frames, " << sync_ms / frames << " ms sync+remesh per frame, "
+        << relayouts << " buffer reallocations, " << simulation.frame().particles.size() << " particles in the last frame" << std::endl;
+
+    bool rate_ok = ticks >= (long long)(elapsed * MOTION_TICK_RATE * 0.95);
+    bool copy_ok = view.y_segments == simulation.workpiece.y_segments && view.x_segments == simulation.workpiece.x_segments
+        && view.radius == simulation.workpiece.radius && view.field_enabled && view.field.data == simulation.workpiece.field.data;
+    std::vector<PackedVertex> incremental = view.all_data;
+    view.mark_dirty(0, view.y_segments);
+    view.update_mesh();
+    bool mesh_ok = std::memcmp(&incremental[0], &view.all_data[0], incremental.size() * sizeof(PackedVertex)) == 0;
+    std::cout << "tick rate kept: " << (rate_ok ? "yes" : "NO") << std::endl;
+    std::cout << "synced copy matches the simulation: " << (copy_ok ? "yes" : "NO") << std::endl;
+    std::cout << "incremental mesh matches full rebuild: " << (mesh_ok ? "yes" : "NO") << std::endl;
+    return rate_ok && copy_ok && mesh_ok ? 0 : 1;
+}
+
+// every tool of the library cut at pseudo random places and depths:
+// the profile is compared point by point against min(samples, envelope), and the 2D field cut (SSE2)
+// against the scalar row loop; at 800 segments the form tool is 200 segments wide
+int tool_bench(int y_segments)
+{
+    const std::vector<Tool>& tools = tool_library();
+    const int cuts = 2000;
+    const int samples = 20000;
+    bool ok = true;
+    for (size_t k = 1; k < tools.size(); k++)
+    {
+        const Tool& tool = tools[k];
+        Workpiece workpiece(y_segments, X_SEGMENTS);
+        std::vector<float> expected(samples, 1.0f);
+        Profile::KnotList envelope;
+        unsigned seed = 12345;
+        auto next_random = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 8) / 16777216.0; };
+        double cut_us = 0.0;
+        double width = 0.0;
+        for (int i = 0; i < cuts; i++)
+        {
+            double u = next_random();
+            float distance = (float)(0.5 + 0.5 * next_random());
+            tool.envelope(u, distance, envelope);
+            width = (envelope.back().first - envelope.front().first) * y_segments;
+            Clock::time_point t0 = Clock::now();
+            workpiece.cut_envelope(envelope);
+            cut_us += elapsed_ms(t0) * 1000.0;
+            //逐点暴力：每个采样点取刀刃在那里的值
+            for (int j = 0; j < samples; j++)
+            {
+                double x = (j + 0.5) / samples;
+                if (x > envelope.front().first && x < envelope.back().first)
+                {
+                    float left, right;
+                    envelope_at(envelope, x, left, right);
+                    expected[j] = std::min(expected[j], std::min(left, right));
+                }
+            }
+        }
+        float max_error = 0.0f;
+        for (int j = 0; j < samples; j++)
+        {
+            max_error = std::max(max_error, std::fabs(workpiece.profile.radius_at((j + 0.5) / samples) - expected[j]));
+        }
+
+        //二维半径场：整圈切，SSE2（cut_rows）和逐个块的标量循环结果一致
+        Workpiece field_piece(y_segments, X_SEGMENTS);
+        field_piece.set_field_enabled(true);
+        RadiusField scalar = field_piece.field;
+        double simd_us = 0.0;
+        double scalar_us = 0.0;
+        std::vector<float> depth;
+        for (int i = 0; i < 200; i++)
+        {
+            double u = next_random();
+            float distance = (float)(0.5 + 0.5 * next_random());
+            tool.envelope(u, distance, envelope);
+            Clock::time_point t0 = Clock::now();
+            field_piece.cut_field_envelope(envelope, 0.0, 2.0 * PI);
+            simd_us += elapsed_ms(t0) * 1000.0;
+            int first = std::max(0, (int)std::floor(envelope.front().first * y_segments));
+            int last = std::min(y_segments - 1, (int)std::ceil(envelope.back().first * y_segments) - 1);
+            depth.resize(std::max(1, last - first + 1));
+            envelope_min_rows(envelope, first, last - first + 1, y_segments, &depth[0]);
+            t0 = Clock::now();
+            for (int y = first; y <= last; y++)
+            {
+                scalar.cut_row_scalar(y, 0, scalar.theta_segments - 1, depth[y - first]);
+            }
+            scalar_us += elapsed_ms(t0) * 1000.0;
+        }
+        bool field_ok = scalar.data == field_piece.field.data;
+        bool tool_ok = max_error <= 1e-5f && field_ok;
+        ok = ok && tool_ok;
+        std::cout << tool.name << ": " << width << " segments wide, " << cut_us / cuts << " us per profile cut, "
+            << workpiece.profile.knot_count() << " knots, max error " << max_error
+            << " | 2D full turn: " << simd_us / 200 << " us (scalar " << scalar_us / 200 << " us)"
+            << (field_ok ? "" : " MISMATCH") << std::endl;
+    }
+    std::cout << "tool checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// the part the generated program turns (radius in mm at z): Ø20 to Z-30, an R5 fillet up to Ø30, Ø30 to Z-80,
+// a 45° chamfer up to Ø40 at Z-85, Ø40 to the end of the program at Z-150
+const int GCODE_TEST_PASSES = 20;
+const double GCODE_TEST_ALLOWANCE = 0.2;
+
+double gcode_part_radius(double z)
+{
+    if (z >= -30.0)
+    {
+        return 10.0;
+    }
+    if (z >= -35.0)
+    {
+        return 15.0 - std::sqrt(std::max(0.0, 25.0 - (z + 30.0) * (z + 30.0)));
+    }
+    if (z >= -80.0)
+    {
+        return 15.0;
+    }
+    if (z >= -85.0)
+    {
+        return 15.0 + (-80.0 - z);
+    }
+    return 20.0;
+}
+
+// how far the last roughing pass of a program of `moves` lines dips below the part at z (mm, radial): its straight
+// steps join points on the part plus the allowance, and where the fillet runs into Ø30 vertically a step that
+// straddles Z-35 cuts the corner by more than the allowance once the steps get longer than about 0.05 mm
+double gcode_roughing_gouge(double z, int moves)
+{
+    const int steps = std::max(1, moves / GCODE_TEST_PASSES);
+    const double step = 150.0 / steps;
+    int i = std::min(steps - 1, std::max(0, (int)std::floor(-z / step)));
+    double z0 = -150.0 * i / steps;
+    double z1 = -150.0 * (i + 1) / steps;
+    double t = (z0 - z) / (z0 - z1);
+    double rough = (1.0 - t) * gcode_part_radius(z0) + t * gcode_part_radius(z1) + GCODE_TEST_ALLOWANCE;
+    return std::max(0.0, gcode_part_radius(z) - rough);
+}
+
+// write a program of about `moves` lines: roughing layers made of short G1 steps (the way CAM output looks)
+// down to the part plus a 0.2 mm allowance, G91 retracts, then a finishing pass with a G2 fillet and a chamfer
+bool gcode_write_test_program(const std::string& path, int moves)
+{
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+    if (!out)
+    {
+        return false;
+    }
+    const int passes = GCODE_TEST_PASSES;
+    const double allowance = GCODE_TEST_ALLOWANCE;
+    const double doc = (GCODE_STOCK_DIAMETER * 0.5 - 10.0 - allowance) / passes;
+    const int steps = std::max(1, moves / passes);
+    char line[128];
+    out << "%\nO1000 (GENERATED ROUGHING TEST)\nG21 G18 G40 G90 G95\nG50 S3000\nG97 S1200 M3\nG0 X52. Z2.\n";
+    for (int k = 1; k <= passes; k++)
+    {
+        double layer = GCODE_STOCK_DIAMETER * 0.5 - k * doc;
+        std::snprintf(line, sizeof(line), "G0 X%.3f Z1.\nG1 Z0. F0.25\n", 2.0 * std::max(layer, gcode_part_radius(0.0) + allowance));
+        out << line;
+        for (int i = 1; i <= steps; i++)
+        {
+            double z = -150.0 * i / steps;
+            std::snprintf(line, sizeof(line), "X%.3f Z%.3f\n", 2.0 * std::max(layer, gcode_part_radius(z) + allowance), z);
+            out << line;
+        }
+        out << "G91 G0 X2.\nG90 Z1.\n";
+    }
+    out << "G0 X20. Z1.\nG1 Z-30. F0.1\nG2 X30. Z-35. R5.\nG1 Z-80.\nX40. Z-85.\nZ-150.\nX52.\nG0 Z2.\nM5\nM30\n%\n";
+    return (bool)out;
+}
+
+// stream a program at full speed and report lines per second; without a file a roughing program is generated,
+// the finished part is checked against its contour, the same program is run at real-time pace tick by tick
+// (the simulation thread's path) and compared, and it is run once more with the turning tool
+int gcode_bench(const std::string& file, int moves)
+{
+    const int y_segments = 800;
+    std::string path = file;
+    if (path.empty())
+    {
+        path = "gcode_bench.nc";
+        if (!gcode_write_test_program(path, moves))
+        {
+            std::cout << "cannot write " << path << std::endl;
+            return 1;
+        }
+    }
+    Workpiece full(y_segments, X_SEGMENTS);
+    Cutter cutter;
+    GcodeProgram program;
+    if (!program.open(path, cutter))
+    {
+        return 1;
+    }
+    GcodeReport r = program.run(full, cutter);
+    std::cout << "full speed, point: ";
+    print_gcode_report(r);
+    std::cout << "  " << full.profile.knot_count() << " knots, " << r.seconds / std::max(1LL, r.moves) * 1e6 << " us per move" << std::endl;
+    if (!file.empty())
+    {
+        return r.errors == 0 ? 0 : 1;
+    }
+    bool ok = r.errors == 0;
+
+    //精车之后的轮廓，误差按法向算（圆弧拆成的弦在陡的地方径向差得多）
+    //粗车步长大了会在R5和Ø30的交角处切过余量，精车补不回来，所以容差加上最后一刀在同一处的过切量
+    double max_error = 0.0;
+    double gouge = 0.0;
+    for (int i = 0; i < 3000; i++)
+    {
+        double z = -150.0 * (i + 0.5) / 3000;
+        double actual = full.profile.radius_at(gcode_axial(z)) * GCODE_STOCK_DIAMETER * 0.5;
+        double slope = (gcode_part_radius(z + 1e-4) - gcode_part_radius(z - 1e-4)) / 2e-4;
+        max_error = std::max(max_error, std::fabs(actual - gcode_part_radius(z)) / std::sqrt(1.0 + slope * slope));
+        gouge = std::max(gouge, gcode_roughing_gouge(z, moves) / std::sqrt(1.0 + slope * slope));
+    }
+    double tolerance = 0.005 + gouge;
+    std::cout << "  contour error: " << max_error << " mm (tolerance " << tolerance << " mm for "
+        << 150.0 / std::max(1, moves / GCODE_TEST_PASSES) << " mm roughing steps)" << std::endl;
+    ok = ok && max_error < tolerance;
+
+    //实时节奏：和模拟线程一样逐tick推进，只是不等墙钟
+    Workpiece paced(y_segments, X_SEGMENTS);
+    Cutter paced_cutter;
+    program.open(path, paced_cutter);
+    long long ticks = 0;
+    Clock::time_point t0 = Clock::now();
+    while (program.active())
+    {
+        program.tick(paced, paced_cutter, ticks++);
+    }
+    double paced_ms = elapsed_ms(t0);
+    float max_diff = 0.0f;
+    for (int i = 0; i < y_segments; i++)
+    {
+        max_diff = std::max(max_diff, std::fabs(paced.radius[i] - full.radius[i]));
+    }
+    std::cout << "real-time pace: " << ticks << " ticks (" << ticks / (double)MOTION_TICK_RATE << " s of machine time), "
+        << paced_ms << " ms, " << paced_ms * 1000.0 / ticks << " us per tick, max difference to full speed " << max_diff << std::endl;
+    ok = ok && max_diff < 1e-5f && std::fabs(ticks / (double)MOTION_TICK_RATE - r.machine_time) < 2.0 / MOTION_TICK_RATE;
+
+    //外圆车刀：刀尖是刀刃的一部分，切掉的不会比刀尖点少
+    Workpiece turned(y_segments, X_SEGMENTS);
+    Cutter turning;
+    turning.tool = 1;
+    program.open(path, turning);
+    GcodeReport rt = program.run(turned, turning);
+    std::cout << "full speed, " << tool_library()[turning.tool].name << ": ";
+    print_gcode_report(rt);
+    for (int i = 0; i < y_segments; i++)
+    {
+        ok = ok && turned.radius[i] <= full.radius[i] + 1e-6f;
+    }
+
+    //G20：F是in/min、in/r，G96的S是ft/min，换算成mm之后和同样的G21程序一样；G4 P是毫秒，G4 X/U是秒
+    const char* metric[] = { "G21 G90 G94 F254.", "G96 S100. M3", "G1 Z-25.4", "G95 F0.254", "G1 Z-50.8", "G4 P500", "G4 X1.5", "G4 U1.5" };
+    const char* inch[] = { "G20 G90 G94 F10.", "G96 S328.084 M3", "G1 Z-1.", "G95 F.01", "G1 Z-2.", "G4 P500", "G4 X1.5", "G4 U1.5" };
+    double times[2], dwells[2];
+    for (int pass = 0; pass < 2; pass++)
+    {
+        GcodeInterpreter interpreter;
+        interpreter.reset(50.8, 0.0);
+        std::vector<GcodeMove> out;
+        for (int i = 0; i < 8; i++)
+        {
+            interpreter.parse_line(pass == 0 ? metric[i] : inch[i], out);
+        }
+        dwells[pass] = 0.0;
+        for (size_t i = 0; i < out.size(); i++)
+        {
+            dwells[pass] += out[i].dwell;
+        }
+        times[pass] = interpreter.machine_time;
+        ok = ok && interpreter.errors == 0;
+    }
+    //25.4mm走254mm/min是6s，再按0.254mm/r、Ø50.8处100m/min的转速走25.4mm，然后停0.5 + 1.5 + 1.5s
+    double expected = 6.0 + 60.0 * 25.4 / (0.254 * 100000.0 / (PI * 50.8)) + 3.5;
+    bool units_ok = std::fabs(times[0] - expected) < 1e-6 && std::fabs(times[1] - expected) < 1e-4
+        && std::fabs(dwells[0] - 3.5) < 1e-9 && std::fabs(dwells[1] - 3.5) < 1e-9;
+    std::cout << "G20/G21 and G4: " << (units_ok ? "ok" : "FAILED") << " (machine time " << times[0] << " s / "
+        << times[1] << " s, expected " << expected << " s)" << std::endl;
+    ok = ok && units_ok;
+    std::remove(path.c_str());
+    std::cout << "gcode checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+void print_replay_report(const ReplayReport& r)
+{
+    std::cout << "replay: " << r.ticks << " ticks (" << r.ticks / (double)MOTION_TICK_RATE << " s recorded), "
+        << r.inputs << " inputs, " << r.commands << " commands, " << r.seconds * 1000.0 << " ms, "
+        << (r.seconds > 0.0 ? r.ticks / (double)MOTION_TICK_RATE / r.seconds : 0.0) << "x real time" << std::endl;
+}
+
+// record a session from the running simulation thread: random arrow keys every few milliseconds (wall clock, so the
+// ticks they land on differ from run to run) plus a tool change, a bezier, a spline, the 2D field on and off, a resolution change,
+// a short real-time G-code program and a planned roughing program; then replay the journal without the thread and compare the parts
+int journal_bench(double seconds)
+{
+    const std::string journal_file = "journal_bench.jnl";
+    const std::string program_file = "journal_bench.nc";
+    const std::string plan_file = "journal_bench_plan.nc";
+    {
+        std::ofstream program(program_file.c_str(), std::ios::out | std::ios::trunc);
+        program << "G21 G90 G94 F600\nG0 X46. Z1.\nG1 Z-40.\nG3 X40. Z-50. R8.\nG1 Z-60.\nG0 X52.\nM30\n";
+    }
+    Simulation simulation;
+    simulation.cutter.spindle_speed = 5.0;
+    simulation.cutter.spindle_phase = PI;
+    if (!simulation.record(journal_file))
+    {
+        return 1;
+    }
+    simulation.start();
+    unsigned seed = 2024;
+    auto next_random = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 8) % 1000; };
+    const char* events[] = { "tool", "bezier", "spline", "field on", "resolution", "field off", "gcode", "plan" };
+    int next_event = 0;
+    Clock::time_point start = Clock::now();
+    while (elapsed_ms(start) < seconds * 1000.0)
+    {
+        simulation.axial_dir = (int)(next_random() % 3) - 1;
+        simulation.radial_dir = next_random() < 400 ? -1 : (next_random() < 500 ? 1 : 0);
+        simulation.feed_scale = next_random() < 200 ? 1.0f / 16.0f : 1.0f;
+        double t = elapsed_ms(start) / (seconds * 1000.0);
+        if (next_event < 8 && t > (next_event + 1) / 9.0)
+        {
+            SimulationCommand command;
+            switch (next_event)
+            {
+            case 0: command.type = COMMAND_TOOL; command.value = -1; break;
+            case 1:
+                command.type = COMMAND_BEZIER;
+                command.points[0] = glm::vec2(-1.0f, 0.9f);
+                command.points[1] = glm::vec2(-0.3f, 0.2f);
+                command.points[2] = glm::vec2(0.3f, 1.2f);
+                command.points[3] = glm::vec2(1.0f, 0.7f);
+                break;
+            case 2:
+                command.type = COMMAND_SPLINE;
+                command.value = -1;
+                for (int k = 0; k < 12; k++)
+                {
+                    command.spline.push_back(glm::vec2(-0.9f + k * 0.16f, 0.5f + 0.3f * (k % 3 == 0 ? 1.0f : -0.2f)));
+                }
+                break;
+            case 3: command.type = COMMAND_FIELD; command.value = 1; break;
+            case 4: command.type = COMMAND_RESOLUTION; command.value = 600; break;
+            case 5: command.type = COMMAND_FIELD; command.value = 0; break;
+            case 6: command.type = COMMAND_GCODE; command.path = program_file; break;
+            default:
+                command.type = COMMAND_PLAN;
+                command.value = PLAN_CONTOUR;
+                command.path = plan_file;
+                command.points[0] = glm::vec2(-0.8f, 0.5f);
+                command.points[1] = glm::vec2(-0.2f, 0.0f);
+                command.points[2] = glm::vec2(0.2f, 0.9f);
+                command.points[3] = glm::vec2(0.8f, 0.4f);
+                break;
+            }
+            simulation.post(command);
+            std::cout << "  " << events[next_event] << " at " << elapsed_ms(start) << " ms" << std::endl;
+            next_event++;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(1000 + next_random() * 7));
+    }
+    simulation.stop();
+    std::ifstream journal(journal_file.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    std::cout << "recorded " << simulation.cutter.motion_tick << " ticks, journal " << journal.tellg() << " bytes" << std::endl;
+    journal.close();
+
+    Simulation replayed;
+    ReplayReport report;
+    bool ok = replayed.replay(journal_file, report);
+    print_replay_report(report);
+    ok = ok && report.ended && report.identical && replayed.workpiece.radius == simulation.workpiece.radius
+        && report.ticks == simulation.cutter.motion_tick;
+    std::cout << "radius[] bit-identical: " << (report.identical ? "yes" : "no") << std::endl;
+    std::remove(journal_file.c_str());
+    std::remove(program_file.c_str());
+    std::remove(plan_file.c_str());
+    std::cout << "journal checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// replay a journal as fast as possible
+int replay(const std::string& path)
+{
+    Simulation simulation;
+    ReplayReport report;
+    if (!simulation.replay(path, report))
+    {
+        std::cout << "cannot replay " << path << std::endl;
+        return 1;
+    }
+    print_replay_report(report);
+    std::cout << "resolution: " << simulation.workpiece.y_segments << " x " << simulation.workpiece.x_segments
+        << ", " << simulation.workpiece.profile.knot_count() << " knots" << std::endl;
+    if (!report.ended)
+    {
+        std::cout << "the journal has no end record (the session did not exit normally), nothing to compare" << std::endl;
+        return 0;
+    }
+    std::cout << "radius[] bit-identical: " << (report.identical ? "yes" : "no") << std::endl;
+    return report.identical ? 0 : 1;
+}
+
+// the state a level is checked against: the exact knots, the segment radii and the 2D field
+struct UndoState
+{
+    Profile::KnotList knots;
+    std::vector<float> radius;
+    std::vector<float> field;
+};
+
+UndoState undo_state(const Workpiece& workpiece)
+{
+    UndoState state;
+    workpiece.profile.copy_knots(0.0, 2.0, state.knots);
+    state.radius = workpiece.radius;
+    if (workpiece.field_enabled)
+    {
+        state.field = workpiece.field.data;
+    }
+    return state;
+}
+
+// same knots and field bit for bit; radius[] is resampled only where something was restored, so it may differ
+// from the radius computed back then by float rounding (returns the largest difference)
+bool undo_same(const Workpiece& workpiece, const UndoState& state, float& radius_error)
+{
+    UndoState now = undo_state(workpiece);
+    bool same = history_same_knots(now.knots, state.knots) && now.field == state.field && now.radius.size() == state.radius.size();
+    for (size_t i = 0; same && i < now.radius.size(); i++)
+    {
+        radius_error = std::max(radius_error, std::fabs(now.radius[i] - state.radius[i]));
+    }
+    return same && radius_error < 1e-5f;
+}
+
+// on a bar with a thousand fine grooves, cut `strokes` random strokes (a checkpoint after each, like letting go of the arrow keys), undo all the way and
+// redo all the way comparing every level with the state stored when it was made, then start a new branch halfway;
+// the same again, shorter, with the 2D radius field cut at random spindle angles
+int undo_bench(int strokes)
+{
+    bool ok = true;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool field = pass == 1;
+        int count = field ? std::max(1, strokes / 5) : strokes;
+        Workpiece workpiece(800, field ? 64 : X_SEGMENTS);
+        if (field)
+        {
+            workpiece.set_field_enabled(true, 64);
+        }
+        for (int j = 0; j < 1000; j++)
+        {
+            workpiece.cut_span(j / 1000.0, j / 1000.0 + 0.0004, 0.98f);//先车出一排细槽，轮廓有几千个折点
+        }
+        workpiece.update_mesh();
+        History history;
+        history.clear(workpiece);
+        std::vector<UndoState> states(1, undo_state(workpiece));
+        unsigned seed = 99;
+        auto next_random = [&seed]() { seed = seed * 1103515245u + 12345u; return ((seed >> 8) % 100000) / 100000.0; };
+        double checkpoint_ms = 0.0;
+        for (int i = 0; i < count; i++)
+        {
+            double u0 = next_random() * 0.95;
+            double u1 = u0 + 0.005 + next_random() * 0.05;
+            float d0 = 0.3f + (float)next_random() * 0.7f;
+            float d1 = 0.3f + (float)next_random() * 0.7f;
+            if (field && i % 2)
+            {
+                double theta0 = next_random() * 2.0 * PI;
+                workpiece.cut_field(u0, u1, theta0, theta0 + next_random() * PI, d0);
+            }
+            else
+            {
+                workpiece.cut_span(u0, u1, d0, d1);
+            }
+            workpiece.update_mesh();
+            Clock::time_point start = Clock::now();
+            bool level = history.checkpoint(workpiece);
+            checkpoint_ms += elapsed_ms(start);
+            if (level)
+            {
+                states.push_back(undo_state(workpiece));//刀没碰到工件的那几下不算一步
+            }
+        }
+        const int levels = history.levels();
+        const size_t offset = states.size() - levels;//超出HISTORY_LEVELS的最早几步已经丢掉了
+        size_t full_copy = 0;
+        for (size_t i = offset; i < states.size(); i++)
+        {
+            full_copy += states[i].knots.size() * sizeof(Profile::KnotList::value_type) + states[i].field.size() * sizeof(float);
+        }
+        std::cout << (field ? "2D field" : "profile") << ": " << count << " strokes, " << levels << " levels, "
+            << workpiece.profile.knot_count() << " knots now" << std::endl;
+        std::cout << "  history " << history.bytes() / 1024.0 << " KB (full copies would be " << full_copy / 1024.0 << " KB), "
+            << checkpoint_ms * 1000.0 / count << " us per checkpoint" << std::endl;
+
+        double undo_ms = 0.0, mesh_ms = 0.0;
+        long long rows = 0;
+        float radius_error = 0.0f;
+        int undone = 0;
+        for (int level = levels - 2; level >= 0; level--)
+        {
+            Clock::time_point start = Clock::now();
+            bool moved = history.undo(workpiece);
+            undo_ms += elapsed_ms(start);
+            rows += workpiece.is_dirty() ? workpiece.dirty_last - workpiece.dirty_first + 1 : 0;
+            start = Clock::now();
+            workpiece.update_mesh();
+            mesh_ms += elapsed_ms(start);
+            if (!moved || history.position() != level || !undo_same(workpiece, states[offset + level], radius_error))
+            {
+                std::cout << "  undo to level " << level << " FAILED" << std::endl;
+                ok = false;
+                break;
+            }
+            undone++;
+        }
+        ok = ok && !history.undo(workpiece);
+        for (int level = 1; ok && level < levels; level++)
+        {
+            if (!history.redo(workpiece) || !undo_same(workpiece, states[offset + level], radius_error))
+            {
+                std::cout << "  redo to level " << level << " FAILED" << std::endl;
+                ok = false;
+            }
+        }
+        ok = ok && !history.redo(workpiece);
+        std::cout << "  " << undone << " undos: " << undo_ms * 1000.0 / std::max(1, undone) << " us each, "
+            << rows / (double)std::max(1, undone) << " of " << workpiece.y_segments << " rings remeshed on average ("
+            << mesh_ms * 1000.0 / std::max(1, undone) << " us), redo back to the last level, radius error " << radius_error << std::endl;
+
+        //撤销一半之后再切：后面那些不能再重做
+        for (int i = 0; ok && i < levels / 2; i++)
+        {
+            history.undo(workpiece);
+        }
+        workpiece.cut_span(0.4, 0.45, 0.2f);
+        bool branched = !history.redo(workpiece) && history.checkpoint(workpiece) && !history.redo(workpiece)
+            && history.levels() == levels - levels / 2 + 1 && history.undo(workpiece)
+            && undo_same(workpiece, states[offset + levels - 1 - levels / 2], radius_error);
+        std::cout << "  new branch after undoing half: " << (branched ? "ok" : "FAILED") << std::endl;
+        ok = ok && branched;
+    }
+    std::cout << "undo checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// plan the same bezier target with every tool and strategy and cut each plan into a fresh bar: nothing may go below
+// the target, no roughing move may take more than the depth of cut, and the point tool has to end on the target;
+// the written program run through GcodeProgram has to cut the same part, and a target read from a file works too
+int plan_bench(int bins)
+{
+    const glm::vec2 A(-0.9f, 0.6f), B(-0.3f, -0.5f), C(0.3f, 0.9f), D(0.9f, 0.2f);
+    const std::string program_file = "plan_bench.nc";
+    const std::string target_file = "plan_bench.txt";
+    bool ok = true;
+    Workpiece stock(bins, X_SEGMENTS);
+    stock.set_mesh_enabled(false);
+    std::vector<float> target;
+    Clock::time_point start = Clock::now();
+    plan_target_bezier(A, B, C, D, stock, bins, target);
+    std::cout << bins << " bins, target sampled in " << elapsed_ms(start) << " ms" << std::endl;
+    const int tools[] = { 0, 1, 2, 3 };
+    for (int t = 0; t < 4; t++)
+    {
+        for (int strategy = 0; strategy < PLAN_STRATEGIES; strategy++)
+        {
+            PlanSettings settings;
+            settings.tool = tools[t];
+            settings.strategy = strategy;
+            ToolPath path;
+            double best = 1e9;
+            for (int run = 0; run < 5; run++)
+            {
+                path = plan_toolpath(stock, target, settings, 1.0, 1.0f);
+                best = std::min(best, path.plan_ms);
+            }
+            path.plan_ms = best;
+            print_plan_report(path);
+
+            Workpiece workpiece = stock;
+            Cutter cutter;
+            cutter.tool = settings.tool;
+            //切深按格子中点量（规划只知道格子中点的毛坯）：刀尖走过的格子中点每刀不超过depth；切槽刀的刀底比刀尖宽，
+            //斜着走时刀底在半个刀宽外比刀尖低 坡度 × 半个刀宽，算进余量；水平、竖直移动时刀底和侧刃带到旁边格子的是刀的形状，不算
+            const double half = tool_library()[settings.tool].width / (2.0 * length_k) * 0.5;
+            float deepest = 0.0f, over = 0.0f;
+            std::vector<float> before(bins);
+            for (int i = 0; i < bins; i++)
+            {
+                before[i] = workpiece.profile.radius_at((i + 0.5) / bins);
+            }
+            for (size_t i = 0; i < path.moves.size(); i++)
+            {
+                const GcodeMove& m = path.moves[i];
+                double u0 = gcode_axial(m.z0), u1 = gcode_axial(m.z1);
+                float d0 = gcode_distance(m.x0), d1 = gcode_distance(m.x1);
+                cutter.cut_sweep(workpiece, u0, d0, u1, d1);
+                bool sloped = u0 != u1 && d0 != d1;
+                double drag = sloped ? half : 0.0;
+                float slack = sloped ? (float)(std::fabs((d1 - d0) / (u1 - u0)) * half) : 0.0f;
+                for (int k = 0; k < bins; k++)
+                {
+                    double u = (k + 0.5) / bins;
+                    float r = workpiece.profile.radius_at(u);
+                    if (m.feed == settings.rough_feed && u >= std::min(u0, u1) - drag && u <= std::max(u0, u1) + drag)
+                    {
+                        deepest = std::max(deepest, before[k] - r);
+                        over = std::max(over, before[k] - r - slack - plan_radius(settings.depth));
+                    }
+                    before[k] = r;
+                }
+            }
+            float gouge = 0.0f, error = 0.0f;
+            for (int i = 0; i < bins; i++)
+            {
+                float r = workpiece.profile.radius_at((i + 0.5) / bins);
+                gouge = std::max(gouge, target[i] - r);
+                error = std::max(error, r - target[i]);
+            }
+            const float mm = GCODE_STOCK_DIAMETER / 2.0f;
+            std::cout << "  deepest roughing cut " << deepest * mm << " mm, below target " << gouge * mm << " mm, above target "
+                << error * mm << " mm" << std::endl;
+            //点状刀尖能车到任何形状；成形的刀到不了凹处，只检查不过切
+            //刀补管刀尖在格子里的任何位置，中点之间直线够不着的地方走台阶，格子多少都不会过切，只留浮点误差
+            bool point = tool_library()[settings.tool].is_point();
+            ok = ok && gouge < 1e-5f && (!point || error < 1e-4f)
+                && (strategy == PLAN_PLUNGE || over <= 1e-5f);
+            if (t == 1 && strategy == PLAN_AXIAL)
+            {
+                //写成程序再按G代码全速跑一遍，和直接切的结果对比（程序里坐标保留4位小数）
+                Workpiece replayed = stock;
+                Cutter program_cutter;
+                GcodeProgram program;
+                bool same = plan_write_gcode(path, program_file) && program.open(program_file, program_cutter);
+                GcodeReport report = program.run(replayed, program_cutter);
+                float difference = 0.0f;
+                for (int i = 0; i < bins; i++)
+                {
+                    difference = std::max(difference, std::fabs(replayed.radius[i] - workpiece.radius[i]));
+                }
+                same = same && report.errors == 0 && difference < 1e-4f;
+                std::cout << "  as a G-code program: " << report.lines << " lines, machine time " << report.machine_time
+                    << " s, max difference " << difference * mm << " mm " << (same ? "ok" : "FAILED") << std::endl;
+                ok = ok && same;
+            }
+        }
+    }
+    Workpiece direct = stock;
+    Clock::time_point direct_start = Clock::now();
+    bezier_cut(direct, A, B, C, D);
+    float removed = 0.0f;
+    for (int i = 0; i < bins; i++)
+    {
+        removed = std::max(removed, stock.radius[i] - direct.radius[i]);
+    }
+    std::cout << "bezier_cut() for comparison: one step, " << removed * GCODE_STOCK_DIAMETER / 2.0 << " mm deep, " << elapsed_ms(direct_start) << " ms" << std::endl;
+
+    {
+        std::ofstream file(target_file.c_str(), std::ios::out | std::ios::trunc);
+        file << "# Z X\n0 30\n-40 30\n-60 20\n-120 20\n-150 40\n";
+    }
+    PlanSettings settings;
+    bool loaded = plan_target_file(target_file, stock, bins, target);
+    ToolPath path = plan_toolpath(stock, target, settings, 1.0, 1.0f);
+    Workpiece workpiece = stock;
+    Cutter cutter;
+    plan_execute(path, workpiece, cutter);
+    float step_error = std::fabs(workpiece.profile.radius_at(gcode_axial(-90.0)) - gcode_distance(20.0))
+        + std::fabs(workpiece.profile.radius_at(gcode_axial(-20.0)) - gcode_distance(30.0))
+        + std::fabs(workpiece.profile.radius_at(gcode_axial(-180.0)) - 1.0f);
+    std::cout << "target from a file: " << (loaded ? "read" : "FAILED") << ", " << path.passes << " passes, estimated "
+        << path.cycle_time << " s, error " << step_error * GCODE_STOCK_DIAMETER / 2.0 << " mm" << std::endl;
+    ok = ok && loaded && step_error < 1e-4f;
+    std::remove(program_file.c_str());
+    std::remove(target_file.c_str());
+    std::cout << "plan checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// the same sums as Metrology, every segment from scratch (the 1D extremes by scanning every knot, only when asked)
+MeasureNode measure_brute(const Workpiece& workpiece, int first, int last, bool extremes = true)
+{
+    const double h = GCODE_STOCK_LENGTH / workpiece.y_segments;
+    const double mm = GCODE_STOCK_DIAMETER / 2.0;
+    MeasureNode m;
+    for (int y = first; y <= last; y++)
+    {
+        if (workpiece.field_enabled)
+        {
+            int columns = workpiece.field.theta_segments;
+            double z = ((y + 0.5) / workpiece.y_segments - 1.0) * GCODE_STOCK_LENGTH;
+            for (int t = 0; t < columns; t++)
+            {
+                float r = workpiece.field.at(y, t);
+                double R = r * mm;
+                double volume = PI * R * R * h / columns;
+                m.volume += volume;
+                m.moment += volume * z;
+                m.inertia += 0.5 * PI * R * R * R * R * h / columns;
+                m.min_radius = std::min(m.min_radius, r);
+                m.max_radius = std::max(m.max_radius, r);
+            }
+            continue;
+        }
+        //一维：轮廓在折点之间是直线，每一段用三点Gauss-Legendre积分（5次以内精确，r⁴是4次），不走Metrology的闭式
+        //每一段两端的值：折点两侧各一个，segment两端按radius_at()插值（和Metrology一样）
+        double u0 = (double)y / workpiece.y_segments, u1 = (double)(y + 1) / workpiece.y_segments;
+        std::vector<double> breaks(1, u0);
+        std::vector<double> ends(1, workpiece.profile.radius_at(u0));
+        Profile::KnotMap::const_iterator it = workpiece.profile.knots.upper_bound(u0);
+        for (; it != workpiece.profile.knots.end() && it->first < u1; ++it)
+        {
+            breaks.push_back(it->first);
+            ends.push_back(it->second.left);
+            ends.push_back(it->second.right);
+        }
+        breaks.push_back(u1);
+        ends.push_back(it != workpiece.profile.knots.end() && it->first == u1 ? it->second.left : workpiece.profile.radius_at(u1));
+        const double nodes[3] = { -std::sqrt(0.6), 0.0, std::sqrt(0.6) };
+        const double weights[3] = { 5.0 / 9.0, 8.0 / 9.0, 5.0 / 9.0 };
+        for (size_t k = 0; k + 1 < breaks.size(); k++)
+        {
+            double middle = 0.5 * (breaks[k] + breaks[k + 1]), half = 0.5 * (breaks[k + 1] - breaks[k]);
+            for (int g = 0; g < 3; g++)
+            {
+                double u = middle + half * nodes[g];
+                double t = 0.5 * (1.0 + nodes[g]);
+                double R = (ends[2 * k] + (ends[2 * k + 1] - ends[2 * k]) * t) * mm;
+                double volume = PI * R * R * half * weights[g] * GCODE_STOCK_LENGTH;
+                m.volume += volume;
+                m.moment += volume * (u - 1.0) * GCODE_STOCK_LENGTH;
+                m.inertia += 0.5 * volume * R * R;
+            }
+        }
+        m.min_radius = std::min(m.min_radius, workpiece.radius[y]);
+        m.max_radius = std::max(m.max_radius, workpiece.radius[y]);
+        if (extremes)
+        {
+            //一维：直径的范围取轮廓在segment里的最高、最低点（两端取朝segment里面的那一边），逐点扫一遍
+            double u0 = (double)y / workpiece.y_segments, u1 = (double)(y + 1) / workpiece.y_segments;
+            float at_u1 = workpiece.profile.radius_at(u1);
+            for (Profile::KnotMap::const_iterator it = workpiece.profile.knots.begin(); it != workpiece.profile.knots.end(); ++it)
+            {
+                if (it->first > u0 && it->first < u1)
+                {
+                    m.min_radius = std::min(m.min_radius, std::min(it->second.left, it->second.right));
+                    m.max_radius = std::max(m.max_radius, std::max(it->second.left, it->second.right));
+                }
+                if (it->first == u1)
+                {
+                    at_u1 = it->second.left;
+                }
+            }
+            float at_u0 = workpiece.profile.radius_at(u0);
+            m.min_radius = std::min(m.min_radius, std::min(at_u0, at_u1));
+            m.max_radius = std::max(m.max_radius, std::max(at_u0, at_u1));
+        }
+    }
+    return m;
+}
+
+bool measure_same(const MeasureNode& a, const MeasureNode& b, double tolerance = 1e-9)
+{
+    return std::fabs(a.volume - b.volume) <= tolerance * std::max(1.0, std::fabs(b.volume))
+        && std::fabs(a.moment - b.moment) <= tolerance * std::max(1.0, std::fabs(b.moment))
+        && std::fabs(a.inertia - b.inertia) <= tolerance * std::max(1.0, std::fabs(b.inertia))
+        && a.min_radius == b.min_radius && a.max_radius == b.max_radius;
+}
+
+// random cuts on a fine bar (1D and 2D): after each one the tree is updated from the dirty range and queried,
+// compared now and then against summing every segment again; plus the closed forms of a plain cylinder
+int metrology_bench(int cuts)
+{
+    bool ok = true;
+    {
+        //整根毛坯：体积 PI R² L，转动惯量 m R² / 2；整根车到一半半径，体积剩四分之一、转动惯量剩十六分之一
+        Workpiece workpiece(800, X_SEGMENTS);
+        Metrology metrology;
+        metrology.update(workpiece);
+        const double R = GCODE_STOCK_DIAMETER / 2.0;
+        double mass = PI * R * R * GCODE_STOCK_LENGTH * 1e-3 * metrology_materials()[1].density;
+        double inertia = 0.5 * mass * 1e-3 * R * R * 1e-2;
+        bool stock = std::fabs(metrology.removed_volume()) < 1e-6 * metrology.stock_volume()
+            && std::fabs(metrology.mass(1) - mass) < 1e-6 * mass && std::fabs(metrology.inertia(1) - inertia) < 1e-6 * inertia
+            && std::fabs(metrology.center_of_mass() + GCODE_STOCK_LENGTH / 2.0) < 1e-6;
+        workpiece.cut_span(0.0, 1.0, 0.5f);
+        metrology.update(workpiece);
+        bool turned = std::fabs(metrology.volume() - metrology.stock_volume() / 4.0) < 1e-6 * metrology.stock_volume()
+            && std::fabs(metrology.inertia(1) - inertia / 16.0) < 1e-6 * inertia
+            && std::fabs(metrology.max_diameter(0.0, 1.0) - R) < 1e-6;
+        std::cout << "silver stock: " << metrology.stock_volume() / 1000.0 << " cm3, " << mass << " g, " << inertia << " kg*cm2 "
+            << (stock ? "ok" : "FAILED") << ", turned to half the diameter " << (turned ? "ok" : "FAILED") << std::endl;
+        ok = ok && stock && turned;
+
+        //segment中间的台阶：整个segment按平均半径算会少算体积，按轮廓积分和闭式一样
+        Workpiece stepped(10, X_SEGMENTS);
+        stepped.cut_span(0.55, 1.0, 0.5f);
+        metrology.update(stepped);
+        bool step = std::fabs(metrology.volume() - metrology.stock_volume() * (0.55 + 0.45 / 4.0)) < 1e-9 * metrology.stock_volume()
+            && std::fabs(metrology.inertia(1) - inertia * (0.55 + 0.45 / 16.0)) < 1e-9 * inertia;
+        std::cout << "step inside a segment: " << (step ? "ok" : "FAILED") << " (" << metrology.volume() / metrology.stock_volume()
+            << " of the stock, exact " << 0.55 + 0.45 / 4.0 << ")" << std::endl;
+        ok = ok && step;
+    }
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool field = pass == 1;
+        int count = field ? std::max(1, cuts / 10) : cuts;
+        Workpiece workpiece(field ? 1024 : 4096, field ? 128 : X_SEGMENTS);
+        workpiece.set_mesh_enabled(false);
+        if (field)
+        {
+            workpiece.set_field_enabled(true, 128);
+        }
+        Metrology metrology;
+        metrology.update(workpiece);
+        unsigned seed = 7;
+        auto next_random = [&seed]() { seed = seed * 1103515245u + 12345u; return ((seed >> 8) % 100000) / 100000.0; };
+        double update_ms = 0.0, query_ms = 0.0, brute_ms = 0.0;
+        int checks = 0;
+        bool same = true;
+        volatile double sink = 0.0;//查询的结果要用掉，不然会被优化掉
+        for (int i = 0; i < count; i++)
+        {
+            double u0 = next_random() * 0.98;
+            double u1 = u0 + 0.001 + next_random() * 0.02;
+            float distance = 0.2f + (float)next_random() * 0.8f;
+            if (field && i % 2)
+            {
+                double theta = next_random() * 2.0 * PI;
+                workpiece.cut_field(u0, u1, theta, theta + 0.3, distance);
+            }
+            else if (i % 2)
+            {
+                workpiece.cut_span(u0, u1, distance, 0.2f + (float)next_random() * 0.8f);
+            }
+            else
+            {
+                workpiece.cut_span(u0, u1, distance);
+            }
+            Clock::time_point start = Clock::now();
+            metrology.update(workpiece);
+            update_ms += elapsed_ms(start);
+            double q0 = next_random(), q1 = std::min(1.0, q0 + next_random() * 0.3);
+            start = Clock::now();
+            MeasureNode part = metrology.query(q0, q1);
+            sink = sink + metrology.mass(0) + metrology.inertia(1) + metrology.center_of_mass() + part.volume + part.min_radius;
+            query_ms += elapsed_ms(start);
+            if (i % 25 == 0 || i == count - 1)
+            {
+                start = Clock::now();
+                sink = sink + measure_brute(workpiece, 0, workpiece.y_segments - 1, false).volume;
+                brute_ms += elapsed_ms(start);
+                MeasureNode all = measure_brute(workpiece, 0, workpiece.y_segments - 1);
+                int first = (int)std::floor(q0 * workpiece.y_segments);
+                int last = std::min(workpiece.y_segments - 1, std::max(first, (int)std::ceil(q1 * workpiece.y_segments) - 1));
+                //一维：合并折点时会动到切削范围外面的一段（不超过merge_tolerance，见Profile::merge()），那几个segment不重算，
+                //所以r²、r⁴只能差到4 * merge_tolerance / 最小半径0.2（相对）；换分辨率重建之后还是按1e-9比
+                double tolerance = field ? 1e-9 : 4.0 * workpiece.profile.merge_tolerance / 0.2;
+                same = same && measure_same(metrology.total(), all, tolerance) && measure_same(part, measure_brute(workpiece, first, last), tolerance);
+                checks++;
+            }
+        }
+        //换分辨率之后整棵树重建
+        workpiece.set_resolution(workpiece.y_segments / 2, workpiece.x_segments);
+        metrology.update(workpiece);
+        same = same && measure_same(metrology.total(), measure_brute(workpiece, 0, workpiece.y_segments - 1));
+        std::cout << (field ? "2D field " : "profile ") << workpiece.y_segments * 2 << " segments, " << count << " cuts: update "
+            << update_ms * 1000.0 / count << " us/cut, queries " << query_ms * 1000.0 / count << " us/cut, summing everything "
+            << brute_ms * 1000.0 / checks << " us, " << checks << " comparisons " << (same ? "ok" : "FAILED") << std::endl;
+        print_metrology_report(metrology.total(), 1);
+        ok = ok && same;
+    }
+    std::cout << "metrology checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// plunge 0.3 s, then feed along the bar: ticks driven by hand, the samples drained every frame's worth of ticks
+TelemetryMeter telemetry_stroke(Simulation& sim, double& step_ms, unsigned long long& dropped)
+{
+    TelemetryMeter meter;
+    TelemetrySample sample;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < 2300; i++)
+    {
+        sim.radial_dir = i < 300 ? -1 : 0;
+        sim.axial_dir = i < 300 ? 0 : 1;
+        sim.step();
+        if (i % 16 == 15)
+        {
+            while (sim.telemetry.pop(sample))
+            {
+                meter.add(sample);
+            }
+        }
+    }
+    step_ms = elapsed_ms(start) / 2300;
+    while (sim.telemetry.pop(sample))
+    {
+        meter.add(sample);
+    }
+    dropped = sim.telemetry.dropped();
+    return meter;
+}
+
+int telemetry_bench(double seconds)
+{
+    bool ok = true;
+    {
+        //同一刀先木头再银：切掉的体积逐位相同，功率之比就是比切削能之比
+        Simulation sim;
+        sim.cutter.spindle_speed = 5.0;
+        double step_ms = 0.0;
+        unsigned long long dropped = 0;
+        TelemetryMeter wood = telemetry_stroke(sim, step_ms, dropped);
+        Metrology check;
+        check.update(sim.workpiece);//模拟线程自己的那份已经取走了范围，这里从头建一份
+        double removed = check.removed_volume();
+        SimulationCommand command;
+        command.type = COMMAND_RESET;
+        sim.post(command);
+        command.type = COMMAND_MATERIAL;
+        command.value = 1;
+        sim.post(command);
+        TelemetryMeter silver = telemetry_stroke(sim, step_ms, dropped);
+        double ratio = silver.energy / wood.energy;
+        double expected = metrology_materials()[1].specific_energy / metrology_materials()[0].specific_energy;
+        bool sums = std::fabs(wood.removed - removed) < 1e-6 * removed && wood.removed == silver.removed
+            && std::fabs(ratio - expected) < 1e-4 * expected && wood.ticks == 2300 && silver.ticks == 2300 && dropped == 0;
+        std::cout << "one stroke: removed " << wood.removed / 1000.0 << " cm3 (part lost " << removed / 1000.0 << " cm3), wood "
+            << wood.energy << " J peak " << wood.peak_power << " W, silver " << silver.energy << " J peak " << silver.peak_power
+            << " W peak force " << silver.peak_force << " N, " << step_ms * 1000.0 << " us/tick " << (sums ? "ok" : "FAILED") << std::endl;
+        ok = ok && sums;
+    }
+    {
+        //环形缓冲本身：两个线程，写的一方全速写，收到的顺序不乱、收到的加上丢掉的等于写的
+        const long long count = 2000000;
+        TelemetryBuffer buffer;
+        std::atomic<bool> done{ false };
+        long long received = 0;
+        bool ordered = true;
+        std::thread reader([&]() {
+            TelemetrySample s;
+            long long last = -1;
+            for (;;)
+            {
+                bool finished = done;
+                while (buffer.pop(s))
+                {
+                    ordered = ordered && s.tick > last;
+                    last = s.tick;
+                    received++;
+                }
+                if (finished)
+                {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        });
+        Clock::time_point start = Clock::now();
+        TelemetrySample s;
+        for (long long i = 0; i < count; i++)
+        {
+            s.tick = i;
+            buffer.push(s);
+        }
+        double push_ns = elapsed_ms(start) * 1e6 / count;
+        done = true;
+        reader.join();
+        bool complete = ordered && received + (long long)buffer.dropped() == count;
+        std::cout << "ring buffer: " << count << " pushes at " << push_ns << " ns each, " << received << " received, "
+            << buffer.dropped() << " dropped " << (complete ? "ok" : "FAILED") << std::endl;
+        ok = ok && complete;
+    }
+    {
+        //实时：模拟线程1kHz，渲染线程16ms一帧、每60帧卡50ms，一条都不该丢
+        Simulation sim;
+        sim.cutter.spindle_speed = 5.0;
+        sim.radial_dir = -1;
+        sim.start();
+        Clock::time_point start = Clock::now();
+        TelemetryMeter meter;
+        TelemetrySample sample;
+        long long last = -1;
+        bool contiguous = true;
+        int frames = 0;
+        while (elapsed_ms(start) < seconds * 1000.0)
+        {
+            double t = elapsed_ms(start) / 1000.0;
+            if (t > 0.3)
+            {
+                sim.radial_dir = 0;
+                sim.axial_dir = (int)(t / 1.5) % 2 == 0 ? 1 : -1;
+            }
+            while (sim.telemetry.pop(sample))
+            {
+                contiguous = contiguous && (last < 0 || sample.tick == last + 1);
+                last = sample.tick;
+                meter.add(sample);
+            }
+            frames++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(frames % 60 == 0 ? 50 : 16));
+        }
+        sim.stop();
+        while (sim.telemetry.pop(sample))
+        {
+            contiguous = contiguous && sample.tick == last + 1;
+            last = sample.tick;
+            meter.add(sample);
+        }
+        bool live = contiguous && sim.telemetry.dropped() == 0 && meter.ticks == sim.cutter.motion_tick;
+        std::cout << "live: " << meter.ticks << " ticks in " << frames << " frames, mean " << meter.mean_power() << " W, "
+            << meter.mrr() * 60.0 / 1000.0 << " cm3/min, dropped " << sim.telemetry.dropped() << " " << (live ? "ok" : "FAILED") << std::endl;
+        ok = ok && live;
+    }
+    std::cout << "telemetry checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// how far the profile rises above the line from (u0, d0) to (u1, d1): every knot of the whole profile, no tree
+float rapid_brute(const Workpiece& workpiece, double u0, float d0, double u1, float d1)
+{
+    if (u1 < u0)
+    {
+        std::swap(u0, u1);
+        std::swap(d0, d1);
+    }
+    double a = std::max(0.0, u0), b = std::min(1.0, u1);
+    if (a > b)
+    {
+        return -1.0f;
+    }
+    auto line = [&](double u) { return u1 > u0 ? d0 + (d1 - d0) * (float)((u - u0) / (u1 - u0)) : std::min(d0, d1); };
+    const Profile& profile = workpiece.profile;
+    if (b - a <= 2.0 * METROLOGY_EDGE)
+    {
+        return std::min(profile.radius_at(a - METROLOGY_EDGE), profile.radius_at(b + METROLOGY_EDGE)) - std::min(d0, d1);
+    }
+    float excess = std::max(profile.radius_at(a + METROLOGY_EDGE) - line(a + METROLOGY_EDGE), profile.radius_at(b - METROLOGY_EDGE) - line(b - METROLOGY_EDGE));
+    for (Profile::KnotMap::const_iterator it = profile.knots.begin(); it != profile.knots.end(); ++it)
+    {
+        if (it->first > a + METROLOGY_EDGE && it->first < b - METROLOGY_EDGE)
+        {
+            excess = std::max(excess, std::max(it->second.left, it->second.right) - line(it->first));
+        }
+    }
+    return excess;
+}
+
+// run a program file on a fresh bar with the given tool, guarded by a Metrology or not
+GcodeReport collision_run(const std::string& path, int tool, RapidPolicy policy, bool guarded, Workpiece& workpiece)
+{
+    Metrology metrology;
+    Cutter cutter;
+    cutter.tool = tool;
+    GcodeProgram program;
+    program.guard = guarded ? &metrology : nullptr;
+    program.rapid_policy = policy;
+    program.open(path, cutter);
+    return program.run(workpiece, cutter);
+}
+
+int collision_bench(int moves)
+{
+    bool ok = true;
+    {
+        //随机G0对暴力：工件先车出几千个折点，一半是轴向的快移，一半是斜的
+        Workpiece workpiece(4096, X_SEGMENTS);
+        workpiece.set_mesh_enabled(false);
+        unsigned seed = 11;
+        auto next_random = [&seed]() { seed = seed * 1103515245u + 12345u; return ((seed >> 8) % 100000) / 100000.0; };
+        for (int i = 0; i < 3000; i++)
+        {
+            double u = next_random();
+            workpiece.cut_span(u, u + next_random() * 0.01, 0.4f + (float)next_random() * 0.6f);
+        }
+        Metrology metrology;
+        metrology.update(workpiece);
+        std::vector<double> u0(moves), u1(moves);
+        std::vector<float> d0(moves), d1(moves);
+        for (int i = 0; i < moves; i++)
+        {
+            u0[i] = next_random() * 1.2 - 0.1;
+            u1[i] = i % 2 ? u0[i] : u0[i] + (next_random() - 0.5) * 0.4;
+            d0[i] = 0.3f + (float)next_random() * 0.8f;
+            d1[i] = i % 2 ? d0[i] : 0.3f + (float)next_random() * 0.8f;
+        }
+        std::vector<int> hits(moves);
+        float excess = 0.0f;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < moves; i++)
+        {
+            hits[i] = metrology.first_above(workpiece, u0[i], d0[i], u1[i], d1[i], RAPID_TOLERANCE, excess);
+        }
+        double tree_ms = elapsed_ms(start);
+        int collisions = 0, wrong = 0;
+        start = Clock::now();
+        for (int i = 0; i < moves; i++)
+        {
+            excess = rapid_brute(workpiece, u0[i], d0[i], u1[i], d1[i]);
+            bool hit = excess > RAPID_TOLERANCE;
+            collisions += hit ? 1 : 0;
+            wrong += hit != (hits[i] >= 0) && std::fabs(excess - RAPID_TOLERANCE) > 1e-6f ? 1 : 0;//刚好在容差上的两边都算对
+        }
+        double brute_ms = elapsed_ms(start);
+        std::cout << moves << " random rapids over " << workpiece.profile.knot_count() << " knots: " << collisions << " would cut, "
+            << tree_ms * 1e6 / moves << " ns per check (every knot: " << brute_ms * 1e6 / moves << " ns), "
+            << wrong << " disagree " << (wrong == 0 ? "ok" : "FAILED") << std::endl;
+        ok = ok && wrong == 0;
+    }
+    {
+        //生成的粗车+精车程序：G0都在空中，带检查结果不变、一条也不报；比较每秒行数
+        const std::string path = "collision_bench.nc";
+        gcode_write_test_program(path, 200000);
+        Workpiece plain(800, X_SEGMENTS), guarded(800, X_SEGMENTS);
+        GcodeReport a = collision_run(path, 0, RAPID_STOP, false, plain);
+        GcodeReport b = collision_run(path, 0, RAPID_STOP, true, guarded);
+        //车刀的副刀刃（30°）在第一层进刀时擦到棒料端面的角：程序是按点状刀尖写的，这一下是真的碰撞
+        Workpiece turned(800, X_SEGMENTS);
+        GcodeReport c = collision_run(path, 1, RAPID_WARN, true, turned);
+        bool same = plain.radius == guarded.radius && b.rapid_collisions == 0 && c.rapid_collisions > 0 && c.lines == a.lines;
+        std::cout << "roughing program, " << a.lines << " lines: " << a.lines / a.seconds << " lines/s unchecked, " << b.lines / b.seconds
+            << " lines/s checked, " << b.rapid_collisions << " collisions; " << c.lines / c.seconds << " lines/s with the "
+            << tool_library()[1].name << " tool, " << c.rapid_collisions << " collision(s) of its trailing edge " << (same ? "ok" : "FAILED") << std::endl;
+        ok = ok && same;
+
+        //G0沿着工件表面往里走：停下的程序什么都没切；只报错的照样切；切槽刀贴着槽壁退刀不算
+        {
+            std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+            out << "G21 G90 G94 F200\nG0 X60. Z5.\nG0 X40.\nG0 Z-100.\nG0 X60.\nM30\n";
+        }
+        Workpiece stopped(800, X_SEGMENTS), warned(800, X_SEGMENTS), fresh(800, X_SEGMENTS);
+        GcodeReport s1 = collision_run(path, 0, RAPID_STOP, true, stopped);
+        GcodeReport s2 = collision_run(path, 0, RAPID_WARN, true, warned);
+        bool stop_ok = s1.rapid_collisions == 1 && stopped.radius == fresh.radius && s2.rapid_collisions == 1 && warned.radius != fresh.radius;
+        {
+            std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+            out << "G21 G90 G94 F200\nG0 X60. Z-50.\nG1 X30.\nG0 X60.\nZ-80.\nG1 X40.\nG0 X60.\nM30\n";
+        }
+        Workpiece grooved(800, X_SEGMENTS);
+        GcodeReport s3 = collision_run(path, 3, RAPID_STOP, true, grooved);
+        stop_ok = stop_ok && s3.rapid_collisions == 0 && grooved.profile.radius_at(gcode_axial(-80.0)) < 0.81f;
+        std::cout << "rapid into the part: stopped " << (stopped.radius == fresh.radius ? "before cutting" : "AFTER CUTTING") << ", warned "
+            << s2.rapid_collisions << " time(s); " << tool_library()[3].name << " retracting out of its grooves: " << s3.rapid_collisions
+            << " collisions " << (stop_ok ? "ok" : "FAILED") << std::endl;
+        ok = ok && stop_ok;
+        std::remove(path.c_str());
+    }
+    std::cout << "collision checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// the sampler bezier_cut() used to be: y_segments + 1 points at fixed steps of t with pow(), each cutting the one bin it lands in;
+// the bins it lands in are marked in touched[]
+void bezier_cut_sampled(Workpiece& workpiece, glm::vec2 A, glm::vec2 B, glm::vec2 C, glm::vec2 D, std::vector<char>* touched)
+{
+    const int segments = workpiece.y_segments;
+    std::vector<glm::vec2> ps(segments + 1);
+    int i = 0;
+    for (float t = 0.0f; t <= 1.0f && i <= segments; t += 1.0f / segments)
+    {
+        float a1 = std::pow((1.0f - t), 3);
+        float a2 = std::pow((1.0f - t), 2) * 3 * t;
+        float a3 = 3.0f * t * t * (1.0f - t);
+        float a4 = t * t * t;
+        ps[i].x = a1 * A.x + a2 * B.x + a3 * C.x + a4 * D.x;
+        ps[i].y = a1 * A.y + a2 * B.y + a3 * C.y + a4 * D.y;
+        i = i + 1;
+    }
+    ps[segments] = D;
+    for (int i = 0; i <= segments; i++)
+    {
+        int index = (int)((ps[i].x + 1.0f) * segments / 2);
+        if (touched && index >= 0 && index < segments)
+        {
+            (*touched)[index] = 1;
+        }
+        workpiece.cut(index, (ps[i].y + 1.0f) / 2.0f);
+    }
+}
+
+// the cubic in double by de Casteljau, the reference the flattened polyline is checked against
+glm::dvec2 bezier_exact(const glm::vec2* P, double t)
+{
+    glm::dvec2 p[4] = { glm::dvec2(P[0]), glm::dvec2(P[1]), glm::dvec2(P[2]), glm::dvec2(P[3]) };
+    for (int k = 3; k > 0; k--)
+    {
+        for (int i = 0; i < k; i++)
+        {
+            p[i] = p[i] + (p[i + 1] - p[i]) * t;
+        }
+    }
+    return p[0];
+}
+
+// random cubics over a 400-segment bar: bins the old fixed-step sampler skips and the rasterizer covers, how far the polyline
+// strays from the exact curve, SSE2 against scalar evaluation, and the time to evaluate, rasterize and cut
+int bezier_bench(int curves)
+{
+    const int bins = Y_SEGMENTS;
+    unsigned seed = 21;
+    auto next_random = [&seed]() { seed = seed * 1103515245u + 12345u; return ((seed >> 8) % 100000) / 100000.0f; };
+    std::vector<glm::vec2> P(curves * 4);
+    for (int i = 0; i < curves; i++)
+    {
+        //一半是从头到尾横跨工件、中间走得很快的曲线，一半随便放
+        for (int k = 0; k < 4; k++)
+        {
+            P[i * 4 + k] = glm::vec2(next_random() * 2.0f - 1.0f, next_random() * 1.4f - 0.5f);
+        }
+        if (i % 2 == 0)
+        {
+            P[i * 4].x = -0.95f;
+            P[i * 4 + 1].x = -0.9f + 0.1f * next_random();
+            P[i * 4 + 2].x = 0.9f - 0.1f * next_random();
+            P[i * 4 + 3].x = 0.95f;
+        }
+    }
+    bool ok = true;
+
+    //覆盖：原来的取点法漏掉的格子，光栅化在折线x范围里一个都不能漏
+    long long old_missed = 0, new_missed = 0, old_curves = 0;
+    double worst = 0.0;
+    long long points = 0;
+    std::vector<glm::vec2> line;
+    std::vector<float> lowest(bins);
+    for (int i = 0; i < curves; i++)
+    {
+        const glm::vec2* c = &P[i * 4];
+        Workpiece sampled(bins, 8);
+        sampled.set_mesh_enabled(false);
+        std::vector<char> touched(bins, 0);
+        bezier_cut_sampled(sampled, c[0], c[1], c[2], c[3], &touched);
+        Bezier curve(c[0], c[1], c[2], c[3]);
+        curve.flatten(line);
+        points += (long long)line.size();
+        std::fill(lowest.begin(), lowest.end(), BEZIER_NONE);
+        int first = bins, last = -1;
+        bezier_rasterize(&line[0], line.size(), bins, &lowest[0], first, last);
+        double lo = 1.0, hi = 0.0;
+        for (size_t k = 0; k < line.size(); k++)
+        {
+            lo = std::min(lo, bezier_axial(line[k]));
+            hi = std::max(hi, bezier_axial(line[k]));
+        }
+        int span_first = std::max(0, (int)std::floor(lo * bins)), span_last = std::min(bins - 1, (int)std::ceil(hi * bins) - 1);
+        long long missed = 0;
+        for (int y = span_first; y <= span_last; y++)
+        {
+            old_missed += touched[y] ? 0 : 1;
+            missed += touched[y] ? 0 : 1;
+            new_missed += lowest[y] == BEZIER_NONE ? 1 : 0;
+        }
+        old_curves += missed > 0 ? 1 : 0;
+        new_missed += span_first <= span_last && (first != span_first || last != span_last) ? 1 : 0;
+        //折线每一段的中间几个点到这一段弦的距离
+        const int n = (int)line.size() - 1;
+        for (int k = 0; k < n; k++)
+        {
+            glm::dvec2 a(line[k]), b(line[k + 1]);
+            glm::dvec2 ab = b - a;
+            for (int j = 1; j < 4; j++)
+            {
+                glm::dvec2 p = bezier_exact(c, (k + j / 4.0) / n) - a;
+                double along = glm::dot(ab, ab) > 0.0 ? std::max(0.0, std::min(1.0, glm::dot(p, ab) / glm::dot(ab, ab))) : 0.0;
+                worst = std::max(worst, glm::length(p - ab * along));
+            }
+        }
+    }
+    bool cover_ok = new_missed == 0 && worst <= BEZIER_TOLERANCE * 1.05;
+    std::cout << curves << " curves over " << bins << " bins: fixed-step sampling skipped " << old_missed << " bins in " << old_curves
+        << " curves, rasterized " << new_missed << "; " << (double)points / curves << " points per curve on average, at most "
+        << worst / BEZIER_TOLERANCE << " of the tolerance off the curve " << (cover_ok ? "ok" : "FAILED") << std::endl;
+    ok = ok && cover_ok;
+
+    //求值：pow取点、标量Horner、SSE2 Horner，后两者逐位一致
+    const int n = 4096;
+    std::vector<glm::vec2> fast(n + 1), slow(n + 1);
+    bool same = true;
+    volatile float sink = 0.0f;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < curves; i++)
+    {
+        const glm::vec2* c = &P[i * 4];
+        for (int k = 0; k <= n; k++)
+        {
+            float t = (float)k / n;
+            float a1 = std::pow((1.0f - t), 3), a2 = std::pow((1.0f - t), 2) * 3 * t, a3 = 3.0f * t * t * (1.0f - t), a4 = t * t * t;
+            slow[k] = a1 * c[0] + a2 * c[1] + a3 * c[2] + a4 * c[3];
+        }
+        sink = sink + slow[n / 2].x;
+    }
+    double pow_ms = elapsed_ms(start);
+    start = Clock::now();
+    for (int i = 0; i < curves; i++)
+    {
+        Bezier(P[i * 4], P[i * 4 + 1], P[i * 4 + 2], P[i * 4 + 3]).evaluate_scalar(n, &slow[0]);
+        sink = sink + slow[n / 2].x;
+    }
+    double scalar_ms = elapsed_ms(start);
+    start = Clock::now();
+    for (int i = 0; i < curves; i++)
+    {
+        Bezier(P[i * 4], P[i * 4 + 1], P[i * 4 + 2], P[i * 4 + 3]).evaluate(n, &fast[0]);
+        sink = sink + fast[n / 2].x;
+    }
+    double sse_ms = elapsed_ms(start);
+    for (int i = 0; i < curves && same; i++)
+    {
+        Bezier curve(P[i * 4], P[i * 4 + 1], P[i * 4 + 2], P[i * 4 + 3]);
+        curve.evaluate(n - i % 4, &fast[0]);//n不是4的倍数时剩下的点走标量
+        curve.evaluate_scalar(n - i % 4, &slow[0]);
+        same = std::memcmp(&fast[0], &slow[0], sizeof(glm::vec2) * (n + 1 - i % 4)) == 0;
+    }
+    double per = 1e6 / ((double)curves * (n + 1));
+    std::cout << "evaluate: pow() " << pow_ms * per << " ns per point, Horner " << scalar_ms * per << " ns, "
+#ifdef LATHE_SSE2
+        << "SSE2 " << sse_ms * per << " ns, "
+#endif
+        << "bit-identical: " << (same ? "yes" : "NO") << std::endl;
+    ok = ok && same;
+
+    //整条流程：原来的bezier_cut()和现在的（展平+按折线切），以及只光栅化到格子
+    Workpiece sampled(bins, X_SEGMENTS), flattened(bins, X_SEGMENTS);
+    sampled.set_mesh_enabled(false);
+    flattened.set_mesh_enabled(false);
+    start = Clock::now();
+    for (int i = 0; i < curves; i++)
+    {
+        sampled.reset();
+        bezier_cut_sampled(sampled, P[i * 4], P[i * 4 + 1], P[i * 4 + 2], P[i * 4 + 3], nullptr);
+    }
+    double old_ms = elapsed_ms(start);
+    start = Clock::now();
+    for (int i = 0; i < curves; i++)
+    {
+        flattened.reset();
+        bezier_cut(flattened, P[i * 4], P[i * 4 + 1], P[i * 4 + 2], P[i * 4 + 3]);
+    }
+    double new_ms = elapsed_ms(start);
+    start = Clock::now();
+    for (int i = 0; i < curves; i++)
+    {
+        Bezier(P[i * 4], P[i * 4 + 1], P[i * 4 + 2], P[i * 4 + 3]).flatten(line);
+        std::fill(lowest.begin(), lowest.end(), BEZIER_NONE);
+        int first = bins, last = -1;
+        bezier_rasterize(&line[0], line.size(), bins, &lowest[0], first, last);
+        sink = sink + lowest[bins / 2];
+    }
+    double raster_ms = elapsed_ms(start);
+    //最后一条曲线切出来的工件：每个格子都不高于曲线在格子里的最低点
+    bool below = true;
+    Bezier(P[(curves - 1) * 4], P[(curves - 1) * 4 + 1], P[(curves - 1) * 4 + 2], P[(curves - 1) * 4 + 3]).flatten(line);
+    std::fill(lowest.begin(), lowest.end(), BEZIER_NONE);
+    int first = bins, last = -1;
+    bezier_rasterize(&line[0], line.size(), bins, &lowest[0], first, last);
+    for (int y = first; y <= last; y++)
+    {
+        below = below && flattened.profile.min_radius((double)y / bins, (double)(y + 1) / bins) <= std::max(0.0f, lowest[y]) + 1e-6f;
+    }
+    std::cout << "per curve: old bezier_cut() " << old_ms * 1e3 / curves << " us, flatten + cut " << new_ms * 1e3 / curves
+        << " us, flatten + rasterize " << raster_ms * 1e3 / curves << " us; cut reaches the curve in every bin " << (below ? "ok" : "FAILED") << std::endl;
+    ok = ok && below;
+    std::cout << "bezier checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// a shaft profile of `points` control points on a 1600-segment bar, dragged at random like the editor's mouse: after every drag the
+// incremental raster must equal the whole curve rasterized from scratch, and only the rings around the dragged spans are rebuilt;
+// then points are added and deleted, and the finished spline is cut through the simulation command
+int spline_bench(int points)
+{
+    const int bins = 1600;
+    const int drags = 2000;
+    unsigned seed = 5;
+    auto next_random = [&seed]() { seed = seed * 1103515245u + 12345u; return ((seed >> 8) % 100000) / 100000.0f; };
+    SplineEditor spline(bins);
+    for (int k = 0; k < points; k++)
+    {
+        //台阶、锥面交替的轴
+        float x = -0.95f + 1.9f * k / (points - 1);
+        spline.add(glm::vec2(x, 0.2f + 0.5f * ((k / 3) % 2) + 0.05f * next_random()));
+    }
+    Workpiece view(bins, X_SEGMENTS);
+    int first, last;
+    Clock::time_point start = Clock::now();
+    spline.update(first, last);
+    double build_ms = elapsed_ms(start);
+    view.set_preview(spline.lowest, first, last);
+    view.update_mesh();
+    view.clear_upload();
+
+    //拖动：每次只动一个点，结果和从头光栅化整条曲线逐位相同
+    bool same = true;
+    long long spans_before = spline.evaluated();
+    long long bins_changed = 0, rings_rebuilt = 0;
+    double update_ms = 0.0, mesh_ms = 0.0;
+    std::vector<glm::vec2> curve;
+    std::vector<float> scratch(bins);
+    for (int i = 0; i < drags; i++)
+    {
+        int k = (int)(next_random() * points) % points;
+        glm::vec2 p = spline.point(k) + glm::vec2((next_random() - 0.5f) * 0.01f, (next_random() - 0.5f) * 0.05f);
+        start = Clock::now();
+        spline.move(k, p);
+        bool changed = spline.update(first, last);
+        update_ms += elapsed_ms(start);
+        if (changed)
+        {
+            bins_changed += last - first + 1;
+            start = Clock::now();
+            view.set_preview(spline.lowest, first, last);
+            rings_rebuilt += std::min(view.dirty_last + 1, view.y_segments) - std::max(view.dirty_first - 1, 0) + 1;
+            view.update_mesh();
+            view.clear_upload();
+            mesh_ms += elapsed_ms(start);
+        }
+        if (i % 20 == 0 || i == drags - 1)
+        {
+            spline.polyline(curve);
+            std::fill(scratch.begin(), scratch.end(), BEZIER_NONE);
+            int a = bins, b = -1;
+            bezier_rasterize(&curve[0], curve.size(), bins, &scratch[0], a, b);
+            same = same && scratch == spline.lowest;
+        }
+    }
+    long long spans = spline.evaluated() - spans_before;
+    Workpiece full(bins, X_SEGMENTS);
+    full.set_preview(spline.lowest, 0, bins - 1);
+    start = Clock::now();
+    full.update_mesh();
+    double full_mesh_ms = elapsed_ms(start);
+    std::cout << points << " control points, " << bins << " segments: whole curve " << build_ms * 1e3 << " us; " << drags << " drags: "
+        << (double)spans / drags << " spans, " << (double)bins_changed / drags << " segments and " << (double)rings_rebuilt / drags
+        << " rings per drag, " << update_ms * 1e3 / drags << " us to re-rasterize + " << mesh_ms * 1e3 / drags << " us to remesh (all rings: "
+        << full_mesh_ms * 1e3 << " us), same as from scratch: " << (same ? "yes" : "NO") << std::endl;
+    bool ok = same && spans <= 4LL * drags;
+
+    //加点、删点：整条重新算
+    start = Clock::now();
+    for (int i = 0; i < 20; i++)
+    {
+        int k = spline.add(glm::vec2(next_random() * 1.8f - 0.9f, 0.5f));
+        spline.update(first, last);
+        spline.erase(k);
+        spline.update(first, last);
+    }
+    double edit_ms = elapsed_ms(start) / 40.0;
+    spline.polyline(curve);
+    std::fill(scratch.begin(), scratch.end(), BEZIER_NONE);
+    int a = bins, b = -1;
+    bezier_rasterize(&curve[0], curve.size(), bins, &scratch[0], a, b);
+    bool edit_same = scratch == spline.lowest;
+    std::cout << "add or delete a point: " << edit_ms * 1e3 << " us, same as from scratch: " << (edit_same ? "yes" : "NO") << std::endl;
+    ok = ok && edit_same;
+
+    //切：每个格子都切到曲线在格子里的最低点
+    Simulation simulation(bins, X_SEGMENTS);
+    SimulationCommand command;
+    command.type = COMMAND_SPLINE;
+    command.value = -1;
+    command.spline = spline.points();
+    start = Clock::now();
+    simulation.apply(command);
+    double cut_ms = elapsed_ms(start);
+    bool below = true;
+    for (int y = 0; y < bins; y++)
+    {
+        if (spline.lowest[y] != BEZIER_NONE && spline.lowest[y] < 1.0f)
+        {
+            below = below && simulation.workpiece.profile.min_radius((double)y / bins, (double)(y + 1) / bins) <= std::max(0.0f, spline.lowest[y]) + 1e-5f;//浮点误差以内
+        }
+    }
+    std::cout << "cut through COMMAND_SPLINE: " << cut_ms << " ms, " << simulation.workpiece.profile.knot_count() << " knots, reaches the curve in every segment "
+        << (below ? "ok" : "FAILED") << std::endl;
+    ok = ok && below;
+    std::cout << "spline checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// the outline both test drawings describe, radius in mm at program Z (mm), -1 where nothing is drawn
+double drawing_expected(double z)
+{
+    if (z > 0.0 || z < -180.0 || (z < -150.0 && z > -160.0))
+    {
+        return -1.0;
+    }
+    if (z > -40.0)
+    {
+        return 15.0;
+    }
+    if (z > -60.0)
+    {
+        return 15.0 - std::sqrt(std::max(0.0, 100.0 - (z + 50.0) * (z + 50.0)));//R10的槽
+    }
+    if (z > -100.0)
+    {
+        return 15.0 + (z + 60.0) / -40.0 * 5.0;//锥面
+    }
+    if (z > -150.0)
+    {
+        return 20.0;
+    }
+    return 20.0 + std::sqrt(std::max(0.0, 100.0 - (z + 170.0) * (z + 170.0)));//R10的凸台
+}
+
+// largest difference from drawing_expected() at the bin middles (mm), and whether the drawn bins are exactly the expected ones
+double drawing_error(const std::vector<float>& radius, bool& coverage)
+{
+    const int bins = (int)radius.size();
+    double error = 0.0;
+    coverage = true;
+    for (int i = 0; i < bins; i++)
+    {
+        double z = plan_z((i + 0.5) / bins);
+        double expected = drawing_expected(z);
+        //两种情况的分界正好落在格子中点附近时不比较
+        double edge = std::min(std::fabs(z + 150.0), std::fabs(z + 160.0));
+        if (expected < 0.0 || radius[i] == DRAWING_NONE)
+        {
+            coverage = coverage && ((expected < 0.0) == (radius[i] == DRAWING_NONE) || edge < 1e-6 || z > -1e-6);
+            continue;
+        }
+        error = std::max(error, std::fabs(radius[i] * GCODE_STOCK_DIAMETER / 2.0 - expected));
+    }
+    return error;
+}
+
+// write a drawing of a wavy shaft, r = 15 + 3 sin(z / 7) over the whole bar, of about `bytes` bytes: one long polyline
+// (a path) plus hatch lines under it; returns the vertex count
+long long drawing_write_large(const std::string& path, bool svg, long long bytes)
+{
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+    const long long vertices = std::max(1000LL, bytes / (svg ? 22 : 26));
+    char text[128];
+    if (svg)
+    {
+        file << "<?xml version=\"1.0\"?>\n<!-- wavy shaft -->\n<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"-200 -30 200 60\">\n"
+            << "<line x1=\"-200\" y1=\"0\" x2=\"0\" y2=\"0\" stroke=\"black\"/>\n<path stroke=\"black\" d=\"M";
+    }
+    else
+    {
+        file << "0\nSECTION\n2\nHEADER\n9\n$INSUNITS\n70\n4\n0\nENDSEC\n0\nSECTION\n2\nENTITIES\n"
+            << "0\nLWPOLYLINE\n8\nOUTLINE\n90\n" << vertices << "\n70\n0\n";
+    }
+    for (long long k = 0; k < vertices; k++)
+    {
+        double z = -GCODE_STOCK_LENGTH * k / (vertices - 1);
+        double r = 15.0 + 3.0 * std::sin(z / 7.0);
+        if (svg)
+        {
+            std::snprintf(text, sizeof(text), k == 0 ? "%.5f,%.5f" : " L%.5f,%.5f", z, -r);
+        }
+        else
+        {
+            std::snprintf(text, sizeof(text), "10\n%.5f\n20\n%.5f\n", z, r);
+        }
+        file << text;
+    }
+    file << (svg ? "\"/>\n" : "");
+    //剖面线：在轮廓下面，不影响目标
+    for (int k = 0; k < 400; k++)
+    {
+        double z = -5.0 - k * 0.45;
+        if (svg)
+        {
+            std::snprintf(text, sizeof(text), "<path d=\"m%.3f,0 l-3,-10\"/>\n", z);
+        }
+        else
+        {
+            std::snprintf(text, sizeof(text), "0\nLINE\n8\nHATCH\n10\n%.3f\n20\n0\n11\n%.3f\n21\n10\n", z, z - 3.0);
+        }
+        file << text;
+    }
+    file << (svg ? "</svg>\n" : "0\nENDSEC\n0\nEOF\n");
+    return vertices;
+}
+
+// drawing import: a hand-written SVG and DXF of the same shaft (steps, an arc groove, a taper, an arc bump) read back
+// bin by bin; then two large generated drawings for the streaming speed, cut and planned through COMMAND_DRAWING
+int drawing_bench(int kilobytes)
+{
+    const int bins = Y_SEGMENTS;
+    const std::string svg_file = "drawing_bench.svg";
+    const std::string dxf_file = "drawing_bench.dxf";
+    const double tolerance = 1e-2;//mm：折线的弦高，在竖直切线附近（槽的两端）按半径方向量会大一些
+    bool ok = true;
+    {
+        //y朝下的SVG，紧凑写法：数字之间不加空格、隐含的重复命令、相对命令、圆弧标志连写、直线写成三次曲线
+        std::ofstream file(svg_file.c_str(), std::ios::out | std::ios::trunc);
+        file << "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"-200 -40 200 80\">\n"
+            << "  <!-- centre line, not part of the outline -->\n"
+            << "  <path style=\"stroke:red\" d='M0 0H-200'/>\n"
+            << "  <path d=\"m0-15-40,0A10 10 0 0 1-60-15C-73.333333-16.666667-86.666667-18.333333-100-20L-150-20V0H0z\"/>\n"
+            << "  <path d=\"M-160-20a10,10 0 00-20,0\"/>\n"
+            << "</svg>\n";
+    }
+    {
+        std::ofstream file(dxf_file.c_str(), std::ios::out | std::ios::trunc);
+        file << "  0\nSECTION\n  2\nBLOCKS\n  0\nLINE\n 10\n0\n 20\n100\n 11\n-200\n 21\n100\n  0\nENDSEC\n"//块里的实体不算
+            << "  0\nSECTION\n  2\nENTITIES\n"
+            << "  0\nLWPOLYLINE\n  8\n0\n 90\n6\n 70\n1\n"
+            << " 10\n0\n 20\n0\n 10\n0\n 20\n15\n 10\n-40\n 20\n15\n 42\n-1\n 10\n-60\n 20\n15\n 10\n-100\n 20\n20\n 10\n-150\n 20\n20\n 10\n-150\n 20\n0\n"
+            << "  0\nLINE\n  8\nCENTRE\n 10\n0\n 20\n0\n 11\n-200\n 21\n0\n"
+            << "  0\nARC\n  8\n0\n 10\n-170\n 20\n20\n 40\n10\n 50\n0\n 51\n180\n"
+            << "  0\nENDSEC\n  0\nEOF\n";
+    }
+    const std::string files[2] = { svg_file, dxf_file };
+    for (int f = 0; f < 2; f++)
+    {
+        std::vector<float> radius;
+        DrawingReport report;
+        bool read = drawing_read(files[f], bins, radius, report);
+        bool coverage;
+        double error = drawing_error(radius, coverage);
+        bool good = read && coverage && error < tolerance && report.errors == 0;
+        std::cout << files[f] << ": " << report.entities << " entities, " << report.segments << " segments, " << report.bins_hit
+            << " bins, max error " << error << " mm, drawn bins " << (coverage ? "as expected" : "WRONG") << " " << (good ? "ok" : "FAILED") << std::endl;
+        ok = ok && good;
+    }
+    std::remove(svg_file.c_str());
+    std::remove(dxf_file.c_str());
+
+    //大图纸：流式读的速度
+    for (int f = 0; f < 2; f++)
+    {
+        long long vertices = drawing_write_large(files[f], f == 0, (long long)kilobytes * 1024);
+        std::vector<float> radius;
+        DrawingReport report;
+        bool read = drawing_read(files[f], bins, radius, report);
+        double error = 0.0;
+        for (int i = 0; i < bins; i++)
+        {
+            double z = plan_z((i + 0.5) / bins);
+            error = std::max(error, std::fabs(radius[i] * GCODE_STOCK_DIAMETER / 2.0 - (15.0 + 3.0 * std::sin(z / 7.0))));
+        }
+        bool good = read && report.bins_hit == bins && error < tolerance && report.errors == 0;
+        std::cout << files[f] << ": " << report.bytes / 1024 << " KB, " << vertices << " vertices, " << report.segments << " segments, read in "
+            << report.read_ms << " ms (" << report.bytes / 1048576.0 / (report.read_ms / 1000.0) << " MB/s), buffer "
+            << DRAWING_BUFFER / 1024 << " KB, max error " << error << " mm " << (good ? "ok" : "FAILED") << std::endl;
+        ok = ok && good;
+
+        //一次切到位，再在新的毛坯上规划
+        Simulation simulation(bins, X_SEGMENTS);
+        SimulationCommand command;
+        command.type = COMMAND_DRAWING;
+        command.value = -1;
+        command.path = files[f];
+        Clock::time_point start = Clock::now();
+        simulation.apply(command);
+        double cut_ms = elapsed_ms(start);
+        float deviation = 0.0f;
+        for (int i = 0; i < bins; i++)
+        {
+            deviation = std::max(deviation, std::fabs(simulation.workpiece.profile.radius_at((i + 0.5) / bins) - radius[i]));
+        }
+        std::cout << "  cut through COMMAND_DRAWING: " << cut_ms << " ms, max deviation " << deviation * GCODE_STOCK_DIAMETER / 2.0 << " mm "
+            << (deviation < 1e-5f ? "ok" : "FAILED") << std::endl;
+        ok = ok && deviation < 1e-5f;
+        if (f == 1)
+        {
+            Simulation planned(bins, X_SEGMENTS);
+            command.value = PLAN_AXIAL;
+            planned.apply(command);
+            std::ifstream program(drawing_program_path(files[f]).c_str());
+            std::cout << "  planned through COMMAND_DRAWING: program " << drawing_program_path(files[f]) << " " << (program ? "written" : "MISSING") << std::endl;
+            ok = ok && (bool)program;
+            program.close();
+            std::remove(drawing_program_path(files[f]).c_str());
+        }
+        std::remove(files[f].c_str());
+    }
+    std::cout << "drawing checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// a closed turned part about the y axis: `rings` rings of `segments` vertices following r(y) (steps are two rings at one y),
+// end caps fanned to a centre vertex; ring_y/ring_r give the rings
+void mesh_turned_part(int rings, int segments, TriangleMesh& mesh, std::vector<float>& ring_y, std::vector<float>& ring_r)
+{
+    mesh = TriangleMesh();
+    ring_y.clear();
+    ring_r.clear();
+    for (int k = 0; k < rings; k++)
+    {
+        float y = 4.0f * k / (rings - 1);
+        float r = y < 1.0f ? 0.3f : (y < 2.5f ? 0.5f + 0.05f * std::sin(y * 9.0f) : 0.35f + 0.1f * (y - 2.5f));
+        if (k > 0 && (ring_y.back() < 1.0f) != (y < 1.0f))
+        {
+            //台阶：同一个y上的两圈
+            ring_y.push_back(1.0f);
+            ring_r.push_back(0.3f);
+            ring_y.push_back(1.0f);
+            ring_r.push_back(0.5f + 0.05f * std::sin(9.0f));
+        }
+        ring_y.push_back(y);
+        ring_r.push_back(r);
+    }
+    const int n = (int)ring_y.size();
+    for (int k = 0; k < n; k++)
+    {
+        for (int j = 0; j < segments; j++)
+        {
+            float theta = 2.0f * PI * j / segments;
+            mesh.vertices.push_back(glm::vec3(ring_r[k] * std::cos(theta), ring_y[k], ring_r[k] * std::sin(theta)));
+        }
+    }
+    for (int k = 0; k + 1 < n; k++)
+    {
+        for (int j = 0; j < segments; j++)
+        {
+            unsigned int a = k * segments + j, b = k * segments + (j + 1) % segments;
+            unsigned int c = a + segments, d = b + segments;
+            unsigned int quad[6] = { a, c, b, b, c, d };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+    for (int end = 0; end < 2; end++)
+    {
+        unsigned int centre = (unsigned int)mesh.vertices.size();
+        int k = end == 0 ? 0 : n - 1;
+        mesh.vertices.push_back(glm::vec3(0.0f, ring_y[k], 0.0f));
+        for (int j = 0; j < segments; j++)
+        {
+            unsigned int a = k * segments + j, b = k * segments + (j + 1) % segments;
+            unsigned int fan[3] = { centre, end == 0 ? a : b, end == 0 ? b : a };
+            mesh.indices.insert(mesh.indices.end(), fan, fan + 3);
+        }
+    }
+}
+
+// the envelope of one triangle the slow way: clip it to each bin's slab (Sutherland-Hodgman) and take the farthest corner
+void mesh_triangle_clipped(const glm::vec3* corners, int bins, std::vector<float>& envelope)
+{
+    for (int i = 0; i < bins; i++)
+    {
+        std::vector<glm::vec3> polygon(corners, corners + 3), clipped;
+        for (int side = 0; side < 2; side++)
+        {
+            float plane = (float)(i + side) / bins;
+            clipped.clear();
+            for (size_t k = 0; k < polygon.size(); k++)
+            {
+                const glm::vec3& p = polygon[k];
+                const glm::vec3& q = polygon[(k + 1) % polygon.size()];
+                bool p_in = side == 0 ? p.x >= plane : p.x <= plane;
+                bool q_in = side == 0 ? q.x >= plane : q.x <= plane;
+                if (p_in)
+                {
+                    clipped.push_back(p);
+                }
+                if (p_in != q_in)
+                {
+                    clipped.push_back(p + (q - p) * ((plane - p.x) / (q.x - p.x)));
+                }
+            }
+            polygon.swap(clipped);
+        }
+        for (size_t k = 0; k < polygon.size(); k++)
+        {
+            envelope[i] = std::max(envelope[i], mesh_radius(polygon[k]));
+        }
+    }
+}
+
+// turning envelope of a mesh: random triangles against slab clipping, a turned part against its rings, 1 thread against
+// all cores (bit for bit), OBJ/STL files read back, the teapot about its best axis
+int mesh_bench(int triangles)
+{
+    const int bins = Y_SEGMENTS;
+    bool ok = true;
+    unsigned int seed = 24;
+    auto next_random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.0f; };
+
+    //随机三角形：比格子宽的、比格子窄的、竖直的
+    float worst = 0.0f;
+    for (int t = 0; t < 3000; t++)
+    {
+        glm::vec3 corners[3];
+        float width = t % 3 == 0 ? 0.5f : (t % 3 == 1 ? 0.004f : 0.0f);
+        float centre = next_random();
+        for (int k = 0; k < 3; k++)
+        {
+            corners[k] = glm::vec3(std::min(1.0f, std::max(0.0f, centre + (next_random() - 0.5f) * width)), next_random() * 2.0f - 1.0f, next_random() * 2.0f - 1.0f);
+        }
+        std::vector<float> fast(bins, MESH_NONE), slow(bins, MESH_NONE);
+        mesh_triangle(corners[0], corners[1], corners[2], bins, &fast[0]);
+        mesh_triangle_clipped(corners, bins, slow);
+        for (int i = 0; i < bins; i++)
+        {
+            worst = std::max(worst, std::fabs(fast[i] - slow[i]));
+        }
+    }
+    std::cout << "3000 random triangles against clipping to each bin: max difference " << worst << " " << (worst < 1e-5f ? "ok" : "FAILED") << std::endl;
+    ok = ok && worst < 1e-5f;
+
+    //车出来的零件：包络就是各圈的半径，格子端面上按相邻两圈线性插值
+    int segments = 256;
+    int rings = std::max(4, triangles / (2 * segments));
+    TriangleMesh mesh;
+    std::vector<float> ring_y, ring_r;
+    mesh_turned_part(rings, segments, mesh, ring_y, ring_r);
+    TurningAxis axis;
+    MeshEnvelope single = mesh_envelope(mesh, axis, bins, 1);
+    MeshEnvelope parallel = mesh_envelope(mesh, axis, bins, std::max(8, mesh_threads(0)));//单核的机器上也要合并几份包络
+    std::vector<float> expected(bins, MESH_NONE);
+    const float axial = (float)(single.scale / STOCK_LENGTH);//网格单位换成u
+    for (size_t k = 0; k < ring_y.size(); k++)
+    {
+        float u = 1.0f + (ring_y[k] - ring_y.back()) * axial;
+        int i = std::min(bins - 1, (int)std::floor(u * bins));
+        expected[i] = std::max(expected[i], ring_r[k]);
+        if (k + 1 < ring_y.size())
+        {
+            float u1 = 1.0f + (ring_y[k + 1] - ring_y.back()) * axial;
+            for (int plane = (int)std::floor(u * bins) + 1; plane <= (int)std::floor(u1 * bins) && plane < bins; plane++)
+            {
+                float r = ring_r[k] + (ring_r[k + 1] - ring_r[k]) * (((float)plane / bins - u) / (u1 - u));
+                expected[plane - 1] = std::max(expected[plane - 1], r);
+                expected[plane] = std::max(expected[plane], r);
+            }
+        }
+    }
+    float fit = (float)(single.scale * 2.0 / STOCK_DIAMETER);//网格单位换成工件半径单位
+    float difference = 0.0f;
+    for (int i = 0; i < bins; i++)
+    {
+        difference = std::max(difference, expected[i] == MESH_NONE ? std::fabs(single.radius[i] - MESH_NONE) : std::fabs(single.radius[i] - expected[i] * fit));
+    }
+    bool same = single.radius == parallel.radius;
+    std::cout << "turned part, " << mesh.triangles() << " triangles: max difference from the rings " << difference << ", turnability "
+        << single.turnability << (difference < 1e-5f && single.turnability > 0.98 && single.turnability <= 1.0 ? " ok" : " FAILED") << std::endl;
+    std::cout << "  1 thread " << single.ms << " ms, " << parallel.threads << " threads " << parallel.ms << " ms ("
+        << parallel.triangles / (parallel.ms / 1000.0) / 1e6 << " M triangles/s, " << mesh_threads(0) << " cores), same envelope: " << (same ? "yes" : "NO") << std::endl;
+    ok = ok && difference < 1e-5f && single.turnability > 0.98 && single.turnability <= 1.0 && same;
+
+    //写成文件再读回来：OBJ的四边形面、二进制和ASCII的STL
+    TriangleMesh small;
+    mesh_turned_part(40, 48, small, ring_y, ring_r);
+    MeshEnvelope reference = mesh_envelope(small, axis, bins, 1);
+    const std::string obj_file = "mesh_bench.obj", stl_file = "mesh_bench.stl", ascii_file = "mesh_bench_ascii.stl";
+    {
+        std::ofstream obj(obj_file.c_str(), std::ios::out | std::ios::trunc);
+        char text[128];
+        obj << "# turned part\no part\n";
+        for (size_t v = 0; v < small.vertices.size(); v++)
+        {
+            std::snprintf(text, sizeof(text), "v %.9g %.9g %.9g\n", small.vertices[v].x, small.vertices[v].y, small.vertices[v].z);
+            obj << text;
+        }
+        obj << "vn 0 1 0\nvt 0 0\n";
+        //两个三角形一组写成四边形，负下标
+        const long count = (long)small.vertices.size();
+        for (size_t t = 0; t + 1 < small.triangles(); t += 2)
+        {
+            const unsigned int* q = &small.indices[t * 3];
+            if (q[3] == q[2] && q[4] == q[1])
+            {
+                obj << "f " << q[0] + 1 << "/1/1 " << q[1] + 1 << "/1/1 " << q[5] + 1 << "/1/1 " << q[2] + 1 << "/1/1\n";
+            }
+            else
+            {
+                obj << "f " << (long)q[0] - count << " " << (long)q[1] - count << " " << (long)q[2] - count << "\n"
+                    << "f " << q[3] + 1 << "//1 " << q[4] + 1 << "//1 " << q[5] + 1 << "//1\n";
+            }
+        }
+        std::ofstream stl(stl_file.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+        std::ofstream ascii(ascii_file.c_str(), std::ios::out | std::ios::trunc);
+        char header[80] = "turned part";
+        uint32_t count32 = (uint32_t)small.triangles();
+        stl.write(header, 80);
+        stl.write((const char*)&count32, 4);
+        ascii << "solid part\n";
+        for (size_t t = 0; t < small.triangles(); t++)
+        {
+            float record[12] = { 0.0f };
+            ascii << "  facet normal 0 0 0\n    outer loop\n";
+            for (int k = 0; k < 3; k++)
+            {
+                const glm::vec3& v = small.vertices[small.indices[t * 3 + k]];
+                std::memcpy(&record[3 + k * 3], &v, sizeof(v));
+                std::snprintf(text, sizeof(text), "      vertex %.9g %.9g %.9g\n", v.x, v.y, v.z);
+                ascii << text;
+            }
+            ascii << "    endloop\n  endfacet\n";
+            uint16_t attribute = 0;
+            stl.write((const char*)record, 48);
+            stl.write((const char*)&attribute, 2);
+        }
+        ascii << "endsolid part\n";
+    }
+    const std::string files[3] = { obj_file, stl_file, ascii_file };
+    for (int f = 0; f < 3; f++)
+    {
+        TriangleMesh loaded;
+        Clock::time_point start = Clock::now();
+        bool read = mesh_load(files[f], loaded);
+        double read_ms = elapsed_ms(start);
+        MeshEnvelope e = mesh_envelope(loaded, axis, bins, 1);
+        float diff = 0.0f;
+        for (int i = 0; i < bins; i++)
+        {
+            diff = std::max(diff, std::fabs(e.radius[i] - reference.radius[i]));
+        }
+        bool good = read && loaded.triangles() == small.triangles() && diff < 1e-6f && std::fabs(e.volume - reference.volume) < 1e-6 * reference.volume;
+        std::cout << files[f] << ": " << loaded.triangles() << " triangles read in " << read_ms << " ms, envelope difference " << diff << " "
+            << (good ? "ok" : "FAILED") << std::endl;
+        ok = ok && good;
+        std::remove(files[f].c_str());
+    }
+
+    //仓库里的茶壶：三根轴各算一次（茶壶不是封闭的，体积和可车性只是参考）
+    TriangleMesh teapot;
+    std::ifstream probe("resources/teapot.obj");
+    if (probe && mesh_load("resources/teapot.obj", teapot))
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            TurningAxis about;
+            about.direction = glm::dvec3(0.0);
+            about.direction[k] = 1.0;
+            print_mesh_report("resources/teapot.obj", mesh_envelope(teapot, about, bins));
+        }
+    }
+    std::cout << "mesh checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// Deviation from scratch: every segment's classes, the totals and the out-of-tolerance runs by a plain scan
+struct DeviationBrute
+{
+    DeviationNode all;
+    std::vector<uint8_t> states;
+    std::vector<DeviationRange> ranges;
+};
+
+DeviationBrute deviation_brute(const Workpiece& workpiece, const std::vector<float>& target, const std::vector<float>& under, const std::vector<float>& over)
+{
+    DeviationBrute b;
+    const float mm = (float)(STOCK_DIAMETER * 0.5);
+    b.states.assign(workpiece.y_segments, DEVIATION_NONE);
+    for (int y = 0; y < workpiece.y_segments; y++)
+    {
+        if (target[y] < 0.0f)
+        {
+            continue;
+        }
+        float highest = workpiece.radius[y], lowest = workpiece.radius[y];
+        if (workpiece.field_enabled)
+        {
+            highest = 0.0f;
+            lowest = FLT_MAX;
+            for (int t = 0; t < workpiece.field.theta_segments; t++)
+            {
+                highest = std::max(highest, workpiece.field.at(y, t));
+                lowest = std::min(lowest, workpiece.field.at(y, t));
+            }
+        }
+        float o = (highest - target[y]) * mm, u = (target[y] - lowest) * mm;
+        if (o > b.all.over)
+        {
+            b.all.over = o;
+            b.all.over_bin = y;
+        }
+        if (u > b.all.under)
+        {
+            b.all.under = u;
+            b.all.under_bin = y;
+        }
+        b.states[y] = o > over[y] ? DEVIATION_OVER : (u > under[y] ? DEVIATION_UNDER : DEVIATION_IN);
+        if (b.states[y] == DEVIATION_IN)
+        {
+            continue;
+        }
+        b.all.out++;
+        if (!b.ranges.empty() && b.ranges.back().last == y - 1)
+        {
+            b.ranges.back().last = y;
+            b.ranges.back().over = std::max(b.ranges.back().over, o);
+            b.ranges.back().under = std::max(b.ranges.back().under, u);
+            continue;
+        }
+        DeviationRange r;
+        r.first = y;
+        r.last = y;
+        r.over = o;
+        r.under = u;
+        b.ranges.push_back(r);
+    }
+    return b;
+}
+
+bool deviation_same(const Deviation& deviation, const DeviationBrute& b)
+{
+    const DeviationNode& all = deviation.total();
+    bool same = all.over == b.all.over && all.under == b.all.under && all.over_bin == b.all.over_bin
+        && all.under_bin == b.all.under_bin && all.out == b.all.out;
+    for (int y = 0; y < (int)b.states.size(); y++)
+    {
+        same = same && deviation.state(y) == b.states[y];
+    }
+    std::vector<DeviationRange> ranges;
+    int count = deviation.ranges(ranges);
+    same = same && count == std::min((int)b.ranges.size(), DEVIATION_RANGE_LIMIT + 1);
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        const DeviationRange& r = b.ranges[i];
+        same = same && ranges[i].first == r.first && ranges[i].last == r.last && ranges[i].over == r.over && ranges[i].under == r.under;
+    }
+    return same;
+}
+
+// random cuts on a fine bar against a bezier target (1D and 2D): after each one the tree is updated from the dirty range,
+// compared now and then against a full scan, with a tight band over part of the bar; then a planned program run
+// through the simulation until the part is inside the band, and the classes synced into the render copy's vertices
+int deviation_bench(int cuts)
+{
+    const glm::vec2 A(-0.9f, 0.6f), B(-0.3f, -0.5f), C(0.3f, 0.9f), D(0.9f, 0.2f);
+    bool ok = true;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool field = pass == 1;
+        int count = field ? std::max(1, cuts / 10) : cuts;
+        Workpiece workpiece(field ? 1024 : 4096, field ? 128 : X_SEGMENTS);
+        workpiece.set_mesh_enabled(false);
+        if (field)
+        {
+            workpiece.set_field_enabled(true, 128);
+        }
+        std::vector<float> target;
+        plan_target_bezier(A, B, C, D, workpiece, workpiece.y_segments, target);
+        for (int y = workpiece.y_segments * 9 / 10; y < workpiece.y_segments; y++)
+        {
+            target[y] = DEVIATION_NONE_TARGET;//卡盘夹着的一段不比较
+        }
+        int n = workpiece.y_segments;
+        std::vector<float> under(n, (float)DEVIATION_TOLERANCE), over(n, (float)DEVIATION_TOLERANCE);
+        Deviation deviation;
+        deviation.set_target(workpiece, target);
+        unsigned seed = 11;
+        auto next_random = [&seed]() { seed = seed * 1103515245u + 12345u; return ((seed >> 8) % 100000) / 100000.0; };
+        double update_ms = 0.0, build_ms = 0.0, brute_ms = 0.0;
+        int checks = 0;
+        bool same = deviation_same(deviation, deviation_brute(workpiece, target, under, over));
+        for (int i = 0; i < count; i++)
+        {
+            //几个segment宽的一刀，切到这几个segment最低的目标附近：大多数在公差带里，一部分留多了或者切多了
+            double u0 = next_random() * 0.98;
+            double u1 = u0 + (1.0 + next_random() * 4.0) / n;
+            float goal = 1.0f;
+            for (int y = (int)(u0 * n); y < std::min(n, (int)std::ceil(u1 * n)); y++)
+            {
+                goal = std::min(goal, target[y] < 0.0f ? 0.8f : target[y]);
+            }
+            float distance = std::max(0.05f, goal + plan_radius((next_random() - 0.3) * 0.15));
+            if (field && i % 2)
+            {
+                double theta = next_random() * 2.0 * PI;
+                workpiece.cut_field(u0, u1, theta, theta + 0.3, distance);
+            }
+            else
+            {
+                workpiece.cut_span(u0, u1, distance);
+            }
+            if (i == count / 2)
+            {
+                //中间一段改成更紧的公差带
+                deviation.set_band(workpiece, n / 4, n / 2, 0.01, 0.02);
+                std::fill(under.begin() + n / 4, under.begin() + n / 2 + 1, 0.01f);
+                std::fill(over.begin() + n / 4, over.begin() + n / 2 + 1, 0.02f);
+            }
+            Clock::time_point start = Clock::now();
+            deviation.update(workpiece);
+            update_ms += elapsed_ms(start);
+            if (i % 25 == 0 || i == count - 1)
+            {
+                start = Clock::now();
+                DeviationBrute b = deviation_brute(workpiece, target, under, over);
+                brute_ms += elapsed_ms(start);
+                start = Clock::now();
+                Deviation rebuilt;
+                rebuilt.set_target(workpiece, target);
+                build_ms += elapsed_ms(start);
+                same = same && deviation_same(deviation, b);
+                checks++;
+            }
+        }
+        std::vector<DeviationRange> ranges;
+        int range_count = deviation.ranges(ranges);
+        std::cout << (field ? "2D field " : "profile ") << n << " segments, " << count << " cuts: update "
+            << update_ms * 1000.0 / count << " us/cut, rebuilding the tree " << build_ms * 1000.0 / checks << " us, scanning everything "
+            << brute_ms * 1000.0 / checks << " us, " << checks << " comparisons " << (same ? "ok" : "FAILED") << std::endl;
+        print_deviation_report(deviation.total(), ranges, range_count, deviation.bins());
+        //换分辨率之后目标按最近的segment取，整棵树重建
+        workpiece.set_resolution(n / 2, workpiece.x_segments);
+        deviation.update(workpiece);
+        std::vector<float> half_target(n / 2), half_under(n / 2), half_over(n / 2);
+        for (int y = 0; y < n / 2; y++)
+        {
+            half_target[y] = target[2 * y + 1];
+            half_under[y] = under[2 * y + 1];
+            half_over[y] = over[2 * y + 1];
+        }
+        bool resampled = deviation.bins() == n / 2 && deviation_same(deviation, deviation_brute(workpiece, half_target, half_under, half_over));
+        std::cout << "  after halving the resolution " << (resampled ? "ok" : "FAILED") << std::endl;
+        ok = ok && same && resampled;
+    }
+    {
+        //模拟线程（不跑线程）：规划命令设置目标，程序跑完之后整根零件都在公差带里；分类同步到渲染用的副本、写进点阵
+        const std::string program_file = "deviation_bench.nc";
+        Simulation sim(1024, X_SEGMENTS);
+        SimulationCommand command;
+        command.type = COMMAND_PLAN;
+        command.value = PLAN_CONTOUR;
+        command.path = program_file;
+        command.points[0] = A;
+        command.points[1] = B;
+        command.points[2] = C;
+        command.points[3] = D;
+        sim.post(command);
+        DeviationNode before = sim.deviation.total();
+        sim.post([](Simulation& s) { s.program.run(s.workpiece, s.cutter); });
+        sim.publish();
+        Workpiece view(1024, X_SEGMENTS);
+        bool relayout = false;
+        sim.sync(view, relayout);
+        view.update_mesh();
+        const DeviationNode& after = sim.frame().deviation_total;
+        bool inside = before.out > 0 && after.out == 0 && sim.frame().deviation_bins == 1024 && after.over <= DEVIATION_TOLERANCE && after.under <= DEVIATION_TOLERANCE;
+        bool synced = true;
+        for (int y = 0; y < view.y_segments; y++)
+        {
+            synced = synced && view.deviation[y] == sim.deviation.state(y) && view.deviation[y] == DEVIATION_IN
+                && view.all_data[y * (view.x_segments + 1)].deviation == view.deviation[y];
+        }
+        std::cout << "planned contour program: " << before.out << " segments out of tolerance before, " << after.out << " after, over "
+            << after.over << " mm, under " << after.under << " mm " << (inside ? "ok" : "FAILED") << ", synced into the vertices "
+            << (synced ? "ok" : "FAILED") << std::endl;
+        //直接切一刀bezier：不按规划走，欠差是刀尖形状切进目标的部分
+        command.type = COMMAND_BEZIER;
+        sim.post(command);
+        std::vector<DeviationRange> ranges;
+        int range_count = sim.deviation.ranges(ranges);
+        print_deviation_report(sim.deviation.total(), ranges, range_count, sim.deviation.bins());
+        ok = ok && inside && synced;
+        std::remove(program_file.c_str());
+    }
+    std::cout << "deviation checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
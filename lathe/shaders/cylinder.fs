@@ -19,10 +19,14 @@ struct Light {
 in vec3 FragPos;  
 in vec3 Normal;  
 in float isPolished;
+flat in uint deviation;
 
 uniform vec3 viewPos;
 uniform Material material;
 uniform Light light;
+// tint by the segment's deviation from the target (DEVIATION_* in deviation.h): in tolerance, over-size, under-size
+uniform bool deviation_overlay;
+const vec3 deviation_colors[3] = vec3[3](vec3(0.1, 0.8, 0.2), vec3(0.9, 0.15, 0.1), vec3(0.1, 0.3, 0.95));
 
 void main()
 {
@@ -42,6 +46,8 @@ void main()
     vec3 specular = light.specular * (spec * material.specular);  
         
     vec3 result = ambient + diffuse + specular;
+    if (deviation_overlay && deviation != 0u)
+        result = mix(result, deviation_colors[deviation - 1u] * (0.35 + diff), 0.6);
     FragColor = vec4(result, 1.0)*isPolished;
 
 } 
\ No newline at end of file
@@ -1,20 +1,109 @@
 #version 330 core
+// PackedVertex: pos normalized to the workpiece bounds, octahedral normal, surface state bits, deviation class
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in float aPolished;
+layout (location = 1) in vec2 aNormal;
+layout (location = 2) in uint aState;
+layout (location = 3) in uint aDeviation;
 
 out vec3 FragPos;
 out vec3 Normal;
 out float isPolished;
+flat out uint deviation;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 bounds;
+
+// procedural mode: no vertex buffer, everything comes from the radius profile texture and gl_VertexID
+// (drawn with the same index buffer, so gl_VertexID is the point index y * (x_segments + 1) + x)
+uniform bool procedural;
+uniform sampler1D profile;
+uniform int x_segments;
+uniform int y_segments;
+uniform float radius_k;
+uniform float length_k;
+// 2D radius field mode: texel (x, y) is the radius of segment y at angle x * 2PI / x_segments
+uniform bool field_mode;
+uniform sampler2D field;
+// deviation class of every segment (DEVIATION_* in deviation.h), uploaded next to the profile texture
+uniform usampler1D deviation_classes;
+
+const float PI = 3.14159265358979323846;
+const uint STATE_POLISHED = 1u;
+
+vec3 oct_decode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+float profile_radius(int y)
+{
+    return texelFetch(profile, y, 0).r;
+}
+
+float field_radius(int y, int x)
+{
+    x = (x + x_segments) % x_segments;
+    y = clamp(y, 0, y_segments - 1);
+    return texelFetch(field, ivec2(x, y), 0).r;
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
-    isPolished = aPolished;
+    vec3 pos = aPos * bounds;
+    vec3 normal = oct_decode(aNormal);
+    float polished = (aState & STATE_POLISHED) != 0u ? 1.0 : 0.5;
+    deviation = aDeviation;
+    if (procedural)
+    {
+        // same as Workpiece::update_ring()
+        int y = gl_VertexID / (x_segments + 1);
+        int x = gl_VertexID - y * (x_segments + 1);
+        int below = max(y - 1, 1);
+        int above = min(y + 1, y_segments - 1);
+        float dR = radius_k * (profile_radius(above) - profile_radius(below));
+        float dY = length_k * 2.0 * float(above - below) / float(y_segments);
+        float angle = float(x) / float(x_segments) * 2.0 * PI;
+        float r = radius_k * profile_radius(y);
+        pos = vec3(r * cos(angle), length_k * (2.0 * float(y) / float(y_segments) - 1.0), r * sin(angle));
+        normal = normalize(vec3(cos(angle) * dY, -dR, sin(angle) * dY));
+        if (y == 0)
+        {
+            pos.xz = vec2(0.0);
+            normal = vec3(0.0, -1.0, 0.0);
+        }
+        else if (y == y_segments)
+        {
+            pos.xz = vec2(0.0);
+            normal = vec3(0.0, 1.0, 0.0);
+        }
+        polished = profile_radius(min(y, y_segments - 1)) < 1.0 ? 1.0 : 0.5;
+        // same as Workpiece::update_ring(): the ring carries the class of the segment above it
+        deviation = texelFetch(deviation_classes, min(y, y_segments - 1), 0).r;
+        if (field_mode && y > 0 && y < y_segments)
+        {
+            // same as Workpiece::update_field_ring()
+            float c = cos(angle);
+            float s = sin(angle);
+            float fr = field_radius(y, x);
+            float dr = (field_radius(y, x + 1) - field_radius(y, x - 1)) / (2.0 * (2.0 * PI / float(x_segments)));
+            float fdR = radius_k * (field_radius(above, x) - field_radius(below, x));
+            float bx = radius_k * (dr * c - fr * s);
+            float bz = radius_k * (dr * s + fr * c);
+            vec3 n = vec3(dY * bz, fdR * s * bx - fdR * c * bz, -dY * bx);
+            if (dot(n, n) < 1e-12)
+                n = vec3(c * dY, -fdR, s * dY);
+            pos.xz = radius_k * fr * vec2(c, s);
+            normal = normalize(n);
+            polished = fr < 1.0 ? 1.0 : 0.5;
+        }
+    }
+    FragPos = vec3(model * vec4(pos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
+    isPolished = polished;
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}